@@ -5,7 +5,10 @@ extern "C" {
 }
 
 #include "Settings.h"
+// The Blynk instance is defined below, on a client that arms edgentBlockingHook
+#define NO_GLOBAL_BLYNK
 #include <BlynkSimpleEsp32_SSL.h>
+#include <frameTrace.h>
 
 #if defined(BLYNK_USE_LITTLEFS)
   #include <LittleFS.h>
@@ -37,6 +40,54 @@ extern "C" {
 
 BlynkTimer edgentTimer;
 
+// Called while Edgent is busy waiting (connecting, config mode, ...),
+// so the application can keep running (e.g. keep the lights animated)
+void (*edgentYieldHook)() = NULL;
+
+// Called to power the WiFi modem down between failed connect attempts
+// (falls back to turning WiFi off, if the application doesn't set it)
+void (*edgentRadioOffHook)() = NULL;
+
+// Called with true right before a call that may block for a long time without
+// calling app_loop() (the TCP + TLS connect to the cloud, only when Blynk actually
+// attempts one), and with false after it - the application can keep drawing from
+// another task in between (no buttons / settings: the loop is parked mid-call)
+void (*edgentBlockingHook)(bool blocking) = NULL;
+
+// WiFiClientSecure for the cloud connection - Blynk.run() only calls connect() once a connect attempt is due,
+// and the DNS lookup / TCP connect / TLS handshake then block for up to a few seconds
+class BlockingHookClient : public WiFiClientSecure {
+
+public:
+  int connect(IPAddress ip, uint16_t port) override {
+    setBlocking(true);
+    int ret = WiFiClientSecure::connect(ip, port);
+    setBlocking(false);
+    return ret;
+  }
+
+  int connect(const char* host, uint16_t port) override {
+    setBlocking(true);
+    int ret = WiFiClientSecure::connect(host, port);
+    setBlocking(false);
+    return ret;
+  }
+
+private:
+  static void setBlocking(bool blocking) {
+    if (edgentBlockingHook) {
+      edgentBlockingHook(blocking);
+    }
+  }
+};
+
+static BlockingHookClient _blynkWifiClient;
+static BlynkArduinoClientSecure<WiFiClientSecure> _blynkTransport(_blynkWifiClient);
+BlynkWifi<BlynkArduinoClientSecure<WiFiClientSecure> > Blynk(_blynkTransport);
+
+#include <connectBackoff.h>
+#include <assetStore.h>
+
 #include "BlynkState.h"
 #include "ConfigStore.h"
 #include "ResetButton.h"
@@ -96,21 +147,45 @@ class Edgent {
 public:
   void begin()
   {
-    WiFi.persistent(false);
-    WiFi.enableSTA(true); // Needed to get MAC
+    while (!beginStep()) {}
+  }
+
+  // Same as begin(), but split into short steps so the application
+  // can keep running in between. Returns true once the last step is done.
+  bool beginStep()
+  {
+    switch (beginStage++) {
+    case 0:
+      WiFi.persistent(false);
+      WiFi.enableSTA(true); // Needed to get MAC
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 0, 0))
-    WiFi.setMinSecurity(WIFI_AUTH_WEP);
+      WiFi.setMinSecurity(WIFI_AUTH_WEP);
 #endif
+      return false;
 
+    case 1:
 #ifdef BLYNK_FS
-    BLYNK_FS.begin(true);
+      BLYNK_FS.begin(true);
 #endif
-
-    indicator_init();
-    button_init();
-    config_init();
-    printDeviceBanner();
-    console_init();
+      return false;
+
+    case 2:
+      indicator_init();
+      button_init();
+      config_init();
+      edgentTimer.setInterval(WIFI_LEASE_CHECK_MS, checkWiFiLease);
+      connectBackoff::begin(&edgentRadio, (uint32_t) ESP.getEfuseMac());
+      return false;
+
+    case 3:
+      printDeviceBanner();
+      console_init();
+      return false;
+
+    default:
+      beginStage = 4;
+      break;
+    }
 
     if (configStore.getFlag(CONFIG_FLAG_VALID)) {
       BlynkState::set(MODE_CONNECTING_NET);
@@ -127,6 +202,7 @@ public:
       DEBUG_PRINT("Invalid configuration of TEMPLATE_ID / TEMPLATE_NAME");
       while (true) { delay(100); }
     }
+    return true;
   }
 
   void run() {
@@ -144,10 +220,19 @@ public:
     }
   }
 
+private:
+  uint8_t beginStage = 0;
+
 } BlynkEdgent;
 
 void app_loop() {
+    TRACE_BEGIN("edgentTimer.run");
     edgentTimer.run();
+    TRACE_END("edgentTimer.run");
     edgentConsole.run();
+    wifiScan.run();
+    if (edgentYieldHook) {
+      edgentYieldHook();
+    }
 }
 
@@ -3,10 +3,13 @@
 #include <WebServer.h>
 #include <DNSServer.h>
 #include <Update.h>
+#include <time.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
 
-#ifndef BLYNK_FS
-
-  const char* config_form = R"html(
+// Fallback pages, served if the packed (gzipped) pages aren't in flash - see tools/webAssets
+const char* config_form = R"html(
 <!DOCTYPE HTML>
 <html>
 <head>
@@ -55,14 +58,22 @@
 </html>
 )html";
 
-#endif
-
 WebServer server(80);
 DNSServer dnsServer;
 const byte DNS_PORT = 53;
 
-static int connectNetRetries    = WIFI_CLOUD_MAX_RETRIES;
-static int connectBlynkRetries  = WIFI_CLOUD_MAX_RETRIES;
+// Powers the WiFi modem down between failed connect attempts (see connectBackoff)
+class EdgentRadio : public backoffRadio {
+public:
+  void power_down() override {
+    if (edgentRadioOffHook) {
+      edgentRadioOffHook();
+    } else {
+      WiFi.disconnect(true);
+      WiFi.mode(WIFI_OFF);
+    }
+  }
+} edgentRadio;
 
 static const char serverUpdateForm[] PROGMEM =
   R"(<html><body>
@@ -162,6 +173,233 @@ String getWiFiNetworkBSSID() {
   return WiFi.BSSIDstr();
 }
 
+// Background WiFi scan, cached: the scan runs asynchronously, and the result is
+// sorted by signal strength and serialized to JSON once when it completes -
+// /wifi_scan.json and the console are served straight from the cache
+struct WiFiScanNet {
+  char              ssid[33];
+  uint8_t           bssid[6];
+  int8_t            rssi;
+  uint8_t           channel;
+  wifi_auth_mode_t  sec;
+};
+
+class WiFiScanCache {
+
+public:
+  // Start a background scan, unless one is already running
+  void request() {
+    if (scanning) return;
+    if (WiFi.scanNetworks(true, true) == WIFI_SCAN_RUNNING) {
+      scanning = true;
+      startMs = millis();
+    }
+  }
+
+  // Start a background scan if the cache is older than maxAgeMs
+  void refresh(uint32_t maxAgeMs) {
+    if (!valid || millis() - scanMs >= maxAgeMs) {
+      request();
+    }
+  }
+
+  // Collect a completed scan - called from app_loop()
+  void run() {
+    if (!scanning) return;
+    int found = WiFi.scanComplete();
+    if (found == WIFI_SCAN_RUNNING && millis() - startMs < WIFI_SCAN_TIMEOUT) return;
+
+    scanning = false;
+    if (found >= 0) {
+      collect(found);
+    }
+    WiFi.scanDelete();
+  }
+
+  // Wait for the running scan (up to WIFI_SCAN_TIMEOUT) - only needed while the cache is still empty
+  void wait() {
+    while (scanning) {
+      delay(20);
+      app_loop();
+    }
+  }
+
+  bool              isValid()    const { return valid; }
+  bool              isScanning() const { return scanning; }
+  uint32_t          ageMs()      const { return millis() - scanMs; }
+  uint8_t           count()      const { return qty; }
+  const WiFiScanNet& net(uint8_t i) const { return nets[i]; }
+  const char*       json()       const { return jsonBuff; }
+  size_t            jsonLength() const { return jsonLen; }
+
+private:
+  void collect(int found) {
+    // Insertion sort into the cache, strongest first (hidden networks are skipped)
+    qty = 0;
+    for (int i = 0; i < found; i++) {
+      const wifi_ap_record_t* ap = (const wifi_ap_record_t*) WiFi.getScanInfoByIndex(i);
+      if (!ap || !ap->ssid[0]) continue;
+      if (qty == WIFI_SCAN_MAX_NETS && ap->rssi <= nets[qty-1].rssi) continue;
+
+      uint8_t pos = (qty < WIFI_SCAN_MAX_NETS) ? qty++ : qty - 1;
+      for (; pos > 0 && nets[pos-1].rssi < ap->rssi; pos--) {
+        nets[pos] = nets[pos-1];
+      }
+      WiFiScanNet& net = nets[pos];
+      strlcpy(net.ssid, (const char*) ap->ssid, sizeof(net.ssid));
+      memcpy(net.bssid, ap->bssid, sizeof(net.bssid));
+      net.rssi = ap->rssi;
+      net.channel = ap->primary;
+      net.sec = ap->authmode;
+    }
+    DEBUG_PRINT(String("Found networks: ") + found);
+
+    serialize();
+    valid = true;
+    scanMs = millis();
+  }
+
+  void serialize() {
+    size_t len = 0;
+    jsonBuff[len++] = '[';
+    for (uint8_t i = 0; i < qty && i < WIFI_SCAN_JSON_NETS; i++) {
+      const WiFiScanNet& net = nets[i];
+      char ssid[sizeof(net.ssid) * 2];
+      escapeJson(net.ssid, ssid);
+      int n = snprintf(jsonBuff + len, sizeof(jsonBuff) - len - 3,
+        R"json(%s
+  {"ssid":"%s","bssid":"%02x:%02x:%02x:%02x:%02x:%02x","rssi":%i,"sec":"%s","ch":%i})json",
+        (i ? "," : ""), ssid,
+        net.bssid[0], net.bssid[1], net.bssid[2], net.bssid[3], net.bssid[4], net.bssid[5],
+        net.rssi, wifiSecToStr(net.sec), net.channel
+      );
+      if (n < 0 || len + n >= sizeof(jsonBuff) - 3) break;   // Out of room - leave the rest out
+      len += n;
+    }
+    if (len > 1) jsonBuff[len++] = '\n';
+    jsonBuff[len++] = ']';
+    jsonBuff[len] = '\0';
+    jsonLen = len;
+  }
+
+  template<int N>
+  static void escapeJson(const char* src, char (&dst)[N]) {
+    int len = 0;
+    for (; *src && len < N - 2; src++) {
+      if (*src == '"' || *src == '\\') dst[len++] = '\\';
+      else if ((uint8_t) *src < 0x20) continue;
+      dst[len++] = *src;
+    }
+    dst[len] = '\0';
+  }
+
+  WiFiScanNet nets[WIFI_SCAN_MAX_NETS];
+  uint8_t     qty = 0;
+  bool        valid = false;
+  bool        scanning = false;
+  uint32_t    startMs = 0;
+  uint32_t    scanMs = 0;
+  char        jsonBuff[WIFI_SCAN_JSON_NETS * 128 + 8] = "[]";
+  size_t      jsonLen = 2;
+
+} wifiScan;
+
+// Pre-gzipped web pages (tools/webAssets/pack_web.py), served from the mapped asset
+// partition or from the file system: streamed in chunks with Content-Encoding: gzip,
+// and a strong ETag so a page the browser already has is answered with a 304
+struct WebAssetETag {
+  uint32_t  pathHash;
+  uint32_t  etag;
+};
+
+WebAssetETag webAssetETags[WEB_ASSET_ETAG_QTY] = {};
+
+static
+uint32_t webAssetHash(uint32_t hash, const uint8_t* data, size_t len) {
+  // 32b FNV-1a, same as pack_web.py prints
+  while (len--) {
+    hash = (hash ^ *data++) * 16777619UL;
+  }
+  return hash;
+}
+
+// Returns false if the page isn't packed (the caller sends its fallback)
+bool serveWebAsset(const char* name, const char* contentType) {
+  char path[ASSET_NAME_LEN];
+  if (snprintf(path, sizeof(path), WEB_ASSET_DIR "%s.gz", name) >= (int) sizeof(path)) return false;
+
+  assetView mapped = assetStore::find(path);
+#ifdef BLYNK_FS
+  File file;
+  if (!mapped) {
+    file = BLYNK_FS.open(String("/") + path, "r");
+    if (!file) return false;
+  }
+#else
+  if (!mapped) return false;
+#endif
+  uint8_t buff[WEB_ASSET_CHUNK];
+
+  // The ETag is the hash of the compressed page - worked out once per boot
+  uint32_t pathHash = assetStore::hash_name(path);
+  uint32_t etag = 0;
+  uint8_t slot = 0;
+  for (; slot < WEB_ASSET_ETAG_QTY && webAssetETags[slot].pathHash; slot++) {
+    if (webAssetETags[slot].pathHash == pathHash) {
+      etag = webAssetETags[slot].etag;
+      break;
+    }
+  }
+  if (!etag) {
+    etag = 2166136261UL;
+    if (mapped) {
+      etag = webAssetHash(etag, mapped.data, mapped.len);
+    }
+#ifdef BLYNK_FS
+    else {
+      for (size_t n; (n = file.read(buff, sizeof(buff))) > 0; ) {
+        etag = webAssetHash(etag, buff, n);
+      }
+      file.seek(0);
+    }
+#endif
+    if (slot < WEB_ASSET_ETAG_QTY) {
+      webAssetETags[slot] = { pathHash, etag };
+    }
+  }
+
+  char etagStr[12];
+  snprintf(etagStr, sizeof(etagStr), "\"%08x\"", (unsigned) etag);
+  server.sendHeader("ETag", etagStr);
+  server.sendHeader("Cache-Control", "no-cache");   // Revalidate on every visit - cheap, it's a 304 while unchanged
+  if (server.header("If-None-Match") == etagStr) {
+    server.send(304);
+    return true;
+  }
+
+  // Headers first, then the page straight from flash - no copy of it is built in RAM
+  size_t len = mapped ? mapped.len : 0;
+#ifdef BLYNK_FS
+  if (!mapped) len = file.size();
+#endif
+  server.sendHeader("Content-Encoding", "gzip");
+  server.setContentLength(len);
+  server.send(200, contentType, "");
+  if (mapped) {
+    for (size_t pos = 0; pos < len; pos += WEB_ASSET_CHUNK) {
+      server.sendContent((const char*) mapped.data + pos, BlynkMin((size_t) WEB_ASSET_CHUNK, len - pos));
+    }
+  }
+#ifdef BLYNK_FS
+  else {
+    for (size_t n; (n = file.read(buff, sizeof(buff))) > 0; ) {
+      server.sendContent((const char*) buff, n);
+    }
+  }
+#endif
+  return true;
+}
+
 void enterConfigMode()
 {
   WiFi.mode(WIFI_OFF);
@@ -172,6 +410,9 @@ void enterConfigMode()
   WiFi.softAP(getWiFiName().c_str());
   delay(500);
 
+  // The app asks for the network list right away - have it ready
+  wifiScan.request();
+
   // Set up DNS Server
   dnsServer.setTTL(300); // Time-to-live 300s
   dnsServer.setErrorReplyCode(DNSReplyCode::ServerFailure); // Return code for non-accessible domains
@@ -185,7 +426,9 @@ void enterConfigMode()
 
   server.on("/update", HTTP_GET, []() {
     server.sendHeader("Connection", "close");
-    server.send(200, "text/html", serverUpdateForm);
+    if (!serveWebAsset("update.html", "text/html")) {
+      server.send(200, "text/html", serverUpdateForm);
+    }
   });
   server.on("/update", HTTP_POST, []() {
     server.sendHeader("Connection", "close");
@@ -225,11 +468,11 @@ void enterConfigMode()
       }
     }
   });
-#ifndef BLYNK_FS
   server.on("/", []() {
-    server.send(200, "text/html", config_form);
+    if (!serveWebAsset("index.html", "text/html")) {
+      server.send(200, "text/html", config_form);
+    }
   });
-#endif
   server.on("/config", []() {
     DEBUG_PRINT("Applying configuration...");
     String ssid = server.arg("ssid");
@@ -298,7 +541,7 @@ void enterConfigMode()
       }
       server.send(200, "application/json", content);
 
-      connectNetRetries = connectBlynkRetries = 1;
+      connectBackoff::start_over(1);   // Report a failure to the app right away
       BlynkState::set(MODE_SWITCH_TO_STA);
     } else {
       DEBUG_PRINT("Configuration invalid");
@@ -328,57 +571,16 @@ void enterConfigMode()
     server.send(200, "application/json", buff);
   });
   server.on("/wifi_scan.json", []() {
-    DEBUG_PRINT("Scanning networks...");
-    int wifi_nets = WiFi.scanNetworks(true, true);
-    const uint32_t t = millis();
-    while (wifi_nets < 0 &&
-           millis() - t < 20000)
-    {
-      delay(20);
-      wifi_nets = WiFi.scanComplete();
-    }
-    DEBUG_PRINT(String("Found networks: ") + wifi_nets);
-
-    if (wifi_nets > 0) {
-      // Sort networks
-      int indices[wifi_nets];
-      for (int i = 0; i < wifi_nets; i++) {
-        indices[i] = i;
-      }
-      for (int i = 0; i < wifi_nets; i++) {
-        for (int j = i + 1; j < wifi_nets; j++) {
-          if (WiFi.RSSI(indices[j]) > WiFi.RSSI(indices[i])) {
-            std::swap(indices[i], indices[j]);
-          }
-        }
-      }
-
-      wifi_nets = BlynkMin(15, wifi_nets); // Show top 15 networks
-
-      // TODO: skip empty names
-      String result = "[\n";
-
-      char buff[256];
-      for (int i = 0; i < wifi_nets; i++){
-        int id = indices[i];
-
-        snprintf(buff, sizeof(buff),
-          R"json(  {"ssid":"%s","bssid":"%s","rssi":%i,"sec":"%s","ch":%i})json",
-          WiFi.SSID(id).c_str(),
-          WiFi.BSSIDstr(id).c_str(),
-          WiFi.RSSI(id),
-          wifiSecToStr(WiFi.encryptionType(id)),
-          WiFi.channel(id)
-        );
-
-        result += buff;
-        if (i != wifi_nets-1) result += ",\n";
-      }
-      WiFi.scanDelete();
-      server.send(200, "application/json", result + "\n]");
-    } else {
-      server.send(200, "application/json", "[]");
+    // Served from the background scan - only the very first request waits for it
+    // An older list is served as it is, and refreshed for the next request (not while the credentials are being applied)
+    if (!wifiScan.isValid()) {
+      DEBUG_PRINT("Scanning networks...");
+      wifiScan.request();
+      wifiScan.wait();
+    } else if (!BlynkState::is(MODE_CONFIGURING)) {
+      wifiScan.refresh(WIFI_SCAN_REFRESH_MS);
     }
+    server.send_P(200, "application/json", wifiScan.json(), wifiScan.jsonLength());
   });
   server.on("/reset", []() {
     BlynkState::set(MODE_RESET_CONFIG);
@@ -388,11 +590,20 @@ void enterConfigMode()
     restartMCU();
   });
 
-#ifdef BLYNK_FS
-  server.serveStatic("/img/favicon.png", BLYNK_FS, "/img/favicon.png");
-  server.serveStatic("/img/logo.png", BLYNK_FS, "/img/logo.png");
-  server.serveStatic("/", BLYNK_FS, "/index.html");
-#endif
+  server.on("/img/favicon.png", []() {
+    if (!serveWebAsset("img/favicon.png", "image/png")) {
+      server.send(404);
+    }
+  });
+  server.on("/img/logo.png", []() {
+    if (!serveWebAsset("img/logo.png", "image/png")) {
+      server.send(404);
+    }
+  });
+
+  // Needed to answer revalidations with a 304
+  const char* webAssetHeaders[] = { "If-None-Match" };
+  server.collectHeaders(webAssetHeaders, 1);
 
   server.begin();
 
@@ -400,6 +611,11 @@ void enterConfigMode()
     delay(10);
     dnsServer.processNextRequest();
     server.handleClient();
+    // A scan takes the radio off the AP's channel - only keep the list fresh while nobody is connected to the AP
+    // (the app's /wifi_scan.json requests refresh it on demand then)
+    if (BlynkState::is(MODE_WAIT_CONFIG) && WiFi.softAPgetStationNum() == 0) {
+      wifiScan.refresh(WIFI_SCAN_REFRESH_MS);
+    }
     app_loop();
     if (BlynkState::is(MODE_CONFIGURING) && WiFi.softAPgetStationNum() == 0) {
       BlynkState::set(MODE_WAIT_CONFIG);
@@ -409,9 +625,178 @@ void enterConfigMode()
   server.stop();
 }
 
+// Reconnect telemetry (reported by the "wifi" console command)
+struct WiFiConnectStats {
+  uint32_t  lastConnectMs;    // Time the last connect took (from WiFi.begin to an IP)
+  bool      lastFast;         // The last connect went through the fast path
+  uint16_t  fastQty;          // Connects made on the cached BSSID / channel / lease
+  uint16_t  fullQty;          // Connects made with a full scan + DHCP
+  uint16_t  fallbackQty;      // Fast connects that failed, and fell back to a full scan
+};
+
+WiFiConnectStats wifiConnectStats = {};
+
+// The IP in use is the cached DHCP lease (DHCP was skipped, and hasn't renewed it yet)
+static bool usingCachedLease = false;
+
+// DHCP was restarted to renew the cached lease, and hasn't bound yet (see checkWiFiLease)
+static bool leaseRenewing = false;
+
+// Forget the last good connection (RAM only - the next good connection saves a new one)
+static void clearWiFiCache() {
+  configStore.setFlag(CONFIG_FLAG_WIFI_CACHE, false);
+  usingCachedLease = false;
+}
+
+// The lwIP interface of the WiFi station
+static struct netif* staNetif() {
+  esp_netif_t* sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  return sta ? (struct netif*) esp_netif_get_netif_impl(sta) : NULL;
+}
+
+// DHCP holds the address in use (bound, or renewing it)
+static bool dhcpBound() {
+  struct netif* netif = staNetif();
+  return netif && dhcp_supplied_address(netif);
+}
+
+// Wall clock time the DHCP lease in use runs out: option 51, less the time since the last ACK
+// 0 if DHCP doesn't hold the address, or the clock isn't set yet (SNTP, see WIFI_NTP_SERVER)
+// esp_netif has no getter for the lease time - lwIP's DHCP state is only read here, never changed
+static uint32_t dhcpLeaseExpiry() {
+  time_t now = time(NULL);
+  struct netif* netif = staNetif();
+  if (now < WIFI_CLOCK_VALID || !netif || !dhcp_supplied_address(netif)) {
+    return 0;
+  }
+  struct dhcp* dhcp = netif_dhcp_data(netif);
+  uint32_t usedSecs = dhcp->lease_used * DHCP_COARSE_TIMER_SECS;
+  uint32_t leftSecs = dhcp->offered_t0_lease > usedSecs ? dhcp->offered_t0_lease - usedSecs : 0;
+  uint64_t expiry = (uint64_t) now + leftSecs;   // An infinite lease is 0xFFFFFFFF s
+  return expiry > UINT32_MAX ? UINT32_MAX : (uint32_t) expiry;
+}
+
+// The cached lease has at least margin (s) left
+// The clock survives a reset and deep sleep, but not a power cut - the lease isn't reused until SNTP has set it again
+static bool cachedLeaseValid(uint32_t margin) {
+  time_t now = time(NULL);
+  return configStore.leaseExpiry && now >= WIFI_CLOCK_VALID &&
+         (uint64_t) now + margin < configStore.leaseExpiry;
+}
+
+// Remember the access point / channel / DHCP lease of the connection just made, for the next fast connect
+// Only written to flash when something changed, and only once the config is valid (it's saved then anyway)
+static void cacheWiFiConnection() {
+  ConfigStore cached = configStore;
+  memcpy(cached.wifiBSSID, WiFi.BSSID(), sizeof(cached.wifiBSSID));
+  cached.wifiChannel = WiFi.channel();
+  if (!usingCachedLease && !configStore.getFlag(CONFIG_FLAG_STATIC_IP)) {
+    // The expiry moves by up to a DHCP timer tick between checks - only a renewal (or a new lease) is saved
+    uint32_t expiry = dhcpLeaseExpiry();
+    uint32_t slack = 2 * DHCP_COARSE_TIMER_SECS;
+    if ((uint32_t) WiFi.localIP() != configStore.leaseIP) {
+      cached.leaseExpiry = expiry;   // 0 until the clock is set
+    } else if (expiry && (expiry > configStore.leaseExpiry + slack || expiry + slack < configStore.leaseExpiry)) {
+      cached.leaseExpiry = expiry;
+    }
+    cached.leaseIP = WiFi.localIP();
+    cached.leaseMask = WiFi.subnetMask();
+    cached.leaseGW = WiFi.gatewayIP();
+    cached.leaseDNS = WiFi.dnsIP(0);
+    cached.leaseDNS2 = WiFi.dnsIP(1);
+  }
+  cached.setFlag(CONFIG_FLAG_WIFI_CACHE, true);
+
+  if (memcmp(&cached, &configStore, sizeof(configStore))) {
+    configStore = cached;
+    if (configStore.getFlag(CONFIG_FLAG_VALID)) {
+      config_save();
+    }
+  }
+}
+
+// Lease bookkeeping while connected (every WIFI_LEASE_CHECK_MS): renew the cached lease before it runs out,
+// and cache the expiry once the clock is set / after a renewal
+static void checkWiFiLease() {
+  if (WiFi.status() != WL_CONNECTED || BlynkState::is(MODE_CONNECTING_NET) ||
+      !configStore.getFlag(CONFIG_FLAG_WIFI_CACHE)) {
+    return;
+  }
+  if (usingCachedLease) {
+    if (cachedLeaseValid(WIFI_LEASE_RENEW_SECS)) {
+      return;
+    }
+    // Back to DHCP through esp_netif (esp_netif_dhcpc_start): the address is dropped until DHCP binds, and
+    // IP_EVENT_STA_GOT_IP fires then - WiFi / the sockets on the old address all see the change
+    DEBUG_PRINT("Cached lease runs out, renewing with DHCP");
+    usingCachedLease = false;
+    leaseRenewing = true;
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    return;
+  }
+  if (!dhcpBound()) {
+    return;
+  }
+  if (leaseRenewing) {
+    leaseRenewing = false;
+    if ((uint32_t) WiFi.localIP() != configStore.leaseIP) {
+      // The router gave the address away: the cloud connection is bound to the old one, reconnect it now
+      // rather than waiting for the heartbeat to time out (the UDP sockets are bound to any address, and lwIP
+      // reports the multicast groups again on the new one)
+      BLYNK_LOG_IP("Lease renewed on a new address: ", WiFi.localIP());
+      Blynk.disconnect();
+    } else {
+      BLYNK_LOG_IP("Cached lease renewed: ", WiFi.localIP());
+    }
+  }
+  cacheWiFiConnection();
+}
+
+// Wait for the connection started by WiFi.begin() - returns false on timeout, or if the state was changed meanwhile (disconnected then)
+// Gives up early once the driver reports the network missing / the connect failed, so the radio isn't kept on for nothing
+// (after WIFI_FAIL_FAST_MS - a status left over from before WiFi.begin() isn't taken for the answer)
+static bool waitConnectNet(unsigned long timeout) {
+  unsigned long startMs = millis();
+  unsigned long timeoutMs = startMs + timeout;
+  while ((timeoutMs > millis()) && (WiFi.status() != WL_CONNECTED))
+  {
+    delay(10);
+    app_loop();
+
+    wl_status_t status = WiFi.status();
+    if ((status == WL_NO_SSID_AVAIL || status == WL_CONNECT_FAILED) && (millis() - startMs) > WIFI_FAIL_FAST_MS) {
+      break;
+    }
+
+    if (!BlynkState::is(MODE_CONNECTING_NET)) {
+      WiFi.disconnect();
+      return false;
+    }
+  }
+  return WiFi.status() == WL_CONNECTED;
+}
+
+// A connect attempt failed - power the radio down, and wait out the backoff in MODE_CONNECTING_NET
+// (enterConnectNet returns right away until the next attempt is due, so the application keeps running)
+static void connectFailed(int error) {
+  uint32_t waitMs = connectBackoff::failed();
+  if (connectBackoff::exhausted()) {
+    config_set_last_error(error);
+    BlynkState::set(MODE_ERROR);
+    return;
+  }
+  DEBUG_PRINT(String("Connect failed, radio off for ") + waitMs + "ms");
+  BlynkState::set(MODE_CONNECTING_NET);
+}
+
 void enterConnectNet() {
   BlynkState::set(MODE_CONNECTING_NET);
+  if (!connectBackoff::due()) {
+    return;
+  }
+  connectBackoff::attempt();
   DEBUG_PRINT(String("Connecting to WiFi: ") + configStore.wifiSSID);
+  leaseRenewing = false;
 
   // Needed for setHostname to work
   WiFi.enableSTA(false);
@@ -420,56 +805,124 @@ void enterConnectNet() {
   hostname.replace(" ", "-");
   WiFi.setHostname(hostname.c_str());
 
-  if (configStore.getFlag(CONFIG_FLAG_STATIC_IP)) {
-    if (!WiFi.config(configStore.staticIP,
-                    configStore.staticGW,
-                    configStore.staticMask,
-                    configStore.staticDNS,
-                    configStore.staticDNS2)
-    ) {
-      DEBUG_PRINT("Failed to configure Static IP");
-      config_set_last_error(BLYNK_PROV_ERR_CONFIG);
-      BlynkState::set(MODE_ERROR);
-      return;
+  unsigned long startMs = millis();
+  bool fast = configStore.getFlag(CONFIG_FLAG_WIFI_CACHE);
+  bool connected = false;
+
+  // Fast path: join the last good access point on its channel (no scan),
+  // and reuse the last DHCP lease while it's valid (no DHCP exchange)
+  if (fast) {
+    bool reuseLease = !configStore.getFlag(CONFIG_FLAG_STATIC_IP) && cachedLeaseValid(WIFI_LEASE_MARGIN);
+    bool configured;
+    if (configStore.getFlag(CONFIG_FLAG_STATIC_IP)) {
+      configured = WiFi.config(configStore.staticIP, configStore.staticGW, configStore.staticMask,
+                               configStore.staticDNS, configStore.staticDNS2);
+    } else if (reuseLease) {
+      configured = WiFi.config(configStore.leaseIP, configStore.leaseGW, configStore.leaseMask,
+                               configStore.leaseDNS, configStore.leaseDNS2);
+    } else {
+      DEBUG_PRINT("Cached lease expired (or the clock isn't set), using DHCP");
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);   // Back to DHCP
+      configured = true;
     }
-  }
 
-  WiFi.begin(configStore.wifiSSID, configStore.wifiPass);
+    if (configured) {
+      WiFi.begin(configStore.wifiSSID, configStore.wifiPass, configStore.wifiChannel, configStore.wifiBSSID);
+      connected = waitConnectNet(reuseLease || configStore.getFlag(CONFIG_FLAG_STATIC_IP) ?
+                                 WIFI_FAST_CONNECT_TIMEOUT : WIFI_FAST_DHCP_TIMEOUT);
+      if (!BlynkState::is(MODE_CONNECTING_NET)) {
+        return;
+      }
+    }
 
-  unsigned long timeoutMs = millis() + WIFI_NET_CONNECT_TIMEOUT;
-  while ((timeoutMs > millis()) && (WiFi.status() != WL_CONNECTED))
-  {
-    delay(10);
-    app_loop();
+    if (connected) {
+      usingCachedLease = reuseLease;
+    } else {
+      // Moved access point / channel, or the network is gone - scan, and get a new lease
+      DEBUG_PRINT("Fast connect failed, scanning");
+      wifiConnectStats.fallbackQty++;
+      clearWiFiCache();
+      WiFi.disconnect();
+      fast = false;
+      if (!configStore.getFlag(CONFIG_FLAG_STATIC_IP)) {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);   // Back to DHCP
+      }
+    }
+  }
 
+  if (!connected) {
+    if (configStore.getFlag(CONFIG_FLAG_STATIC_IP)) {
+      if (!WiFi.config(configStore.staticIP,
+                      configStore.staticGW,
+                      configStore.staticMask,
+                      configStore.staticDNS,
+                      configStore.staticDNS2)
+      ) {
+        DEBUG_PRINT("Failed to configure Static IP");
+        config_set_last_error(BLYNK_PROV_ERR_CONFIG);
+        BlynkState::set(MODE_ERROR);
+        return;
+      }
+    }
+
+    WiFi.begin(configStore.wifiSSID, configStore.wifiPass);
+    connected = waitConnectNet(WIFI_NET_CONNECT_TIMEOUT);
     if (!BlynkState::is(MODE_CONNECTING_NET)) {
-      WiFi.disconnect();
       return;
     }
   }
 
-  if (WiFi.status() == WL_CONNECTED) {
+  if (connected) {
     IPAddress localip = WiFi.localIP();
     if (configStore.getFlag(CONFIG_FLAG_STATIC_IP)) {
       BLYNK_LOG_IP("Using Static IP: ", localip);
+    } else if (usingCachedLease) {
+      BLYNK_LOG_IP("Using cached DHCP lease: ", localip);
     } else {
       BLYNK_LOG_IP("Using Dynamic IP: ", localip);
     }
 
-    connectNetRetries = WIFI_CLOUD_MAX_RETRIES;
+    wifiConnectStats.lastConnectMs = millis() - startMs;
+    wifiConnectStats.lastFast = fast;
+    if (fast) {
+      wifiConnectStats.fastQty++;
+    } else {
+      wifiConnectStats.fullQty++;
+    }
+    DEBUG_PRINT(String("WiFi connected in ") + wifiConnectStats.lastConnectMs + "ms" + (fast ? " (fast)" : ""));
+
+    // Wall clock for the lease expiry (SNTP keeps it set from now on)
+    static bool clockStarted = false;
+    if (!clockStarted) {
+      configTime(0, 0, WIFI_NTP_SERVER);
+      clockStarted = true;
+    }
+
+    cacheWiFiConnection();
     BlynkState::set(MODE_CONNECTING_CLOUD);
-  } else if (--connectNetRetries <= 0) {
-    config_set_last_error(BLYNK_PROV_ERR_NETWORK);
-    BlynkState::set(MODE_ERROR);
+  } else {
+    connectFailed(BLYNK_PROV_ERR_NETWORK);
   }
 }
 
+// Cloud connect telemetry (reported by the "cloud" console command)
+struct CloudConnectStats {
+  uint32_t  lastHandshakeMs;  // TCP connect + TLS handshake of the last connection
+  uint32_t  maxHandshakeMs;
+  uint32_t  totalHandshakeMs;
+  uint16_t  handshakeQty;
+  uint32_t  lastLoginMs;      // From the start of enterConnectCloud until Blynk was connected
+};
+
+CloudConnectStats cloudConnectStats = {};
+
 void enterConnectCloud() {
   BlynkState::set(MODE_CONNECTING_CLOUD);
 
   Blynk.config(configStore.cloudToken, configStore.cloudHost, configStore.cloudPort);
   Blynk.connect(0);
 
+  unsigned long startMs = millis();
   unsigned long timeoutMs = millis() + WIFI_CLOUD_CONNECT_TIMEOUT;
   while ((timeoutMs > millis()) &&
         (WiFi.status() == WL_CONNECTED) &&
@@ -477,7 +930,21 @@ void enterConnectCloud() {
         (Blynk.connected() == false))
   {
     delay(10);
+
+    // Blynk.run() connects the transport (TCP + TLS handshake) in one blocking call, once an attempt is due
+    // (the lights are kept running meanwhile, see BlockingHookClient)
+    bool transportUp = _blynkTransport.connected();
+    unsigned long runStartMs = millis();
     Blynk.run();
+    if (!transportUp && _blynkTransport.connected()) {
+      uint32_t handshakeMs = millis() - runStartMs;
+      cloudConnectStats.lastHandshakeMs = handshakeMs;
+      cloudConnectStats.maxHandshakeMs = max(cloudConnectStats.maxHandshakeMs, handshakeMs);
+      cloudConnectStats.totalHandshakeMs += handshakeMs;
+      cloudConnectStats.handshakeQty++;
+      DEBUG_PRINT(String("TLS connected in ") + handshakeMs + "ms");
+    }
+
     app_loop();
     if (!BlynkState::is(MODE_CONNECTING_CLOUD)) {
       Blynk.disconnect();
@@ -495,8 +962,9 @@ void enterConnectCloud() {
   } else if (WiFi.status() != WL_CONNECTED) {
     BlynkState::set(MODE_CONNECTING_NET);
   } else if (Blynk.connected()) {
+    cloudConnectStats.lastLoginMs = millis() - startMs;
     BlynkState::set(MODE_RUNNING);
-    connectBlynkRetries = WIFI_CLOUD_MAX_RETRIES;
+    connectBackoff::connected();
 
     if (!configStore.getFlag(CONFIG_FLAG_VALID)) {
       configStore.last_error = BLYNK_PROV_ERR_NONE;
@@ -505,9 +973,20 @@ void enterConnectCloud() {
 
       Blynk.sendInternal("meta", "set", "Hotspot Name", getWiFiName());
     }
-  } else if (--connectBlynkRetries <= 0) {
-    config_set_last_error(BLYNK_PROV_ERR_CLOUD);
-    BlynkState::set(MODE_ERROR);
+  } else if (usingCachedLease) {
+    // The reused lease may have been handed to another device since - reconnect with DHCP
+    DEBUG_PRINT("Cloud unreachable on the cached lease, renewing");
+    clearWiFiCache();
+    if (configStore.getFlag(CONFIG_FLAG_VALID)) {
+      config_save();
+    }
+    Blynk.disconnect();
+    WiFi.disconnect();
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    BlynkState::set(MODE_CONNECTING_NET);
+  } else {
+    Blynk.disconnect();
+    connectFailed(BLYNK_PROV_ERR_CLOUD);
   }
 }
 
@@ -1,6 +1,7 @@
 
 #define CONFIG_FLAG_VALID       0x01
 #define CONFIG_FLAG_STATIC_IP   0x02
+#define CONFIG_FLAG_WIFI_CACHE  0x04   // wifiBSSID / wifiChannel / lease* hold the last good connection
 
 #define BLYNK_PROV_ERR_NONE     0      // All good
 #define BLYNK_PROV_ERR_CONFIG   700    // Invalid config from app (malformed token,etc)
@@ -29,6 +30,17 @@ struct ConfigStore {
 
   int       last_error;
 
+  // Last good connection, for the fast reconnect (see enterConnectNet)
+  // Appended, so a config saved by an older firmware loads with an empty cache
+  uint8_t   wifiBSSID[6];
+  uint8_t   wifiChannel;
+  uint32_t  leaseIP;
+  uint32_t  leaseMask;
+  uint32_t  leaseGW;
+  uint32_t  leaseDNS;
+  uint32_t  leaseDNS2;
+  uint32_t  leaseExpiry;     // Wall clock (UTC s) the lease runs out (DHCP option 51), 0 = unknown - not reused then
+
   void setFlag(uint8_t mask, bool value) {
     if (value) {
       flags |= mask;
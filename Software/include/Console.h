@@ -65,6 +65,18 @@ void console_init()
     BlynkState::set(MODE_SWITCH_TO_STA);
   });
 
+  edgentConsole.addCommand("cloud", [](int argc, const char* argv[]) {
+    edgentConsole.printf(
+        "handshake:%ums max:%ums avg:%ums qty:%u login:%ums heartbeat:%us\n",
+        (unsigned) cloudConnectStats.lastHandshakeMs,
+        (unsigned) cloudConnectStats.maxHandshakeMs,
+        (unsigned) (cloudConnectStats.handshakeQty ? cloudConnectStats.totalHandshakeMs / cloudConnectStats.handshakeQty : 0),
+        cloudConnectStats.handshakeQty,
+        (unsigned) cloudConnectStats.lastLoginMs,
+        BLYNK_HEARTBEAT
+    );
+  });
+
   edgentConsole.addCommand("wifi", [](int argc, const char* argv[]) {
     if (argc < 1 || 0 == strcmp(argv[0], "show")) {
       edgentConsole.printf(
@@ -75,19 +87,46 @@ void console_init()
           getWiFiNetworkBSSID().c_str(),
           WiFi.RSSI()
       );
+      edgentConsole.printf(
+          "connect:%ums (%s) fast:%u full:%u fallback:%u cached:%s\n",
+          (unsigned) wifiConnectStats.lastConnectMs,
+          (wifiConnectStats.lastFast ? "fast" : "full"),
+          wifiConnectStats.fastQty, wifiConnectStats.fullQty, wifiConnectStats.fallbackQty,
+          (configStore.getFlag(CONFIG_FLAG_WIFI_CACHE) ? "yes" : "no")
+      );
+      edgentConsole.printf(
+          "lease: %s expires in:%ds\n",
+          (usingCachedLease ? "cached" : (dhcpBound() ? "dhcp" : "none")),
+          (configStore.leaseExpiry && time(NULL) >= WIFI_CLOCK_VALID) ?
+              (int) (configStore.leaseExpiry - time(NULL)) : -1
+      );
+      edgentConsole.printf(
+          "backoff: failures:%u retry in:%ums radio on:%ums\n",
+          connectBackoff::failure_qty(), (unsigned) connectBackoff::wait_left_ms(),
+          (unsigned) connectBackoff::radio_on_ms()
+      );
     } else if (0 == strcmp(argv[0], "scan")) {
-      int found = WiFi.scanNetworks();
-      for (int i = 0; i < found; i++) {
-        bool current = (WiFi.SSID(i) == WiFi.SSID());
+      // Print the cached scan, and refresh it in the background (run "wifi scan" again for the new one)
+      bool fresh = wifiScan.isValid() && wifiScan.ageMs() < WIFI_SCAN_REFRESH_MS;
+      if (!fresh) {
+        wifiScan.request();
+      }
+      if (!wifiScan.isValid()) {
+        edgentConsole.print("scanning...\n");
+        return;
+      }
+      String current = WiFi.SSID();
+      for (int i = 0; i < wifiScan.count(); i++) {
+        const WiFiScanNet& net = wifiScan.net(i);
         edgentConsole.printf(
             "%s %s [%s] %s ch:%d rssi:%d\n",
-            (current ? "*" : " "), WiFi.SSID(i).c_str(),
-            macToString(WiFi.BSSID(i)).c_str(),
-            wifiSecToStr(WiFi.encryptionType(i)),
-            WiFi.channel(i), WiFi.RSSI(i)
+            (current == net.ssid ? "*" : " "), net.ssid,
+            macToString((byte*) net.bssid).c_str(),
+            wifiSecToStr(net.sec),
+            net.channel, net.rssi
         );
       }
-      WiFi.scanDelete();
+      edgentConsole.printf("(%us old%s)\n", (unsigned) (wifiScan.ageMs() / 1000), (wifiScan.isScanning() ? ", refreshing" : ""));
     }
   });
 
@@ -108,9 +108,23 @@
 #define CONFIG_DEFAULT_PORT           443
 #endif
 
-#define WIFI_CLOUD_MAX_RETRIES        500
-#define WIFI_NET_CONNECT_TIMEOUT      50000
+#define WIFI_NET_CONNECT_TIMEOUT      20000   // Longest a connect attempt keeps the radio on - failed attempts back off (see lib/connectBackoff)
+#define WIFI_FAIL_FAST_MS             1000    // Earliest an attempt ends on WL_NO_SSID_AVAIL / WL_CONNECT_FAILED
+#define WIFI_FAST_CONNECT_TIMEOUT     1500    // Cached BSSID / channel / lease - falls back to a full scan after this
+#define WIFI_FAST_DHCP_TIMEOUT        5000    // Cached BSSID / channel with DHCP (the cached lease ran out) - falls back to a full scan after this
+#define WIFI_LEASE_MARGIN             600     // The cached lease is only reused with at least this long (s) left
+#define WIFI_LEASE_RENEW_SECS         300     // The cached lease is renewed with DHCP once it has less than this long (s) left
+#define WIFI_LEASE_CHECK_MS           10000   // Period of the lease bookkeeping (expiry, the renewal)
+#define WIFI_NTP_SERVER               "pool.ntp.org"  // Wall clock for the lease expiry
+#define WIFI_CLOCK_VALID              1672531200      // time() before this (2023-01-01) means the clock isn't set
 #define WIFI_CLOUD_CONNECT_TIMEOUT    50000
+#define WIFI_SCAN_REFRESH_MS          30000   // Age of the scan cache before it is refreshed in config mode (in the background while nobody is connected to the AP, on request otherwise)
+#define WIFI_SCAN_TIMEOUT             20000   // A scan that didn't finish after this is given up
+#define WIFI_SCAN_MAX_NETS            20      // Networks kept in the scan cache (strongest first)
+#define WIFI_SCAN_JSON_NETS           15      // Networks listed in /wifi_scan.json
+#define WEB_ASSET_DIR                 "www/"  // Pre-gzipped provisioning pages, in the asset partition or LittleFS (see tools/webAssets)
+#define WEB_ASSET_CHUNK               1024    // Bytes per write when streaming a page
+#define WEB_ASSET_ETAG_QTY            8       // Pages whose ETag is remembered (worked out on the first request)
 #define WIFI_AP_IP                    IPAddress(192, 168, 4, 1)
 #define WIFI_AP_Subnet                IPAddress(255, 255, 255, 0)
 //#define WIFI_CAPTIVE_PORTAL_ENABLE
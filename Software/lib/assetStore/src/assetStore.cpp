@@ -0,0 +1,203 @@
+/*
+    assetStore.h - built from 'lib_template.h'
+    This library is intended to give the light libraries read-only access to large assets
+    (palettes, lookup tables, pre-rendered animations, ...) without copying them into RAM,
+    so the heap stays free for Blynk / SSL.
+
+    See assetStore.h for the asset image layout.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <assetStore.h>
+#elif defined(__linux__)
+    /* Host build - map image files with POSIX mmap */
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+const uint8_t *assetStore::_image = NULL;
+uint32_t assetStore::_image_len = 0;
+const uint16_t *assetStore::_buckets = NULL;
+uint16_t assetStore::_bucket_qty = 0;
+const assetEntry *assetStore::_entries = NULL;
+uint16_t assetStore::_asset_qty = 0;
+#ifndef ONLINE_SIMULATION
+    spi_flash_mmap_handle_t assetStore::_mmap_handle = 0;
+    bool assetStore::_mmapped = false;
+#elif defined(__linux__)
+    void *assetStore::_mmap_addr = NULL;
+    size_t assetStore::_mmap_len = 0;
+#endif
+
+/* Open an asset image that is already in memory (or memory mapped) - returns false (and stays closed) if it is invalid */
+bool assetStore::begin(const uint8_t *image, uint32_t image_len) {
+    end();
+    return open_image(image, image_len);
+}
+
+#ifndef ONLINE_SIMULATION
+    /* Memory map the asset image in a flash partition */
+    bool assetStore::begin(const char *partition_label) {
+        end();
+
+        const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+        if (!partition) {return false;}
+
+        /* Map the whole partition into the data address space - the flash cache then serves reads directly */
+        const void *mapped = NULL;
+        if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &_mmap_handle) != ESP_OK) {return false;}
+        _mmapped = true;
+
+        if (open_image((const uint8_t *) mapped, partition->size)) {return true;}
+
+        end();
+        return false;
+    }
+#elif defined(__linux__)
+    /* Memory map an asset image file (host build) */
+    bool assetStore::begin_file(const char *path) {
+        end();
+
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {return false;}
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t) st.st_size > UINT32_MAX) {::close(fd); return false;}
+
+        void *mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {return false;}
+        _mmap_addr = mapped;
+        _mmap_len = st.st_size;
+
+        if (open_image((const uint8_t *) mapped, st.st_size)) {return true;}
+
+        end();
+        return false;
+    }
+#endif
+
+/* Close the image (and unmap it) - any views handed out before are no longer valid */
+void assetStore::end() {
+    #ifndef ONLINE_SIMULATION
+        if (_mmapped) {spi_flash_munmap(_mmap_handle); _mmapped = false;}
+    #elif defined(__linux__)
+        if (_mmap_addr) {munmap(_mmap_addr, _mmap_len); _mmap_addr = NULL;}
+    #endif
+
+    _image = NULL;
+    _image_len = 0;
+    _asset_qty = 0;
+}
+
+/* Returns true if an asset image is open */
+bool assetStore::is_open() {
+    return _image != NULL;
+}
+
+/* Look up an asset by name - the view is empty (false) if there is no such asset */
+assetView assetStore::find(const char *name) {
+    assetView view = {NULL, 0};
+    if (!_image) {return view;}
+
+    uint32_t hash = hash_name(name);
+    uint16_t mask = _bucket_qty - 1;
+
+    /* Buckets are at most half full, so an empty bucket ends the probe - it never takes more than a lap either way */
+    uint16_t bucket = hash & mask;
+    for (uint16_t step = 0; step < _bucket_qty && _buckets[bucket]; step++, bucket = (bucket + 1) & mask) {
+        const assetEntry *e = &_entries[_buckets[bucket] - 1];
+        if (e->name_hash == hash && 0 == strncmp(e->name, name, ASSET_NAME_LEN)) {
+            view.data = &_image[e->offset];
+            view.len = e->len;
+            break;
+        }
+    }
+
+    return view;
+}
+
+/* Qty of assets in the image, and access to them by index (e.g. to list them) */
+uint16_t assetStore::asset_qty() {
+    return _asset_qty;
+}
+
+const assetEntry *assetStore::entry(uint16_t idx) {
+    return (idx < _asset_qty) ? &_entries[idx] : NULL;
+}
+
+assetView assetStore::asset(uint16_t idx) {
+    assetView view = {NULL, 0};
+    if (idx < _asset_qty) {
+        view.data = &_image[_entries[idx].offset];
+        view.len = _entries[idx].len;
+    }
+
+    return view;
+}
+
+/* Size of the open image (bytes) */
+uint32_t assetStore::image_len() {
+    return _image_len;
+}
+
+/* 32b FNV-1a hash of an asset name (same as the packer) */
+uint32_t assetStore::hash_name(const char *name) {
+    uint32_t hash = 2166136261UL;
+    while (*name) {
+        hash ^= (uint8_t) *name++;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/* Validate an image and point the class at it */
+bool assetStore::open_image(const uint8_t *image, uint32_t image_len) {
+    if (!image || image_len < ASSET_HEADER_LEN) {return false;}
+    if (image[0] != ASSET_MAGIC_0 || image[1] != ASSET_MAGIC_1 || image[2] != ASSET_MAGIC_2 || image[3] != ASSET_VERSION) {return false;}
+
+    uint16_t asset_qty = image[4] | (image[5] << 8);
+    uint16_t bucket_qty = image[6] | (image[7] << 8);
+    uint32_t used_len = image[8] | (image[9] << 8) | ((uint32_t) image[10] << 16) | ((uint32_t) image[11] << 24);
+
+    /* The image may be smaller than the partition / file holding it, but never bigger */
+    if (used_len > image_len) {return false;}
+
+    /* Buckets must be a power of 2, and at most half full */
+    if (!bucket_qty || (bucket_qty & (bucket_qty - 1)) || (uint32_t) asset_qty * 2 > bucket_qty) {return false;}
+
+    uint32_t buckets_ofs = ASSET_HEADER_LEN;
+    uint32_t entries_ofs = buckets_ofs + (((uint32_t) bucket_qty * 2 + 3) & ~3UL);
+    uint32_t data_ofs = entries_ofs + (uint32_t) asset_qty * ASSET_ENTRY_LEN;
+    if (data_ofs > used_len) {return false;}
+
+    const uint16_t *buckets = (const uint16_t *) &image[buckets_ofs];
+    const assetEntry *entries = (const assetEntry *) &image[entries_ofs];
+
+    /* Exactly one bucket in use per asset - with at most half of them in use, the rest are empty (they end a lookup) */
+    uint16_t used_qty = 0;
+    for (uint16_t i = 0; i < bucket_qty; i++) {
+        if (buckets[i] > asset_qty) {return false;}
+        if (buckets[i]) {used_qty++;}
+    }
+    if (used_qty != asset_qty) {return false;}
+
+    for (uint16_t i = 0; i < asset_qty; i++) {
+        const assetEntry *e = &entries[i];
+        if (e->offset < data_ofs || e->offset > used_len || e->len > used_len - e->offset) {return false;}
+        if (e->name[ASSET_NAME_LEN - 1] != '\0') {return false;}
+    }
+
+    _image = image;
+    _image_len = used_len;
+    _buckets = buckets;
+    _bucket_qty = bucket_qty;
+    _entries = entries;
+    _asset_qty = asset_qty;
+    return true;
+}
@@ -0,0 +1,138 @@
+/*
+    assetStore.h - built from 'lib_template.h'
+    This library is intended to give the light libraries read-only access to large assets
+    (palettes, lookup tables, pre-rendered animations, ...) without copying them into RAM,
+    so the heap stays free for Blynk / SSL.
+
+    On the ghost, the whole 'assets' flash partition (see 'partitions.csv') is memory mapped
+    with esp_partition_mmap, and each asset is handed out as a pointer + length straight into
+    the mapped flash.  On a Linux host the same image file is mapped with mmap instead.
+    Use 'tools/assetStore/pack_assets.py' to build an image from a folder of files.
+
+    Asset image layout (all multi-byte values are little-endian, every section is 4 byte aligned):
+        Header (16 bytes):
+            'G' 'A' 'S' <version>
+            <asset_qty:u16> <bucket_qty:u16> <image_len:u32> <reserved:u32>
+        Buckets (bucket_qty x u16, padded to 4 bytes):
+            hash table over the asset names (open addressing, linear probing), each bucket
+            holds the asset's index + 1, or 0 if it is empty.  bucket_qty is a power of 2,
+            at least twice asset_qty, so a lookup only ever touches a few buckets.
+        Entries (asset_qty x 40 bytes):
+            <name_hash:u32> <offset:u32> <len:u32> <name[28], NUL padded>
+        Data:
+            the assets themselves, each starting on a 4 byte boundary
+
+    Names are hashed with 32b FNV-1a.  The image is fully validated when it is opened, so
+    lookups don't need to re-check offsets / lengths.
+*/
+
+#ifndef assetStore_h
+    #define assetStore_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    /* Include the flash partition API, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <esp_partition.h>
+    #endif
+
+    /* Asset image definitions */
+    #define ASSET_MAGIC_0 'G'
+    #define ASSET_MAGIC_1 'A'
+    #define ASSET_MAGIC_2 'S'
+    #define ASSET_VERSION 1
+    #define ASSET_HEADER_LEN 16
+    #define ASSET_ENTRY_LEN 40
+    #define ASSET_NAME_LEN 28                   //Including the terminating NUL
+
+    /* Default label of the flash partition holding the asset image */
+    #ifndef ASSET_PARTITION_LABEL
+        #define ASSET_PARTITION_LABEL "assets"
+    #endif
+
+    /* Read-only view of a single asset - points straight into the mapped image (no copy) */
+    struct assetView
+    {
+        const uint8_t *data;
+        uint32_t len;
+
+        /* True if the asset was found */
+        operator bool() const {return data != NULL;}
+
+        /* View the asset as a table of T (e.g. const CRGB *, const uint16_t *) */
+        template <typename T> const T *as() const {return (const T *) data;}
+        template <typename T> uint32_t count() const {return len / sizeof(T);}
+    };
+
+    /* One entry of the asset image's index */
+    struct assetEntry
+    {
+        uint32_t name_hash;
+        uint32_t offset;
+        uint32_t len;
+        char name[ASSET_NAME_LEN];
+    };
+
+    /* Class container */
+    class assetStore
+    {
+        public:
+            /* Constructor of the class */
+            /* Not currently needed to initialize anything - every member is static, so all users share the same mapped image */
+
+            /* Open an asset image that is already in memory (or memory mapped) - returns false (and stays closed) if it is invalid */
+            static bool begin(const uint8_t *image, uint32_t image_len);
+
+            #ifndef ONLINE_SIMULATION
+                /* Memory map the asset image in a flash partition */
+                static bool begin(const char *partition_label=ASSET_PARTITION_LABEL);
+            #elif defined(__linux__)
+                /* Memory map an asset image file (host build) */
+                static bool begin_file(const char *path);
+            #endif
+
+            /* Close the image (and unmap it) - any views handed out before are no longer valid */
+            static void end();
+
+            /* Returns true if an asset image is open */
+            static bool is_open();
+
+            /* Look up an asset by name - the view is empty (false) if there is no such asset */
+            static assetView find(const char *name);
+
+            /* Qty of assets in the image, and access to them by index (e.g. to list them) */
+            static uint16_t asset_qty();
+            static const assetEntry *entry(uint16_t idx);
+            static assetView asset(uint16_t idx);
+
+            /* Size of the open image (bytes) */
+            static uint32_t image_len();
+
+            /* 32b FNV-1a hash of an asset name (same as the packer) */
+            static uint32_t hash_name(const char *name);
+
+        private:
+            /* Validate an image and point the class at it */
+            static bool open_image(const uint8_t *image, uint32_t image_len);
+
+            /* Mapped image */
+            static const uint8_t *_image;
+            static uint32_t _image_len;
+
+            /* Sections of the image */
+            static const uint16_t *_buckets;
+            static uint16_t _bucket_qty;
+            static const assetEntry *_entries;
+            static uint16_t _asset_qty;
+
+            /* Mapping handles, to be released by end() */
+            #ifndef ONLINE_SIMULATION
+                static spi_flash_mmap_handle_t _mmap_handle;
+                static bool _mmapped;
+            #elif defined(__linux__)
+                static void *_mmap_addr;
+                static size_t _mmap_len;
+            #endif
+    };
+#endif
@@ -0,0 +1,315 @@
+/*
+    audioReactive.h - built from 'lib_template.h'
+    This library is intended to let the lights react to music, through an analog
+    microphone on one of the ESP32's ADC1 pins.
+
+    See audioReactive.h for the audio path and the analysis.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <audioReactive.h>
+    #include <driver/i2s.h>
+#endif
+
+/* Memory barrier between the analysis (writer) and the patterns (readers) - they run on different cores on the ESP32 */
+#ifdef __AVR__
+    #define AUDIO_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+    #define AUDIO_BARRIER() __sync_synchronize()
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *audioReactive::_lightTools = NULL;
+ledSpan audioReactive::_led_arr;
+uint16_t audioReactive::_led_qty = 0;
+uint16_t audioReactive::_led_midpoint = 0;
+int16_t audioReactive::_re[AUDIO_FFT_LEN];
+int16_t audioReactive::_im[AUDIO_FFT_LEN];
+int16_t audioReactive::_cos[AUDIO_FFT_LEN / 2];
+int16_t audioReactive::_sin[AUDIO_FFT_LEN / 2];
+int16_t audioReactive::_window[AUDIO_FFT_LEN / 2];
+bool audioReactive::_tables_ready = false;
+uint16_t audioReactive::_sample_qty = 0;
+int32_t audioReactive::_dc_q8 = 0;
+uint32_t audioReactive::_band_peak[AUDIO_BAND_QTY];
+uint32_t audioReactive::_level_peak = 0;
+uint32_t audioReactive::_bass_avg = 0;
+uint32_t audioReactive::_prev_bass = 0;
+uint32_t audioReactive::_audio_ms = 0;
+uint32_t audioReactive::_audio_ms_rem = 0;
+uint32_t audioReactive::_frame_qty = 0;
+uint32_t audioReactive::_last_frame_ms = 0;
+uint16_t audioReactive::_signal_ms = 0;
+bool audioReactive::_signal = false;
+audioSnapshot audioReactive::_snapshot;
+volatile uint32_t audioReactive::_snapshot_seq = 0;
+#ifndef ONLINE_SIMULATION
+    TaskHandle_t audioReactive::_task = NULL;
+#endif
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+audioReactive::audioReactive(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = led_qty;
+
+    /* calculate the midpoint */
+    _led_midpoint = _led_qty / 2;
+}
+
+/* Band levels drawn from the middle of the strand outwards (bass in the middle), flashing on every beat */
+void audioReactive::pulse() {
+    static audioSnapshot audio = {};
+    static uint16_t last_beat_qty = 0;
+    static uint32_t last_beat_ms = 0;
+
+    /* Keep the previous snapshot if the analysis was busy publishing a new one */
+    snapshot(&audio);
+
+    /* Flash the whole strand on a new beat, fading out over 200ms */
+    uint32_t now = GET_MILLIS();
+    if (audio.beat_qty != last_beat_qty) {
+        last_beat_qty = audio.beat_qty;
+        last_beat_ms = now;
+    }
+    uint32_t beat_age = now - last_beat_ms;
+    uint8_t flash = (beat_age < 200) ? 255 - (beat_age * 255) / 200 : 0;
+
+    /* Each band gets an equal part of each half of the strand, colored by its position in the palette */
+    for (uint16_t i = 0; i < _led_midpoint; i++) {
+        uint8_t band = ((uint32_t) i * AUDIO_BAND_QTY) / _led_midpoint;
+        CRGB color = _lightTools->palette(band * (256 / AUDIO_BAND_QTY), qadd8(audio.bands[band], flash));
+        _led_arr[_led_midpoint - 1 - i] = color;
+        _led_arr[_led_midpoint + i] = color;
+    }
+
+    /* The last light of an odd strand has no partner */
+    if (_led_qty & 1) {_led_arr[_led_qty - 1] = CRGB::Black;}
+}
+
+#ifndef ONLINE_SIMULATION
+    /* Start sampling the microphone on an ADC1 channel, and start the analysis task - returns false if the I2S driver couldn't be set up */
+    bool audioReactive::begin(adc1_channel_t channel) {
+        if (_task) {return true;}
+
+        /* The I2S peripheral drives the built-in ADC, and DMA fills the buffers */
+        i2s_config_t config = {};
+        config.mode = (i2s_mode_t) (I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+        config.sample_rate = AUDIO_SAMPLE_RATE;
+        config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+        config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+        config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+        config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+        config.dma_buf_count = 4;
+        config.dma_buf_len = AUDIO_FFT_LEN;
+
+        if (i2s_driver_install(I2S_NUM_0, &config, 0, NULL) != ESP_OK) {return false;}
+        if (i2s_set_adc_mode(ADC_UNIT_1, channel) != ESP_OK || i2s_adc_enable(I2S_NUM_0) != ESP_OK) {
+            i2s_driver_uninstall(I2S_NUM_0);
+            return false;
+        }
+
+        /* The analysis runs on the other core than the Arduino loop */
+        if (xTaskCreatePinnedToCore(audio_task, "audio", AUDIO_TASK_STACK, NULL, 1, &_task, AUDIO_TASK_CORE) != pdPASS) {
+            _task = NULL;
+            i2s_adc_disable(I2S_NUM_0);
+            i2s_driver_uninstall(I2S_NUM_0);
+            return false;
+        }
+
+        return true;
+    }
+
+    /* Audio task - waits on the I2S DMA buffers, and runs the analysis */
+    void audioReactive::audio_task(void *arg) {
+        static uint16_t raw[AUDIO_FFT_LEN];
+        static int16_t samples[AUDIO_FFT_LEN];
+
+        for (;;) {
+            size_t bytes = 0;
+            if (i2s_read(I2S_NUM_0, raw, sizeof(raw), &bytes, portMAX_DELAY) != ESP_OK) {continue;}
+
+            /* 12b ADC readings (the top 4 bits hold the channel), delivered in swapped pairs --> centered 16b samples in order */
+            uint16_t qty = (bytes / sizeof(raw[0])) & ~1;
+            for (uint16_t i = 0; i < qty; i++) {samples[i] = ((int16_t) (raw[i ^ 1] & 0x0FFF) - 2048) << 4;}
+
+            process(samples, qty);
+        }
+    }
+#endif
+
+/* Analyze a block of signed 16b samples (at AUDIO_SAMPLE_RATE) - a snapshot is published for every AUDIO_FFT_LEN samples */
+void audioReactive::process(const int16_t *samples, uint16_t qty) {
+    if (!_tables_ready) {init_tables();}
+
+    for (uint16_t i = 0; i < qty; i++) {
+        /* Remove the DC offset (mic bias) with a slow running average */
+        _dc_q8 += (((int32_t) samples[i] << 8) - _dc_q8) >> 12;
+        _re[_sample_qty++] = constrain((int32_t) samples[i] - (_dc_q8 >> 8), -32768, 32767);
+
+        if (_sample_qty == AUDIO_FFT_LEN) {
+            analyze();
+            _sample_qty = 0;
+        }
+    }
+}
+
+/* Copy the latest snapshot - returns false if the writer kept it busy (the snapshot is left unchanged then) */
+bool audioReactive::snapshot(audioSnapshot *snapshot) {
+    for (uint8_t attempt = 0; attempt < 4; attempt++) {
+        uint32_t seq = _snapshot_seq;
+        if (seq & 1) {continue;}
+
+        AUDIO_BARRIER();
+        audioSnapshot copy = _snapshot;
+        AUDIO_BARRIER();
+
+        if (_snapshot_seq == seq) {
+            *snapshot = copy;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Returns true if audio was analyzed within the last AUDIO_ACTIVE_MS, and has been above the noise floor for AUDIO_SIGNAL_MS */
+bool audioReactive::active() {
+    return _signal && _frame_qty && (GET_MILLIS() - _last_frame_ms) < AUDIO_ACTIVE_MS;
+}
+
+/* Qty of analysis frames since the start */
+uint32_t audioReactive::frame_qty() {
+    return _frame_qty;
+}
+
+/* Analyze the full window of samples */
+void audioReactive::analyze() {
+    /* Hann window, also scaling by 1/2 so no FFT stage can overflow */
+    for (uint16_t i = 0; i < AUDIO_FFT_LEN / 2; i++) {
+        _re[i] = ((int32_t) _re[i] * _window[i]) >> 16;
+        _re[AUDIO_FFT_LEN - 1 - i] = ((int32_t) _re[AUDIO_FFT_LEN - 1 - i] * _window[i]) >> 16;
+        _im[i] = _im[AUDIO_FFT_LEN - 1 - i] = 0;
+    }
+
+    fft();
+
+    /* Average magnitude per octave band (alpha max + beta min approximation of the magnitude) */
+    uint32_t bands[AUDIO_BAND_QTY];
+    uint32_t total = 0;
+    for (uint8_t band = 0; band < AUDIO_BAND_QTY; band++) {
+        uint32_t sum = 0;
+        for (uint16_t bin = 1 << band; bin < (2 << band); bin++) {
+            uint16_t re = abs(_re[bin]);
+            uint16_t im = abs(_im[bin]);
+            sum += (re > im) ? re + ((im * 3) >> 3) : im + ((re * 3) >> 3);
+        }
+        bands[band] = sum >> band;
+        total += bands[band];
+    }
+
+    /* Audio time of this frame */
+    _audio_ms_rem += AUDIO_FFT_LEN * 1000UL;
+    _audio_ms += _audio_ms_rem / AUDIO_SAMPLE_RATE;
+    _audio_ms_rem %= AUDIO_SAMPLE_RATE;
+
+    /* Signal - time the loudest band spent above the noise floor, less twice the time it didn't: audio only counts
+       once it's loud most of the time (noise from an unconnected, floating input is spread over all the bands - it's
+       above the floor about every other frame at most) */
+    const uint16_t frame_ms = max((AUDIO_FFT_LEN * 1000UL) / AUDIO_SAMPLE_RATE, 1UL);
+    uint32_t loudest = 0;
+    for (uint8_t band = 0; band < AUDIO_BAND_QTY; band++) {loudest = max(loudest, bands[band]);}
+    if (loudest > AUDIO_NOISE_FLOOR) {
+        _signal_ms = min((uint32_t) _signal_ms + frame_ms, (uint32_t) AUDIO_SIGNAL_MS);
+        if (_signal_ms == AUDIO_SIGNAL_MS) {_signal = true;}
+    } else {
+        _signal_ms -= min(_signal_ms, (uint16_t) (frame_ms * 2));
+        if (!_signal_ms) {_signal = false;}
+    }
+
+    /* Beats - an onset in the bass, well above its running average */
+    uint32_t bass = bands[0] + bands[1];
+    bool beat = bass > AUDIO_NOISE_FLOOR * 2 && bass > _prev_bass && bass * 16 > _bass_avg * AUDIO_BEAT_RATIO_Q4 &&
+                (!_snapshot.beat_qty || (_audio_ms - _snapshot.beat_ms) >= AUDIO_BEAT_MIN_MS);
+    _bass_avg = (int32_t) _bass_avg + (((int32_t) bass - (int32_t) _bass_avg) >> 5);
+    _prev_bass = bass;
+
+    /* Automatic gain - levels are relative to a slowly decaying peak (which never drops below the noise floor) */
+    audioSnapshot next = _snapshot;
+    for (uint8_t band = 0; band < AUDIO_BAND_QTY; band++) {
+        _band_peak[band] = max(max(_band_peak[band] - (_band_peak[band] >> 7), bands[band]), (uint32_t) AUDIO_NOISE_FLOOR);
+        next.bands[band] = (bands[band] * 255) / _band_peak[band];
+    }
+    _level_peak = max(max(_level_peak - (_level_peak >> 7), total), (uint32_t) AUDIO_NOISE_FLOOR * AUDIO_BAND_QTY);
+    next.level = (total * 255) / _level_peak;
+    next.audio_ms = _audio_ms;
+    if (beat) {
+        next.beat_qty++;
+        next.beat_ms = _audio_ms;
+    }
+
+    /* Publish the snapshot (odd sequence while it's being written) */
+    _snapshot_seq++;
+    AUDIO_BARRIER();
+    _snapshot = next;
+    AUDIO_BARRIER();
+    _snapshot_seq++;
+
+    _frame_qty++;
+    _last_frame_ms = GET_MILLIS();
+}
+
+/* In-place fixed-point FFT of _re / _im (each stage scales by 1/2, to never overflow) */
+void audioReactive::fft() {
+    /* Bit-reversed reordering */
+    for (uint16_t i = 1, j = 0; i < AUDIO_FFT_LEN; i++) {
+        uint16_t bit = AUDIO_FFT_LEN >> 1;
+        for (; j & bit; bit >>= 1) {j ^= bit;}
+        j ^= bit;
+
+        if (i < j) {
+            int16_t re = _re[i]; _re[i] = _re[j]; _re[j] = re;
+            int16_t im = _im[i]; _im[i] = _im[j]; _im[j] = im;
+        }
+    }
+
+    /* Radix-2 butterflies */
+    for (uint16_t len = 2; len <= AUDIO_FFT_LEN; len <<= 1) {
+        uint16_t half = len >> 1;
+        uint16_t step = AUDIO_FFT_LEN / len;
+
+        for (uint16_t start = 0; start < AUDIO_FFT_LEN; start += len) {
+            for (uint16_t k = 0; k < half; k++) {
+                int32_t wr = _cos[k * step];
+                int32_t wi = -_sin[k * step];
+                uint16_t a = start + k;
+                uint16_t b = a + half;
+
+                int32_t tr = (wr * _re[b] - wi * _im[b]) >> 15;
+                int32_t ti = (wr * _im[b] + wi * _re[b]) >> 15;
+                int32_t ar = _re[a];
+                int32_t ai = _im[a];
+
+                _re[a] = (ar + tr) >> 1;
+                _im[a] = (ai + ti) >> 1;
+                _re[b] = (ar - tr) >> 1;
+                _im[b] = (ai - ti) >> 1;
+            }
+        }
+    }
+}
+
+/* Build the twiddle / window tables */
+void audioReactive::init_tables() {
+    for (uint16_t i = 0; i < AUDIO_FFT_LEN / 2; i++) {
+        _cos[i] = lround(32767.0 * cos(2.0 * PI * i / AUDIO_FFT_LEN));
+        _sin[i] = lround(32767.0 * sin(2.0 * PI * i / AUDIO_FFT_LEN));
+        _window[i] = lround(32767.0 * (0.5 - 0.5 * cos(2.0 * PI * i / (AUDIO_FFT_LEN - 1))));
+    }
+
+    _tables_ready = true;
+}
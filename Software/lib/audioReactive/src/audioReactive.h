@@ -0,0 +1,166 @@
+/*
+    audioReactive.h - built from 'lib_template.h'
+    This library is intended to let the lights react to music, through an analog
+    microphone on one of the ESP32's ADC1 pins.
+
+    Audio path (ESP32):
+        - the I2S peripheral clocks the built-in ADC at AUDIO_SAMPLE_RATE, and DMA moves the
+          samples into a ring of DMA buffers - the CPU never polls the ADC
+        - a FreeRTOS task on core 0 (the Arduino loop / FastLED run on core 1) blocks on the
+          DMA buffers, and runs the analysis on every AUDIO_FFT_LEN samples
+        - the analysis result is published as a snapshot (levels per band, beats), which the
+          patterns read lock-free (sequence lock - the writer never waits on a reader)
+
+    Analysis (process(), also used by the host tools to analyze WAV files):
+        - DC removal + Hann window + fixed-point (Q15) radix-2 FFT
+        - AUDIO_BAND_QTY octave bands (band b = FFT bins 2^b to 2^(b+1)-1), each with an
+          automatic gain, so levels are 0-255 regardless of how loud the music is
+        - beats are onsets in the bass (the lowest two bands) - a frame louder than
+          AUDIO_BEAT_RATIO_Q4/16 times the running average, and at least AUDIO_BEAT_MIN_MS
+          after the previous beat
+*/
+
+#ifndef audioReactive_h
+    #define audioReactive_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+        #include <driver/adc.h>
+    #endif
+
+    /* Sampling / analysis configuration */
+    #ifndef AUDIO_SAMPLE_RATE
+        #define AUDIO_SAMPLE_RATE 10240             //Samples per second (40 Hz per FFT bin with a 256 point FFT)
+    #endif
+    #ifndef AUDIO_FFT_BITS
+        #ifdef __AVR__
+            #define AUDIO_FFT_BITS 4                //16 point FFT - there's no microphone on the online simulator's AVR, keep its buffers minimal
+        #else
+            #define AUDIO_FFT_BITS 8                //256 point FFT (25ms of audio per analysis frame)
+        #endif
+    #endif
+    #define AUDIO_FFT_LEN (1 << AUDIO_FFT_BITS)
+    #define AUDIO_BAND_QTY (AUDIO_FFT_BITS - 1)     //Octave bands up to half the sample rate
+
+    /* Level / beat detection tuning */
+    #ifndef AUDIO_NOISE_FLOOR
+        #define AUDIO_NOISE_FLOOR 64                //Band magnitude treated as silence (the automatic gain never goes above this)
+    #endif
+    #ifndef AUDIO_BEAT_RATIO_Q4
+        #define AUDIO_BEAT_RATIO_Q4 24              //Bass must reach 24/16 = 1.5x its running average to count as a beat
+    #endif
+    #ifndef AUDIO_BEAT_MIN_MS
+        #define AUDIO_BEAT_MIN_MS 250               //Shortest time between two beats (240 BPM)
+    #endif
+    #ifndef AUDIO_ACTIVE_MS
+        #define AUDIO_ACTIVE_MS 1000                //Audio is considered active while it was analyzed this recently
+    #endif
+    #ifndef AUDIO_SIGNAL_MS
+        #define AUDIO_SIGNAL_MS 2000                //...and once it was above the noise floor this long (net - quiet frames count down twice as fast, to 0 when the signal is lost)
+    #endif
+
+    /* Audio task (ESP32) */
+    #ifndef AUDIO_TASK_STACK
+        #define AUDIO_TASK_STACK 4096
+    #endif
+    #ifndef AUDIO_TASK_CORE
+        #define AUDIO_TASK_CORE 0
+    #endif
+
+    /* Result of the latest analysis frame */
+    struct audioSnapshot
+    {
+        uint8_t level;                      //Overall loudness (0-255, relative to the recent peak)
+        uint8_t bands[AUDIO_BAND_QTY];      //Loudness per octave band, lowest band first (0-255, relative to each band's recent peak)
+        uint16_t beat_qty;                  //Incremented on every beat - compare against the previous value to catch new beats
+        uint32_t beat_ms;                   //Audio time of the latest beat
+        uint32_t audio_ms;                  //Audio time of this analysis frame (ms of audio analyzed since the start)
+    };
+
+    /* Class container */
+    class audioReactive
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            audioReactive(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Band levels drawn from the middle of the strand outwards (bass in the middle), flashing on every beat */
+            static void pulse();
+
+            #ifndef ONLINE_SIMULATION
+                /* Start sampling the microphone on an ADC1 channel, and start the analysis task - returns false if the I2S driver couldn't be set up */
+                static bool begin(adc1_channel_t channel);
+            #endif
+
+            /* Analyze a block of signed 16b samples (at AUDIO_SAMPLE_RATE) - a snapshot is published for every AUDIO_FFT_LEN samples */
+            static void process(const int16_t *samples, uint16_t qty);
+
+            /* Copy the latest snapshot - returns false if the writer kept it busy (the snapshot is left unchanged then) */
+            static bool snapshot(audioSnapshot *snapshot);
+
+            /* Returns true if audio was analyzed within the last AUDIO_ACTIVE_MS, and has been above the noise floor for AUDIO_SIGNAL_MS */
+            static bool active();
+
+            /* Qty of analysis frames since the start */
+            static uint32_t frame_qty();
+
+        private:
+            /* Analyze the full window of samples */
+            static void analyze();
+
+            /* In-place fixed-point FFT of _re / _im (each stage scales by 1/2, to never overflow) */
+            static void fft();
+
+            /* Build the twiddle / window tables */
+            static void init_tables();
+
+            #ifndef ONLINE_SIMULATION
+                /* Audio task - waits on the I2S DMA buffers, and runs the analysis */
+                static void audio_task(void *arg);
+                static TaskHandle_t _task;
+            #endif
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Class bound (calculated) led midpoint */
+            static uint16_t _led_midpoint;
+
+            /* Analysis buffers / tables */
+            static int16_t _re[AUDIO_FFT_LEN];
+            static int16_t _im[AUDIO_FFT_LEN];
+            static int16_t _cos[AUDIO_FFT_LEN / 2];
+            static int16_t _sin[AUDIO_FFT_LEN / 2];
+            static int16_t _window[AUDIO_FFT_LEN / 2];
+            static bool _tables_ready;
+            static uint16_t _sample_qty;
+            static int32_t _dc_q8;
+
+            /* Analysis state */
+            static uint32_t _band_peak[AUDIO_BAND_QTY];
+            static uint32_t _level_peak;
+            static uint32_t _bass_avg;
+            static uint32_t _prev_bass;
+            static uint32_t _audio_ms;
+            static uint32_t _audio_ms_rem;
+            static uint32_t _frame_qty;
+            static uint32_t _last_frame_ms;
+            static uint16_t _signal_ms;
+            static bool _signal;
+
+            /* Published snapshot, guarded by a sequence lock (odd while being written) */
+            static audioSnapshot _snapshot;
+            static volatile uint32_t _snapshot_seq;
+    };
+#endif
@@ -29,7 +29,7 @@
 
 /* Initialize static class variables defined in the header file */
 lightTools *cochise::_lightTools = NULL;
-CRGB *cochise::_led_arr = NULL;
+ledSpan cochise::_led_arr;
 uint16_t cochise::_led_qty = 0;
 uint16_t cochise::_led_midpoint = 0;
 
@@ -39,7 +39,7 @@ cochise::cochise(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
     _lightTools = lightTools;
 
     /* update the class-bound pointers / variables */
-    _led_arr = led_arr;
+    _led_arr = ledSpan(led_arr, led_qty);
     _led_qty = led_qty;
 
     /* calculate the midpoint */
@@ -56,8 +56,8 @@ void cochise::red_and_green_curtain_lights_to_middle() {
     // Every 25ms we'll update the LED pattern
     EVERY_N_MILLISECONDS( 25 ) { 
         if(curtain_UpCounter < _led_midpoint) {
-            _led_arr[curtain_UpCounter++] = curtain_LightToggle ? CRGB::Green : CRGB::Red;        // As long as the LED upCounter has not reached the middle of the LED string increment and turn the next light
-            _led_arr[curtain_DownCounter--] = curtain_LightToggle ? CRGB::Green : CRGB::Red;      // Same condition as above but this walks in our LED pattern from the "farside" of the LED string in toward the middle
+            _led_arr[curtain_UpCounter++] = _lightTools->palette(curtain_LightToggle ? LIGHT_PAL(2) : LIGHT_PAL(0));        // As long as the LED upCounter has not reached the middle of the LED string increment and turn the next light
+            _led_arr[curtain_DownCounter--] = _lightTools->palette(curtain_LightToggle ? LIGHT_PAL(2) : LIGHT_PAL(0));      // Same condition as above but this walks in our LED pattern from the "farside" of the LED string in toward the middle
         } else {
             curtain_UpCounter = 0;                          // After reaching the middle we now want to start the pattern over so we send the counters back to the "far ends" of the LED string
             curtain_DownCounter = _led_qty - 1;             
@@ -72,7 +72,7 @@ void cochise::stack_lights_in_the_middle(){
     static uint16_t stack_DownCounter = _led_qty - 1;
     static uint16_t stack_LightStop = _led_midpoint;
     static uint16_t stack_pattern_count = 0;
-    static uint32_t stack_color_pattern[] = {CRGB::Red, CRGB::White, CRGB::Green, CRGB::Gold};
+    static const uint8_t stack_color_pattern[] = {LIGHT_PAL(0), LIGHT_PAL(1), LIGHT_PAL(2), LIGHT_PAL(3)};     // Red, White, Green, Gold in the christmas palette
     
     EVERY_N_MILLISECONDS(15){
         /* if LightStop is non-zero, stack towards the LightStop */
@@ -83,8 +83,8 @@ void cochise::stack_lights_in_the_middle(){
                 if (stack_DownCounter < (_led_qty - 1)) { _led_arr[stack_DownCounter + 1] = CRGB::Black;}
 
                 /* Set the current light, and move the counters towards the LightStop */
-                _led_arr[ stack_UpCounter++ ] = stack_color_pattern[stack_pattern_count];
-                _led_arr[ stack_DownCounter-- ] = stack_color_pattern[stack_pattern_count];
+                _led_arr[ stack_UpCounter++ ] = _lightTools->palette(stack_color_pattern[stack_pattern_count]);
+                _led_arr[ stack_DownCounter-- ] = _lightTools->palette(stack_color_pattern[stack_pattern_count]);
 
             } else {
                 /* Counters have reached the LightStop - move the LightStop and reset counters */
@@ -97,7 +97,7 @@ void cochise::stack_lights_in_the_middle(){
             }
         } else {
             /* LightStop has reached the begining of the strand, reset everything*/
-            fadeToBlackBy(_led_arr, _led_qty, 255);
+            fadeToBlackBy(_led_arr.data(), _led_qty, 255);
             stack_LightStop = _led_midpoint;
             stack_UpCounter = 0;
             stack_DownCounter = _led_qty - 1;
@@ -0,0 +1,105 @@
+/*
+    connectBackoff.h - built from 'lib_template.h'
+    This library is intended to pace the WiFi / cloud connect attempts while the network is
+    down (router off, out of range, ...), so the ghost doesn't burn battery retrying back to back.
+
+    See connectBackoff.h for the retry schedule.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <connectBackoff.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+backoffRadio *connectBackoff::_radio = NULL;
+uint32_t connectBackoff::_seed = 1;
+uint16_t connectBackoff::_failure_qty = 0;
+uint16_t connectBackoff::_max_attempts = BACKOFF_MAX_ATTEMPTS;
+uint32_t connectBackoff::_wait_ms = 0;
+uint32_t connectBackoff::_failed_ms = 0;
+bool connectBackoff::_attempting = false;
+uint32_t connectBackoff::_attempt_ms = 0;
+uint32_t connectBackoff::_radio_on_ms = 0;
+
+/* Start over with the radio to power down between attempts, and a seed for the jitter (e.g. the MAC address) */
+void connectBackoff::begin(backoffRadio *radio, uint32_t seed) {
+    _radio = radio;
+    _seed = seed ? seed : 1;
+    _radio_on_ms = 0;
+    _attempting = false;
+    start_over();
+}
+
+/* Reset the schedule, giving up after max_attempts failures in a row (until the next successful connection) */
+void connectBackoff::start_over(uint16_t max_attempts) {
+    _failure_qty = 0;
+    _wait_ms = 0;
+    _max_attempts = max_attempts;
+}
+
+/* Returns true once the next attempt may start (right away if nothing failed yet) */
+bool connectBackoff::due() {
+    return !_failure_qty || (millis() - _failed_ms) >= _wait_ms;
+}
+
+/* A connect attempt starts (the radio is on from now) */
+void connectBackoff::attempt() {
+    if (_attempting) {return;}
+    _attempting = true;
+    _attempt_ms = millis();
+}
+
+/* The attempt failed - powers the radio down, and schedules the next attempt - returns the wait until then (ms) */
+uint32_t connectBackoff::failed() {
+    if (_radio) {_radio->power_down();}
+    _failed_ms = millis();
+    if (_attempting) {_radio_on_ms += _failed_ms - _attempt_ms;}
+    _attempting = false;
+
+    /* BACKOFF_BASE_MS * 2^(failures - 1), capped - then anywhere from half of it to all of it */
+    if (_failure_qty < 0xFFFF) {_failure_qty++;}
+    uint32_t ceiling = BACKOFF_BASE_MS;
+    for (uint16_t failure = 1; failure < _failure_qty && ceiling < BACKOFF_MAX_MS; failure++) {ceiling *= 2;}
+    ceiling = min(ceiling, (uint32_t) BACKOFF_MAX_MS);
+    _wait_ms = ceiling / 2 + random32() % (ceiling - ceiling / 2 + 1);
+
+    return _wait_ms;
+}
+
+/* The attempt succeeded - resets the schedule (and the attempt limit back to BACKOFF_MAX_ATTEMPTS) */
+void connectBackoff::connected() {
+    _attempting = false;
+    start_over();
+}
+
+/* Returns true once the attempt limit was reached (BACKOFF_MAX_ATTEMPTS failures in a row, unless set by start_over) */
+bool connectBackoff::exhausted() {
+    return _failure_qty >= _max_attempts;
+}
+
+/* Failed attempts in a row */
+uint16_t connectBackoff::failure_qty() {
+    return _failure_qty;
+}
+
+/* Wait scheduled after the last failure (ms), and the time left of it */
+uint32_t connectBackoff::wait_ms() {
+    return _wait_ms;
+}
+uint32_t connectBackoff::wait_left_ms() {
+    return due() ? 0 : _wait_ms - (millis() - _failed_ms);
+}
+
+/* Total time the radio was on for attempts that failed (ms) */
+uint32_t connectBackoff::radio_on_ms() {
+    return _radio_on_ms;
+}
+
+/* Next value of the jitter generator (xorshift32) */
+uint32_t connectBackoff::random32() {
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    return _seed;
+}
@@ -0,0 +1,100 @@
+/*
+    connectBackoff.h - built from 'lib_template.h'
+    This library is intended to pace the WiFi / cloud connect attempts while the network is
+    down (router off, out of range, ...), so the ghost doesn't burn battery retrying back to back.
+
+    Schedule:
+        - after the n-th failed attempt in a row, the next attempt waits a random time between
+          half and all of BACKOFF_BASE_MS * 2^(n-1), capped at BACKOFF_MAX_MS - the jitter keeps
+          ghosts that lost the network at the same moment (a power cut) from retrying in lockstep
+        - the radio is powered down as soon as an attempt fails, and stays down until the next one
+        - waiting is non-blocking: due() is polled from the main loop, so the lights keep running
+        - after BACKOFF_MAX_ATTEMPTS failures in a row, exhausted() turns true (the caller gives up,
+          e.g. restarts) - a successful connection resets the schedule
+
+    The radio-on time of the failed attempts (from the start of an attempt until it failed) is
+    accounted, to check the duty cycle during an outage.
+*/
+
+#ifndef connectBackoff_h
+    #define connectBackoff_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    /* Schedule configuration */
+    #ifndef BACKOFF_BASE_MS
+        #define BACKOFF_BASE_MS 2000                    //Longest wait after the first failed attempt
+    #endif
+    #ifndef BACKOFF_MAX_MS
+        #define BACKOFF_MAX_MS 300000                   //Longest wait between two attempts (5 minutes)
+    #endif
+    #ifndef BACKOFF_MAX_ATTEMPTS
+        #define BACKOFF_MAX_ATTEMPTS 64                 //Failed attempts in a row before giving up (~4 hours at the capped wait)
+    #endif
+
+    /* Radio powered down between the attempts (the WiFi modem on the ghost, a fake driver in the host tools) */
+    class backoffRadio
+    {
+        public:
+            virtual ~backoffRadio() {}
+
+            /* Power the radio down completely (the next connect attempt powers it back up) */
+            virtual void power_down() = 0;
+    };
+
+    /* Class container */
+    class connectBackoff
+    {
+        public:
+            /* Start over with the radio to power down between attempts, and a seed for the jitter (e.g. the MAC address) */
+            static void begin(backoffRadio *radio, uint32_t seed);
+
+            /* Reset the schedule, giving up after max_attempts failures in a row (until the next successful connection) */
+            static void start_over(uint16_t max_attempts=BACKOFF_MAX_ATTEMPTS);
+
+            /* Returns true once the next attempt may start (right away if nothing failed yet) */
+            static bool due();
+
+            /* A connect attempt starts (the radio is on from now) */
+            static void attempt();
+
+            /* The attempt failed - powers the radio down, and schedules the next attempt - returns the wait until then (ms) */
+            static uint32_t failed();
+
+            /* The attempt succeeded - resets the schedule (and the attempt limit back to BACKOFF_MAX_ATTEMPTS) */
+            static void connected();
+
+            /* Returns true once the attempt limit was reached (BACKOFF_MAX_ATTEMPTS failures in a row, unless set by start_over) */
+            static bool exhausted();
+
+            /* Failed attempts in a row */
+            static uint16_t failure_qty();
+
+            /* Wait scheduled after the last failure (ms), and the time left of it */
+            static uint32_t wait_ms();
+            static uint32_t wait_left_ms();
+
+            /* Total time the radio was on for attempts that failed (ms) */
+            static uint32_t radio_on_ms();
+
+        private:
+            /* Next value of the jitter generator (xorshift32) */
+            static uint32_t random32();
+
+            /* Radio to power down between attempts */
+            static backoffRadio *_radio;
+
+            /* Schedule */
+            static uint32_t _seed;
+            static uint16_t _failure_qty;
+            static uint16_t _max_attempts;
+            static uint32_t _wait_ms;
+            static uint32_t _failed_ms;
+
+            /* Radio-on accounting */
+            static bool _attempting;
+            static uint32_t _attempt_ms;
+            static uint32_t _radio_on_ms;
+    };
+#endif
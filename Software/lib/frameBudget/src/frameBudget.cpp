@@ -0,0 +1,134 @@
+/*
+    frameBudget.cpp - built from 'lib_template.h'
+    This library is intended to keep a pattern that overruns its frame budget (e.g. a 1 ms
+    EVERY_N_MILLISECONDS blend over a long strand) from starving the rest of loop() - the
+    buttons, the Blynk keepalives, ... - by lowering the render quality step by step while the
+    render time stays over the budget, and raising it back once there's headroom again.
+
+    See frameBudget.h for the quality levels / when they change.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <frameBudget.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *frameBudget::_lightTools = NULL;
+uint32_t frameBudget::_budget_us = FRAME_BUDGET_US;
+uint8_t frameBudget::_level = FRAME_BUDGET_FULL;
+uint8_t frameBudget::_pattern_idx = 0;
+uint8_t frameBudget::_pattern_levels[FRAME_BUDGET_PATTERN_QTY];
+uint16_t frameBudget::_over_qty = 0;
+uint16_t frameBudget::_headroom_qty = 0;
+uint16_t frameBudget::_restore_frames = FRAME_BUDGET_RESTORE_FRAMES;
+uint16_t frameBudget::_since_raised_qty = UINT16_MAX;
+uint32_t frameBudget::_frame_us = 0;
+frameBudgetStats frameBudget::_stats;
+
+/* Constructor of the class - pass the lightTools class member (its blending / detail follow the quality level) */
+frameBudget::frameBudget(lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+}
+
+/* The pattern about to be rendered - switching patterns restores the level the new one settled on */
+void frameBudget::set_pattern(uint8_t pattern_idx) {
+    if (pattern_idx == _pattern_idx) {return;}
+
+    if (_pattern_idx < FRAME_BUDGET_PATTERN_QTY) {_pattern_levels[_pattern_idx] = _level;}
+    _pattern_idx = pattern_idx;
+    _over_qty = 0;
+    _headroom_qty = 0;
+    _restore_frames = FRAME_BUDGET_RESTORE_FRAMES;
+    _since_raised_qty = UINT16_MAX;
+    set_level((pattern_idx < FRAME_BUDGET_PATTERN_QTY) ? _pattern_levels[pattern_idx] : FRAME_BUDGET_FULL);
+}
+
+/* Returns true if a frame is due at now_us (always, unless the frame rate is capped) */
+bool frameBudget::frame_due(uint32_t now_us) {
+    if (_level >= FRAME_BUDGET_LOW_FPS && (now_us - _frame_us) < 1000000UL / FRAME_BUDGET_LOW_FPS_HZ) {return false;}
+
+    _frame_us = now_us;
+    return true;
+}
+
+/* Report the render time of the frame just drawn - returns -1 if the quality was lowered a level, 1 if it was raised, 0 if it stayed */
+int8_t frameBudget::report(uint32_t render_us) {
+    _stats.frame_qty++;
+    _stats.worst_us = max(_stats.worst_us, render_us);
+    if (_since_raised_qty < UINT16_MAX) {_since_raised_qty++;}
+
+    /* A raised level that held for twice the hold --> the next raise may come sooner again */
+    if (_since_raised_qty == 2 * (uint32_t) _restore_frames) {_restore_frames = max(_restore_frames / 2, FRAME_BUDGET_RESTORE_FRAMES);}
+
+    /* Over the budget of the level --> lower the quality a level, once it happened FRAME_BUDGET_OVER_FRAMES times in a row */
+    if (render_us > level_budget_us(_level)) {
+        _stats.over_qty++;
+        _headroom_qty = 0;
+        if (++_over_qty < FRAME_BUDGET_OVER_FRAMES || _level == FRAME_BUDGET_HALF_RES) {
+            _over_qty = min(_over_qty, (uint16_t) FRAME_BUDGET_OVER_FRAMES);
+            return 0;
+        }
+
+        /* The level was only just raised --> wait longer before trying it again */
+        if (_since_raised_qty <= _restore_frames) {_restore_frames = min(_restore_frames * 2, FRAME_BUDGET_RESTORE_MAX_FRAMES);}
+        _over_qty = 0;
+        set_level(_level + 1);
+        _stats.lowered_qty++;
+        return -1;
+    }
+    _over_qty = 0;
+
+    /* Well under the budget of the level above --> raise the quality a level, once the headroom held for the whole hold */
+    if (_level == FRAME_BUDGET_FULL || (uint64_t) render_us * 100 >= (uint64_t) level_budget_us(_level - 1) * FRAME_BUDGET_HEADROOM_PCT) {
+        _headroom_qty = 0;
+        return 0;
+    }
+    if (++_headroom_qty < _restore_frames) {return 0;}
+
+    _headroom_qty = 0;
+    _since_raised_qty = 0;
+    set_level(_level - 1);
+    _stats.raised_qty++;
+    return 1;
+}
+
+/* Current quality level (FRAME_BUDGET_FULL ... FRAME_BUDGET_HALF_RES), and its name */
+uint8_t frameBudget::level() {
+    return _level;
+}
+
+const char *frameBudget::level_name(uint8_t level) {
+    static const char *names[FRAME_BUDGET_LEVEL_QTY] = {"full", "low_fps", "no_blend", "half_res"};
+    return (level < FRAME_BUDGET_LEVEL_QTY) ? names[level] : "?";
+}
+
+/* Render time allowed per frame at full quality */
+uint32_t frameBudget::budget_us() {
+    return _budget_us;
+}
+
+void frameBudget::set_budget_us(uint32_t budget_us) {
+    _budget_us = budget_us;
+}
+
+/* Render time allowed per frame at a quality level (its share of loop() from low_fps on) */
+uint32_t frameBudget::level_budget_us(uint8_t level) {
+    if (level == FRAME_BUDGET_FULL) {return _budget_us;}
+
+    /* Render time x the capped frame rate against the time there is - never less than at full quality */
+    uint32_t share_us = (uint64_t) 1000000UL * FRAME_BUDGET_LOW_FPS_SHARE_PCT / (100UL * FRAME_BUDGET_LOW_FPS_HZ);
+    return max(share_us, _budget_us);
+}
+
+/* Statistics since the start */
+const frameBudgetStats &frameBudget::stats() {
+    return _stats;
+}
+
+/* Move to a quality level, and hand its blending / detail to lightTools */
+void frameBudget::set_level(uint8_t level) {
+    _level = level;
+    if (_lightTools) {_lightTools->set_quality(level < FRAME_BUDGET_NO_BLEND, (level >= FRAME_BUDGET_HALF_RES) ? 2 : 1);}
+}
@@ -0,0 +1,131 @@
+/*
+    frameBudget.h - built from 'lib_template.h'
+    This library is intended to keep a pattern that overruns its frame budget (e.g. a 1 ms
+    EVERY_N_MILLISECONDS blend over a long strand) from starving the rest of loop() - the
+    buttons, the Blynk keepalives, ... - by lowering the render quality step by step while the
+    render time stays over the budget, and raising it back once there's headroom again.
+
+    Quality levels (each one keeps the cuts of the levels before it):
+        FRAME_BUDGET_FULL       a frame every loop(), with blending, every light drawn
+        FRAME_BUDGET_LOW_FPS    at most FRAME_BUDGET_LOW_FPS_HZ frames a second - loop() gets the time in between
+        FRAME_BUDGET_NO_BLEND   no blending: fades / palette crossfades jump to their end (lightTools::blending())
+        FRAME_BUDGET_HALF_RES   half resolution: patterns working out every light on their own only draw every
+                                2nd light, lightTools::upscale() fills in the others (lightTools::detail_step())
+
+    Enforcing:
+        - at full quality a frame is over the budget if it takes longer than FRAME_BUDGET_US - from low_fps on, the
+          frame rate is capped, so a frame is judged by its share of loop(): its render time at the capped rate may take
+          FRAME_BUDGET_LOW_FPS_SHARE_PCT of the time (6.7 ms at 30 fps) - low_fps doesn't make a frame faster, only rarer
+        - the quality is lowered a level after FRAME_BUDGET_OVER_FRAMES frames in a row over the budget
+        - it is raised a level after a hold of frames in a row under FRAME_BUDGET_HEADROOM_PCT of the budget of that level -
+          the hold starts at FRAME_BUDGET_RESTORE_FRAMES, and doubles every time a raised level overran
+          again (up to FRAME_BUDGET_RESTORE_MAX_FRAMES), so a pattern on the edge doesn't flap
+        - the level is remembered per pattern: a pattern known to be slow starts out at the level it
+          settled on, instead of overrunning again every time it comes around
+*/
+
+#ifndef frameBudget_h
+    #define frameBudget_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+    #endif
+
+    /* Quality levels, from the best to the lowest */
+    #define FRAME_BUDGET_FULL 0
+    #define FRAME_BUDGET_LOW_FPS 1
+    #define FRAME_BUDGET_NO_BLEND 2
+    #define FRAME_BUDGET_HALF_RES 3
+    #define FRAME_BUDGET_LEVEL_QTY 4
+
+    /* Budget configuration */
+    #ifndef FRAME_BUDGET_US
+        #define FRAME_BUDGET_US 4000                //Render time allowed per frame
+    #endif
+    #ifndef FRAME_BUDGET_LOW_FPS_HZ
+        #define FRAME_BUDGET_LOW_FPS_HZ 30          //Frame rate cap from FRAME_BUDGET_LOW_FPS on
+    #endif
+    #ifndef FRAME_BUDGET_LOW_FPS_SHARE_PCT
+        #define FRAME_BUDGET_LOW_FPS_SHARE_PCT 20   //Share of the time a frame may take at the capped frame rate (from FRAME_BUDGET_LOW_FPS on)
+    #endif
+    #ifndef FRAME_BUDGET_OVER_FRAMES
+        #define FRAME_BUDGET_OVER_FRAMES 5          //Frames in a row over the budget before lowering the quality a level
+    #endif
+    #ifndef FRAME_BUDGET_HEADROOM_PCT
+        #define FRAME_BUDGET_HEADROOM_PCT 40        //A frame rendered in less than this share of the budget has headroom
+    #endif
+    #ifndef FRAME_BUDGET_RESTORE_FRAMES
+        #define FRAME_BUDGET_RESTORE_FRAMES 150     //Frames in a row with headroom before raising the quality a level (5 s at 30 fps)
+    #endif
+    #ifndef FRAME_BUDGET_RESTORE_MAX_FRAMES
+        #define FRAME_BUDGET_RESTORE_MAX_FRAMES 4800
+    #endif
+    #ifndef FRAME_BUDGET_PATTERN_QTY
+        #define FRAME_BUDGET_PATTERN_QTY 32         //Patterns whose level is remembered (the others start out at full quality)
+    #endif
+
+    /* Statistics since the start */
+    struct frameBudgetStats
+    {
+        uint32_t frame_qty;                         //Frames reported
+        uint32_t over_qty;                          //Frames over the budget
+        uint32_t lowered_qty;                       //Times the quality was lowered / raised a level
+        uint32_t raised_qty;
+        uint32_t worst_us;                          //Longest render time
+    };
+
+    /* Class container */
+    class frameBudget
+    {
+        public:
+            /* Constructor of the class - pass the lightTools class member (its blending / detail follow the quality level) */
+            frameBudget(lightTools *lightTools);
+
+            /* The pattern about to be rendered - switching patterns restores the level the new one settled on */
+            static void set_pattern(uint8_t pattern_idx);
+
+            /* Returns true if a frame is due at now_us (always, unless the frame rate is capped) */
+            static bool frame_due(uint32_t now_us);
+
+            /* Report the render time of the frame just drawn - returns -1 if the quality was lowered a level, 1 if it was raised, 0 if it stayed */
+            static int8_t report(uint32_t render_us);
+
+            /* Current quality level (FRAME_BUDGET_FULL ... FRAME_BUDGET_HALF_RES), and its name */
+            static uint8_t level();
+            static const char *level_name(uint8_t level);
+
+            /* Render time allowed per frame at full quality */
+            static uint32_t budget_us();
+            static void set_budget_us(uint32_t budget_us);
+
+            /* Render time allowed per frame at a quality level (its share of loop() from low_fps on) */
+            static uint32_t level_budget_us(uint8_t level);
+
+            /* Statistics since the start */
+            static const frameBudgetStats &stats();
+
+        private:
+            /* Move to a quality level, and hand its blending / detail to lightTools */
+            static void set_level(uint8_t level);
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Budget state */
+            static uint32_t _budget_us;
+            static uint8_t _level;
+            static uint8_t _pattern_idx;
+            static uint8_t _pattern_levels[FRAME_BUDGET_PATTERN_QTY];
+            static uint16_t _over_qty;                                      //Frames in a row over the budget
+            static uint16_t _headroom_qty;                                  //Frames in a row with headroom
+            static uint16_t _restore_frames;                                //Hold before raising the quality
+            static uint16_t _since_raised_qty;                              //Frames since the quality was raised (a raised level overrunning within the hold doubles it)
+            static uint32_t _frame_us;                                      //Start of the last frame (frame rate cap)
+            static frameBudgetStats _stats;
+    };
+#endif
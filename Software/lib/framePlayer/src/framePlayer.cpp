@@ -0,0 +1,276 @@
+/*
+    framePlayer.h - built from 'lib_template.h'
+    This library is intended to play back pre-rendered animations (frame sequences),
+    for effects that are easier to author as images than as code.
+
+    See framePlayer.h for the animation file layout.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <framePlayer.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *framePlayer::_lightTools = NULL;
+ledSpan framePlayer::_led_arr;
+uint16_t framePlayer::_led_qty = 0;
+frameSource *framePlayer::_source = NULL;
+uint16_t framePlayer::_anim_led_qty = 0;
+uint16_t framePlayer::_frame_qty = 0;
+uint16_t framePlayer::_frame_ms = 0;
+uint16_t framePlayer::_frame_index = 0;
+uint32_t framePlayer::_last_frame_ms = 0;
+bool framePlayer::_restart = false;
+uint8_t framePlayer::_buf[FRAME_PLAYER_BUF_LEN];
+uint16_t framePlayer::_buf_len = 0;
+uint16_t framePlayer::_buf_pos = 0;
+#ifndef ONLINE_SIMULATION
+    fileFrameSource framePlayer::_file_source;
+#endif
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+framePlayer::framePlayer(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = led_qty;
+}
+
+/* Open an animation from any frame source - returns false (and stays closed) if the header is invalid */
+bool framePlayer::open(frameSource *source) {
+    close();
+
+    uint8_t header[FRAME_PLAYER_HEADER_LEN];
+    if (!source || !source->seek(0) || source->read(header, sizeof(header)) != sizeof(header)) {return false;}
+    if (header[0] != FRAME_PLAYER_MAGIC_0 || header[1] != FRAME_PLAYER_MAGIC_1 || header[2] != FRAME_PLAYER_MAGIC_2 || header[3] != FRAME_PLAYER_VERSION) {return false;}
+
+    _anim_led_qty = header[4] | (header[5] << 8);
+    _frame_qty = header[6] | (header[7] << 8);
+    _frame_ms = header[8] | (header[9] << 8);
+    if (!_anim_led_qty || !_frame_qty || !_frame_ms) {return false;}
+
+    _source = source;
+    _restart = true;
+    return true;
+}
+
+#ifndef ONLINE_SIMULATION
+    /* Open an animation file from a file system (e.g. LittleFS) */
+    bool framePlayer::open(fs::FS &fs, const char *path) {
+        close();
+        if (!_file_source.open(fs, path)) {return false;}
+        if (open(&_file_source)) {return true;}
+
+        _file_source.close();
+        return false;
+    }
+#endif
+
+/* Start over from the first (full) frame on the next play() - call it whenever the animation (re)gains the lights, once they no longer hold its previous frame */
+void framePlayer::restart() {
+    _restart = true;
+}
+
+/* Stop playing the current animation */
+void framePlayer::close() {
+    #ifndef ONLINE_SIMULATION
+        if (_source == &_file_source) {_file_source.close();}
+    #endif
+    _source = NULL;
+}
+
+/* Returns true if an animation is open and ready to play */
+bool framePlayer::is_open() {
+    return _source != NULL;
+}
+
+/* Details of the open animation */
+uint16_t framePlayer::frame_qty() {
+    return _frame_qty;
+}
+
+uint16_t framePlayer::frame_ms() {
+    return _frame_ms;
+}
+
+/* Encode a frame as SKIP / RUN / COPY commands against the previous frame (NULL = full frame), the same way 'encode_frames.py' does - returns the encoded length, or 0 if it doesn't fit in out_len */
+uint16_t framePlayer::encode_frame(const CRGB *frame, const CRGB *previous, uint16_t led_qty, uint8_t *out, uint16_t out_len) {
+    const uint16_t max_qty = FRAME_CMD_QTY_MASK + 1;
+    uint32_t len = 0;
+    uint16_t idx = 0;
+
+    while (idx < led_qty) {
+        uint16_t end = idx;
+
+        /* Unchanged lights --> SKIP */
+        if (previous && frame[idx] == previous[idx]) {
+            while (end < led_qty && frame[end] == previous[end]) {end++;}
+            uint16_t qty = end - idx;
+            if (len + 3 > out_len) {return 0;}
+            if (qty > max_qty) {
+                out[len++] = FRAME_CMD_LONG_SKIP;
+                out[len++] = qty & 0xFF;
+                out[len++] = qty >> 8;
+            } else {
+                out[len++] = FRAME_CMD_SKIP | (qty - 1);
+            }
+            idx = end;
+            continue;
+        }
+
+        /* Several lights of the same color --> RUN */
+        while (end < led_qty && end - idx < max_qty && frame[end] == frame[idx]) {end++;}
+        if (end - idx >= 2) {
+            if (len + 4 > out_len) {return 0;}
+            out[len++] = FRAME_CMD_RUN | (end - idx - 1);
+            out[len++] = frame[idx].r;
+            out[len++] = frame[idx].g;
+            out[len++] = frame[idx].b;
+            idx = end;
+            continue;
+        }
+
+        /* Anything else --> COPY, until a run or an unchanged light starts */
+        end = idx;
+        while (end < led_qty && end - idx < max_qty) {
+            if (previous && frame[end] == previous[end]) {break;}
+            if (end + 1 < led_qty && frame[end] == frame[end + 1] && end > idx) {break;}
+            end++;
+        }
+        uint16_t qty = end - idx;
+        if (len + 1 + qty * 3 > out_len) {return 0;}
+        out[len++] = FRAME_CMD_COPY | (qty - 1);
+        for (; idx < end; idx++) {
+            out[len++] = frame[idx].r;
+            out[len++] = frame[idx].g;
+            out[len++] = frame[idx].b;
+        }
+    }
+
+    if (len + 1 > out_len) {return 0;}
+    out[len++] = FRAME_CMD_END;
+    return len;
+}
+
+/* Play the open animation, decoding the next frame when it is due (to be called from the 'main.cpp' pattern list) */
+void framePlayer::play() {
+    if (!_source) {return;}
+
+    uint32_t now = GET_MILLIS();
+
+    /* Just opened, or restart() was called --> the first (full) frame is due now */
+    if (_restart) {
+        if (!rewind()) {close(); return;}
+        _last_frame_ms = now - _frame_ms;
+        _restart = false;
+    }
+
+    /* Wait until the next frame is due */
+    if ((now - _last_frame_ms) < _frame_ms) {return;}
+
+    /* Keep a steady frame rate, but don't try to catch up if we fell more than a frame behind */
+    _last_frame_ms = ((now - _last_frame_ms) < (uint32_t) _frame_ms * 2) ? _last_frame_ms + _frame_ms : now;
+
+    /* Loop back to the start once every frame was shown */
+    if (_frame_index >= _frame_qty && !rewind()) {close(); return;}
+
+    if (!decode_frame()) {close(); return;}
+    _frame_index++;
+}
+
+/* Go back to the first frame */
+bool framePlayer::rewind() {
+    _frame_index = 0;
+    _buf_len = _buf_pos = 0;
+    return _source->seek(FRAME_PLAYER_HEADER_LEN);
+}
+
+/* Decode the next frame into the LED array - returns false if the animation data is corrupt */
+bool framePlayer::decode_frame() {
+    uint16_t pos = 0;           //Position in the animation's frame
+    uint8_t cmd;
+
+    while (read_byte(&cmd)) {
+        if (cmd == FRAME_CMD_END) {return true;}
+
+        if (cmd == FRAME_CMD_LONG_SKIP) {
+            uint8_t qty[2];
+            if (!read_bytes(qty, sizeof(qty))) {return false;}
+            pos += qty[0] | (qty[1] << 8);
+            if (pos > _anim_led_qty) {return false;}
+            continue;
+        }
+
+        uint16_t qty = (cmd & FRAME_CMD_QTY_MASK) + 1;
+        if ((uint32_t) pos + qty > _anim_led_qty) {return false;}
+
+        /* Lights beyond the end of our LED array are decoded, but not drawn */
+        uint16_t drawn = (pos >= _led_qty) ? 0 : min(qty, (uint16_t) (_led_qty - pos));
+
+        switch (cmd & ~FRAME_CMD_QTY_MASK) {
+            case FRAME_CMD_SKIP:
+                break;
+
+            case FRAME_CMD_RUN: {
+                uint8_t rgb[3];
+                if (!read_bytes(rgb, sizeof(rgb))) {return false;}
+                for (uint16_t i = 0; i < drawn; i++) {_led_arr[pos + i] = CRGB(rgb[0], rgb[1], rgb[2]);}
+                break;
+            }
+
+            case FRAME_CMD_COPY:
+                /* CRGB is stored as R,G,B bytes --> copy straight from the read buffer into the LED array */
+                if (!read_bytes((uint8_t *) (_led_arr.data() + pos), drawn * 3) || !skip_bytes((qty - drawn) * 3)) {return false;}
+                break;
+
+            default:
+                return false;
+        }
+
+        pos += qty;
+    }
+
+    return false;
+}
+
+/* Buffered reads from the frame source */
+bool framePlayer::read_byte(uint8_t *value) {
+    if (_buf_pos >= _buf_len) {
+        _buf_len = _source->read(_buf, sizeof(_buf));
+        _buf_pos = 0;
+        if (!_buf_len) {return false;}
+    }
+
+    *value = _buf[_buf_pos++];
+    return true;
+}
+
+bool framePlayer::read_bytes(uint8_t *dst, uint16_t len) {
+    while (len) {
+        if (_buf_pos >= _buf_len) {
+            _buf_len = _source->read(_buf, sizeof(_buf));
+            _buf_pos = 0;
+            if (!_buf_len) {return false;}
+        }
+
+        uint16_t chunk = min(len, (uint16_t) (_buf_len - _buf_pos));
+        memcpy(dst, &_buf[_buf_pos], chunk);
+        _buf_pos += chunk;
+        dst += chunk;
+        len -= chunk;
+    }
+
+    return true;
+}
+
+bool framePlayer::skip_bytes(uint16_t len) {
+    uint8_t value;
+    while (len--) {
+        if (!read_byte(&value)) {return false;}
+    }
+
+    return true;
+}
@@ -0,0 +1,196 @@
+/*
+    framePlayer.h - built from 'lib_template.h'
+    This library is intended to play back pre-rendered animations (frame sequences),
+    for effects that are easier to author as images than as code (e.g. a GIF made in
+    'Rainbow_GIF_editor.pptm').
+
+    Animations are streamed from flash (a LittleFS file, or any other frameSource) and
+    decoded directly into the LED array - only a small read buffer is used, the file is
+    never loaded into RAM.  Use 'tools/framePlayer/encode_frames.py' to convert a GIF or a
+    PNG sequence into this format.
+
+    Animation file layout (".gfa", all multi-byte values are little-endian):
+        Header (16 bytes):
+            'G' 'F' 'A' <version>
+            <led_qty:u16> <frame_qty:u16> <frame_ms:u16> <reserved:u16> <reserved:u32>
+        Frames (frame_qty of them, back to back), each a list of commands ended by 0xFF:
+            0x00-0x3F   SKIP  n+1               the next n+1 lights are unchanged from the previous frame
+            0x40-0x7F   RUN   n+1  R G B        the next n+1 lights are set to one color
+            0x80-0xBF   COPY  n+1  (R G B)*n+1  the next n+1 lights are set one by one
+            0xFE        LONG SKIP  <qty:u16>    the next qty lights are unchanged
+            0xFF        end of frame
+
+    Every frame after the first is a delta against the frame before it (the LED array itself
+    holds the previous frame), so the first frame must not use SKIP.  Playback restarts at the
+    first frame whenever the animation loops, or restart() was called (the owner of the LED
+    array calls it whenever something else drew over the animation's lights meanwhile).
+*/
+
+#ifndef framePlayer_h
+    #define framePlayer_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+        #include <FS.h>
+    #endif
+
+    /* Animation file definitions */
+    #define FRAME_PLAYER_MAGIC_0 'G'
+    #define FRAME_PLAYER_MAGIC_1 'F'
+    #define FRAME_PLAYER_MAGIC_2 'A'
+    #define FRAME_PLAYER_VERSION 1
+    #define FRAME_PLAYER_HEADER_LEN 16
+
+    /* Frame commands */
+    #define FRAME_CMD_SKIP 0x00
+    #define FRAME_CMD_RUN 0x40
+    #define FRAME_CMD_COPY 0x80
+    #define FRAME_CMD_QTY_MASK 0x3F
+    #define FRAME_CMD_LONG_SKIP 0xFE
+    #define FRAME_CMD_END 0xFF
+
+    /* Size of the read buffer between flash and the decoder */
+    #ifndef FRAME_PLAYER_BUF_LEN
+        #ifdef __AVR__
+            #define FRAME_PLAYER_BUF_LEN 16         //Any size works (the reads are chunked) - keeps the online simulator's AVR within its RAM
+        #else
+            #define FRAME_PLAYER_BUF_LEN 256
+        #endif
+    #endif
+
+    /* Source of animation bytes (file, memory, ...) */
+    class frameSource
+    {
+        public:
+            virtual ~frameSource() {}
+
+            /* Read up to 'len' bytes into 'buf', returning the qty actually read (0 at the end of the source) */
+            virtual size_t read(uint8_t *buf, size_t len) = 0;
+
+            /* Move to an absolute byte position in the source */
+            virtual bool seek(uint32_t pos) = 0;
+    };
+
+    /* Animation held in memory (or memory mapped flash) */
+    class memoryFrameSource : public frameSource
+    {
+        public:
+            memoryFrameSource(const uint8_t *data=NULL, uint32_t len=0) : _data(data), _len(len), _pos(0) {}
+
+            size_t read(uint8_t *buf, size_t len) {
+                if (len > _len - _pos) {len = _len - _pos;}
+                memcpy(buf, &_data[_pos], len);
+                _pos += len;
+                return len;
+            }
+
+            bool seek(uint32_t pos) {
+                if (pos > _len) {return false;}
+                _pos = pos;
+                return true;
+            }
+
+        private:
+            const uint8_t *_data;
+            uint32_t _len;
+            uint32_t _pos;
+    };
+
+    #ifndef ONLINE_SIMULATION
+        /* Animation stored as a file (LittleFS / SPIFFS / SD) */
+        class fileFrameSource : public frameSource
+        {
+            public:
+                fileFrameSource() {}
+                bool open(fs::FS &fs, const char *path) {_file = fs.open(path, "r"); return (bool) _file;}
+                void close() {if (_file) {_file.close();}}
+                size_t read(uint8_t *buf, size_t len) {return _file.read(buf, len);}
+                bool seek(uint32_t pos) {return _file.seek(pos);}
+
+            private:
+                fs::File _file;
+        };
+    #endif
+
+    /* Class container */
+    class framePlayer
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            framePlayer(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Play the open animation, decoding the next frame when it is due (to be called from the 'main.cpp' pattern list) */
+            static void play();
+
+            /* Open an animation from any frame source - returns false (and stays closed) if the header is invalid */
+            static bool open(frameSource *source);
+
+            #ifndef ONLINE_SIMULATION
+                /* Open an animation file from a file system (e.g. LittleFS) */
+                static bool open(fs::FS &fs, const char *path);
+            #endif
+
+            /* Start over from the first (full) frame on the next play() - call it whenever the animation (re)gains the lights, once they no longer hold its previous frame */
+            static void restart();
+
+            /* Stop playing the current animation */
+            static void close();
+
+            /* Returns true if an animation is open and ready to play */
+            static bool is_open();
+
+            /* Details of the open animation */
+            static uint16_t frame_qty();
+            static uint16_t frame_ms();
+
+            /* Encode a frame as SKIP / RUN / COPY commands against the previous frame (NULL = full frame), the same way 'encode_frames.py' does - returns the encoded length, or 0 if it doesn't fit in out_len */
+            static uint16_t encode_frame(const CRGB *frame, const CRGB *previous, uint16_t led_qty, uint8_t *out, uint16_t out_len);
+
+        private:
+            /* Decode the next frame into the LED array - returns false if the animation data is corrupt */
+            static bool decode_frame();
+
+            /* Go back to the first frame */
+            static bool rewind();
+
+            /* Buffered reads from the frame source */
+            static bool read_byte(uint8_t *value);
+            static bool read_bytes(uint8_t *dst, uint16_t len);
+            static bool skip_bytes(uint16_t len);
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Animation being played */
+            static frameSource *_source;
+            static uint16_t _anim_led_qty;
+            static uint16_t _frame_qty;
+            static uint16_t _frame_ms;
+            static uint16_t _frame_index;
+
+            /* Playback timing */
+            static uint32_t _last_frame_ms;
+            static bool _restart;
+
+            /* Read buffer */
+            static uint8_t _buf[FRAME_PLAYER_BUF_LEN];
+            static uint16_t _buf_len;
+            static uint16_t _buf_pos;
+
+            #ifndef ONLINE_SIMULATION
+                /* Class bound file source, used by open(fs, path) */
+                static fileFrameSource _file_source;
+            #endif
+    };
+#endif
@@ -0,0 +1,186 @@
+/*
+    frameStream.cpp - built from 'lib_template.h'
+    This library is intended to stream the lights over the serial port in a compact binary
+    form, mixed in with the usual log text - for a live preview / capture of the real device on
+    a host ('tools/host/serial_view.cpp'), with the time every frame was drawn and the time it
+    took to render.
+
+    See frameStream.h for the framing / packet format.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <frameStream.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *frameStream::_lightTools = NULL;
+ledSpan frameStream::_led_arr;
+uint16_t frameStream::_led_qty = 0;
+frameSink *frameStream::_sink = NULL;
+bool frameStream::_raw = false;
+uint16_t frameStream::_seq = 0;
+uint16_t frameStream::_ref = 0;
+uint8_t frameStream::_since_key = FRAME_STREAM_KEY_INTERVAL;
+frameStreamStats frameStream::_stats = {};
+CRGB frameStream::_prev[FRAME_STREAM_MAX_LEDS];
+uint8_t frameStream::_packet[FRAME_STREAM_PACKET_LEN];
+uint8_t frameStream::_out[FRAME_STREAM_OUT_LEN];
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+frameStream::frameStream(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = led_qty;
+}
+
+/* Start streaming to a sink - raw = send every frame uncompressed (no delta / RLE) */
+void frameStream::begin(frameSink *sink, bool raw) {
+    _sink = sink;
+    _raw = raw;
+    _since_key = FRAME_STREAM_KEY_INTERVAL;
+}
+
+/* Stop streaming */
+void frameStream::end() {
+    _sink = NULL;
+}
+
+/* Returns true while streaming */
+bool frameStream::is_open() {
+    return _sink != NULL;
+}
+
+/* Returns true if the frames are sent uncompressed */
+bool frameStream::raw() {
+    return _raw;
+}
+
+/* Send the lights as they are now (call it after the frame was drawn) - returns false if the frame was skipped */
+bool frameStream::send(uint32_t time_us, uint32_t render_us) {
+    if (!_sink) {return false;}
+    uint16_t seq = _seq++;
+
+    /* Not even an unchanged frame would fit - don't bother encoding */
+    if (_sink->room() < FRAME_STREAM_MIN_OUT_LEN) {
+        _stats.skipped_qty++;
+        return false;
+    }
+
+    /* Data first (its length goes in the header) */
+    uint16_t led_qty = min(_led_qty, (uint16_t) FRAME_STREAM_MAX_LEDS);
+    bool key = _raw || _since_key >= FRAME_STREAM_KEY_INTERVAL;
+    uint8_t *data = &_packet[FRAME_STREAM_HEADER_LEN];
+    uint16_t len = led_qty * 3;
+    if (_raw) {
+        memcpy(data, _led_arr.data(), len);
+    } else {
+        len = framePlayer::encode_frame(_led_arr.data(), key ? NULL : _prev, led_qty, data, FRAME_STREAM_DATA_LEN);
+        if (!len) {return false;}
+    }
+
+    uint8_t flags = (_raw ? FRAME_STREAM_RAW : 0) | (key ? FRAME_STREAM_KEY : 0);
+    uint16_t ref = key ? seq : _ref;
+    _packet[0] = FRAME_STREAM_TYPE_FRAME;
+    _packet[1] = flags;
+    _packet[2] = seq & 0xFF;
+    _packet[3] = seq >> 8;
+    _packet[4] = ref & 0xFF;
+    _packet[5] = ref >> 8;
+    for (uint8_t byte = 0; byte < 4; byte++) {
+        _packet[6 + byte] = time_us >> (8 * byte);
+        _packet[10 + byte] = render_us >> (8 * byte);
+    }
+    _packet[14] = led_qty & 0xFF;
+    _packet[15] = led_qty >> 8;
+    len += FRAME_STREAM_HEADER_LEN;
+    uint16_t crc = crc16(_packet, len);
+    _packet[len++] = crc & 0xFF;
+    _packet[len++] = crc >> 8;
+
+    /* Frame it between two delimiters - sent whole, or not at all */
+    _out[0] = 0x00;
+    uint16_t out_len = cobs_encode(_packet, len, &_out[1]) + 1;
+    _out[out_len++] = 0x00;
+    if (_sink->room() < out_len) {
+        _stats.skipped_qty++;
+        return false;
+    }
+    _stats.byte_qty += _sink->write(_out, out_len);
+
+    /* The frame sent is the reference of the next delta */
+    if (!_raw) {memcpy(_prev, _led_arr.data(), led_qty * sizeof(CRGB));}
+    _ref = seq;
+    _since_key = key ? 1 : _since_key + 1;
+    _stats.frame_qty++;
+    if (key) {_stats.key_qty++;}
+    return true;
+}
+
+/* Stream statistics */
+const frameStreamStats &frameStream::stats() {
+    return _stats;
+}
+
+/* COBS encode len bytes (the output holds no 0x00) - returns the encoded length (at most FRAME_STREAM_COBS_LEN(len)) */
+uint16_t frameStream::cobs_encode(const uint8_t *data, uint16_t len, uint8_t *out) {
+    uint16_t code_pos = 0;
+    uint16_t out_pos = 1;
+    uint8_t code = 1;
+
+    for (uint16_t pos = 0; pos < len; pos++) {
+        if (data[pos]) {
+            out[out_pos++] = data[pos];
+            code++;
+        }
+
+        /* A 0x00 ends a block, and so does a block of 254 bytes */
+        if (!data[pos] || code == 0xFF) {
+            out[code_pos] = code;
+            code = 1;
+            code_pos = out_pos++;
+        }
+    }
+    out[code_pos] = code;
+
+    return out_pos;
+}
+
+/* COBS decode (without the delimiters) - returns the decoded length, or -1 if the data isn't valid COBS / doesn't fit out_len */
+int32_t frameStream::cobs_decode(const uint8_t *data, uint16_t len, uint8_t *out, uint16_t out_len) {
+    uint16_t pos = 0;
+    uint16_t out_pos = 0;
+
+    while (pos < len) {
+        uint8_t code = data[pos++];
+        if (!code || pos + code - 1 > len || out_pos + code > out_len + 1) {return -1;}
+
+        for (uint8_t byte = 1; byte < code; byte++) {
+            if (!data[pos]) {return -1;}
+            out[out_pos++] = data[pos++];
+        }
+
+        /* Every block but a full one (or the last) stood in front of a 0x00 */
+        if (code < 0xFF && pos < len) {
+            if (out_pos >= out_len) {return -1;}
+            out[out_pos++] = 0x00;
+        }
+    }
+
+    return out_pos;
+}
+
+/* CRC-16/CCITT-FALSE of a packet */
+uint16_t frameStream::crc16(const uint8_t *data, uint16_t len) {
+    uint16_t crc = 0xFFFF;
+
+    for (uint16_t pos = 0; pos < len; pos++) {
+        crc ^= (uint16_t) data[pos] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;}
+    }
+
+    return crc;
+}
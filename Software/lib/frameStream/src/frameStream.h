@@ -0,0 +1,154 @@
+/*
+    frameStream.h - built from 'lib_template.h'
+    This library is intended to stream the lights over the serial port in a compact binary
+    form, mixed in with the usual log text - for a live preview / capture of the real device on
+    a host ('tools/host/serial_view.cpp'), with the time every frame was drawn and the time it
+    took to render.
+
+    Framing:
+        - every packet is COBS encoded (it holds no 0x00 byte), and sent between two 0x00
+          delimiters:  0x00 COBS(packet) 0x00
+        - log text never holds a 0x00 byte, so the host tells packets apart from the text around
+          them - anything between two delimiters that doesn't decode to a packet with a valid CRC
+          is text (e.g. the tail of a packet, when the host started listening in the middle of it)
+
+    Packet (before COBS, multi-byte values little-endian):
+        offset  0   'F'
+                1   flags           FRAME_STREAM_RAW / FRAME_STREAM_KEY
+                2   seq  (u16)      counts every frame offered to send() - a gap is frames skipped
+                4   ref  (u16)      seq of the packet this one is a delta against (delta frames)
+                6   time_us (u32)   micros() when the frame started rendering
+                10  render_us (u32) time the frame took to render
+                14  led_qty (u16)
+                16  data            FRAME_STREAM_RAW: led_qty x R G B
+                                    else: a frame in framePlayer's format (SKIP / RUN / COPY
+                                    commands ended by 0xFF, see framePlayer.h), a delta against
+                                    packet 'ref' - no SKIP at all in a FRAME_STREAM_KEY frame
+                ..  crc  (u16)      CRC-16/CCITT-FALSE of everything before it
+
+    Bandwidth:
+        - a frame is only sent if the sink has room for the whole packet right now, so streaming
+          never stalls the lights - it takes whatever the link has left, and skips the rest
+        - deltas are against the last frame sent, so skipping keeps the chain intact - a key
+          frame is sent every FRAME_STREAM_KEY_INTERVAL packets, for a host that starts listening
+          mid-stream (or lost a packet)
+*/
+
+#ifndef frameStream_h
+    #define frameStream_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools + the frame codec, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+        #include <framePlayer.h>
+    #endif
+
+    /* The online simulator's AVR can't hold a frame - keep the buffers minimal there */
+    #ifdef __AVR__
+        #define FRAME_STREAM_MAX_LEDS 1
+    #endif
+
+    /* Stream configuration */
+    #ifndef FRAME_STREAM_MAX_LEDS
+        #define FRAME_STREAM_MAX_LEDS 512           //Lights past this aren't streamed
+    #endif
+    #ifndef FRAME_STREAM_KEY_INTERVAL
+        #define FRAME_STREAM_KEY_INTERVAL 64        //Packets between two key frames (delta mode)
+    #endif
+
+    /* Packet definitions */
+    #define FRAME_STREAM_TYPE_FRAME 'F'
+    #define FRAME_STREAM_RAW 0x01                   //Data is led_qty x R G B (not delta / RLE compressed)
+    #define FRAME_STREAM_KEY 0x02                   //Full frame - doesn't depend on an earlier packet
+    #define FRAME_STREAM_HEADER_LEN 16
+    #define FRAME_STREAM_CRC_LEN 2
+    #define FRAME_STREAM_DATA_LEN (FRAME_STREAM_MAX_LEDS * 3 + FRAME_STREAM_MAX_LEDS / (FRAME_CMD_QTY_MASK + 1) + 2)      //Full frame: COPY commands + END (longer than a raw frame)
+    #define FRAME_STREAM_PACKET_LEN (FRAME_STREAM_HEADER_LEN + FRAME_STREAM_DATA_LEN + FRAME_STREAM_CRC_LEN)
+    #define FRAME_STREAM_COBS_LEN(len) ((len) + (len) / 254 + 1)                                                      //Longest COBS encoding of len bytes
+    #define FRAME_STREAM_OUT_LEN (FRAME_STREAM_COBS_LEN(FRAME_STREAM_PACKET_LEN) + 2)                                 //+ the two delimiters
+    #define FRAME_STREAM_MIN_OUT_LEN (FRAME_STREAM_HEADER_LEN + 1 + FRAME_STREAM_CRC_LEN + 3)                          //Shortest packet sent (an unchanged delta frame)
+
+    /* Where the stream goes - implemented by the application (main.cpp: the serial port) */
+    class frameSink
+    {
+        public:
+            virtual ~frameSink() {}
+
+            /* Bytes that can be written right now without waiting */
+            virtual size_t room() = 0;
+
+            /* Write bytes - returns the qty written */
+            virtual size_t write(const uint8_t *data, size_t len) = 0;
+    };
+
+    /* Stream statistics */
+    struct frameStreamStats
+    {
+        uint32_t frame_qty;                         //Frames sent
+        uint32_t key_qty;                           //Key frames sent
+        uint32_t skipped_qty;                       //Frames skipped (the sink had no room for them)
+        uint32_t byte_qty;                          //Bytes sent
+    };
+
+    /* Class container */
+    class frameStream
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            frameStream(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Start streaming to a sink - raw = send every frame uncompressed (no delta / RLE) */
+            static void begin(frameSink *sink, bool raw=false);
+
+            /* Stop streaming */
+            static void end();
+
+            /* Returns true while streaming */
+            static bool is_open();
+
+            /* Returns true if the frames are sent uncompressed */
+            static bool raw();
+
+            /* Send the lights as they are now (call it after the frame was drawn) - returns false if the frame was skipped */
+            static bool send(uint32_t time_us, uint32_t render_us);
+
+            /* Stream statistics */
+            static const frameStreamStats &stats();
+
+            /* COBS encode len bytes (the output holds no 0x00) - returns the encoded length (at most FRAME_STREAM_COBS_LEN(len)) */
+            static uint16_t cobs_encode(const uint8_t *data, uint16_t len, uint8_t *out);
+
+            /* COBS decode (without the delimiters) - returns the decoded length, or -1 if the data isn't valid COBS / doesn't fit out_len */
+            static int32_t cobs_decode(const uint8_t *data, uint16_t len, uint8_t *out, uint16_t out_len);
+
+            /* CRC-16/CCITT-FALSE of a packet */
+            static uint16_t crc16(const uint8_t *data, uint16_t len);
+
+        private:
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Stream */
+            static frameSink *_sink;
+            static bool _raw;
+            static uint16_t _seq;                                           //seq of the next frame offered
+            static uint16_t _ref;                                           //seq of the last frame sent (the reference of the next delta)
+            static uint8_t _since_key;                                      //Packets sent since the last key frame (FRAME_STREAM_KEY_INTERVAL = the next one is a key frame)
+            static frameStreamStats _stats;
+
+            /* The last frame sent, the packet being built, and its encoding */
+            static CRGB _prev[FRAME_STREAM_MAX_LEDS];
+            static uint8_t _packet[FRAME_STREAM_PACKET_LEN];
+            static uint8_t _out[FRAME_STREAM_OUT_LEN];
+    };
+#endif
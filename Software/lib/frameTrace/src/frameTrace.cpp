@@ -0,0 +1,117 @@
+/*
+    frameTrace.cpp - built from 'lib_template.h'
+    This library is intended to show how the work of a frame interleaves over time (render,
+    FastLED.show(), the buttons, BlynkEdgent.run(), ... and the pattern switches / WiFi events
+    around them): begin / end markers are written into a ring buffer per core, dumped as text,
+    and turned into Chrome trace-event JSON on a host ('tools/host/trace_json.cpp' - opens in
+    chrome://tracing / ui.perfetto.dev).
+
+    See frameTrace.h for the markers / the dump format.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <frameTrace.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+traceRecord frameTrace::_records[TRACE_CORE_QTY][TRACE_RECORD_QTY];
+uint32_t frameTrace::_head[TRACE_CORE_QTY];
+volatile bool frameTrace::_running = false;
+char frameTrace::_trigger[TRACE_TRIGGER_LEN] = "";
+volatile bool frameTrace::_triggered = false;
+uint32_t frameTrace::_stop_after = 0;
+
+/* Constructor of the class */
+frameTrace::frameTrace() {
+}
+
+/* Start tracing (the rings are cleared), optionally frozen around the first TRACE_INSTANT named trigger - returns false if tracing isn't compiled in */
+bool frameTrace::begin(const char *trigger) {
+    end();
+
+    #ifdef FRAME_TRACE
+        memset(_records, 0, sizeof(_records));
+        memset(_head, 0, sizeof(_head));
+        strncpy(_trigger, trigger ? trigger : "", TRACE_TRIGGER_LEN - 1);
+        _triggered = false;
+        _running = true;
+    #endif
+
+    return _running;
+}
+
+/* Stop tracing - the records stay in the rings */
+void frameTrace::end() {
+    _running = false;
+}
+
+/* Returns true while tracing / once the trigger was hit */
+bool frameTrace::running() {
+    return _running;
+}
+
+bool frameTrace::triggered() {
+    return _triggered;
+}
+
+/* Records in the rings / written since begin() (each ring keeps the last TRACE_RECORD_QTY of its core) */
+uint32_t frameTrace::record_qty() {
+    uint32_t qty = 0;
+    for (uint8_t core = 0; core < TRACE_CORE_QTY; core++) {qty += min(_head[core], (uint32_t) TRACE_RECORD_QTY);}
+    return qty;
+}
+
+uint32_t frameTrace::total_qty() {
+    uint32_t qty = 0;
+    for (uint8_t core = 0; core < TRACE_CORE_QTY; core++) {qty += _head[core];}
+    return qty;
+}
+
+/* Stop tracing, and pass the records to print_line, one line at a time */
+void frameTrace::dump(void (*print_line)(const char *line)) {
+    end();
+
+    char line[96];
+    snprintf(line, sizeof(line), "# trace cores=%u now_us=%u records=%u total=%u trigger=%s",
+             TRACE_CORE_QTY, (unsigned) micros(), (unsigned) record_qty(), (unsigned) total_qty(), _trigger[0] ? _trigger : "-");
+    print_line(line);
+
+    /* Oldest first - the ring of a core that wrapped starts at its head */
+    for (uint8_t core = 0; core < TRACE_CORE_QTY; core++) {
+        uint32_t head = _head[core];
+        for (uint32_t idx = head - min(head, (uint32_t) TRACE_RECORD_QTY); idx != head; idx++) {
+            const traceRecord &rec = _records[core][idx % TRACE_RECORD_QTY];
+            if (!rec.name) {continue;}
+            snprintf(line, sizeof(line), "%u %u %c %u %s", core, (unsigned) rec.time_us, rec.phase, rec.arg, rec.name);
+            print_line(line);
+        }
+    }
+}
+
+/* Write a record to the ring of the calling core - use the TRACE_* macros, so it is compiled out with the tracing */
+void IRAM_ATTR frameTrace::record(const char *name, char phase, uint16_t arg) {
+    if (!_running) {return;}
+
+    #if defined(ESP32)
+        uint8_t core = xPortGetCoreID();
+    #else
+        uint8_t core = 0;
+    #endif
+
+    /* Claim the next slot of the core's ring - a task / interrupt preempting this one claims the one after it, neither waits */
+    uint32_t time_us = micros();
+    traceRecord &rec = _records[core][__atomic_fetch_add(&_head[core], 1, __ATOMIC_RELAXED) % TRACE_RECORD_QTY];
+    rec.time_us = time_us;
+    rec.arg = arg;
+    rec.phase = phase;
+    __atomic_store_n(&rec.name, name, __ATOMIC_RELEASE);
+
+    /* Freeze the rings half a ring after the trigger */
+    if (_triggered) {
+        if (__atomic_sub_fetch(&_stop_after, 1, __ATOMIC_RELAXED) == 0) {_running = false;}
+    } else if (phase == 'i' && _trigger[0] && !strcmp(name, _trigger)) {
+        _stop_after = TRACE_RECORD_QTY / 2;
+        _triggered = true;
+    }
+}
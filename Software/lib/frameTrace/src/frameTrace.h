@@ -0,0 +1,127 @@
+/*
+    frameTrace.h - built from 'lib_template.h'
+    This library is intended to show how the work of a frame interleaves over time (render,
+    FastLED.show(), the buttons, BlynkEdgent.run(), ... and the pattern switches / WiFi events
+    around them): begin / end markers are written into a ring buffer per core, dumped as text,
+    and turned into Chrome trace-event JSON on a host ('tools/host/trace_json.cpp' - opens in
+    chrome://tracing / ui.perfetto.dev).
+
+    Compile-time switch:
+        - the markers only exist if FRAME_TRACE is defined (the 'esp32doit-devkit-v1-trace'
+          environment in platformio.ini) - without it the TRACE_* macros expand to nothing, and
+          the ring buffers shrink to a single record (begin() returns false)
+
+    Markers (the name must be a string literal - only its address is recorded):
+        TRACE_BEGIN("name") / TRACE_END("name")     a span - spans of a core must nest
+        TRACE_SCOPE("name")                         a span up to the end of the enclosing block
+        TRACE_INSTANT("name", arg)                  a single point in time, with a 16 bit argument
+
+    Ring buffers:
+        - one per core, of TRACE_RECORD_QTY fixed size records - a core only writes to its own
+          ring, and a record is claimed with an atomic increment, so tasks / interrupts
+          preempting each other on a core never lock (nor share a slot) - the most recent
+          records are kept
+        - a trigger (begin("name")) freezes the rings half a ring after the first TRACE_INSTANT
+          of that name, so the dump holds what happened around it
+
+    Dump (one line each, see dump()):
+        # trace cores=<qty> now_us=<micros()> records=<qty> total=<qty> trigger=<name | ->
+        <core> <time_us> <B | E | i> <arg> <name>              (oldest first, per core)
+*/
+
+#ifndef frameTrace_h
+    #define frameTrace_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    /* Markers - compiled out unless FRAME_TRACE is defined */
+    #ifdef FRAME_TRACE
+        #define TRACE_BEGIN(name) frameTrace::record("" name, 'B', 0)
+        #define TRACE_END(name) frameTrace::record("" name, 'E', 0)
+        #define TRACE_INSTANT(name, arg) frameTrace::record("" name, 'i', (arg))
+        #define TRACE_SCOPE(name) frameTraceScope TRACE_SCOPE_VAR(__LINE__)("" name)
+        #define TRACE_SCOPE_VAR(line) TRACE_SCOPE_VAR_(line)
+        #define TRACE_SCOPE_VAR_(line) trace_scope_##line
+    #else
+        #define TRACE_BEGIN(name) do {} while (0)
+        #define TRACE_END(name) do {} while (0)
+        #define TRACE_INSTANT(name, arg) do {} while (0)
+        #define TRACE_SCOPE(name) do {} while (0)
+
+        /* Nothing is recorded - keep the buffers minimal */
+        #define TRACE_RECORD_QTY 1
+    #endif
+
+    /* Trace configuration */
+    #if defined(ESP32)
+        #define TRACE_CORE_QTY 2
+    #else
+        #define TRACE_CORE_QTY 1
+    #endif
+    #ifndef TRACE_RECORD_QTY
+        #define TRACE_RECORD_QTY 1024               //Records per core (~1 s of frames at 100 fps, 12 KB per core)
+    #endif
+    #ifndef TRACE_TRIGGER_LEN
+        #define TRACE_TRIGGER_LEN 24                //Longest trigger name
+    #endif
+
+    /* One record */
+    struct traceRecord
+    {
+        const char *name;                           //NULL until the record is written
+        uint32_t time_us;
+        uint16_t arg;
+        char phase;                                 //'B'egin / 'E'nd / 'i'nstant
+    };
+
+    /* Class container */
+    class frameTrace
+    {
+        public:
+            /* Constructor of the class */
+            frameTrace();
+
+            /* Start tracing (the rings are cleared), optionally frozen around the first TRACE_INSTANT named trigger - returns false if tracing isn't compiled in */
+            static bool begin(const char *trigger=NULL);
+
+            /* Stop tracing - the records stay in the rings */
+            static void end();
+
+            /* Returns true while tracing / once the trigger was hit */
+            static bool running();
+            static bool triggered();
+
+            /* Records in the rings / written since begin() (each ring keeps the last TRACE_RECORD_QTY of its core) */
+            static uint32_t record_qty();
+            static uint32_t total_qty();
+
+            /* Stop tracing, and pass the records to print_line, one line at a time */
+            static void dump(void (*print_line)(const char *line));
+
+            /* Write a record to the ring of the calling core - use the TRACE_* macros, so it is compiled out with the tracing */
+            static void record(const char *name, char phase, uint16_t arg);
+
+        private:
+            /* Rings */
+            static traceRecord _records[TRACE_CORE_QTY][TRACE_RECORD_QTY];
+            static uint32_t _head[TRACE_CORE_QTY];                          //Records claimed on each core since begin()
+
+            /* Tracing state */
+            static volatile bool _running;
+            static char _trigger[TRACE_TRIGGER_LEN];
+            static volatile bool _triggered;
+            static uint32_t _stop_after;                                    //Records left to write once triggered
+    };
+
+    /* Span up to the end of the enclosing block (TRACE_SCOPE) */
+    class frameTraceScope
+    {
+        public:
+            frameTraceScope(const char *name) : _name(name) {frameTrace::record(_name, 'B', 0);}
+            ~frameTraceScope() {frameTrace::record(_name, 'E', 0);}
+
+        private:
+            const char *_name;
+    };
+#endif
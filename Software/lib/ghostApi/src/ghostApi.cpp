@@ -0,0 +1,516 @@
+/*
+    ghostApi.h - built from 'lib_template.h'
+    This library is intended to let the ghost be watched and controlled from the local network
+    while it is running - a small HTTP server with a JSON API (pattern list / selection,
+    brightness), and a WebSocket streaming a live preview of the lights.
+
+    See ghostApi.h for the endpoints / preview format.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <ghostApi.h>
+#endif
+
+/* BSD sockets (lwIP on the ESP32) */
+#ifdef GHOST_API_SOCKETS
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #ifdef __linux__
+        #include <netinet/tcp.h>
+    #endif
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+#endif
+
+/* WebSocket definitions (RFC 6455) */
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_OP_BINARY 0x82                           //FIN + binary
+#define WS_OP_CLOSE 0x08
+#define WS_KEY_LEN 24                               //Base64 of a 16 byte nonce
+#define WS_ACCEPT_LEN 28                            //Base64 of a SHA-1 digest
+
+/* Initialize static class variables defined in the header file */
+lightTools *ghostApi::_lightTools = NULL;
+ledSpan ghostApi::_led_arr;
+uint16_t ghostApi::_led_qty = 0;
+apiControl *ghostApi::_control = NULL;
+int ghostApi::_listen_fd = -1;
+apiClient ghostApi::_clients[GHOST_API_MAX_CLIENTS];
+char ghostApi::_body[GHOST_API_BODY_LEN];
+CRGB ghostApi::_prev[GHOST_API_MAX_LEDS];
+uint8_t ghostApi::_frame[GHOST_API_FRAME_LEN + 4];
+bool ghostApi::_keyframe = true;
+uint32_t ghostApi::_last_preview_ms = 0;
+ghostApiStats ghostApi::_stats = {};
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+ghostApi::ghostApi(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = led_qty;
+
+    for (apiClient &client : _clients) {
+        client.fd = -1;
+        client.state = GHOST_API_FREE;
+    }
+}
+
+/* Start listening - returns false if the port couldn't be opened */
+bool ghostApi::begin(apiControl *control, uint16_t port) {
+    end();
+    _control = control;
+
+    #ifdef GHOST_API_SOCKETS
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {return false;}
+
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(fd, (sockaddr *) &addr, sizeof(addr)) || listen(fd, GHOST_API_MAX_CLIENTS)) {
+            close(fd);
+            return false;
+        }
+        _listen_fd = fd;
+    #endif
+
+    return _listen_fd >= 0;
+}
+
+/* Stop listening, and drop every client */
+void ghostApi::end() {
+    for (apiClient &client : _clients) {
+        if (client.state != GHOST_API_FREE) {drop(client);}
+    }
+    #ifdef GHOST_API_SOCKETS
+        if (_listen_fd >= 0) {close(_listen_fd);}
+    #endif
+    _listen_fd = -1;
+}
+
+/* Accept / serve clients, and send a preview frame when one is due - never blocks (call it after the frame was drawn) */
+void ghostApi::loop() {
+    if (_listen_fd < 0) {return;}
+
+    #ifdef GHOST_API_SOCKETS
+        /* New connections (a few per call at most) */
+        for (uint8_t attempt = 0; attempt < GHOST_API_MAX_CLIENTS; attempt++) {
+            int fd = accept(_listen_fd, NULL, NULL);
+            if (fd < 0) {break;}
+
+            apiClient *slot = NULL;
+            for (apiClient &client : _clients) {
+                if (client.state == GHOST_API_FREE) {slot = &client; break;}
+            }
+            if (!slot) {
+                close(fd);
+                _stats.refused_qty++;
+                continue;
+            }
+
+            int yes = 1;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            int sndbuf = GHOST_API_SNDBUF;
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+            slot->fd = fd;
+            slot->state = GHOST_API_HTTP;
+            slot->in_len = slot->out_len = slot->out_pos = 0;
+            slot->start_ms = millis();
+        }
+    #endif
+
+    for (apiClient &client : _clients) {
+        if (client.state != GHOST_API_FREE) {serve(client);}
+    }
+
+    preview();
+}
+
+/* Returns true while listening */
+bool ghostApi::is_open() {
+    return _listen_fd >= 0;
+}
+
+/* Qty of open WebSocket previews */
+uint8_t ghostApi::preview_qty() {
+    uint8_t qty = 0;
+    for (apiClient &client : _clients) {
+        if (client.state == GHOST_API_WEBSOCKET) {qty++;}
+    }
+    return qty;
+}
+
+/* Server statistics */
+const ghostApiStats &ghostApi::stats() {
+    return _stats;
+}
+
+/* Receive / parse / answer one client */
+void ghostApi::serve(apiClient &client) {
+    /* Finish sending first - a client isn't read while it has data pending */
+    if (!flush(client) || (client.out_len && (millis() - client.start_ms) > GHOST_API_TIMEOUT_MS)) {
+        drop(client);
+        return;
+    }
+    if (client.out_len) {return;}
+    if (client.state == GHOST_API_CLOSING) {
+        drop(client);
+        return;
+    }
+
+    #ifdef GHOST_API_SOCKETS
+        ssize_t len = recv(client.fd, &client.buf[client.in_len], GHOST_API_BUF_LEN - 1 - client.in_len, MSG_DONTWAIT);
+        if (len == 0 || (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            drop(client);
+            return;
+        }
+        if (len > 0) {client.in_len += len;}
+    #endif
+
+    if (client.state == GHOST_API_WEBSOCKET) {
+        handle_websocket(client);
+        return;
+    }
+
+    /* HTTP - answer once the headers are complete */
+    client.buf[client.in_len] = '\0';
+    if (strstr((const char *) client.buf, "\r\n\r\n")) {
+        handle_request(client);
+    } else if (client.in_len >= GHOST_API_BUF_LEN - 1) {
+        respond(client, 431, R"json({"status":"error","msg":"request too long"})json");
+    } else if ((millis() - client.start_ms) > GHOST_API_TIMEOUT_MS) {
+        drop(client);
+    }
+}
+
+/* Answer a complete HTTP request */
+void ghostApi::handle_request(apiClient &client) {
+    /* Request line: <method> <path>[?<query>] HTTP/1.1 */
+    char *method = (char *) client.buf;
+    char *path = strchr(method, ' ');
+    char *version = path ? strchr(path + 1, ' ') : NULL;
+    if (!version) {
+        respond(client, 400, R"json({"status":"error","msg":"bad request"})json");
+        return;
+    }
+    *path++ = '\0';
+    *version++ = '\0';
+    char *query = strchr(path, '?');
+    if (query) {*query++ = '\0';} else {query = version + strlen(version);}
+    bool get = !strcmp(method, "GET");
+    bool post = !strcmp(method, "POST");
+
+    /* Preview */
+    char upgrade[16];
+    char key[WS_KEY_LEN + 1];
+    if (!strcmp(path, "/ws")) {
+        if (!get || !header_value(version, "Upgrade", upgrade, sizeof(upgrade)) || strcasecmp(upgrade, "websocket") ||
+            !header_value(version, "Sec-WebSocket-Key", key, sizeof(key)) || strlen(key) != WS_KEY_LEN) {
+            respond(client, 400, R"json({"status":"error","msg":"websocket upgrade expected"})json");
+            return;
+        }
+
+        char accept[WS_ACCEPT_LEN + 1];
+        websocket_accept(key, accept);
+        client.out_len = snprintf((char *) client.buf, GHOST_API_BUF_LEN,
+                                  "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+        client.out = client.buf;
+        client.out_pos = client.in_len = 0;
+        client.state = GHOST_API_WEBSOCKET;
+        client.start_ms = millis();
+        _stats.request_qty++;
+        _keyframe = true;
+        if (!flush(client)) {drop(client);}
+        return;
+    }
+
+    /* JSON API */
+    long value;
+    if (!strcmp(path, "/api/state") && get) {
+        state_json();
+        respond(client, 200, _body);
+    } else if (!strcmp(path, "/api/patterns") && get) {
+        uint8_t qty = _control->pattern_qty();
+        int len = snprintf(_body, sizeof(_body), R"json({"pattern":%u,"patterns":[)json", _control->pattern_idx());
+        for (uint8_t idx = 0; idx < qty; idx++) {
+            int entry = snprintf(&_body[len], sizeof(_body) - len, R"json(%s{"idx":%u,"available":%s})json",
+                                 idx ? "," : "", idx, _control->pattern_available(idx) ? "true" : "false");
+            if (entry < 0 || len + entry >= (int) sizeof(_body) - 3) {break;}
+            len += entry;
+        }
+        snprintf(&_body[len], sizeof(_body) - len, "]}");
+        respond(client, 200, _body);
+    } else if (!strcmp(path, "/api/pattern") && post) {
+        if (!query_int(query, "idx", &value) || value < 0 || value >= _control->pattern_qty()) {
+            respond(client, 400, R"json({"status":"error","msg":"idx out of range"})json");
+        } else if (!_control->select_pattern(value)) {
+            respond(client, 409, R"json({"status":"error","msg":"pattern not available"})json");
+        } else {
+            state_json();
+            respond(client, 200, _body);
+        }
+    } else if (!strcmp(path, "/api/brightness") && post) {
+        if (!query_int(query, "value", &value) || value < 0 || value > 255) {
+            respond(client, 400, R"json({"status":"error","msg":"value out of range"})json");
+        } else {
+            _control->set_brightness(value);
+            state_json();
+            respond(client, 200, _body);
+        }
+    } else if (!strcmp(path, "/api/state") || !strcmp(path, "/api/patterns") || !strcmp(path, "/api/pattern") || !strcmp(path, "/api/brightness")) {
+        respond(client, 405, R"json({"status":"error","msg":"method not allowed"})json");
+    } else {
+        respond(client, 404, R"json({"status":"error","msg":"unknown endpoint"})json");
+    }
+}
+
+/* Consume the WebSocket messages of a client (only a close is acted on) */
+void ghostApi::handle_websocket(apiClient &client) {
+    static const uint8_t close_frame[2] = {0x80 | WS_OP_CLOSE, 0};
+
+    while (client.in_len >= 2) {
+        uint8_t *frame = client.buf;
+        uint32_t len = frame[1] & 0x7F;
+        uint16_t pos = 2;
+        if (len == 126) {
+            if (client.in_len < 4) {return;}
+            len = (frame[2] << 8) | frame[3];
+            pos = 4;
+        } else if (len == 127) {
+            drop(client);
+            return;
+        }
+        if (frame[1] & 0x80) {pos += 4;}                           //Masking key (clients always mask)
+
+        /* Messages that can't fit the buffer are never expected from a preview client */
+        if (len > (uint32_t) (GHOST_API_BUF_LEN - 1 - pos)) {
+            drop(client);
+            return;
+        }
+        if (client.in_len < pos + len) {return;}
+
+        /* Close --> answer it, then close the connection once the answer was sent */
+        if ((frame[0] & 0x0F) == WS_OP_CLOSE) {
+            client.out = close_frame;
+            client.out_len = sizeof(close_frame);
+            client.out_pos = 0;
+            client.state = GHOST_API_CLOSING;
+            client.start_ms = millis();
+            if (!flush(client)) {drop(client);}
+            return;
+        }
+
+        client.in_len -= pos + len;
+        memmove(client.buf, &client.buf[pos + len], client.in_len);
+    }
+}
+
+/* Queue a JSON response - the connection is closed once it was sent */
+void ghostApi::respond(apiClient &client, uint16_t code, const char *body) {
+    const char *reason;
+    switch (code) {
+        case 200: reason = "OK"; break;
+        case 400: reason = "Bad Request"; break;
+        case 404: reason = "Not Found"; break;
+        case 405: reason = "Method Not Allowed"; break;
+        case 409: reason = "Conflict"; break;
+        case 431: reason = "Request Header Fields Too Large"; break;
+        default: reason = "Error"; break;
+    }
+
+    /* The request in the buffer was parsed already - the response takes its place */
+    int len = snprintf((char *) client.buf, GHOST_API_BUF_LEN,
+                       "HTTP/1.1 %u %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n%s",
+                       code, reason, (unsigned) strlen(body), body);
+    client.out = client.buf;
+    client.out_len = min(len, GHOST_API_BUF_LEN - 1);
+    client.out_pos = client.in_len = 0;
+    client.state = GHOST_API_CLOSING;
+    client.start_ms = millis();
+    _stats.request_qty++;
+    if (!flush(client)) {drop(client);}
+}
+
+/* Write the state object into _body */
+void ghostApi::state_json() {
+    snprintf(_body, sizeof(_body), R"json({"pattern":%u,"brightness":%u,"led_qty":%u,"preview_ms":%u,"clients":%u})json",
+             _control->pattern_idx(), _control->brightness(), _led_qty, GHOST_API_PREVIEW_MS, preview_qty());
+}
+
+/* Send as much of a client's pending data as the socket takes - returns false if the connection broke */
+bool ghostApi::flush(apiClient &client) {
+    #ifdef GHOST_API_SOCKETS
+        while (client.out_pos < client.out_len) {
+            ssize_t len = send(client.fd, &client.out[client.out_pos], client.out_len - client.out_pos, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (len < 0) {return errno == EAGAIN || errno == EWOULDBLOCK;}
+            client.out_pos += len;
+        }
+    #endif
+    client.out_len = client.out_pos = 0;
+    return true;
+}
+
+/* Encode a preview frame, and queue it for every WebSocket that is ready */
+void ghostApi::preview() {
+    if (!preview_qty() || (millis() - _last_preview_ms) < GHOST_API_PREVIEW_MS) {return;}
+    _last_preview_ms = millis();
+
+    /* Every client gets the same delta - skip the frame if anyone is still taking the previous one */
+    for (apiClient &client : _clients) {
+        if (client.state == GHOST_API_WEBSOCKET && client.out_len) {
+            _stats.skipped_qty++;
+            return;
+        }
+    }
+
+    /* Encode behind room for the largest message header, then put the header right in front of it */
+    uint16_t led_qty = min(_led_qty, (uint16_t) GHOST_API_MAX_LEDS);
+    uint16_t len = framePlayer::encode_frame(_led_arr.data(), _keyframe ? NULL : _prev, led_qty, &_frame[4], GHOST_API_FRAME_LEN);
+    if (!len) {return;}
+    memcpy(_prev, _led_arr.data(), led_qty * sizeof(CRGB));
+    _keyframe = false;
+
+    uint8_t *message = _frame;
+    if (len < 126) {
+        message = &_frame[2];
+        message[1] = len;
+    } else {
+        message[1] = 126;
+        message[2] = len >> 8;
+        message[3] = len & 0xFF;
+    }
+    message[0] = WS_OP_BINARY;
+    uint16_t message_len = &_frame[4] - message + len;
+
+    for (apiClient &client : _clients) {
+        if (client.state != GHOST_API_WEBSOCKET) {continue;}
+        client.out = message;
+        client.out_len = message_len;
+        client.out_pos = 0;
+        client.start_ms = millis();
+        if (!flush(client)) {drop(client);}
+    }
+    _stats.frame_qty++;
+    _stats.byte_qty += message_len;
+}
+
+/* Close a client connection */
+void ghostApi::drop(apiClient &client) {
+    #ifdef GHOST_API_SOCKETS
+        if (client.fd >= 0) {close(client.fd);}
+    #endif
+    client.fd = -1;
+    client.state = GHOST_API_FREE;
+    client.in_len = client.out_len = client.out_pos = 0;
+}
+
+/* Find a request header (case-insensitive name) and copy its value - returns false if it's missing or doesn't fit value_len */
+bool ghostApi::header_value(const char *request, const char *name, char *value, uint16_t value_len) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(request, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) || line[name_len] != ':') {continue;}
+
+        const char *start = &line[name_len + 1];
+        while (*start == ' ') {start++;}
+        const char *end = strstr(start, "\r\n");
+        if (!end || (uint16_t) (end - start) >= value_len) {return false;}
+        memcpy(value, start, end - start);
+        value[end - start] = '\0';
+        return true;
+    }
+    return false;
+}
+
+/* Find an integer parameter in a query string (name=value&...) */
+bool ghostApi::query_int(const char *query, const char *name, long *value) {
+    size_t name_len = strlen(name);
+    for (const char *param = query; *param; ) {
+        if (!strncmp(param, name, name_len) && param[name_len] == '=') {
+            char *end;
+            *value = strtol(&param[name_len + 1], &end, 10);
+            return end != &param[name_len + 1] && (*end == '\0' || *end == '&');
+        }
+        param = strchr(param, '&');
+        if (!param) {break;}
+        param++;
+    }
+    return false;
+}
+
+/* Sec-WebSocket-Accept for a Sec-WebSocket-Key (base64 of the SHA-1 of key + GUID) */
+void ghostApi::websocket_accept(const char *key, char *accept) {
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    char text[WS_KEY_LEN + sizeof(WS_GUID)];
+    snprintf(text, sizeof(text), "%s" WS_GUID, key);
+    uint8_t digest[21] = {};                                        //20 byte digest + a zero byte, so it splits into 7 groups of 3
+    sha1((const uint8_t *) text, strlen(text), digest);
+
+    for (uint8_t group = 0; group < 7; group++) {
+        uint32_t bits = (digest[group * 3] << 16) | (digest[group * 3 + 1] << 8) | digest[group * 3 + 2];
+        for (uint8_t idx = 0; idx < 4; idx++) {accept[group * 4 + idx] = base64[(bits >> (18 - idx * 6)) & 0x3F];}
+    }
+    accept[WS_ACCEPT_LEN - 1] = '=';
+    accept[WS_ACCEPT_LEN] = '\0';
+}
+
+/* SHA-1 (only ever used on the short WebSocket key, once per connection) */
+void ghostApi::sha1(const uint8_t *data, uint32_t len, uint8_t *digest) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint8_t block[64];
+    uint64_t bit_len = (uint64_t) len * 8;
+
+    /* Data, then 0x80, zeros and the bit length - as many blocks as that takes */
+    uint32_t block_qty = (len + 8) / 64 + 1;
+    for (uint32_t block_idx = 0; block_idx < block_qty; block_idx++) {
+        for (uint8_t idx = 0; idx < 64; idx++) {
+            uint32_t pos = block_idx * 64 + idx;
+            if (pos < len) {block[idx] = data[pos];}
+            else if (pos == len) {block[idx] = 0x80;}
+            else if (block_idx == block_qty - 1 && idx >= 56) {block[idx] = bit_len >> ((63 - idx) * 8);}
+            else {block[idx] = 0;}
+        }
+
+        uint32_t w[80];
+        for (uint8_t idx = 0; idx < 16; idx++) {
+            w[idx] = ((uint32_t) block[idx * 4] << 24) | (block[idx * 4 + 1] << 16) | (block[idx * 4 + 2] << 8) | block[idx * 4 + 3];
+        }
+        for (uint8_t idx = 16; idx < 80; idx++) {
+            uint32_t x = w[idx - 3] ^ w[idx - 8] ^ w[idx - 14] ^ w[idx - 16];
+            w[idx] = (x << 1) | (x >> 31);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (uint8_t idx = 0; idx < 80; idx++) {
+            uint32_t f, k;
+            if (idx < 20) {f = (b & c) | (~b & d); k = 0x5A827999;}
+            else if (idx < 40) {f = b ^ c ^ d; k = 0x6ED9EBA1;}
+            else if (idx < 60) {f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC;}
+            else {f = b ^ c ^ d; k = 0xCA62C1D6;}
+            uint32_t temp = ((a << 5) | (a >> 27)) + f + e + k + w[idx];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (uint8_t idx = 0; idx < 20; idx++) {digest[idx] = h[idx / 4] >> ((3 - idx % 4) * 8);}
+}
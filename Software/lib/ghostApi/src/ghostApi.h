@@ -0,0 +1,211 @@
+/*
+    ghostApi.h - built from 'lib_template.h'
+    This library is intended to let the ghost be watched and controlled from the local network
+    while it is running - a small HTTP server with a JSON API (pattern list / selection,
+    brightness), and a WebSocket streaming a live preview of the lights.
+
+    Endpoints (port GHOST_API_PORT):
+        GET  /api/state                     {"pattern":3,"brightness":128,"led_qty":110,"preview_ms":50,"clients":1}
+        GET  /api/patterns                  {"pattern":3,"patterns":[{"idx":0,"available":true},...]}
+        POST /api/pattern?idx=<n>           select a pattern (409 if it can't run right now) - replies with the state
+        POST /api/brightness?value=<0-255>  set the brightness - replies with the state
+        GET  /ws                            WebSocket upgrade - live preview
+
+    Preview:
+        - one binary WebSocket message per frame, at most one every GHOST_API_PREVIEW_MS
+        - each message is a frame in framePlayer's format (SKIP / RUN / COPY commands ended by
+          0xFF, see framePlayer.h), a delta against the previous message - the first message after
+          a client connects is a full frame (no SKIP)
+        - while any client hasn't taken the previous message yet, the frame is skipped for every
+          client: the delta chains stay intact, and a slow client never holds up the lights
+
+    Server:
+        - non-blocking BSD sockets, polled from loop() - nothing ever waits on the network
+        - up to GHOST_API_MAX_CLIENTS connections: HTTP requests are answered and closed, only
+          WebSockets stay open
+        - the request line + headers must fit GHOST_API_BUF_LEN, and parameters are passed in
+          the query string (request bodies are ignored)
+*/
+
+#ifndef ghostApi_h
+    #define ghostApi_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools + the frame codec, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+        #include <framePlayer.h>
+    #endif
+
+    /* The server needs BSD sockets - the ESP32 (lwIP) and the host tools have them, the online simulator's AVR doesn't */
+    #ifndef __AVR__
+        #define GHOST_API_SOCKETS
+    #else
+        /* The server can't open there - keep its buffers minimal */
+        #define GHOST_API_MAX_CLIENTS 1
+        #define GHOST_API_BUF_LEN 16
+        #define GHOST_API_BODY_LEN 16
+        #define GHOST_API_MAX_LEDS 1
+    #endif
+
+    /* Server configuration */
+    #ifndef GHOST_API_PORT
+        #define GHOST_API_PORT 8080
+    #endif
+    #ifndef GHOST_API_MAX_CLIENTS
+        #define GHOST_API_MAX_CLIENTS 4
+    #endif
+    #ifndef GHOST_API_BUF_LEN
+        #define GHOST_API_BUF_LEN 1024              //Per client - holds the request, then the response
+    #endif
+    #ifndef GHOST_API_BODY_LEN
+        #define GHOST_API_BODY_LEN (GHOST_API_BUF_LEN - 192)  //JSON body of a response (the rest of the buffer is left for the headers)
+    #endif
+    #ifndef GHOST_API_SNDBUF
+        #define GHOST_API_SNDBUF 8192               //Socket send buffer per client - bounds the preview data queued up behind a slow client (lwIP has its own, smaller TCP_SND_BUF)
+    #endif
+    #ifndef GHOST_API_TIMEOUT_MS
+        #define GHOST_API_TIMEOUT_MS 5000           //HTTP clients that didn't finish their request / take the response by then are dropped
+    #endif
+
+    /* Preview configuration */
+    #ifndef GHOST_API_PREVIEW_MS
+        #define GHOST_API_PREVIEW_MS 50             //Shortest time between preview frames (20 FPS)
+    #endif
+    #ifndef GHOST_API_MAX_LEDS
+        #define GHOST_API_MAX_LEDS 512              //Lights past this aren't previewed
+    #endif
+    #define GHOST_API_FRAME_LEN (GHOST_API_MAX_LEDS * 3 + GHOST_API_MAX_LEDS / (FRAME_CMD_QTY_MASK + 1) + 2)    //Full frame: COPY commands + END
+
+    /* Client connection states */
+    #define GHOST_API_FREE 0
+    #define GHOST_API_HTTP 1                        //Receiving a request
+    #define GHOST_API_CLOSING 2                     //Sending a response, then closing
+    #define GHOST_API_WEBSOCKET 3
+
+    /* What the API controls - implemented by the application (main.cpp) */
+    class apiControl
+    {
+        public:
+            virtual ~apiControl() {}
+
+            /* Pattern list */
+            virtual uint8_t pattern_qty() = 0;
+            virtual uint8_t pattern_idx() = 0;
+            virtual bool pattern_available(uint8_t idx) = 0;
+
+            /* Select a pattern - returns false if it can't run right now */
+            virtual bool select_pattern(uint8_t idx) = 0;
+
+            /* Brightness (0-255) */
+            virtual uint8_t brightness() = 0;
+            virtual void set_brightness(uint8_t value) = 0;
+    };
+
+    /* One client connection */
+    struct apiClient
+    {
+        int fd;
+        uint8_t state;
+        uint16_t in_len;
+        const uint8_t *out;                         //Data being sent - the client's buffer, or the shared preview frame
+        uint16_t out_len;
+        uint16_t out_pos;
+        uint32_t start_ms;
+        uint8_t buf[GHOST_API_BUF_LEN];
+    };
+
+    /* Server statistics */
+    struct ghostApiStats
+    {
+        uint32_t request_qty;                       //HTTP requests answered
+        uint32_t frame_qty;                         //Preview frames sent
+        uint32_t skipped_qty;                       //Preview frames skipped (a client hadn't taken the previous one yet)
+        uint32_t byte_qty;                          //Preview bytes sent
+        uint32_t refused_qty;                       //Connections refused (no free client slot)
+    };
+
+    /* Class container */
+    class ghostApi
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            ghostApi(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Start listening - returns false if the port couldn't be opened */
+            static bool begin(apiControl *control, uint16_t port=GHOST_API_PORT);
+
+            /* Stop listening, and drop every client */
+            static void end();
+
+            /* Accept / serve clients, and send a preview frame when one is due - never blocks (call it after the frame was drawn) */
+            static void loop();
+
+            /* Returns true while listening */
+            static bool is_open();
+
+            /* Qty of open WebSocket previews */
+            static uint8_t preview_qty();
+
+            /* Server statistics */
+            static const ghostApiStats &stats();
+
+        private:
+            /* Receive / parse / answer one client */
+            static void serve(apiClient &client);
+
+            /* Answer a complete HTTP request */
+            static void handle_request(apiClient &client);
+
+            /* Consume the WebSocket messages of a client (only a close is acted on) */
+            static void handle_websocket(apiClient &client);
+
+            /* Queue a JSON response - the connection is closed once it was sent */
+            static void respond(apiClient &client, uint16_t code, const char *body);
+
+            /* Write the state object into _body */
+            static void state_json();
+
+            /* Send as much of a client's pending data as the socket takes - returns false if the connection broke */
+            static bool flush(apiClient &client);
+
+            /* Encode a preview frame, and queue it for every WebSocket that is ready */
+            static void preview();
+
+            /* Close a client connection */
+            static void drop(apiClient &client);
+
+            /* Request parsing helpers */
+            static bool header_value(const char *request, const char *name, char *value, uint16_t value_len);
+            static bool query_int(const char *query, const char *name, long *value);
+
+            /* Sec-WebSocket-Accept for a Sec-WebSocket-Key (base64 of the SHA-1 of key + GUID) */
+            static void websocket_accept(const char *key, char *accept);
+            static void sha1(const uint8_t *data, uint32_t len, uint8_t *digest);
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Server */
+            static apiControl *_control;
+            static int _listen_fd;
+            static apiClient _clients[GHOST_API_MAX_CLIENTS];
+            static char _body[GHOST_API_BODY_LEN];
+
+            /* Preview - the last frame sent (the reference of the next delta), and the message being sent */
+            static CRGB _prev[GHOST_API_MAX_LEDS];
+            static uint8_t _frame[GHOST_API_FRAME_LEN + 4];
+            static bool _keyframe;                                          //The next preview frame must be a full frame (a client joined)
+            static uint32_t _last_preview_ms;
+            static ghostApiStats _stats;
+    };
+#endif
@@ -0,0 +1,171 @@
+/*
+    ghostSettings.h - built from 'lib_template.h'
+    This library is intended to keep the ghost's user state (active pattern, brightness,
+    pattern duration) across reboots / brown-outs, so it resumes where it left off.
+
+    See ghostSettings.h for the write-behind rules.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <ghostSettings.h>
+    #include <Preferences.h>
+    #include <esp_system.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+ghostSettingsRecord ghostSettings::_current;
+ghostSettingsRecord ghostSettings::_default;
+ghostSettingsRecord ghostSettings::_saved;
+uint32_t ghostSettings::_first_change_ms = 0;
+uint32_t ghostSettings::_last_change_ms = 0;
+uint32_t ghostSettings::_last_write_ms = 0;
+bool ghostSettings::_pending = false;
+bool ghostSettings::_written = false;
+uint32_t ghostSettings::_write_qty = 0;
+
+/* Constructor of the class - pass the defaults, used until (or unless) settings are restored from flash */
+ghostSettings::ghostSettings(uint8_t brightness, uint16_t pattern_duration) {
+    _default.magic = SETTINGS_MAGIC;
+    _default.version = SETTINGS_VERSION;
+    _default.pattern_idx = 0;
+    _default.brightness = brightness;
+    _default.reserved = 0;
+    _default.pattern_duration = pattern_duration;
+
+    _current = _saved = _default;
+}
+
+/* Restore the settings saved in flash - returns false (and keeps the defaults) if nothing valid was saved */
+bool ghostSettings::restore() {
+    bool restored = false;
+
+    #ifndef ONLINE_SIMULATION
+        Preferences prefs;
+        if (prefs.begin("ghost", true)) {
+            ghostSettingsRecord record;
+            if (prefs.getBytes("settings", &record, sizeof(record)) == sizeof(record) &&
+                record.magic == SETTINGS_MAGIC && record.version == SETTINGS_VERSION && record.pattern_duration) {
+                _current = _saved = record;
+                restored = true;
+            }
+            prefs.end();
+        }
+
+        /* Don't lose pending changes when restarting (OTA updates, console 'reboot', ...) */
+        static bool shutdown_registered = false;
+        if (!shutdown_registered) {
+            esp_register_shutdown_handler([]() {flush();});
+            shutdown_registered = true;
+        }
+    #endif
+
+    _pending = false;
+    return restored;
+}
+
+/* Write-behind service - writes pending changes to flash once they are due (call from the main loop) */
+void ghostSettings::loop() {
+    if (!_pending) {return;}
+
+    uint32_t now = millis();
+
+    /* Wait for the changes to settle (or until they were held back long enough), and never write more often than allowed */
+    bool settled = (now - _last_change_ms) >= SETTINGS_IDLE_MS || (now - _first_change_ms) >= SETTINGS_MAX_DIRTY_MS;
+    bool allowed = !_written || (now - _last_write_ms) >= SETTINGS_MIN_WRITE_MS;
+    if (settled && allowed) {flush();}
+}
+
+/* Write pending changes to flash right away (e.g. before going to sleep) */
+bool ghostSettings::flush() {
+    _pending = false;
+    if (!dirty()) {return true;}
+
+    /* Retry from loop() once the next write is allowed */
+    if (!save()) {_pending = true; return false;}
+    return true;
+}
+
+/* Erase the settings saved in flash, and go back to the defaults */
+void ghostSettings::erase() {
+    #ifndef ONLINE_SIMULATION
+        Preferences prefs;
+        if (prefs.begin("ghost", false)) {
+            prefs.clear();
+            prefs.end();
+        }
+    #endif
+
+    _current = _saved = _default;
+    _pending = false;
+}
+
+/* Settings */
+uint8_t ghostSettings::pattern_idx() {
+    return _current.pattern_idx;
+}
+
+void ghostSettings::set_pattern_idx(uint8_t idx) {
+    if (idx == _current.pattern_idx) {return;}
+    _current.pattern_idx = idx;
+    touch();
+}
+
+uint8_t ghostSettings::brightness() {
+    return _current.brightness;
+}
+
+void ghostSettings::set_brightness(uint8_t brightness) {
+    if (brightness == _current.brightness) {return;}
+    _current.brightness = brightness;
+    touch();
+}
+
+uint16_t ghostSettings::pattern_duration() {
+    return _current.pattern_duration;
+}
+
+void ghostSettings::set_pattern_duration(uint16_t seconds) {
+    if (!seconds || seconds == _current.pattern_duration) {return;}
+    _current.pattern_duration = seconds;
+    touch();
+}
+
+/* True if there are changes that are not written to flash yet */
+bool ghostSettings::dirty() {
+    return memcmp(&_current, &_saved, sizeof(_current)) != 0;
+}
+
+/* Qty of flash writes since boot */
+uint32_t ghostSettings::write_qty() {
+    return _write_qty;
+}
+
+/* Mark the settings as changed */
+void ghostSettings::touch() {
+    uint32_t now = millis();
+    if (!_pending) {
+        _pending = true;
+        _first_change_ms = now;
+    }
+    _last_change_ms = now;
+}
+
+/* Write the current settings to flash */
+bool ghostSettings::save() {
+    _written = true;
+    _last_write_ms = millis();
+
+    #ifndef ONLINE_SIMULATION
+        Preferences prefs;
+        if (!prefs.begin("ghost", false)) {return false;}
+
+        bool saved = prefs.putBytes("settings", &_current, sizeof(_current)) == sizeof(_current);
+        prefs.end();
+        if (!saved) {return false;}
+    #endif
+
+    _saved = _current;
+    _write_qty++;
+    return true;
+}
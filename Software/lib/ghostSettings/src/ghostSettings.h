@@ -0,0 +1,102 @@
+/*
+    ghostSettings.h - built from 'lib_template.h'
+    This library is intended to keep the ghost's user state (active pattern, brightness,
+    pattern duration) across reboots / brown-outs, so it resumes where it left off.
+
+    Settings are kept in RAM and written to flash (NVS, through Preferences - the same way
+    'ConfigStore.h' keeps the Blynk config) by a write-behind buffer:
+        - a change is only written once the settings have been left alone for SETTINGS_IDLE_MS,
+          so a burst of button presses is coalesced into a single write
+        - at most one write happens every SETTINGS_MIN_WRITE_MS, no matter how often things change
+        - a change is never held back for longer than SETTINGS_MAX_DIRTY_MS
+        - nothing is written if the settings match what is already in flash
+        - pending changes are flushed when the ESP32 restarts (OTA, console 'reboot', ...), or by
+          calling flush() before going to sleep
+    NVS itself spreads writes over its pages (wear leveling), so this keeps flash wear negligible.
+*/
+
+#ifndef ghostSettings_h
+    #define ghostSettings_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    /* Write-behind timing */
+    #ifndef SETTINGS_IDLE_MS
+        #define SETTINGS_IDLE_MS 5000               //Settings must be unchanged this long before they are written
+    #endif
+    #ifndef SETTINGS_MIN_WRITE_MS
+        #define SETTINGS_MIN_WRITE_MS 30000         //Minimum time between two writes
+    #endif
+    #ifndef SETTINGS_MAX_DIRTY_MS
+        #define SETTINGS_MAX_DIRTY_MS 300000        //Maximum time a change can wait to be written
+    #endif
+
+    /* Settings record (stored as a single blob) */
+    #define SETTINGS_MAGIC 0x47534554               //"GSET"
+    #define SETTINGS_VERSION 1
+
+    struct ghostSettingsRecord
+    {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t pattern_idx;
+        uint8_t brightness;
+        uint8_t reserved;
+        uint16_t pattern_duration;
+    } __attribute__((packed));
+
+    /* Class container */
+    class ghostSettings
+    {
+        public:
+            /* Constructor of the class - pass the defaults, used until (or unless) settings are restored from flash */
+            ghostSettings(uint8_t brightness, uint16_t pattern_duration);
+
+            /* Restore the settings saved in flash - returns false (and keeps the defaults) if nothing valid was saved */
+            static bool restore();
+
+            /* Write-behind service - writes pending changes to flash once they are due (call from the main loop) */
+            static void loop();
+
+            /* Write pending changes to flash right away (e.g. before going to sleep) */
+            static bool flush();
+
+            /* Erase the settings saved in flash, and go back to the defaults */
+            static void erase();
+
+            /* Settings */
+            static uint8_t pattern_idx();
+            static void set_pattern_idx(uint8_t idx);
+            static uint8_t brightness();
+            static void set_brightness(uint8_t brightness);
+            static uint16_t pattern_duration();
+            static void set_pattern_duration(uint16_t seconds);
+
+            /* True if there are changes that are not written to flash yet */
+            static bool dirty();
+
+            /* Qty of flash writes since boot */
+            static uint32_t write_qty();
+
+        private:
+            /* Mark the settings as changed */
+            static void touch();
+
+            /* Write the current settings to flash */
+            static bool save();
+
+            /* Current / default / last saved settings */
+            static ghostSettingsRecord _current;
+            static ghostSettingsRecord _default;
+            static ghostSettingsRecord _saved;
+
+            /* Write-behind state */
+            static uint32_t _first_change_ms;
+            static uint32_t _last_change_ms;
+            static uint32_t _last_write_ms;
+            static bool _pending;
+            static bool _written;
+            static uint32_t _write_qty;
+    };
+#endif
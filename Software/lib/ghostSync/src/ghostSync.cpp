@@ -0,0 +1,252 @@
+/*
+    ghostSync.h - built from 'lib_template.h'
+    This library is intended to keep several ghosts on one lawn showing the same thing at the
+    same time - a shared time base (which the FastLED timing helpers run on, see main.cpp's
+    get_millisecond_timer) and a shared pattern index.
+
+    See ghostSync.h for the protocol.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <ghostSync.h>
+#endif
+
+/* The time base is moved forward from more than one task - FastLED's GET_MILLIS() runs in the loop, in the helper task drawing frames while
+   Edgent blocks (same core), and in the audio analysis (other core).  advance() and the corrections run with this lock held, so no elapsed
+   time is counted twice / lost, and no 64b value is read torn */
+#if defined(ESP32)
+    static portMUX_TYPE sync_mux = portMUX_INITIALIZER_UNLOCKED;
+    #define SYNC_LOCK() portENTER_CRITICAL(&sync_mux)
+    #define SYNC_UNLOCK() portEXIT_CRITICAL(&sync_mux)
+#else
+    #define SYNC_LOCK()
+    #define SYNC_UNLOCK()
+#endif
+
+/* Initialize static class variables defined in the header file */
+syncTransport *ghostSync::_transport = NULL;
+uint32_t ghostSync::_node_id = 0;
+uint32_t ghostSync::_leader_id = 0;
+bool ghostSync::_leading = false;
+bool ghostSync::_locked = false;
+uint8_t ghostSync::_pattern_idx = 0;
+uint8_t ghostSync::_leader_pattern_idx = SYNC_NO_PATTERN;
+uint16_t ghostSync::_seq = 0;
+uint32_t ghostSync::_last_local_us = 0;
+uint64_t ghostSync::_local_us = 0;
+uint64_t ghostSync::_synced_us = 0;
+int32_t ghostSync::_rate_ppm = 0;
+int64_t ghostSync::_rate_rem = 0;
+uint64_t ghostSync::_slew_rem = 0;
+int64_t ghostSync::_pending_us = 0;
+int32_t ghostSync::_last_error_us = 0;
+uint64_t ghostSync::_last_packet_local_us = 0;
+uint64_t ghostSync::_last_sent_local_us = 0;
+uint16_t ghostSync::_step_qty = 0;
+
+/* Start syncing over the transport - node_id must be unique per ghost (e.g. mac_node_id() of the MAC address) */
+void ghostSync::begin(syncTransport *transport, uint32_t node_id) {
+    uint64_t local_us = local_now();
+    _transport = transport;
+    _node_id = node_id;
+    _leader_id = 0;
+    _leading = false;
+    _locked = false;
+    _leader_pattern_idx = SYNC_NO_PATTERN;
+
+    /* Listen for a leader before taking over */
+    _last_packet_local_us = local_us;
+}
+
+/* Node id from a 48b MAC address - all of its bits are mixed in (the vendor bytes are the same on every ghost), so the low bits used
+   for the takeover stagger differ from ghost to ghost too */
+uint32_t ghostSync::mac_node_id(uint64_t mac) {
+    /* 64b finalizer of MurmurHash3 */
+    mac &= 0xFFFFFFFFFFFFULL;
+    mac ^= mac >> 33;
+    mac *= 0xFF51AFD7ED558CCDULL;
+    mac ^= mac >> 33;
+    mac *= 0xC4CEB9FE1A85EC53ULL;
+    mac ^= mac >> 33;
+
+    return (uint32_t) mac;
+}
+
+/* Receive / send sync packets (call from the main loop) */
+void ghostSync::loop() {
+    if (!_transport) {return;}
+
+    /* Nothing to do while the network is down - the time base runs on the trimmed local clock */
+    if (!_transport->ready()) {
+        _last_packet_local_us = local_now();
+        return;
+    }
+
+    uint8_t buf[SYNC_PACKET_LEN + 4];
+    uint16_t len;
+    while ((len = _transport->receive(buf, sizeof(buf))) > 0) {handle_packet(buf, len);}
+
+    uint64_t local_us = local_now();
+    if (_leading) {
+        if (local_us - _last_sent_local_us >= SYNC_INTERVAL_MS * 1000ULL) {send_packet();}
+    } else {
+        /* Nobody is leading --> take over (staggered by node id, so the followers don't all take over at once) */
+        uint64_t timeout_us = (SYNC_LEADER_TIMEOUT_MS + (_node_id & 0x0F) * 64ULL) * 1000ULL;
+        if (local_us - _last_packet_local_us >= timeout_us) {
+            _leading = true;
+            _leader_id = _node_id;
+            _leader_pattern_idx = SYNC_NO_PATTERN;
+            send_packet();
+        }
+    }
+}
+
+/* Shared time base (ms) - follows the local clock until a leader was heard */
+uint32_t ghostSync::millis() {
+    return (uint32_t) (micros64() / 1000);
+}
+
+/* Shared time base (us) - follows the local clock until a leader was heard */
+uint64_t ghostSync::micros64() {
+    SYNC_LOCK();
+    advance();
+    uint64_t synced_us = _synced_us;
+    SYNC_UNLOCK();
+
+    return synced_us;
+}
+
+/* Pattern index to broadcast while leading */
+void ghostSync::set_pattern_idx(uint8_t pattern_idx) {
+    _pattern_idx = pattern_idx;
+}
+
+/* Pattern index of the leader, while following (SYNC_NO_PATTERN if none) */
+uint8_t ghostSync::pattern_idx() {
+    return following() ? _leader_pattern_idx : SYNC_NO_PATTERN;
+}
+
+/* Sync state */
+bool ghostSync::leading() {return _transport && _leading;}
+bool ghostSync::following() {return _transport && !_leading && _locked;}
+uint32_t ghostSync::node_id() {return _node_id;}
+uint32_t ghostSync::leader_id() {return _leader_id;}
+int32_t ghostSync::last_error_us() {return _last_error_us;}
+int32_t ghostSync::rate_ppm() {return _rate_ppm;}
+uint16_t ghostSync::step_qty() {return _step_qty;}
+
+/* Move the time base forward, and return the local clock */
+uint64_t ghostSync::local_now() {
+    SYNC_LOCK();
+    advance();
+    uint64_t local_us = _local_us;
+    SYNC_UNLOCK();
+
+    return local_us;
+}
+
+/* Move the time base forward to the current local time (rate trim + slew applied) - called with the lock held */
+void ghostSync::advance() {
+    uint32_t now = micros();
+    uint32_t delta = now - _last_local_us;
+    _last_local_us = now;
+    _local_us += delta;
+
+    /* Rate trim - keep the remainder, so small steps still add up */
+    int64_t trim = (int64_t) delta * _rate_ppm + _rate_rem;
+    int64_t trim_us = trim / 1000000;
+    _rate_rem = trim - trim_us * 1000000;
+
+    /* Slew - the pending error is worked off at up to SYNC_SLEW_PPM of the elapsed time */
+    int64_t slew_us = 0;
+    if (_pending_us) {
+        uint64_t slew_max = (uint64_t) delta * SYNC_SLEW_PPM + _slew_rem;
+        _slew_rem = slew_max % 1000000;
+        slew_max /= 1000000;
+
+        slew_us = constrain(_pending_us, -(int64_t) slew_max, (int64_t) slew_max);
+        _pending_us -= slew_us;
+    }
+
+    _synced_us += delta + trim_us + slew_us;
+}
+
+/* Handle a packet from another ghost */
+void ghostSync::handle_packet(const uint8_t *buf, uint16_t len) {
+    if (len < SYNC_PACKET_LEN || buf[0] != SYNC_MAGIC_0 || buf[1] != SYNC_MAGIC_1 || buf[2] != SYNC_MAGIC_2 || buf[3] != SYNC_VERSION) {return;}
+
+    uint8_t pattern_idx = buf[6];
+    uint32_t node_id = buf[8] | ((uint32_t) buf[9] << 8) | ((uint32_t) buf[10] << 16) | ((uint32_t) buf[11] << 24);
+    uint32_t time_ms = buf[12] | ((uint32_t) buf[13] << 8) | ((uint32_t) buf[14] << 16) | ((uint32_t) buf[15] << 24);
+    uint16_t time_us = buf[16] | (buf[17] << 8);
+    if (node_id == _node_id || time_us >= 1000) {return;}
+
+    /* Two leaders --> the lower node id stays leader (the other one slews over to its time base, unless it's way off) */
+    if (_leading) {
+        if (node_id > _node_id) {return;}
+        _leading = false;
+    }
+
+    /* A follower sticks with its leader, unless a lower node id shows up (or the leader went quiet, see loop()) */
+    SYNC_LOCK();
+    advance();
+    uint64_t local_us = _local_us;
+    bool leader_alive = _locked && (local_us - _last_packet_local_us) < SYNC_LEADER_TIMEOUT_MS * 1000ULL;
+    if (leader_alive && node_id != _leader_id && node_id > _leader_id) {
+        SYNC_UNLOCK();
+        return;
+    }
+
+    /* Error of the time base against the leader's (wrap safe, the ms field is good for +-24 days) */
+    int64_t error_us = (int64_t) (int32_t) (time_ms - (uint32_t) (_synced_us / 1000)) * 1000 + time_us - (int32_t) (_synced_us % 1000) + SYNC_LATENCY_US;
+    uint64_t interval_us = local_us - _last_packet_local_us;
+
+    bool way_off = error_us > SYNC_STEP_MS * 1000LL || error_us < -SYNC_STEP_MS * 1000LL;
+    if (!_locked || way_off) {
+        /* First contact, or way off --> step the time base */
+        _synced_us += error_us;
+        _pending_us = 0;
+        _step_qty++;
+    } else if (node_id != _leader_id) {
+        /* New leader close by --> slew over to its time base (its clock rate is unknown yet, so keep the trim) */
+        _pending_us = error_us;
+    } else {
+        /* Trim the clock rate by a fraction of the drift since the last packet (the error not left over from it), and slew off the error */
+        int64_t drift_us = error_us - _pending_us;
+        _pending_us = error_us;
+        if (interval_us) {
+            _rate_ppm += (int32_t) (drift_us * 1000000 / (int64_t) interval_us / 8);
+            _rate_ppm = constrain(_rate_ppm, -SYNC_MAX_RATE_PPM, SYNC_MAX_RATE_PPM);
+        }
+    }
+    SYNC_UNLOCK();
+
+    _leader_id = node_id;
+    _locked = true;
+
+    _last_error_us = (int32_t) constrain(error_us, (int64_t) INT32_MIN, (int64_t) INT32_MAX);
+    _leader_pattern_idx = pattern_idx;
+    _last_packet_local_us = local_us;
+}
+
+/* Broadcast the time base */
+void ghostSync::send_packet() {
+    SYNC_LOCK();
+    advance();
+    uint64_t local_us = _local_us;
+    uint64_t synced_us = _synced_us;
+    SYNC_UNLOCK();
+
+    uint32_t time_ms = (uint32_t) (synced_us / 1000);
+    uint16_t time_us = synced_us % 1000;
+    _seq++;
+
+    uint8_t buf[SYNC_PACKET_LEN] = {SYNC_MAGIC_0, SYNC_MAGIC_1, SYNC_MAGIC_2, SYNC_VERSION,
+                                    (uint8_t) _seq, (uint8_t) (_seq >> 8), _pattern_idx, 0,
+                                    (uint8_t) _node_id, (uint8_t) (_node_id >> 8), (uint8_t) (_node_id >> 16), (uint8_t) (_node_id >> 24),
+                                    (uint8_t) time_ms, (uint8_t) (time_ms >> 8), (uint8_t) (time_ms >> 16), (uint8_t) (time_ms >> 24),
+                                    (uint8_t) time_us, (uint8_t) (time_us >> 8), 0, 0};
+    _transport->send(buf, sizeof(buf));
+    _last_sent_local_us = local_us;
+}
@@ -0,0 +1,182 @@
+/*
+    ghostSync.h - built from 'lib_template.h'
+    This library is intended to keep several ghosts on one lawn showing the same thing at the
+    same time - a shared time base (which the FastLED timing helpers run on, see main.cpp's
+    get_millisecond_timer) and a shared pattern index.
+
+    Protocol (UDP multicast on the home network, SYNC_GROUP:SYNC_PORT):
+        - every ghost starts as a follower, and listens for a leader
+        - a follower that hears no leader for SYNC_LEADER_TIMEOUT_MS (staggered by node id)
+          becomes the leader; if two leaders hear each other, the lower node id stays leader
+        - the leader broadcasts its time base + pattern index every SYNC_INTERVAL_MS
+        - followers slew their time base towards the leader's, at most SYNC_SLEW_PPM faster or
+          slower than their own clock (the time base never jumps, and never runs backwards),
+          and trim their clock rate to the leader's (crystal drift)
+        - only the first contact with a leader (or an error over SYNC_STEP_MS) steps the time base
+
+    Packet layout (little-endian, 20 bytes):
+        'G' 'S' 'Y' <version> <seq:u16> <pattern_idx:u8> <flags:u8> <node_id:u32> <time_ms:u32> <time_us:u16> <reserved:u16>
+*/
+
+#ifndef ghostSync_h
+    #define ghostSync_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    #ifndef ONLINE_SIMULATION
+        #include <WiFi.h>
+        #include <WiFiUdp.h>
+    #endif
+
+    /* Network configuration */
+    #ifndef SYNC_PORT
+        #define SYNC_PORT 4210
+    #endif
+    #ifndef SYNC_GROUP
+        #define SYNC_GROUP 239, 71, 83, 89              //Multicast group of the ghosts
+    #endif
+
+    /* Timing configuration */
+    #ifndef SYNC_INTERVAL_MS
+        #define SYNC_INTERVAL_MS 250                    //Time between two leader broadcasts
+    #endif
+    #ifndef SYNC_LEADER_TIMEOUT_MS
+        #define SYNC_LEADER_TIMEOUT_MS 2000             //A follower takes over after hearing nothing for this long (+ a stagger by node id)
+    #endif
+    #ifndef SYNC_SLEW_PPM
+        #define SYNC_SLEW_PPM 50000                     //Fastest correction of the time base (50000ppm = 5% faster / slower than real time)
+    #endif
+    #ifndef SYNC_STEP_MS
+        #define SYNC_STEP_MS 1000                       //Errors larger than this are stepped instead of slewed
+    #endif
+    #ifndef SYNC_MAX_RATE_PPM
+        #define SYNC_MAX_RATE_PPM 500                   //Largest clock rate trim (crystals are within ~50ppm)
+    #endif
+    #ifndef SYNC_LATENCY_US
+        #define SYNC_LATENCY_US 0                       //Expected one-way network latency, added to the leader's time
+    #endif
+
+    /* Packet definitions */
+    #define SYNC_MAGIC_0 'G'
+    #define SYNC_MAGIC_1 'S'
+    #define SYNC_MAGIC_2 'Y'
+    #define SYNC_VERSION 1
+    #define SYNC_PACKET_LEN 20
+    #define SYNC_NO_PATTERN 0xFF
+
+    /* Link between the ghosts (UDP multicast on the ghost, loopback sockets in the host tools) */
+    class syncTransport
+    {
+        public:
+            virtual ~syncTransport() {}
+
+            /* Returns true while packets can be sent / received (e.g. WiFi is connected) */
+            virtual bool ready() = 0;
+
+            /* Send a packet to every other ghost */
+            virtual bool send(const uint8_t *buf, uint16_t len) = 0;
+
+            /* Receive the next packet - returns its length (0 if nothing is waiting) */
+            virtual uint16_t receive(uint8_t *buf, uint16_t len) = 0;
+    };
+
+    #ifndef ONLINE_SIMULATION
+        /* UDP multicast on the WiFi network - joins the group whenever WiFi (re)connects */
+        class udpSyncTransport : public syncTransport
+        {
+            public:
+                udpSyncTransport() : _joined(false) {}
+
+                bool ready() {
+                    if (WiFi.status() != WL_CONNECTED) {_joined = false; return false;}
+                    if (!_joined) {_joined = _udp.beginMulticast(IPAddress(SYNC_GROUP), SYNC_PORT);}
+                    return _joined;
+                }
+
+                bool send(const uint8_t *buf, uint16_t len) {
+                    return _udp.beginMulticastPacket() && _udp.write(buf, len) == len && _udp.endPacket();
+                }
+
+                uint16_t receive(uint8_t *buf, uint16_t len) {
+                    if (!_udp.parsePacket()) {return 0;}
+                    int read = _udp.read(buf, len);
+                    return (read > 0) ? read : 0;
+                }
+
+            private:
+                WiFiUDP _udp;
+                bool _joined;
+        };
+    #endif
+
+    /* Class container */
+    class ghostSync
+    {
+        public:
+            /* Start syncing over the transport - node_id must be unique per ghost (e.g. mac_node_id() of the MAC address) */
+            static void begin(syncTransport *transport, uint32_t node_id);
+
+            /* Node id from a 48b MAC address - all of its bits are mixed in (the vendor bytes are the same on every ghost) */
+            static uint32_t mac_node_id(uint64_t mac);
+
+            /* Receive / send sync packets (call from the main loop) */
+            static void loop();
+
+            /* Shared time base (ms / us) - follows the local clock until a leader was heard */
+            static uint32_t millis();
+            static uint64_t micros64();
+
+            /* Pattern index to broadcast while leading */
+            static void set_pattern_idx(uint8_t pattern_idx);
+
+            /* Pattern index of the leader, while following (SYNC_NO_PATTERN if none) */
+            static uint8_t pattern_idx();
+
+            /* Sync state */
+            static bool leading();
+            static bool following();
+            static uint32_t node_id();
+            static uint32_t leader_id();
+            static int32_t last_error_us();         //Time base error measured on the latest leader packet
+            static int32_t rate_ppm();              //Clock rate trim
+            static uint16_t step_qty();             //Qty of times the time base was stepped
+
+        private:
+            /* Move the time base forward, and return the local clock */
+            static uint64_t local_now();
+
+            /* Move the time base forward to the current local time (rate trim + slew applied) - called with the lock held */
+            static void advance();
+
+            /* Handle a packet from another ghost */
+            static void handle_packet(const uint8_t *buf, uint16_t len);
+
+            /* Broadcast the time base */
+            static void send_packet();
+
+            static syncTransport *_transport;
+            static uint32_t _node_id;
+            static uint32_t _leader_id;
+            static bool _leading;
+            static bool _locked;
+            static uint8_t _pattern_idx;
+            static uint8_t _leader_pattern_idx;
+            static uint16_t _seq;
+
+            /* Local clock (extended to 64b) and the time base */
+            static uint32_t _last_local_us;
+            static uint64_t _local_us;
+            static uint64_t _synced_us;
+
+            /* Corrections */
+            static int32_t _rate_ppm;
+            static int64_t _rate_rem;
+            static uint64_t _slew_rem;
+            static int64_t _pending_us;
+            static int32_t _last_error_us;
+            static uint64_t _last_packet_local_us;
+            static uint64_t _last_sent_local_us;
+            static uint16_t _step_qty;
+    };
+#endif
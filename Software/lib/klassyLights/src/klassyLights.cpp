@@ -29,7 +29,7 @@
 
 /* Initialize static class variables defined in the header file */
 lightTools *klassyLights::_lightTools = NULL;
-CRGB *klassyLights::_led_arr = NULL;
+ledSpan klassyLights::_led_arr;
 uint16_t klassyLights::_led_qty = 0;
 uint16_t klassyLights::_led_midpoint = 0;
 uint16_t klassyLights::_rotating_light_index = 0;
@@ -42,7 +42,7 @@ klassyLights::klassyLights(CRGB *led_arr, uint16_t led_qty, lightTools *lightToo
     _lightTools = lightTools;
     
     /* update the class-bound pointers / variables */
-    _led_arr = led_arr;
+    _led_arr = ledSpan(led_arr, led_qty);
     _led_qty = led_qty;
 
     /* calculate the midpoint */
@@ -61,18 +61,20 @@ void klassyLights::rainbow_pattern() {
     EVERY_N_MILLISECONDS(20) {rainbow_hue++;}
 
     /* Run the FastLED rainbow function */
-    fill_rainbow(_led_arr, _led_qty, rainbow_hue,  7);
+    fill_rainbow(_led_arr.data(), _led_qty, rainbow_hue,  7);
 }
 
 /* Draw a simple red/white pattern to resemble a candy cane */
 /* Return the size of the pattern to a calling function, to allow upstream functions to cycle through if desired */
 uint8_t klassyLights::candy_cane(uint8_t starting_index/*=0*/, uint8_t fade_amount/*=0*/) {
-  /* set entire strip to RedRedWhiteWhite pattern */
-  uint32_t light_pattern[] = {CRGB::Red, CRGB::Red, CRGB::Red, CRGB::Red, CRGB::Red, CRGB::Red, CRGB::White, CRGB::White, CRGB::White, CRGB::White, CRGB::White, CRGB::White};
+  /* set entire strip to RedRedWhiteWhite pattern (palette entries 0 and 1) */
+  CRGB red = _lightTools->palette(LIGHT_PAL(0));
+  CRGB white = _lightTools->palette(LIGHT_PAL(1));
+  CRGB light_pattern[] = {red, red, red, red, red, red, white, white, white, white, white, white};
   uint8_t qty_of_pattern = LIGHT_ARRAY_SIZE(light_pattern);
 
   /* draw the pattern - skipping over the "eye" positions */
-  _lightTools->fill_light_pattern(_led_arr, _led_qty, light_pattern, qty_of_pattern, starting_index, fade_amount);
+  _lightTools->fill_light_pattern(_led_arr.data(), _led_qty, light_pattern, qty_of_pattern, starting_index, fade_amount);
 
   return qty_of_pattern;
 }
@@ -80,12 +82,12 @@ uint8_t klassyLights::candy_cane(uint8_t starting_index/*=0*/, uint8_t fade_amou
 /* Draw a simple red/green/white pattern to resemble christmas spirit */
 /* Return the size of the pattern to a calling function, to allow upstream functions to cycle through if desired */
 uint8_t klassyLights::christmas_spirit(uint8_t starting_index/*=0*/, uint8_t fade_amount/*=0*/) {
-  /* set entire strip to RedWhiteGreen pattern */
-  uint32_t light_pattern[] = {CRGB::Red, CRGB::White, CRGB::Green};
+  /* set entire strip to RedWhiteGreen pattern (palette entries 0, 1 and 2) */
+  CRGB light_pattern[] = {_lightTools->palette(LIGHT_PAL(0)), _lightTools->palette(LIGHT_PAL(1)), _lightTools->palette(LIGHT_PAL(2))};
   uint8_t qty_of_pattern = LIGHT_ARRAY_SIZE(light_pattern);
 
   /* draw the pattern - skipping over the "eye" positions */
-  _lightTools->fill_light_pattern(_led_arr, _led_qty, light_pattern, qty_of_pattern, starting_index, fade_amount);
+  _lightTools->fill_light_pattern(_led_arr.data(), _led_qty, light_pattern, qty_of_pattern, starting_index, fade_amount);
 
   return qty_of_pattern;
 }
@@ -103,32 +105,32 @@ void klassyLights::rotating_christmas_spirit() {
 /* Bouncing lights from end-to-end, with the colors of a candy cane */
 void klassyLights::juggle_candy_cane() {
   /* Fade all of the lights by 20 */
-  fadeToBlackBy(_led_arr, _led_qty, 20);
+  fadeToBlackBy(_led_arr.data(), _led_qty, 20);
 
   /* First light = Red */
-  _led_arr[beatsin16(7, 0, _led_qty - 1)] |= CHSV(0, 255, 255);
+  _led_arr[beatsin16(7, 0, _led_qty - 1)] |= _lightTools->palette(LIGHT_PAL(0));
 
   /* Second light = Pink */
-  _led_arr[beatsin16(14, 0, _led_qty - 1)] |= CHSV(225, 201, 255);
+  _led_arr[beatsin16(14, 0, _led_qty - 1)] |= _lightTools->palette(LIGHT_PAL(5));
 
   /* Third light = Offwhite */
-  _led_arr[beatsin16(21, 0, _led_qty - 1)] |= 0xFFFCE6;  //offwhite
+  _led_arr[beatsin16(21, 0, _led_qty - 1)] |= _lightTools->palette(LIGHT_PAL(4));
 
 }
 
 /* Bouncing lights from end-to-end, with the colors of a christmas spirit */
 void klassyLights::juggle_christmas_spirit() {
   /* Fade all of the lights by 20 */
-  fadeToBlackBy(_led_arr, _led_qty, 20);
+  fadeToBlackBy(_led_arr.data(), _led_qty, 20);
 
   /* First light = Red */
-  _led_arr[beatsin16(7, 0, _led_qty - 1)] |= CHSV(0, 255, 255);
+  _led_arr[beatsin16(7, 0, _led_qty - 1)] |= _lightTools->palette(LIGHT_PAL(0));
 
   /* Second light = Offwhite */
-  _led_arr[beatsin16(14, 0, _led_qty - 1)] |= 0xFFFCE6;  //offwhite
+  _led_arr[beatsin16(14, 0, _led_qty - 1)] |= _lightTools->palette(LIGHT_PAL(4));
 
   /* Third light = Green */
-  _led_arr[beatsin16(21, 0, _led_qty - 1)] |= CHSV(80, 255, 255);
+  _led_arr[beatsin16(21, 0, _led_qty - 1)] |= _lightTools->palette(LIGHT_PAL(6));
 
 }
 
@@ -149,9 +151,9 @@ void klassyLights::jacobs_ladder() {
   /* initialize persistent variables */
   static uint8_t explosion_time = false;
 
-  if (!explosion_time) {explosion_time = travel_light_to_mid(CRGB::Aquamarine, 5);}
+  if (!explosion_time) {explosion_time = travel_light_to_mid(_lightTools->palette(LIGHT_PAL(7)), 5);}
   else {
-      EVERY_N_MILLISECONDS( 1 ) {fadeToBlackBy(_led_arr, _led_qty, 10);}
+      EVERY_N_MILLISECONDS( 1 ) {fadeToBlackBy(_led_arr.data(), _led_qty, 10);}
       EVERY_N_SECONDS( 2 ) { 
         explosion_time = !explosion_time;
         reset_travelling_lights();
@@ -214,7 +216,7 @@ uint8_t klassyLights::travel_light_to_mid(CRGB lead_light_color/*=CRGB::White*/,
     Note: if trail_length = 0, no fading will be done
   */
   //uint8_t fade_amount = (trail_length ? (uint8_t) (6 * 255 / (TRAVEL_LIGHT_TO_MID_TIMER_MS * trail_length)) : 0);
-  //EVERY_N_MILLISECONDS( 1 ) {fadeToBlackBy(_led_arr, _led_qty, fade_amount);}
+  //EVERY_N_MILLISECONDS( 1 ) {fadeToBlackBy(_led_arr.data(), _led_qty, fade_amount);}
 
   return (_travelling_light_start_pos > _travelling_light_end_pos);
 }
\ No newline at end of file
@@ -85,8 +85,8 @@
             /* Class bound lightTools pointer */
             static lightTools *_lightTools;
 
-            /* Class bound led array pointer */
-            static CRGB *_led_arr;
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
 
             /* Class bound led quantity */
             static uint16_t _led_qty;
@@ -0,0 +1,388 @@
+/*
+    lightScript.h - built from 'lib_template.h'
+    This library is intended to run small "light scripts" (compact bytecode programs)
+    over the LED array, so new light patterns can be shipped to the ghost without
+    needing to reflash the firmware.
+
+    See lightScript.h for the script container layout and the instruction set.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <lightScript.h>
+    #include <Preferences.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *lightScript::_lightTools = NULL;
+ledSpan lightScript::_led_arr;
+uint16_t lightScript::_led_qty = 0;
+uint8_t lightScript::_code[LSCRIPT_MAX_CODE_LEN];
+uint16_t lightScript::_code_len = 0;
+uint16_t lightScript::_reg[LSCRIPT_REG_QTY];
+CRGB lightScript::_color[LSCRIPT_COLOR_QTY];
+uint32_t lightScript::_timer[LSCRIPT_TIMER_QTY];
+
+/* Built-in default script - the same red/white fading candy cane as klassyLights::fading_candy_cane */
+const uint8_t lightScript::_default_script[] PROGMEM = {
+    LSCRIPT_MAGIC_0, LSCRIPT_MAGIC_1, LSCRIPT_VERSION, 55, 0,
+    LS_OP_RGB, 0, 0xFF, 0x00, 0x00,         //  RGB c0 #FF0000
+    LS_OP_RGB, 1, 0xFF, 0xFF, 0xFF,         //  RGB c1 #FFFFFF
+    LS_OP_EVERY, 0, 200, 0, 22, 0,          //  EVERY t0 200 -> skip 22 bytes
+    LS_OP_LDI, 1, 1, 0,                     //      LDI r1 1
+    LS_OP_PAT, 0, 2, 6, 0, 1,               //      PAT c0 2 6 r0 r1
+    LS_OP_ADDI, 0, 1, 0,                    //      ADDI r0 1
+    LS_OP_LDI, 2, 12, 0,                    //      LDI r2 12
+    LS_OP_MOD, 0, 0, 2,                     //      MOD r0 r0 r2
+    LS_OP_EVERY, 1, 1, 0, 10, 0,            //  EVERY t1 1 -> skip 10 bytes
+    LS_OP_LDI, 1, 3, 0,                     //      LDI r1 3
+    LS_OP_PAT, 0, 2, 6, 0, 1,               //      PAT c0 2 6 r0 r1
+    LS_OP_END                               //  END
+};
+const uint16_t lightScript::_default_script_len = sizeof(lightScript::_default_script);
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+lightScript::lightScript(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = led_qty;
+
+    /* Start with the built-in script, until something else is loaded */
+    load_default();
+}
+
+/* Total length (opcode + operands) of an instruction, or 0 if the opcode is unknown */
+uint8_t lightScript::op_len(uint8_t op) {
+    switch (op) {
+        case LS_OP_END:     return 1;
+        case LS_OP_FILL:    return 2;
+        case LS_OP_SPAN:    return 4;
+        case LS_OP_BLEND:   return 5;
+        case LS_OP_FADE:    return 2;
+        case LS_OP_PIXEL:   return 3;
+        case LS_OP_ADDPIX:  return 3;
+        case LS_OP_PAT:     return 6;
+        case LS_OP_RGB:     return 5;
+        case LS_OP_HSV:     return 5;
+        case LS_OP_LDI:     return 4;
+        case LS_OP_MOV:     return 3;
+        case LS_OP_ADD:     return 4;
+        case LS_OP_SUB:     return 4;
+        case LS_OP_MOD:     return 4;
+        case LS_OP_ADDI:    return 4;
+        case LS_OP_QTY:     return 2;
+        case LS_OP_TIME:    return 3;
+        case LS_OP_BEATSIN: return 5;
+        case LS_OP_EVERY:   return 6;
+        case LS_OP_JMP:     return 3;
+        case LS_OP_JZ:      return 4;
+        case LS_OP_JNZ:     return 4;
+        case LS_OP_JLT:     return 5;
+        default:            return 0;
+    }
+}
+
+/* Validate the code section of a script (opcodes, operands, jump targets) */
+bool lightScript::validate(const uint8_t *code, uint16_t code_len) {
+    /* Bitmap of the offsets where an instruction starts (jumps must land on one of these, or at the very end) */
+    uint8_t op_start[(LSCRIPT_MAX_CODE_LEN + 7) / 8];
+    memset(op_start, 0, sizeof(op_start));
+
+    /* First pass - check every instruction is known, fully contained, and only uses valid registers */
+    for (uint16_t pc = 0; pc < code_len; ) {
+        const uint8_t *ins = &code[pc];
+        uint8_t len = op_len(ins[0]);
+        if (!len || (pc + len) > code_len) {return false;}
+
+        bool valid = true;
+        switch (ins[0]) {
+            case LS_OP_FILL:    valid = ins[1] < LSCRIPT_COLOR_QTY; break;
+            case LS_OP_SPAN:    valid = ins[1] < LSCRIPT_COLOR_QTY && ins[2] < LSCRIPT_REG_QTY && ins[3] < LSCRIPT_REG_QTY; break;
+            case LS_OP_BLEND:   valid = ins[1] < LSCRIPT_COLOR_QTY && ins[2] < LSCRIPT_REG_QTY && ins[3] < LSCRIPT_REG_QTY && ins[4] < LSCRIPT_REG_QTY; break;
+            case LS_OP_FADE:    valid = ins[1] < LSCRIPT_REG_QTY; break;
+            case LS_OP_PIXEL:
+            case LS_OP_ADDPIX:  valid = ins[1] < LSCRIPT_COLOR_QTY && ins[2] < LSCRIPT_REG_QTY; break;
+            case LS_OP_PAT:     valid = ins[2] && ins[3] && (ins[1] + ins[2]) <= LSCRIPT_COLOR_QTY && ins[4] < LSCRIPT_REG_QTY && ins[5] < LSCRIPT_REG_QTY; break;
+            case LS_OP_RGB:     valid = ins[1] < LSCRIPT_COLOR_QTY; break;
+            case LS_OP_HSV:     valid = ins[1] < LSCRIPT_COLOR_QTY && ins[2] < LSCRIPT_REG_QTY && ins[3] < LSCRIPT_REG_QTY && ins[4] < LSCRIPT_REG_QTY; break;
+            case LS_OP_LDI:
+            case LS_OP_ADDI:
+            case LS_OP_QTY:     valid = ins[1] < LSCRIPT_REG_QTY; break;
+            case LS_OP_MOV:     valid = ins[1] < LSCRIPT_REG_QTY && ins[2] < LSCRIPT_REG_QTY; break;
+            case LS_OP_ADD:
+            case LS_OP_SUB:
+            case LS_OP_MOD:     valid = ins[1] < LSCRIPT_REG_QTY && ins[2] < LSCRIPT_REG_QTY && ins[3] < LSCRIPT_REG_QTY; break;
+            case LS_OP_TIME:    valid = ins[1] < LSCRIPT_REG_QTY && ins[2] < 32; break;
+            case LS_OP_BEATSIN: valid = ins[1] < LSCRIPT_REG_QTY && ins[2] < LSCRIPT_REG_QTY && ins[3] < LSCRIPT_REG_QTY && ins[4] < LSCRIPT_REG_QTY; break;
+            case LS_OP_EVERY:   valid = ins[1] < LSCRIPT_TIMER_QTY; break;
+            case LS_OP_JZ:
+            case LS_OP_JNZ:     valid = ins[1] < LSCRIPT_REG_QTY; break;
+            case LS_OP_JLT:     valid = ins[1] < LSCRIPT_REG_QTY && ins[2] < LSCRIPT_REG_QTY; break;
+        }
+        if (!valid) {return false;}
+
+        op_start[pc >> 3] |= (1 << (pc & 0x07));
+        pc += len;
+    }
+
+    /* Second pass - check every jump lands on an instruction (or exactly at the end of the code) */
+    for (uint16_t pc = 0; pc < code_len; pc += op_len(code[pc])) {
+        uint8_t len = op_len(code[pc]);
+        int32_t target;
+        switch (code[pc]) {
+            case LS_OP_EVERY:
+            case LS_OP_JMP:
+            case LS_OP_JZ:
+            case LS_OP_JNZ:
+            case LS_OP_JLT:
+                target = (int32_t) (pc + len) + (int16_t) (code[pc + len - 2] | (code[pc + len - 1] << 8));
+                if (target < 0 || target > code_len) {return false;}
+                if (target < code_len && !(op_start[target >> 3] & (1 << (target & 0x07)))) {return false;}
+                break;
+        }
+    }
+
+    return true;
+}
+
+/* Reset the machine state (registers, colors, timers) */
+void lightScript::reset_state() {
+    memset(_reg, 0, sizeof(_reg));
+    for (uint8_t i = 0; i < LSCRIPT_COLOR_QTY; i++) {_color[i] = CRGB::Black;}
+    for (uint8_t i = 0; i < LSCRIPT_TIMER_QTY; i++) {_timer[i] = GET_MILLIS();}
+}
+
+/* Validate and load a script container - returns false (and keeps the current script) if it is invalid */
+bool lightScript::load(const uint8_t *script, uint16_t script_len) {
+    /* Check the container header */
+    if (script_len < LSCRIPT_HEADER_LEN) {return false;}
+    if (script[0] != LSCRIPT_MAGIC_0 || script[1] != LSCRIPT_MAGIC_1 || script[2] != LSCRIPT_VERSION) {return false;}
+
+    uint16_t code_len = script[3] | (script[4] << 8);
+    if (code_len > LSCRIPT_MAX_CODE_LEN || (uint32_t) code_len + LSCRIPT_HEADER_LEN > script_len) {return false;}
+
+    /* Check the code itself before replacing the running script */
+    if (!validate(&script[LSCRIPT_HEADER_LEN], code_len)) {return false;}
+
+    memcpy(_code, &script[LSCRIPT_HEADER_LEN], code_len);
+    _code_len = code_len;
+    reset_state();
+    return true;
+}
+
+/* Decode a hex string into a script container and load it - returns false if it is invalid */
+bool lightScript::load_hex(const char *hex) {
+    uint8_t script[LSCRIPT_HEADER_LEN + LSCRIPT_MAX_CODE_LEN];
+    uint16_t script_len = 0;
+
+    for (; hex[0] && hex[1]; hex += 2) {
+        if (script_len >= sizeof(script)) {return false;}
+
+        uint8_t value = 0;
+        for (uint8_t nibble = 0; nibble < 2; nibble++) {
+            char c = hex[nibble];
+            value <<= 4;
+            if (c >= '0' && c <= '9') {value |= c - '0';}
+            else if (c >= 'a' && c <= 'f') {value |= c - 'a' + 10;}
+            else if (c >= 'A' && c <= 'F') {value |= c - 'A' + 10;}
+            else {return false;}
+        }
+        script[script_len++] = value;
+    }
+
+    /* An odd number of characters isn't a valid hex string */
+    if (hex[0]) {return false;}
+
+    return load(script, script_len);
+}
+
+/* Load the built-in default script */
+void lightScript::load_default() {
+    uint8_t script[sizeof(_default_script)];
+    memcpy_P(script, _default_script, sizeof(script));
+    load(script, sizeof(script));
+}
+
+/* Save the currently loaded script to flash, so it is restored after a reboot */
+bool lightScript::save() {
+    #ifndef ONLINE_SIMULATION
+        Preferences prefs;
+        if (!prefs.begin("lscript", false)) {return false;}
+
+        uint8_t header[LSCRIPT_HEADER_LEN] = {LSCRIPT_MAGIC_0, LSCRIPT_MAGIC_1, LSCRIPT_VERSION, (uint8_t) (_code_len & 0xFF), (uint8_t) (_code_len >> 8)};
+        bool saved = prefs.putBytes("head", header, sizeof(header)) == sizeof(header) &&
+                     prefs.putBytes("code", _code, _code_len) == _code_len;
+        prefs.end();
+        return saved;
+    #else
+        return false;
+    #endif
+}
+
+/* Restore the script saved in flash (or the built-in default, if nothing valid was saved) */
+bool lightScript::restore() {
+    #ifndef ONLINE_SIMULATION
+        Preferences prefs;
+        if (prefs.begin("lscript", true)) {
+            uint8_t script[LSCRIPT_HEADER_LEN + LSCRIPT_MAX_CODE_LEN];
+            size_t head_len = prefs.getBytes("head", script, LSCRIPT_HEADER_LEN);
+            size_t code_len = prefs.getBytes("code", &script[LSCRIPT_HEADER_LEN], LSCRIPT_MAX_CODE_LEN);
+            prefs.end();
+
+            if (head_len == LSCRIPT_HEADER_LEN && load(script, LSCRIPT_HEADER_LEN + code_len)) {return true;}
+        }
+    #endif
+
+    load_default();
+    return false;
+}
+
+/* Erase the script saved in flash, and go back to the built-in default */
+void lightScript::erase() {
+    #ifndef ONLINE_SIMULATION
+        Preferences prefs;
+        if (prefs.begin("lscript", false)) {
+            prefs.clear();
+            prefs.end();
+        }
+    #endif
+
+    load_default();
+}
+
+/* Size (in bytes) of the currently loaded script's code */
+uint16_t lightScript::code_len() {
+    return _code_len;
+}
+
+/* Run the currently loaded script for one frame (to be called from the 'main.cpp' pattern list) */
+void lightScript::run() {
+    const uint8_t *code = _code;
+    uint16_t pc = 0;
+
+    for (uint16_t ops = 0; pc < _code_len && ops < LSCRIPT_MAX_OPS_PER_FRAME; ops++) {
+        const uint8_t *ins = &code[pc];
+        pc += op_len(ins[0]);
+
+        switch (ins[0]) {
+            case LS_OP_END:
+                return;
+
+            case LS_OP_FILL:
+                fill_solid(_led_arr.data(), _led_qty, _color[ins[1]]);
+                break;
+
+            case LS_OP_SPAN: {
+                uint16_t end = min(_reg[ins[3]], _led_qty);
+                for (uint16_t i = _reg[ins[2]]; i < end; i++) {_led_arr[i] = _color[ins[1]];}
+                break;
+            }
+
+            case LS_OP_BLEND: {
+                uint16_t end = min(_reg[ins[3]], _led_qty);
+                uint8_t amount = _reg[ins[4]];
+                for (uint16_t i = _reg[ins[2]]; i < end; i++) {_led_arr[i] = _lightTools->fadeToColor(_led_arr[i], _color[ins[1]], amount);}
+                break;
+            }
+
+            case LS_OP_FADE:
+                fadeToBlackBy(_led_arr.data(), _led_qty, (uint8_t) _reg[ins[1]]);
+                break;
+
+            case LS_OP_PIXEL:
+                if (_reg[ins[2]] < _led_qty) {_led_arr[_reg[ins[2]]] = _color[ins[1]];}
+                break;
+
+            case LS_OP_ADDPIX:
+                if (_reg[ins[2]] < _led_qty) {_led_arr[_reg[ins[2]]] += _color[ins[1]];}
+                break;
+
+            case LS_OP_PAT: {
+                /* Walk the pattern the same way lightTools::fill_light_pattern does, without building a color array */
+                const CRGB *colors = &_color[ins[1]];
+                uint8_t width = ins[3];
+                uint16_t period = ins[2] * width;
+                uint16_t pattern_index = _reg[ins[4]] % period;
+                uint8_t amount = _reg[ins[5]];
+
+                for (uint16_t i = 0; i < _led_qty; i++) {
+                    const CRGB &color = colors[pattern_index / width];
+                    _led_arr[i] = amount ? _lightTools->fadeToColor(_led_arr[i], color, amount) : color;
+                    if (++pattern_index >= period) {pattern_index = 0;}
+                }
+                break;
+            }
+
+            case LS_OP_RGB:
+                _color[ins[1]] = CRGB(ins[2], ins[3], ins[4]);
+                break;
+
+            case LS_OP_HSV:
+                _color[ins[1]] = CHSV(_reg[ins[2]], _reg[ins[3]], _reg[ins[4]]);
+                break;
+
+            case LS_OP_LDI:
+                _reg[ins[1]] = ins[2] | (ins[3] << 8);
+                break;
+
+            case LS_OP_MOV:
+                _reg[ins[1]] = _reg[ins[2]];
+                break;
+
+            case LS_OP_ADD:
+                _reg[ins[1]] = _reg[ins[2]] + _reg[ins[3]];
+                break;
+
+            case LS_OP_SUB:
+                _reg[ins[1]] = _reg[ins[2]] - _reg[ins[3]];
+                break;
+
+            case LS_OP_MOD:
+                _reg[ins[1]] = _reg[ins[3]] ? (_reg[ins[2]] % _reg[ins[3]]) : 0;
+                break;
+
+            case LS_OP_ADDI:
+                _reg[ins[1]] += ins[2] | (ins[3] << 8);
+                break;
+
+            case LS_OP_QTY:
+                _reg[ins[1]] = _led_qty;
+                break;
+
+            case LS_OP_TIME:
+                _reg[ins[1]] = (uint16_t) (GET_MILLIS() >> ins[2]);
+                break;
+
+            case LS_OP_BEATSIN:
+                _reg[ins[1]] = beatsin16(_reg[ins[2]], _reg[ins[3]], _reg[ins[4]]);
+                break;
+
+            case LS_OP_EVERY: {
+                /* Same behavior as FastLED's EVERY_N_MILLISECONDS --> run the block once the period has elapsed, then restart the timer */
+                uint32_t now = GET_MILLIS();
+                if ((now - _timer[ins[1]]) >= (uint16_t) (ins[2] | (ins[3] << 8))) {_timer[ins[1]] = now;}
+                else {pc += (int16_t) (ins[4] | (ins[5] << 8));}
+                break;
+            }
+
+            case LS_OP_JMP:
+                pc += (int16_t) (ins[1] | (ins[2] << 8));
+                break;
+
+            case LS_OP_JZ:
+                if (!_reg[ins[1]]) {pc += (int16_t) (ins[2] | (ins[3] << 8));}
+                break;
+
+            case LS_OP_JNZ:
+                if (_reg[ins[1]]) {pc += (int16_t) (ins[2] | (ins[3] << 8));}
+                break;
+
+            case LS_OP_JLT:
+                if (_reg[ins[1]] < _reg[ins[2]]) {pc += (int16_t) (ins[3] | (ins[4] << 8));}
+                break;
+        }
+    }
+}
@@ -0,0 +1,175 @@
+/*
+    lightScript.h - built from 'lib_template.h'
+    This library is intended to run small "light scripts" (compact bytecode programs)
+    over the LED array, so new light patterns can be shipped to the ghost without
+    needing to reflash the firmware.
+
+    A script is executed once per frame (each time 'run' is called by 'main.cpp').
+    Most instructions operate on a whole span of lights at once, so the per-frame
+    interpreter overhead stays small compared to the actual pixel work.
+
+    Script container layout (all multi-byte values are little-endian):
+        'L' 'S' <version> <code_len_lo> <code_len_hi> <code[code_len]>
+
+    Machine state (persists from frame to frame, reset whenever a new script is loaded):
+        r0..r15  - 16b general purpose registers
+        c0..c7   - color registers
+        t0..t7   - timers for the EVERY instruction (same behavior as FastLED's EVERY_N_MILLISECONDS)
+
+    Instruction set ('r' = register index, 'c' = color index, 't' = timer index, 'rel' = signed 16b jump from the next instruction):
+        0x00 END                            stop executing for this frame
+        0x01 FILL   c                       fill the whole array with c
+        0x02 SPAN   c ra rb                 fill lights [ra, rb) with c
+        0x03 BLEND  c ra rb ramt            blend lights [ra, rb) towards c by ramt (lightTools::fadeToColor)
+        0x04 FADE   ramt                    fade the whole array towards black by ramt
+        0x05 PIXEL  c ra                    set light ra to c
+        0x06 ADDPIX c ra                    add c to light ra (saturating)
+        0x07 PAT    c qty width rofs ramt   repeat colors c..c+qty-1 (each 'width' lights wide), shifted by rofs, blended by ramt (0 = no blending)
+        0x10 RGB    c r g b                 load a constant color into c
+        0x11 HSV    c rh rs rv              load CHSV(rh, rs, rv) into c
+        0x20 LDI    r imm16                 r = imm16
+        0x21 MOV    r ra                    r = ra
+        0x22 ADD    r ra rb                 r = ra + rb
+        0x23 SUB    r ra rb                 r = ra - rb
+        0x24 MOD    r ra rb                 r = ra % rb (0 if rb is 0)
+        0x25 ADDI   r imm16                 r = r + imm16
+        0x26 QTY    r                       r = qty of lights in the array
+        0x30 TIME   r shift                 r = (millis >> shift) & 0xFFFF
+        0x31 BEATSIN r rbpm rlo rhi         r = beatsin16(rbpm, rlo, rhi)
+        0x32 EVERY  t imm16 rel             jump by rel unless timer t has elapsed imm16 ms (then restart it)
+        0x40 JMP    rel                     jump by rel
+        0x41 JZ     ra rel                  jump by rel if ra == 0
+        0x42 JNZ    ra rel                  jump by rel if ra != 0
+        0x43 JLT    ra rb rel               jump by rel if ra < rb
+
+    Scripts are fully validated when loaded (opcodes, register indices and jump targets), so the
+    interpreter itself does not need to re-check them every frame.  Each frame is also limited
+    to LSCRIPT_MAX_OPS_PER_FRAME instructions, so a looping script can't starve the main loop.
+
+    Scripts can be authored with 'tools/lightScript/lsasm.py' and uploaded as hex with the
+    'script load <hex>' console command (or a POST to '/script' on the configuration web server).
+*/
+
+#ifndef lightScript_h
+    #define lightScript_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+    #endif
+
+    /* Script container definitions */
+    #define LSCRIPT_MAGIC_0 'L'
+    #define LSCRIPT_MAGIC_1 'S'
+    #define LSCRIPT_VERSION 1
+    #define LSCRIPT_HEADER_LEN 5
+
+    /* Machine limits */
+    #ifndef LSCRIPT_MAX_CODE_LEN
+        #ifdef __AVR__
+            #define LSCRIPT_MAX_CODE_LEN 64     //Fits the built-in script - nothing else can be loaded on the online simulator's AVR
+        #else
+            #define LSCRIPT_MAX_CODE_LEN 512    //Maximum size of a script's code section (bytes)
+        #endif
+    #endif
+    #define LSCRIPT_REG_QTY 16                  //Qty of general purpose registers
+    #define LSCRIPT_COLOR_QTY 8                 //Qty of color registers
+    #define LSCRIPT_TIMER_QTY 8                 //Qty of EVERY timers
+    #define LSCRIPT_MAX_OPS_PER_FRAME 2048      //Instruction budget for a single frame
+
+    /* Instruction opcodes */
+    enum lightScriptOp : uint8_t {
+        LS_OP_END = 0x00,
+        LS_OP_FILL = 0x01,
+        LS_OP_SPAN = 0x02,
+        LS_OP_BLEND = 0x03,
+        LS_OP_FADE = 0x04,
+        LS_OP_PIXEL = 0x05,
+        LS_OP_ADDPIX = 0x06,
+        LS_OP_PAT = 0x07,
+        LS_OP_RGB = 0x10,
+        LS_OP_HSV = 0x11,
+        LS_OP_LDI = 0x20,
+        LS_OP_MOV = 0x21,
+        LS_OP_ADD = 0x22,
+        LS_OP_SUB = 0x23,
+        LS_OP_MOD = 0x24,
+        LS_OP_ADDI = 0x25,
+        LS_OP_QTY = 0x26,
+        LS_OP_TIME = 0x30,
+        LS_OP_BEATSIN = 0x31,
+        LS_OP_EVERY = 0x32,
+        LS_OP_JMP = 0x40,
+        LS_OP_JZ = 0x41,
+        LS_OP_JNZ = 0x42,
+        LS_OP_JLT = 0x43
+    };
+
+    /* Class container */
+    class lightScript
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            lightScript(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Run the currently loaded script for one frame (to be called from the 'main.cpp' pattern list) */
+            static void run();
+
+            /* Validate and load a script container - returns false (and keeps the current script) if it is invalid */
+            static bool load(const uint8_t *script, uint16_t script_len);
+
+            /* Decode a hex string into a script container and load it - returns false if it is invalid */
+            static bool load_hex(const char *hex);
+
+            /* Load the built-in default script */
+            static void load_default();
+
+            /* Save the currently loaded script to flash, so it is restored after a reboot */
+            static bool save();
+
+            /* Restore the script saved in flash (or the built-in default, if nothing valid was saved) */
+            static bool restore();
+
+            /* Erase the script saved in flash, and go back to the built-in default */
+            static void erase();
+
+            /* Size (in bytes) of the currently loaded script's code */
+            static uint16_t code_len();
+
+        private:
+            /* Validate the code section of a script (opcodes, operands, jump targets) */
+            static bool validate(const uint8_t *code, uint16_t code_len);
+
+            /* Total length (opcode + operands) of an instruction, or 0 if the opcode is unknown */
+            static uint8_t op_len(uint8_t op);
+
+            /* Reset the machine state (registers, colors, timers) */
+            static void reset_state();
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Currently loaded code */
+            static uint8_t _code[LSCRIPT_MAX_CODE_LEN];
+            static uint16_t _code_len;
+
+            /* Machine state */
+            static uint16_t _reg[LSCRIPT_REG_QTY];
+            static CRGB _color[LSCRIPT_COLOR_QTY];
+            static uint32_t _timer[LSCRIPT_TIMER_QTY];
+
+            /* Built-in default script */
+            static const uint8_t _default_script[];
+            static const uint16_t _default_script_len;
+    };
+#endif
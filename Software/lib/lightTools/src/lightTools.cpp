@@ -10,17 +10,74 @@
     #include <lightTools.h>
 #endif
 
-/* Constructor of the class */
-    /* Not currently needed to initialize anything - let default constructor be called
-        lightTools::lightTools() {
+/* Built-in gradient palettes (see lightTools.h for the layout) */
+    /* Note - the 'christmas' palette holds the colors the patterns were originally drawn with:
+        0 red, 1 white, 2 green, 3 gold, 4 off-white, 5 pink, 6 lime, 7 aquamarine, 8 bright green, 9-15 red/white/green again */
+const uint8_t light_palette_christmas[] PROGMEM = {
+      0, 0xFF, 0x00, 0x00,
+     17, 0xFF, 0xFF, 0xFF,
+     34, 0x00, 0x80, 0x00,
+     51, 0xFF, 0xD7, 0x00,
+     68, 0xFF, 0xFC, 0xE6,
+     85, 0x92, 0x0B, 0x4C,
+    102, 0x56, 0xD5, 0x00,
+    119, 0x7F, 0xFF, 0xD4,
+    136, 0x00, 0xFF, 0x00,
+    153, 0xFF, 0x00, 0x00,
+    170, 0xFF, 0xFF, 0xFF,
+    187, 0x00, 0x80, 0x00,
+    204, 0xFF, 0x00, 0x00,
+    221, 0xFF, 0xFF, 0xFF,
+    238, 0x00, 0x80, 0x00,
+    255, 0xFF, 0xD7, 0x00,
+};
 
-        }
-    */
+const uint8_t light_palette_ice[] PROGMEM = {
+      0, 0x00, 0x50, 0xFF,
+     17, 0xFF, 0xFF, 0xFF,
+     34, 0x00, 0xC0, 0xFF,
+     51, 0xC0, 0xC0, 0xC0,
+    255, 0xA0, 0xE0, 0xFF,
+};
+
+const uint8_t light_palette_halloween[] PROGMEM = {
+      0, 0xFF, 0x40, 0x00,
+     17, 0x80, 0x00, 0xFF,
+     34, 0x40, 0xFF, 0x00,
+     51, 0xFF, 0xA0, 0x00,
+    255, 0xFF, 0x20, 0x00,
+};
+
+const uint8_t light_palette_warm_white[] PROGMEM = {
+      0, 0xFF, 0xB4, 0x64,
+    128, 0xFF, 0xDC, 0xA0,
+    255, 0xFF, 0x8C, 0x3C,
+};
+
+static const lightPaletteInfo light_palettes[] = {
+    {"christmas", light_palette_christmas},
+    {"ice", light_palette_ice},
+    {"halloween", light_palette_halloween},
+    {"warm_white", light_palette_warm_white},
+};
+
+/* Constructor of the class - starts out with the 'christmas' palette */
+lightTools::lightTools() {
+    load_palette(light_palette_christmas);
+    set_quality(true, 1);
+}
+
+/* Called when a ledSpan is indexed outside of its lights (only with LIGHT_DEBUG_BOUNDS) - reports the bad index and halts */
+void ledSpan_out_of_bounds(int led_index, uint16_t led_qty) {
+    Serial.println(String("ledSpan: light ") + String(led_index) + " is out of bounds (" + String((unsigned int) led_qty) + " lights)");
+    Serial.flush();
+    abort();
+}
 
 /* public simple function to draw a pattern, defined by an incoming array to be repeated over the full LED string */
     /* Note - pattern_starting_index can be incremented to simmulate a "walking pattern" if desired, but needs to be incremented outside of this function */
     /* Note - if "fade_amount" is provided, each light will blend towards the next index of the pattern by 'fade_amount' (set to 0 for no blending to occur and transition to be instant) */
-void lightTools::fill_light_pattern(CRGB *led_arr, uint16_t led_qty, uint32_t *light_pattern, uint16_t pattern_qty, uint8_t pattern_starting_index/*=0*/, uint8_t fade_amount/*=0*/) {
+void lightTools::fill_light_pattern(CRGB *led_arr, uint16_t led_qty, const CRGB *light_pattern, uint16_t pattern_qty, uint8_t pattern_starting_index/*=0*/, uint8_t fade_amount/*=0*/) {
     /* Do a quick check to make sure we weren't passed a starting index > pattern array.  If so - just start at the end of the pattern array */
     uint16_t pattern_index = (pattern_starting_index < pattern_qty) ? pattern_starting_index : pattern_qty - 1;
 
@@ -28,7 +85,7 @@ void lightTools::fill_light_pattern(CRGB *led_arr, uint16_t led_qty, uint32_t *l
     for (uint16_t led_index = 0; led_index < led_qty; led_index++) {
 
         /* If blending is desired, smoothly fade towards the light pattern color.  Otherwise, immediately load the light pattern color directly */
-        if (fade_amount > 0) {led_arr[led_index] = fadeToColor(led_arr[led_index], light_pattern[pattern_index], fade_amount);}
+        if (fade_amount > 0 && _blending) {led_arr[led_index] = fadeToColor(led_arr[led_index], light_pattern[pattern_index], fade_amount);}
         else {led_arr[led_index] = light_pattern[pattern_index];}
 
         /* Move to the next pattern color */
@@ -45,6 +102,138 @@ CRGB lightTools::fadeToColor(CRGB fromCRGB, CRGB toCRGB, uint8_t amount) {
     );
 }
 
+/* public function to fingerprint a frame (32b FNV-1a over the R,G,B bytes) - chain frames by passing the previous hash as the seed */
+uint32_t lightTools::frame_hash(const CRGB *led_arr, uint16_t led_qty, uint32_t seed/*=2166136261UL*/) {
+    uint32_t hash = seed;
+    for (uint16_t led_index = 0; led_index < led_qty; led_index++) {
+        hash = (hash ^ led_arr[led_index].r) * 16777619UL;
+        hash = (hash ^ led_arr[led_index].g) * 16777619UL;
+        hash = (hash ^ led_arr[led_index].b) * 16777619UL;
+    }
+
+    return hash;
+}
+
+/* public function to look up a color of the active palette - index 0-255 runs through the 16 entries, interpolating between them (and wrapping from the last entry back to the first) */
+CRGB lightTools::palette(uint8_t index, uint8_t brightness/*=255*/) {
+    CRGB color = _palette[index >> 4];
+
+    /* Blend towards the next entry by the low 4 bits of the index */
+    uint8_t frac = index & 0x0F;
+    if (frac) {color = blend(color, _palette[((index >> 4) + 1) & 0x0F], frac << 4);}
+
+    if (brightness != 255) {color.nscale8_video(brightness);}
+    return color;
+}
+
+/* public function to switch to a gradient palette (stored in flash) right away */
+void lightTools::load_palette(const uint8_t *gradient) {
+    gradient_to_palette(gradient, _palette);
+    memcpy(_target_palette, _palette, sizeof(_palette));
+    _palette_blending = false;
+}
+
+/* public function to crossfade to a gradient palette (stored in flash) - the fade is done by blend_palette_step(), a little every frame */
+void lightTools::blend_to_palette(const uint8_t *gradient) {
+    gradient_to_palette(gradient, _target_palette);
+    _palette_blending = true;
+}
+
+/* public function to move the active palette one step towards the palette being crossfaded to (to be called once per frame) */
+bool lightTools::blend_palette_step(uint8_t max_changes/*=LIGHT_PALETTE_BLEND_CHANGES*/) {
+    if (!_palette_blending) {return false;}
+
+    /* Without blending --> jump straight to the new palette */
+    if (!_blending) {
+        memcpy(_palette, _target_palette, sizeof(_palette));
+        _palette_blending = false;
+        return false;
+    }
+
+    uint8_t *from = (uint8_t *) _palette;
+    const uint8_t *to = (const uint8_t *) _target_palette;
+    uint8_t changes = 0;
+    for (uint8_t i = 0; i < sizeof(_palette) && changes < max_changes; i++) {
+        if (from[i] == to[i]) {continue;}
+        from[i] = (from[i] < to[i]) ? from[i] + 1 : from[i] - 1;
+        changes++;
+    }
+
+    /* Done once a step didn't need to change anything */
+    if (!changes) {_palette_blending = false;}
+    return _palette_blending;
+}
+
+/* public function to check if a palette crossfade is running */
+bool lightTools::palette_blending() {
+    return _palette_blending;
+}
+
+/* public functions to lower the render quality while the patterns overrun their frame budget (see lib/frameBudget) */
+void lightTools::set_quality(bool blending, uint8_t detail_step) {
+    _blending = blending;
+    _detail_step = max(detail_step, (uint8_t) 1);
+}
+
+bool lightTools::blending() {
+    return _blending;
+}
+
+uint8_t lightTools::detail_step() {
+    return _detail_step;
+}
+
+/* public function to fill in the lights between every detail_step()-th light (a gradient between its two drawn neighbors) - does nothing at full detail */
+void lightTools::upscale(CRGB *led_arr, uint16_t led_qty) {
+    if (_detail_step <= 1) {return;}
+
+    for (uint16_t drawn = 0; drawn < led_qty; drawn += _detail_step) {
+        /* Past the last drawn light --> repeat it */
+        uint16_t next = (drawn + _detail_step < led_qty) ? drawn + _detail_step : drawn;
+        for (uint8_t step = 1; step < _detail_step && drawn + step < led_qty; step++) {
+            led_arr[drawn + step] = fadeToColor(led_arr[drawn], led_arr[next], step * 256 / _detail_step);
+        }
+    }
+}
+
+/* public functions to look up the built-in palettes, by index or by name (returns NULL if not found) */
+uint8_t lightTools::palette_qty() {
+    return LIGHT_ARRAY_SIZE(light_palettes);
+}
+
+const lightPaletteInfo *lightTools::palette_info(uint8_t idx) {
+    return (idx < palette_qty()) ? &light_palettes[idx] : NULL;
+}
+
+const lightPaletteInfo *lightTools::find_palette(const char *name) {
+    for (uint8_t idx = 0; idx < palette_qty(); idx++) {
+        if (!strcmp(light_palettes[idx].name, name)) {return &light_palettes[idx];}
+    }
+
+    return NULL;
+}
+
+/* class-bound function to expand a gradient palette into 16 palette entries */
+void lightTools::gradient_to_palette(const uint8_t *gradient, CRGB *palette) {
+    uint16_t anchor = 0;    //Byte offset of the anchor at (or just before) the entry's position
+
+    for (uint8_t entry = 0; entry < LIGHT_PALETTE_QTY; entry++) {
+        uint8_t pos = entry * 17;
+
+        /* Move to the last anchor at or before this position */
+        while (pgm_read_byte(&gradient[anchor]) < 255 && pgm_read_byte(&gradient[anchor + 4]) <= pos) {anchor += 4;}
+
+        uint8_t from_pos = pgm_read_byte(&gradient[anchor]);
+        CRGB from = CRGB(pgm_read_byte(&gradient[anchor + 1]), pgm_read_byte(&gradient[anchor + 2]), pgm_read_byte(&gradient[anchor + 3]));
+        if (from_pos == pos || from_pos == 255) {palette[entry] = from; continue;}
+
+        /* Interpolate between this anchor and the next one */
+        uint8_t to_pos = pgm_read_byte(&gradient[anchor + 4]);
+        CRGB to = CRGB(pgm_read_byte(&gradient[anchor + 5]), pgm_read_byte(&gradient[anchor + 6]), pgm_read_byte(&gradient[anchor + 7]));
+        palette[entry] = blend(from, to, (uint8_t) (((uint16_t) (pos - from_pos) << 8) / (to_pos - from_pos)));
+    }
+}
+
 /* class-bound function to blend between two unsignedINTs by a specified amount */
 uint8_t lightTools::blendU8(uint8_t fromU8, uint8_t toU8, uint8_t amount) {
     /* don't do anything if they're already equivalent */
@@ -14,26 +14,116 @@
     /* Create an ARRAY_SIZE calculator for the light users if desired */
     #define LIGHT_ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
 
+    /* Palette definitions */
+    #define LIGHT_PALETTE_QTY 16                    //Entries in a palette
+    #define LIGHT_PAL(n) ((uint8_t) ((n) * 16))     //palette() index of entry n (0-15) - returns the entry color exactly, without interpolation
+    #define LIGHT_PALETTE_BLEND_CHANGES 48          //Default qty of color bytes changed per crossfade step (48 = the whole palette)
+
+    /* Gradient palettes are stored in flash as a list of anchors, each <position 0-255> <R> <G> <B>, in order of position.
+        The first anchor must be at position 0, and the last one at 255 (same layout as FastLED's DEFINE_GRADIENT_PALETTE).
+        Entry n of the palette is the gradient's color at position n * 17 - so a gradient with 16 anchors at 0, 17, 34, ... 255 sets every entry exactly */
+    struct lightPaletteInfo {
+        const char *name;
+        const uint8_t *gradient;
+    };
+
+    /* Called when a ledSpan is indexed outside of its lights (only with LIGHT_DEBUG_BOUNDS) - reports the bad index and halts */
+    void ledSpan_out_of_bounds(int led_index, uint16_t led_qty);
+
+    /* View of the lights a light library is allowed to draw on (a pointer into the LED array + the qty of lights)
+        Note - define LIGHT_DEBUG_BOUNDS (the host tools do, or add it to 'build_flags' for a debug build) to check every access against the qty
+        of lights.  Without it, indexing compiles down to the same raw pointer access as a plain 'CRGB *'.
+        Note - use data() to hand the lights to FastLED functions (e.g. fill_rainbow(_led_arr.data(), _led_qty, ...)) */
+    class ledSpan
+    {
+        public:
+            constexpr ledSpan(CRGB *led_arr=NULL, uint16_t led_qty=0) : _led_arr(led_arr), _led_qty(led_qty) {}
+
+            /* Access a single light */
+            inline CRGB &operator[](int led_index) const {
+                #ifdef LIGHT_DEBUG_BOUNDS
+                    if ((unsigned int) led_index >= _led_qty) {ledSpan_out_of_bounds(led_index, _led_qty);}
+                #endif
+                return _led_arr[led_index];
+            }
+
+            /* First light / qty of lights in the view */
+            inline CRGB *data() const {return _led_arr;}
+            inline uint16_t size() const {return _led_qty;}
+
+        private:
+            CRGB *_led_arr;
+            uint16_t _led_qty;
+    };
+
     /* Class container */
     class lightTools
     {   
         public: 
-            /* Constructor of the class */
-            /* Not currently needed to initialize anything - let default constructor be called
-                lightTools();
-            */
+            /* Constructor of the class - starts out with the 'christmas' palette */
+            lightTools();
 
             /* public simple function to draw a pattern, defined by an incoming array to be repeated over the full LED string */
                 /* Note - pattern_starting_index can be incremented to simmulate a "walking pattern" if desired, but needs to be incremented outside of this function */
                 /* Note - if "fade_amount" is provided, each light will blend towards the next index of the pattern by 'fade_amount' (set to 0 for no blending to occur and transition to be instant) */
-            void fill_light_pattern(CRGB *led_arr, uint16_t led_qty, uint32_t *light_pattern, uint16_t pattern_qty, uint8_t pattern_starting_index=0, uint8_t fade_amount=0);
+            void fill_light_pattern(CRGB *led_arr, uint16_t led_qty, const CRGB *light_pattern, uint16_t pattern_qty, uint8_t pattern_starting_index=0, uint8_t fade_amount=0);
 
             /* public function to fade from one color to a different color by a specified amount */
             CRGB fadeToColor(CRGB fromCRGB, CRGB toCRGB, uint8_t amount);
+
+            /* public function to fingerprint a frame (32b FNV-1a over the R,G,B bytes) - chain frames by passing the previous hash as the seed */
+                /* Note - two frames with the same hash are (for all practical purposes) identical, e.g. to check a rewrite is bit-identical to the original */
+            uint32_t frame_hash(const CRGB *led_arr, uint16_t led_qty, uint32_t seed=2166136261UL);
+
+            /* public function to look up a color of the active palette - index 0-255 runs through the 16 entries, interpolating between them (and wrapping from the last entry back to the first) */
+                /* Note - use LIGHT_PAL(n) to get entry n exactly, e.g. the "main color" of a pattern is palette(LIGHT_PAL(0)) */
+            CRGB palette(uint8_t index, uint8_t brightness=255);
+
+            /* public function to switch to a gradient palette (stored in flash) right away */
+            void load_palette(const uint8_t *gradient);
+
+            /* public function to crossfade to a gradient palette (stored in flash) - the fade is done by blend_palette_step(), a little every frame */
+            void blend_to_palette(const uint8_t *gradient);
+
+            /* public function to move the active palette one step towards the palette being crossfaded to (to be called once per frame) */
+                /* Note - every color byte moves by 1 per step, and at most 'max_changes' bytes are changed per step, so a crossfade takes up to 255 frames but never costs more than one pass over the palette */
+                /* Note - returns true while the crossfade is still running */
+            bool blend_palette_step(uint8_t max_changes=LIGHT_PALETTE_BLEND_CHANGES);
+
+            /* public function to check if a palette crossfade is running */
+            bool palette_blending();
+
+            /* public functions to lower the render quality while the patterns overrun their frame budget (see lib/frameBudget) */
+                /* Note - without blending, fill_light_pattern() loads the pattern colors right away, and a palette crossfade jumps to its end */
+                /* Note - with a detail step of 2, patterns working out every light on its own (e.g. pixelMap's) only draw every 2nd light, and upscale() fills in the others */
+            void set_quality(bool blending, uint8_t detail_step);
+            bool blending();
+            uint8_t detail_step();
+
+            /* public function to fill in the lights between every detail_step()-th light (a gradient between its two drawn neighbors) - does nothing at full detail */
+            void upscale(CRGB *led_arr, uint16_t led_qty);
+
+            /* public functions to look up the built-in palettes, by index or by name (returns NULL if not found) */
+            static uint8_t palette_qty();
+            static const lightPaletteInfo *palette_info(uint8_t idx);
+            static const lightPaletteInfo *find_palette(const char *name);
+
         private:
 
             /* class-bound function to blend between two unsignedINTs by a specified amount */
             uint8_t blendU8(uint8_t fromU8, uint8_t toU8, uint8_t amount);
 
+            /* class-bound function to expand a gradient palette into 16 palette entries */
+            void gradient_to_palette(const uint8_t *gradient, CRGB *palette);
+
+            /* class-bound active palette, and the palette being crossfaded to */
+            CRGB _palette[LIGHT_PALETTE_QTY];
+            CRGB _target_palette[LIGHT_PALETTE_QTY];
+            bool _palette_blending;
+
+            /* class-bound render quality */
+            bool _blending;
+            uint8_t _detail_step;
+
     };
 #endif
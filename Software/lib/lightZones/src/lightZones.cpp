@@ -0,0 +1,135 @@
+/*
+    lightZones.h - built from 'lib_template.h'
+    This library is intended to split the LED array into zones (the ghost's eyes, the
+    on-board ambiance lights, the external strand, ...) that each run their own pattern,
+    so the eyes can animate independently of the strand without a second render loop.
+
+    See lightZones.h for how reversed / mirror zones are laid out.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <lightZones.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *lightZones::_lightTools = NULL;
+ledSpan lightZones::_led_arr;
+uint16_t lightZones::_led_qty = 0;
+lightZone lightZones::_zones[LIGHT_ZONE_MAX];
+uint8_t lightZones::_zone_qty = 0;
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+lightZones::lightZones(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = led_qty;
+}
+
+/* Add a zone running its own pattern - returns the zone index, or LIGHT_ZONE_NONE if it doesn't fit in the LED array / zone table */
+uint8_t lightZones::add_zone(uint16_t start, uint16_t len, lightZonePattern pattern, bool reverse, uint8_t phase) {
+    if (_zone_qty >= LIGHT_ZONE_MAX || !len || !pattern || (uint32_t) start + len > _led_qty) {return LIGHT_ZONE_NONE;}
+
+    _zones[_zone_qty] = {start, len, reverse, LIGHT_ZONE_NONE, phase, pattern};
+    return _zone_qty++;
+}
+
+/* Add a zone copying an earlier zone - returns the zone index, or LIGHT_ZONE_NONE if it doesn't fit / the source zone doesn't exist */
+uint8_t lightZones::add_mirror(uint16_t start, uint8_t source, bool reverse) {
+    if (_zone_qty >= LIGHT_ZONE_MAX || source >= _zone_qty || (uint32_t) start + _zones[source].len > _led_qty) {return LIGHT_ZONE_NONE;}
+
+    _zones[_zone_qty] = {start, _zones[source].len, reverse, source, 0, NULL};
+    return _zone_qty++;
+}
+
+/* Change the pattern of a zone (not allowed for mirrors) - returns false if the zone can't run a pattern */
+bool lightZones::set_pattern(uint8_t zone, lightZonePattern pattern) {
+    if (zone >= _zone_qty || _zones[zone].mirror_of != LIGHT_ZONE_NONE || !pattern) {return false;}
+
+    _zones[zone].pattern = pattern;
+    return true;
+}
+
+/* Render every zone, once - call once per frame, before FastLED.show() */
+void lightZones::render() {
+    for (uint8_t idx = 0; idx < _zone_qty; idx++) {
+        const lightZone &zone = _zones[idx];
+
+        if (zone.mirror_of == LIGHT_ZONE_NONE) {
+            /* Patterns may build on the previous frame (fades / trails), so they get the zone back in their own order first */
+            if (zone.reverse) {flip(zone);}
+            zone.pattern(ledSpan(_led_arr.data() + zone.start, zone.len), zone.phase);
+            if (zone.reverse) {flip(zone);}
+            continue;
+        }
+
+        /* Mirror --> copy the source zone light by light, in logical order (the source is already rendered, it was added earlier) */
+        const lightZone &source = _zones[zone.mirror_of];
+        for (uint16_t led = 0; led < zone.len; led++) {
+            uint16_t from = source.reverse ? source.start + source.len - 1 - led : source.start + led;
+            uint16_t to = zone.reverse ? zone.start + zone.len - 1 - led : zone.start + led;
+            _led_arr[to] = _led_arr[from];
+        }
+    }
+}
+
+/* Zone table */
+uint8_t lightZones::zone_qty() {
+    return _zone_qty;
+}
+const lightZone &lightZones::zone(uint8_t idx) {
+    return _zones[idx];
+}
+
+/* Eyes glowing in the palette's main color, breathing slowly and blinking every LIGHT_ZONE_BLINK_MS */
+void lightZones::eyes_glow(ledSpan lights, uint8_t phase) {
+    /* Shut while blinking */
+    uint32_t blink_ms = (GET_MILLIS() + (uint32_t) phase * LIGHT_ZONE_BLINK_MS / 256) % LIGHT_ZONE_BLINK_MS;
+    if (blink_ms < LIGHT_ZONE_BLINK_LEN_MS) {
+        fill_solid(lights.data(), lights.size(), CRGB::Black);
+        return;
+    }
+
+    fill_solid(lights.data(), lights.size(), _lightTools->palette(LIGHT_PAL(0), beatsin8(12, 96, 255, 0, phase)));
+}
+
+/* Eyes drifting through the palette, one color per eye */
+void lightZones::eyes_palette(ledSpan lights, uint8_t phase) {
+    uint8_t index = beat8(4) + phase;
+    for (uint16_t led = 0; led < lights.size(); led++) {
+        lights[led] = _lightTools->palette(index + led * LIGHT_PAL(1));
+    }
+}
+
+/* Ambiance lights breathing through a gradient of the palette */
+void lightZones::ambiance_breathe(ledSpan lights, uint8_t phase) {
+    uint8_t brightness = beatsin8(10, 48, 255, 0, phase);
+    uint8_t index = beat8(6) + phase;
+    for (uint16_t led = 0; led < lights.size(); led++) {
+        lights[led] = _lightTools->palette(index + led * 256 / lights.size(), brightness);
+    }
+}
+
+/* A comet circling the ambiance lights, with a fading tail */
+void lightZones::ambiance_orbit(ledSpan lights, uint8_t phase) {
+    uint16_t len = lights.size();
+    uint16_t head = ((uint32_t) (uint16_t) (beat16(20) + (phase << 8)) * len) >> 16;
+    uint16_t tail = max(len / 2, 1);
+
+    for (uint16_t led = 0; led < len; led++) {
+        uint16_t behind = (head + len - led) % len;
+        lights[led] = (behind < tail) ? _lightTools->palette(LIGHT_PAL(0), 255 - behind * 255 / tail) : CRGB::Black;
+    }
+}
+
+/* Flip the lights of a zone end for end */
+void lightZones::flip(const lightZone &zone) {
+    for (uint16_t low = zone.start, high = zone.start + zone.len - 1; low < high; low++, high--) {
+        CRGB swap = _led_arr[low];
+        _led_arr[low] = _led_arr[high];
+        _led_arr[high] = swap;
+    }
+}
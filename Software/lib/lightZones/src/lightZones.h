@@ -0,0 +1,118 @@
+/*
+    lightZones.h - built from 'lib_template.h'
+    This library is intended to split the LED array into zones (the ghost's eyes, the
+    on-board ambiance lights, the external strand, ...) that each run their own pattern,
+    so the eyes can animate independently of the strand without a second render loop.
+
+    Zones:
+        - a zone is a run of 'len' lights starting at 'start' in the LED array, with its own
+          pattern (and a phase, so two zones running the same pattern don't move in lockstep)
+        - a reversed zone runs its pattern from the far end - the pattern always sees the zone
+          in its own (logical) order, the lights are flipped into place after it ran
+        - a mirror zone runs no pattern of its own: it copies an earlier zone once that zone
+          was rendered (in logical order, so a reversed mirror of a zone is symmetrical to it)
+        - render() walks the zones once per frame, in the order they were added - mirrors can
+          only refer to zones added before them, so their source is always rendered already
+
+    Zone patterns take the zone's lights + phase, instead of the usual void() list functions -
+    the existing list patterns are bound to their lights when constructed, so they are wrapped
+    by a zone pattern that ignores its arguments (see main.cpp).
+*/
+
+#ifndef lightZones_h
+    #define lightZones_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+    #endif
+
+    /* Zone table size */
+    #ifndef LIGHT_ZONE_MAX
+        #ifdef __AVR__
+            #define LIGHT_ZONE_MAX 2                //The online simulator's AVR only maps the strand
+        #else
+            #define LIGHT_ZONE_MAX 8
+        #endif
+    #endif
+    #define LIGHT_ZONE_NONE 0xFF                    //Returned by add_zone() / add_mirror() when the zone doesn't fit, and the mirror_of of a zone running its own pattern
+
+    /* Zone pattern timing */
+    #ifndef LIGHT_ZONE_BLINK_MS
+        #define LIGHT_ZONE_BLINK_MS 4000            //Period of the eyes' blink
+    #endif
+    #ifndef LIGHT_ZONE_BLINK_LEN_MS
+        #define LIGHT_ZONE_BLINK_LEN_MS 150         //How long the eyes stay shut per blink
+    #endif
+
+    /* Pattern run by a zone - draws the zone's lights (in logical order), phase 0-255 offsets the animation */
+    typedef void (*lightZonePattern)(ledSpan lights, uint8_t phase);
+
+    /* Zone definition */
+    struct lightZone
+    {
+        uint16_t start;                             //First light of the zone in the LED array
+        uint16_t len;                               //Qty of lights in the zone
+        bool reverse;                               //Pattern runs from the far end of the zone
+        uint8_t mirror_of;                          //Zone copied by this one (LIGHT_ZONE_NONE = runs its own pattern)
+        uint8_t phase;                              //Animation offset handed to the pattern
+        lightZonePattern pattern;                   //Pattern of the zone (NULL for a mirror)
+    };
+
+    /* Class container */
+    class lightZones
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            lightZones(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Add a zone running its own pattern - returns the zone index, or LIGHT_ZONE_NONE if it doesn't fit in the LED array / zone table */
+            static uint8_t add_zone(uint16_t start, uint16_t len, lightZonePattern pattern, bool reverse=false, uint8_t phase=0);
+
+            /* Add a zone copying an earlier zone - returns the zone index, or LIGHT_ZONE_NONE if it doesn't fit / the source zone doesn't exist */
+            static uint8_t add_mirror(uint16_t start, uint8_t source, bool reverse=false);
+
+            /* Change the pattern of a zone (not allowed for mirrors) - returns false if the zone can't run a pattern */
+            static bool set_pattern(uint8_t zone, lightZonePattern pattern);
+
+            /* Render every zone, once - call once per frame, before FastLED.show() */
+            static void render();
+
+            /* Zone table */
+            static uint8_t zone_qty();
+            static const lightZone &zone(uint8_t idx);
+
+            /* Eyes glowing in the palette's main color, breathing slowly and blinking every LIGHT_ZONE_BLINK_MS */
+            static void eyes_glow(ledSpan lights, uint8_t phase);
+
+            /* Eyes drifting through the palette, one color per eye */
+            static void eyes_palette(ledSpan lights, uint8_t phase);
+
+            /* Ambiance lights breathing through a gradient of the palette */
+            static void ambiance_breathe(ledSpan lights, uint8_t phase);
+
+            /* A comet circling the ambiance lights, with a fading tail */
+            static void ambiance_orbit(ledSpan lights, uint8_t phase);
+
+        private:
+            /* Flip the lights of a zone end for end */
+            static void flip(const lightZone &zone);
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Zone table */
+            static lightZone _zones[LIGHT_ZONE_MAX];
+            static uint8_t _zone_qty;
+    };
+#endif
@@ -29,7 +29,7 @@
 
 /* Initialize static class variables defined in the header file */
 lightTools *nmayelights::_lightTools = NULL;
-CRGB *nmayelights::_led_arr = NULL;
+ledSpan nmayelights::_led_arr;
 uint16_t nmayelights::_led_qty = 0;
 uint16_t nmayelights::_led_midpoint = 0;
 
@@ -39,7 +39,7 @@ nmayelights::nmayelights(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools
     _lightTools = lightTools;
 
     /* update the class-bound pointers / variables */
-    _led_arr = led_arr;
+    _led_arr = ledSpan(led_arr, led_qty);
     _led_qty = led_qty;
 
     /* calculate the midpoint */
@@ -105,25 +105,25 @@ void nmayelights::police_lights(){
   EVERY_N_MILLISECONDS( 100 ) {global_pl_index = (global_pl_index + 1) % 8;}
   switch(global_pl_index) {
     case 0:
-      pl_state1(CRGB(255, 0, 0));
+      pl_state1(_lightTools->palette(LIGHT_PAL(0)));
       break;
     case 1:
       pl_state0();
       break;
     case 2:
-      pl_state1(CRGB(255, 0, 0));
+      pl_state1(_lightTools->palette(LIGHT_PAL(0)));
       break;
     case 3:
       pl_state0();
       break;
     case 4:
-      pl_state2(CRGB(0, 255, 0));
+      pl_state2(_lightTools->palette(LIGHT_PAL(8)));
       break;
     case 5:
       pl_state0();
       break;
     case 6:
-      pl_state2(CRGB(0, 255, 0));
+      pl_state2(_lightTools->palette(LIGHT_PAL(8)));
       break;
     case 7:
       pl_state0();
@@ -0,0 +1,266 @@
+/*
+    pixelMap.h - built from 'lib_template.h'
+    This library is intended to give the patterns a 2D view of the lights, for strands wrapped
+    around a wreath, a grid, a window frame, ... - every light gets an (x, y) position from a
+    layout file, so 2D effects (plasma, radial waves, scrolling text) can be drawn per light.
+
+    Everything a 2D effect needs per light (x, y, distance from the center, angle around the
+    center) is worked out once when a layout is loaded, and kept in index tables - drawing a
+    frame is table lookups + sin8(), with no per-frame trig / square roots.
+    Without a layout, the lights are laid out on a horizontal line (y in the middle).
+
+    See pixelMap.h for the layout file format.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <pixelMap.h>
+#endif
+
+/* Layout of a light in the patterns - a table lookup, or worked out from its place on the line (PIXEL_MAP_LINE_ONLY) */
+#ifndef PIXEL_MAP_LINE_ONLY
+    #define MAP_X(led) _x[led]
+    #define MAP_Y(led) _y[led]
+    #define MAP_RADIUS(led) _radius[led]
+    #define MAP_ANGLE(led) _angle[led]
+#else
+    #define MAP_X(led) line_x(led)
+    #define MAP_Y(led) 128
+    #define MAP_RADIUS(led) polar_radius(line_x(led), 128)
+    #define MAP_ANGLE(led) polar_angle(line_x(led), 128)
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *pixelMap::_lightTools = NULL;
+ledSpan pixelMap::_led_arr;
+uint16_t pixelMap::_led_qty = 0;
+#ifndef PIXEL_MAP_LINE_ONLY
+    uint8_t pixelMap::_x[PIXEL_MAP_MAX_LEDS];
+    uint8_t pixelMap::_y[PIXEL_MAP_MAX_LEDS];
+    uint8_t pixelMap::_radius[PIXEL_MAP_MAX_LEDS];
+    uint8_t pixelMap::_angle[PIXEL_MAP_MAX_LEDS];
+#endif
+bool pixelMap::_mapped = false;
+char pixelMap::_text[PIXEL_MAP_TEXT_LEN] = "MERRY CHRISTMAS!";
+uint8_t pixelMap::_text_len = 16;
+
+/* 3x5 font, 3 columns per glyph (bit 0 = top row) - ' ' to 'Z', lower case is shown as upper case */
+const uint8_t pixelMap::_font[] PROGMEM = {
+    0x00, 0x00, 0x00,    //' '
+    0x00, 0x17, 0x00,    //'!'
+    0x00, 0x00, 0x00,    //'"'
+    0x00, 0x00, 0x00,    //'#'
+    0x00, 0x00, 0x00,    //'$'
+    0x00, 0x00, 0x00,    //'%'
+    0x00, 0x00, 0x00,    //'&'
+    0x00, 0x03, 0x00,    //'\''
+    0x00, 0x00, 0x00,    //'('
+    0x00, 0x00, 0x00,    //')'
+    0x15, 0x0E, 0x15,    //'*'
+    0x04, 0x0E, 0x04,    //'+'
+    0x10, 0x08, 0x00,    //','
+    0x04, 0x04, 0x04,    //'-'
+    0x00, 0x10, 0x00,    //'.'
+    0x18, 0x04, 0x03,    //'/'
+    0x1F, 0x11, 0x1F,    //'0'
+    0x12, 0x1F, 0x10,    //'1'
+    0x1D, 0x15, 0x17,    //'2'
+    0x15, 0x15, 0x1F,    //'3'
+    0x07, 0x04, 0x1F,    //'4'
+    0x17, 0x15, 0x1D,    //'5'
+    0x1F, 0x15, 0x1D,    //'6'
+    0x01, 0x19, 0x07,    //'7'
+    0x1F, 0x15, 0x1F,    //'8'
+    0x17, 0x15, 0x1F,    //'9'
+    0x00, 0x0A, 0x00,    //':'
+    0x00, 0x00, 0x00,    //';'
+    0x00, 0x00, 0x00,    //'<'
+    0x00, 0x00, 0x00,    //'='
+    0x00, 0x00, 0x00,    //'>'
+    0x01, 0x15, 0x07,    //'?'
+    0x00, 0x00, 0x00,    //'@'
+    0x1E, 0x05, 0x1E,    //'A'
+    0x1F, 0x15, 0x0A,    //'B'
+    0x0E, 0x11, 0x11,    //'C'
+    0x1F, 0x11, 0x0E,    //'D'
+    0x1F, 0x15, 0x11,    //'E'
+    0x1F, 0x05, 0x01,    //'F'
+    0x0E, 0x11, 0x1D,    //'G'
+    0x1F, 0x04, 0x1F,    //'H'
+    0x11, 0x1F, 0x11,    //'I'
+    0x08, 0x10, 0x0F,    //'J'
+    0x1F, 0x04, 0x1B,    //'K'
+    0x1F, 0x10, 0x10,    //'L'
+    0x1F, 0x06, 0x1F,    //'M'
+    0x1F, 0x01, 0x1E,    //'N'
+    0x0E, 0x11, 0x0E,    //'O'
+    0x1F, 0x05, 0x02,    //'P'
+    0x0E, 0x19, 0x16,    //'Q'
+    0x1F, 0x05, 0x1A,    //'R'
+    0x12, 0x15, 0x09,    //'S'
+    0x01, 0x1F, 0x01,    //'T'
+    0x1F, 0x10, 0x1F,    //'U'
+    0x0F, 0x10, 0x0F,    //'V'
+    0x1F, 0x0C, 0x1F,    //'W'
+    0x1B, 0x04, 0x1B,    //'X'
+    0x03, 0x1C, 0x03,    //'Y'
+    0x19, 0x15, 0x13,    //'Z'
+};
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+pixelMap::pixelMap(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables (lights past the index tables are left dark by the 2D patterns) */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = min(led_qty, (uint16_t) PIXEL_MAP_MAX_LEDS);
+
+    /* start out as a line, until a layout is loaded */
+    load_line();
+}
+
+/* Load a layout file (e.g. from the asset partition) - returns false, and keeps the current layout, if it isn't valid for the lights */
+bool pixelMap::load(const uint8_t *layout, uint32_t len) {
+    #ifndef PIXEL_MAP_LINE_ONLY
+        if (!layout || len < PIXEL_MAP_HEADER_LEN) {return false;}
+        if (layout[0] != PIXEL_MAP_MAGIC_0 || layout[1] != PIXEL_MAP_MAGIC_1 || layout[2] != PIXEL_MAP_MAGIC_2 || layout[3] != PIXEL_MAP_VERSION) {return false;}
+
+        /* The layout has to place every light (it may place more - those are ignored) */
+        uint16_t layout_qty = layout[4] | (layout[5] << 8);
+        if (layout_qty < _led_qty || len < PIXEL_MAP_HEADER_LEN + 2UL * layout_qty) {return false;}
+
+        const uint8_t *position = layout + PIXEL_MAP_HEADER_LEN;
+        for (uint16_t led = 0; led < _led_qty; led++, position += 2) {
+            _x[led] = position[0];
+            _y[led] = position[1];
+        }
+        build_tables();
+        _mapped = true;
+
+        return true;
+    #else
+        (void) layout; (void) len;
+        return false;
+    #endif
+}
+
+/* Go back to the default layout (a horizontal line) */
+void pixelMap::load_line() {
+    #ifndef PIXEL_MAP_LINE_ONLY
+        for (uint16_t led = 0; led < _led_qty; led++) {
+            _x[led] = line_x(led);
+            _y[led] = 128;
+        }
+        build_tables();
+    #endif
+    _mapped = false;
+}
+
+/* Returns true if a layout file is loaded (the lights aren't just a line) */
+bool pixelMap::mapped() {
+    return _mapped;
+}
+
+/* Set the text shown by scroll_text() (upper case letters, digits and a few symbols - anything else shows as a blank) */
+void pixelMap::set_text(const char *text) {
+    for (_text_len = 0; text[_text_len] && _text_len < PIXEL_MAP_TEXT_LEN - 1; _text_len++) {
+        _text[_text_len] = toupper(text[_text_len]);
+    }
+    _text[_text_len] = 0;
+}
+
+/* Layout of a light - x / y 0-255, radius 0-255 (center to corner), angle 0-255 around the center (0 = right, counter-clockwise) */
+uint8_t pixelMap::x(uint16_t led) {
+    return (led < _led_qty) ? MAP_X(led) : 0;
+}
+uint8_t pixelMap::y(uint16_t led) {
+    return (led < _led_qty) ? MAP_Y(led) : 0;
+}
+uint8_t pixelMap::radius(uint16_t led) {
+    return (led < _led_qty) ? MAP_RADIUS(led) : 0;
+}
+uint8_t pixelMap::angle(uint16_t led) {
+    return (led < _led_qty) ? MAP_ANGLE(led) : 0;
+}
+
+/* Plasma - overlapping sine waves across the layout, colored from the palette */
+void pixelMap::plasma() {
+    uint8_t t1 = beat8(11);
+    uint8_t t2 = beat8(7);
+    uint8_t t3 = beat8(5);
+
+    /* Every light is worked out on its own - at a lowered detail, only every detail_step()-th one (its strand neighbors are filled in) */
+    for (uint16_t led = 0; led < _led_qty; led += _lightTools->detail_step()) {
+        uint16_t wave = sin8(MAP_X(led) + t1) + sin8(MAP_Y(led) - t2) + sin8((MAP_RADIUS(led) << 1) - t3) + sin8(((MAP_X(led) + MAP_Y(led)) >> 1) + t2 + t3);
+        _led_arr[led] = _lightTools->palette(wave >> 2);
+    }
+    _lightTools->upscale(_led_arr.data(), _led_qty);
+}
+
+/* Rings of color travelling outwards from the center of the layout */
+void pixelMap::radial_wave() {
+    uint8_t ring = beat8(40);
+    uint8_t hue = beat8(4);
+
+    for (uint16_t led = 0; led < _led_qty; led += _lightTools->detail_step()) {
+        _led_arr[led] = _lightTools->palette(MAP_ANGLE(led) + hue, sin8(MAP_RADIUS(led) * 3 - ring));
+    }
+    _lightTools->upscale(_led_arr.data(), _led_qty);
+}
+
+/* Text scrolling from right to left across the layout */
+void pixelMap::scroll_text() {
+    /* Font columns in view this frame (a blank screen width follows the text before it repeats) */
+    uint16_t text_cols = _text_len * 4 + PIXEL_MAP_TEXT_COLS;
+    uint16_t scroll = (GET_MILLIS() / PIXEL_MAP_SCROLL_MS) % text_cols;
+    uint8_t columns[PIXEL_MAP_TEXT_COLS];
+    for (uint8_t col = 0; col < PIXEL_MAP_TEXT_COLS; col++) {
+        columns[col] = text_column((scroll + col) % text_cols);
+    }
+
+    CRGB color = _lightTools->palette(LIGHT_PAL(0));
+    for (uint16_t led = 0; led < _led_qty; led++) {
+        uint8_t col = (MAP_X(led) * PIXEL_MAP_TEXT_COLS) >> 8;
+        uint8_t row = (MAP_Y(led) * 5) >> 8;
+        _led_arr[led] = ((columns[col] >> row) & 1) ? color : CRGB::Black;
+    }
+}
+
+/* Work out the radius / angle tables from the x / y tables */
+void pixelMap::build_tables() {
+    #ifndef PIXEL_MAP_LINE_ONLY
+        for (uint16_t led = 0; led < _led_qty; led++) {
+            _radius[led] = polar_radius(_x[led], _y[led]);
+            _angle[led] = polar_angle(_x[led], _y[led]);
+        }
+    #endif
+}
+
+/* Position of a light on the line / distance from the center, angle around the center of a position */
+uint8_t pixelMap::line_x(uint16_t led) {
+    return (_led_qty > 1) ? (uint32_t) led * 255 / (_led_qty - 1) : 128;
+}
+
+uint8_t pixelMap::polar_radius(uint8_t x, uint8_t y) {
+    float dx = x - 127.5f;
+    float dy = 127.5f - y;
+
+    /* center to corner is ~180 */
+    return min(sqrtf(dx * dx + dy * dy) * (255.0f / 180.3f), 255.0f);
+}
+
+uint8_t pixelMap::polar_angle(uint8_t x, uint8_t y) {
+    return (uint8_t) (int16_t) lroundf(atan2f(127.5f - y, x - 127.5f) * (128.0f / (float) M_PI));
+}
+
+/* Returns the font column (bit 0 = top row) at a column of the scrolling text */
+uint8_t pixelMap::text_column(uint16_t column) {
+    uint8_t glyph = column >> 2;
+    uint8_t glyph_col = column & 3;
+    if (glyph >= _text_len || glyph_col == 3) {return 0;}
+
+    char c = _text[glyph];
+    if (c < ' ' || c > 'Z') {return 0;}
+    return pgm_read_byte(&_font[(c - ' ') * 3 + glyph_col]);
+}
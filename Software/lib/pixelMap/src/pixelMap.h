@@ -0,0 +1,133 @@
+/*
+    pixelMap.h - built from 'lib_template.h'
+    This library is intended to give the patterns a 2D view of the lights, for strands wrapped
+    around a wreath, a grid, a window frame, ... - every light gets an (x, y) position from a
+    layout file, so 2D effects (plasma, radial waves, scrolling text) can be drawn per light.
+
+    Everything a 2D effect needs per light (x, y, distance from the center, angle around the
+    center) is worked out once when a layout is loaded, and kept in index tables - drawing a
+    frame is table lookups + sin8(), with no per-frame trig / square roots.
+    Without a layout, the lights are laid out on a horizontal line (y in the middle).
+
+    Layout file (".glm", all multi-byte values are little-endian):
+        Header (8 bytes):
+            'G' 'L' 'M' <version> <led_qty:u16> <reserved:u16>
+        Positions (led_qty x 2 bytes):
+            <x:u8> <y:u8> per light, in strand order - 0,0 is the top left, 255,255 the bottom right
+
+    Use 'tools/pixelMap/make_layout.py' to build a layout (from a CSV of positions, or a grid /
+    ring / wreath), and pack it into the asset image as PIXEL_MAP_LAYOUT_NAME (see main.cpp).
+*/
+
+#ifndef pixelMap_h
+    #define pixelMap_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+    #endif
+
+    /* Layout file definitions */
+    #define PIXEL_MAP_MAGIC_0 'G'
+    #define PIXEL_MAP_MAGIC_1 'L'
+    #define PIXEL_MAP_MAGIC_2 'M'
+    #define PIXEL_MAP_VERSION 1
+    #define PIXEL_MAP_HEADER_LEN 8
+
+    /* The online simulator's AVR has no asset partition to load a layout from - its lights stay on the line, worked out per light instead of kept in tables */
+    #ifdef __AVR__
+        #define PIXEL_MAP_LINE_ONLY
+    #endif
+
+    /* Index table size (4 bytes per light) */
+    #ifndef PIXEL_MAP_MAX_LEDS
+        #define PIXEL_MAP_MAX_LEDS 512
+    #endif
+
+    /* Scrolling text */
+    #ifndef PIXEL_MAP_TEXT_COLS
+        #define PIXEL_MAP_TEXT_COLS 16              //Font columns across the width of the layout (glyphs are 3x5, plus a blank column)
+    #endif
+    #ifndef PIXEL_MAP_SCROLL_MS
+        #define PIXEL_MAP_SCROLL_MS 120             //Time per column of scrolling
+    #endif
+    #ifndef PIXEL_MAP_TEXT_LEN
+        #define PIXEL_MAP_TEXT_LEN 32               //Longest scrolling text, including the terminating NUL
+    #endif
+
+    /* Class container */
+    class pixelMap
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            pixelMap(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Load a layout file (e.g. from the asset partition) - returns false, and keeps the current layout, if it isn't valid for the lights */
+            static bool load(const uint8_t *layout, uint32_t len);
+
+            /* Go back to the default layout (a horizontal line) */
+            static void load_line();
+
+            /* Returns true if a layout file is loaded (the lights aren't just a line) */
+            static bool mapped();
+
+            /* Set the text shown by scroll_text() (upper case letters, digits and a few symbols - anything else shows as a blank) */
+            static void set_text(const char *text);
+
+            /* Layout of a light - x / y 0-255, radius 0-255 (center to corner), angle 0-255 around the center (0 = right, counter-clockwise) */
+            static uint8_t x(uint16_t led);
+            static uint8_t y(uint16_t led);
+            static uint8_t radius(uint16_t led);
+            static uint8_t angle(uint16_t led);
+
+            /* Plasma - overlapping sine waves across the layout, colored from the palette */
+            static void plasma();
+
+            /* Rings of color travelling outwards from the center of the layout */
+            static void radial_wave();
+
+            /* Text scrolling from right to left across the layout */
+            static void scroll_text();
+
+        private:
+            /* Work out the radius / angle tables from the x / y tables */
+            static void build_tables();
+
+            /* Position of a light on the line / distance from the center, angle around the center of a position */
+            static uint8_t line_x(uint16_t led);
+            static uint8_t polar_radius(uint8_t x, uint8_t y);
+            static uint8_t polar_angle(uint8_t x, uint8_t y);
+
+            /* Returns the font column (bit 0 = top row) at a column of the scrolling text */
+            static uint8_t text_column(uint16_t column);
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Index tables, one entry per light */
+            #ifndef PIXEL_MAP_LINE_ONLY
+                static uint8_t _x[PIXEL_MAP_MAX_LEDS];
+                static uint8_t _y[PIXEL_MAP_MAX_LEDS];
+                static uint8_t _radius[PIXEL_MAP_MAX_LEDS];
+                static uint8_t _angle[PIXEL_MAP_MAX_LEDS];
+            #endif
+            static bool _mapped;
+
+            /* Scrolling text */
+            static char _text[PIXEL_MAP_TEXT_LEN];
+            static uint8_t _text_len;
+
+            /* 3x5 font, 3 columns per glyph (bit 0 = top row) */
+            static const uint8_t _font[];
+    };
+#endif
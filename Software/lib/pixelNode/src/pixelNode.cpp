@@ -0,0 +1,230 @@
+/*
+    pixelNode.h - built from 'lib_template.h'
+    This library is intended to let a show controller (xLights, Vixen, FPP, ...) drive the
+    ghost's lights directly, as a pixel node - sACN (E1.31) and Art-Net universes received
+    over UDP are written straight into the LED array, bypassing the patterns.
+
+    See pixelNode.h for the universe mapping / frame assembly rules.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <pixelNode.h>
+#endif
+
+/* BSD sockets (lwIP on the ESP32) */
+#ifdef PIXEL_NODE_SOCKETS
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+lightTools *pixelNode::_lightTools = NULL;
+ledSpan pixelNode::_led_arr;
+uint16_t pixelNode::_led_qty = 0;
+int pixelNode::_e131_fd = -1;
+int pixelNode::_artnet_fd = -1;
+uint16_t pixelNode::_first_universe = 1;
+uint8_t pixelNode::_universe_qty = 0;
+uint32_t pixelNode::_received_mask = 0;
+uint32_t pixelNode::_seq_valid_mask = 0;
+uint8_t pixelNode::_last_seq[PIXEL_NODE_MAX_UNIVERSES];
+uint8_t pixelNode::_frame_seq[PIXEL_NODE_MAX_UNIVERSES];
+bool pixelNode::_frame_seq_valid = false;
+uint8_t pixelNode::_frame_advance = 0;
+uint32_t pixelNode::_last_frame_ms = 0;
+pixelNodeStats pixelNode::_stats = {};
+
+/* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+pixelNode::pixelNode(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools) {
+    /* Point to the provided lightTools member */
+    _lightTools = lightTools;
+
+    /* update the class-bound pointers / variables */
+    _led_arr = ledSpan(led_arr, led_qty);
+    _led_qty = led_qty;
+
+    /* Only as many universes as can be tracked - lights past them are left to the patterns */
+    _universe_qty = min((led_qty + PIXEL_NODE_UNIVERSE_LEDS - 1) / PIXEL_NODE_UNIVERSE_LEDS, PIXEL_NODE_MAX_UNIVERSES);
+}
+
+/* Start listening - the lights map to first_universe onwards (a port of 0 disables that protocol) - returns false if no socket could be opened */
+bool pixelNode::begin(uint16_t first_universe, uint16_t e131_port, uint16_t artnet_port) {
+    end();
+    _first_universe = first_universe;
+
+    #ifdef PIXEL_NODE_SOCKETS
+        if (e131_port) {
+            _e131_fd = open_socket(e131_port);
+
+            /* Join the multicast group of every universe (unicast is received either way, so a failed join isn't fatal) */
+            for (uint8_t idx = 0; _e131_fd >= 0 && idx < _universe_qty; idx++) {
+                uint16_t universe = _first_universe + idx;
+                ip_mreq group = {};
+                group.imr_multiaddr.s_addr = htonl(0xEFFF0000UL | universe);
+                group.imr_interface.s_addr = htonl(INADDR_ANY);
+                setsockopt(_e131_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group));
+            }
+        }
+        if (artnet_port) {_artnet_fd = open_socket(artnet_port);}
+    #endif
+
+    return _e131_fd >= 0 || _artnet_fd >= 0;
+}
+
+/* Stop listening */
+void pixelNode::end() {
+    #ifdef PIXEL_NODE_SOCKETS
+        if (_e131_fd >= 0) {close(_e131_fd);}
+        if (_artnet_fd >= 0) {close(_artnet_fd);}
+    #endif
+    _e131_fd = _artnet_fd = -1;
+    _received_mask = _seq_valid_mask = 0;
+    _frame_seq_valid = false;
+}
+
+/* Receive waiting universes into the lights - returns true once a frame is complete (show it before calling again) */
+bool pixelNode::loop() {
+    #ifdef PIXEL_NODE_SOCKETS
+        /* Take turns between the protocols, and stop at a complete frame - the next universe would already overwrite it */
+        bool waiting = true;
+        while (waiting) {
+            int8_t e131 = (_e131_fd >= 0) ? receive(_e131_fd, false) : -1;
+            int8_t artnet = (_artnet_fd >= 0) ? receive(_artnet_fd, true) : -1;
+            if (e131 > 0 || artnet > 0) {return true;}
+            waiting = e131 >= 0 || artnet >= 0;
+        }
+    #endif
+
+    return false;
+}
+
+/* Returns true while a show controller is streaming (a frame was completed within PIXEL_NODE_ACTIVE_MS) */
+bool pixelNode::active() {
+    return _stats.frame_qty && (millis() - _last_frame_ms) < PIXEL_NODE_ACTIVE_MS;
+}
+
+/* Qty of universes the lights span */
+uint8_t pixelNode::universe_qty() {
+    return _universe_qty;
+}
+
+/* Receive statistics */
+const pixelNodeStats &pixelNode::stats() {
+    return _stats;
+}
+
+/* Receive the next datagram from a socket - returns 1 if it completed a frame, 0 if it didn't, -1 if nothing was waiting */
+int8_t pixelNode::receive(int fd, bool artnet) {
+    #ifdef PIXEL_NODE_SOCKETS
+        /* Peek the header only */
+        uint8_t header[E131_HEADER_LEN];
+        ssize_t header_len = recv(fd, header, sizeof(header), MSG_PEEK | MSG_DONTWAIT);
+        if (header_len < 0) {return -1;}
+
+        uint16_t universe, data_pos, data_len;
+        uint8_t seq;
+        if (artnet) {
+            if (header_len < ARTNET_HEADER_LEN || memcmp(header, "Art-Net", 8) || (header[8] | (header[9] << 8)) != ARTNET_OP_DMX) {return discard(fd, &_stats.ignored_qty);}
+            seq = header[12];
+            universe = header[14] | ((header[15] & 0x7F) << 8);
+            data_pos = ARTNET_HEADER_LEN;
+            data_len = (header[16] << 8) | header[17];
+        } else {
+            static const uint8_t e131_id[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+            if (header_len < E131_HEADER_LEN || memcmp(header + 4, e131_id, sizeof(e131_id)) || header[21] != 0x04 || header[43] != 0x02 ||
+                header[117] != 0x02 || header[E131_HEADER_LEN - 1] != 0x00 || (header[E131_OPTIONS_POS] & E131_OPTION_PREVIEW)) {return discard(fd, &_stats.ignored_qty);}
+            seq = header[E131_SEQ_POS];
+            universe = (header[E131_UNIVERSE_POS] << 8) | header[E131_UNIVERSE_POS + 1];
+            data_pos = E131_HEADER_LEN;
+            data_len = ((header[E131_COUNT_POS] << 8) | header[E131_COUNT_POS + 1]) - 1;
+        }
+
+        uint16_t idx = universe - _first_universe;
+        if (universe < _first_universe || idx >= _universe_qty) {return discard(fd, &_stats.ignored_qty);}
+
+        /* Late / duplicate universe (Art-Net sequence 0 = sequencing disabled) */
+        uint32_t bit = 1UL << idx;
+        bool sequenced = !(artnet && !seq);
+        if ((_seq_valid_mask & bit) && sequenced) {
+            int8_t diff = (int8_t) (seq - _last_seq[idx]);
+            if (diff <= 0 && diff > -PIXEL_NODE_SEQ_WINDOW) {return discard(fd, &_stats.late_qty);}
+        }
+        _last_seq[idx] = seq;
+        _seq_valid_mask |= bit;
+
+        /* Universe of a newer frame than the one being assembled (its sequence number moved further since the last complete frame), or
+           seen again before the frame was complete --> a universe of the frame was lost, drop it and start over with this one */
+        uint8_t advance = seq - _frame_seq[idx];
+        bool newer = sequenced && _frame_seq_valid && _received_mask && advance != _frame_advance;
+        if (newer || (_received_mask & bit)) {
+            _stats.dropped_frame_qty++;
+            _received_mask = 0;
+        }
+        if (!_received_mask) {_frame_advance = advance;}
+
+        /* Receive the DMX data straight into the lights (anything past the lights is truncated away) */
+        uint32_t led_pos = (uint32_t) idx * PIXEL_NODE_UNIVERSE_LEDS * 3;
+        uint32_t led_len = min((uint32_t) min(data_len, (uint16_t) (PIXEL_NODE_UNIVERSE_LEDS * 3)), (uint32_t) _led_qty * 3 - led_pos);
+        iovec parts[2] = {{header, data_pos}, {(uint8_t *) _led_arr.data() + led_pos, led_len}};
+        msghdr msg = {};
+        msg.msg_iov = parts;
+        msg.msg_iovlen = 2;
+        if (recvmsg(fd, &msg, MSG_DONTWAIT) != (ssize_t) (data_pos + led_len)) {
+            _stats.ignored_qty++;
+            return 0;
+        }
+
+        _stats.packet_qty++;
+        _received_mask |= bit;
+        if (_received_mask != (1UL << _universe_qty) - 1) {return 0;}
+
+        /* Complete --> remember where every universe's sequence number was at this frame */
+        for (uint8_t universe = 0; universe < _universe_qty; universe++) {_frame_seq[universe] = _last_seq[universe];}
+        _frame_seq_valid = true;
+        _received_mask = 0;
+        _stats.frame_qty++;
+        _last_frame_ms = millis();
+        return 1;
+    #else
+        return -1;
+    #endif
+}
+
+/* Drop the next datagram from a socket, and count it - returns 0, as receive() does for a datagram that didn't complete a frame */
+int8_t pixelNode::discard(int fd, uint32_t *counter) {
+    #ifdef PIXEL_NODE_SOCKETS
+        uint8_t scratch[1];
+        recv(fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+    #endif
+    (*counter)++;
+    return 0;
+}
+
+/* Open a non-blocking UDP socket on a port */
+int pixelNode::open_socket(uint16_t port) {
+    #ifdef PIXEL_NODE_SOCKETS
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {return -1;}
+
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(fd, (sockaddr *) &addr, sizeof(addr))) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    #else
+        return -1;
+    #endif
+}
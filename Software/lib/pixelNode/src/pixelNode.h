@@ -0,0 +1,147 @@
+/*
+    pixelNode.h - built from 'lib_template.h'
+    This library is intended to let a show controller (xLights, Vixen, FPP, ...) drive the
+    ghost's lights directly, as a pixel node - sACN (E1.31) and Art-Net universes received
+    over UDP are written straight into the LED array, bypassing the patterns.
+
+    Mapping:
+        - the lights are RGB, PIXEL_NODE_UNIVERSE_LEDS (170) per universe, starting at channel 1
+          of 'first_universe' - universe first_universe + n holds lights n*170 to n*170+169
+        - E1.31 universes are joined by multicast (239.255.<hi>.<lo>) and accepted by unicast,
+          Art-Net (ArtDmx) by broadcast / unicast - the Art-Net port address is the universe
+
+    Receive path:
+        - the header of the next datagram is peeked (a few bytes), then the datagram is received
+          with a scatter list that lands the DMX data straight in the LED array - the pixels are
+          never copied through an intermediate buffer
+        - a universe whose sequence number is up to PIXEL_NODE_SEQ_WINDOW behind the previous one
+          is a late (reordered) or duplicate packet, and is dropped before touching the lights
+        - a frame is complete once every universe of the lights was received - loop() returns
+          true then, and stops receiving until the caller has shown it
+        - if a universe shows up again before the frame was completed, or its sequence number moved
+          further since the last complete frame than the other universes of the frame did, a
+          packet of the frame was lost: the incomplete frame is dropped (never shown), and a new
+          frame starts - show controllers send every universe on every frame, each with its own
+          sequence number stepping by one per frame
+*/
+
+#ifndef pixelNode_h
+    #define pixelNode_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Include the standard light tools, unless this is the online simulation */
+    #ifndef ONLINE_SIMULATION
+        #include <lightTools.h>
+    #endif
+
+    /* The receiver needs BSD sockets - the ESP32 (lwIP) and the host tools have them, the online simulator's AVR doesn't */
+    #ifndef __AVR__
+        #define PIXEL_NODE_SOCKETS
+    #endif
+
+    /* Network configuration */
+    #ifndef PIXEL_NODE_E131_PORT
+        #define PIXEL_NODE_E131_PORT 5568
+    #endif
+    #ifndef PIXEL_NODE_ARTNET_PORT
+        #define PIXEL_NODE_ARTNET_PORT 6454
+    #endif
+
+    /* Universe layout */
+    #define PIXEL_NODE_UNIVERSE_LEDS 170            //RGB lights per universe (510 of the 512 channels)
+    #ifndef PIXEL_NODE_MAX_UNIVERSES
+        #define PIXEL_NODE_MAX_UNIVERSES 8
+    #endif
+
+    /* Frame assembly */
+    #ifndef PIXEL_NODE_SEQ_WINDOW
+        #define PIXEL_NODE_SEQ_WINDOW 20            //Sequence numbers this far behind the previous one are late / duplicate packets (E1.31 section 6.7.2)
+    #endif
+    #ifndef PIXEL_NODE_ACTIVE_MS
+        #define PIXEL_NODE_ACTIVE_MS 2000           //Streaming is considered active while a frame was completed this recently
+    #endif
+
+    /* Packet definitions */
+    #define E131_HEADER_LEN 126                     //Root + framing + DMP layers, up to (and including) the DMX start code
+    #define E131_SEQ_POS 111
+    #define E131_OPTIONS_POS 112
+    #define E131_UNIVERSE_POS 113
+    #define E131_COUNT_POS 123
+    #define E131_OPTION_PREVIEW 0x80
+    #define ARTNET_HEADER_LEN 18
+    #define ARTNET_OP_DMX 0x5000
+
+    /* Receive statistics */
+    struct pixelNodeStats
+    {
+        uint32_t packet_qty;                        //Universes written to the lights
+        uint32_t frame_qty;                         //Complete frames
+        uint32_t dropped_frame_qty;                 //Incomplete frames dropped (a universe was lost)
+        uint32_t late_qty;                          //Late / duplicate universes dropped
+        uint32_t ignored_qty;                       //Other datagrams (other universes, other packet types, preview data)
+    };
+
+    /* Class container */
+    class pixelNode
+    {
+        public:
+            /* Constructor of the class - pass the LED array pointer + qty of used LEDs + lightTools class member */
+            pixelNode(CRGB *led_arr, uint16_t led_qty, lightTools *lightTools);
+
+            /* Start listening - the lights map to first_universe onwards (a port of 0 disables that protocol) - returns false if no socket could be opened */
+            static bool begin(uint16_t first_universe, uint16_t e131_port=PIXEL_NODE_E131_PORT, uint16_t artnet_port=PIXEL_NODE_ARTNET_PORT);
+
+            /* Stop listening */
+            static void end();
+
+            /* Receive waiting universes into the lights - returns true once a frame is complete (show it before calling again) */
+            static bool loop();
+
+            /* Returns true while a show controller is streaming (a frame was completed within PIXEL_NODE_ACTIVE_MS) */
+            static bool active();
+
+            /* Qty of universes the lights span */
+            static uint8_t universe_qty();
+
+            /* Receive statistics */
+            static const pixelNodeStats &stats();
+
+        private:
+            /* Receive the next datagram from a socket - returns 1 if it completed a frame, 0 if it didn't, -1 if nothing was waiting */
+            static int8_t receive(int fd, bool artnet);
+
+            /* Drop the next datagram from a socket, and count it - returns 0, as receive() does for a datagram that didn't complete a frame */
+            static int8_t discard(int fd, uint32_t *counter);
+
+            /* Open a non-blocking UDP socket on a port */
+            static int open_socket(uint16_t port);
+
+            /* Class bound lightTools pointer */
+            static lightTools *_lightTools;
+
+            /* Class bound view of the led array (bounds checked in debug builds) */
+            static ledSpan _led_arr;
+
+            /* Class bound led quantity */
+            static uint16_t _led_qty;
+
+            /* Sockets (-1 while closed) */
+            static int _e131_fd;
+            static int _artnet_fd;
+
+            /* Frame assembly */
+            static uint16_t _first_universe;
+            static uint8_t _universe_qty;
+            static uint32_t _received_mask;
+            static uint32_t _seq_valid_mask;
+            static uint8_t _last_seq[PIXEL_NODE_MAX_UNIVERSES];            //Latest sequence number per universe
+            static uint8_t _frame_seq[PIXEL_NODE_MAX_UNIVERSES];           //Sequence number per universe in the last complete frame
+            static bool _frame_seq_valid;
+            static uint8_t _frame_advance;                                  //How far the sequence numbers of the frame being assembled moved since the last complete frame
+            static uint32_t _last_frame_ms;
+            static pixelNodeStats _stats;
+    };
+#endif
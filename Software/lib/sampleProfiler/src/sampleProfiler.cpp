@@ -0,0 +1,242 @@
+/*
+    sampleProfiler.cpp - built from 'lib_template.h'
+    This library is intended to find where the CPU time goes (inside a pattern, a lightTools
+    helper, FastLED.show() ...) without instrumenting any code: a periodic timer interrupt
+    records the address of the code it interrupted into a ring buffer, and the samples are
+    dumped as text, to be symbolized against the firmware ELF on a host
+    ('tools/host/profile_report.cpp' - folded stacks for a flame graph / a flat report).
+
+    See sampleProfiler.h for how the samples are taken / the dump format.
+*/
+
+/* Included header file, unless this is the online simulation */
+#ifndef ONLINE_SIMULATION
+    #include <sampleProfiler.h>
+#endif
+
+/* Sampling backends */
+#ifdef PROFILER_ESP32_TIMER
+    #include <freertos/xtensa_context.h>
+#endif
+#ifdef PROFILER_SIGPROF
+    #include <link.h>
+    #include <signal.h>
+    #include <time.h>
+    #include <ucontext.h>
+#endif
+
+/* Initialize static class variables defined in the header file */
+profileSample sampleProfiler::_samples[PROFILER_SAMPLE_QTY];
+volatile uint16_t sampleProfiler::_head = 0;
+volatile uint32_t sampleProfiler::_total_qty = 0;
+volatile bool sampleProfiler::_running = false;
+uint32_t sampleProfiler::_rate_hz = PROFILER_DEFAULT_HZ;
+volatile uint64_t sampleProfiler::_handler_ticks = 0;
+
+/* Time base of the handler measurement - CPU cycles on the ESP32, ns on Linux */
+static inline uint32_t IRAM_ATTR profiler_ticks() {
+    #if defined(PROFILER_ESP32_TIMER)
+        return xthal_get_ccount();
+    #elif defined(PROFILER_SIGPROF)
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint32_t) (now.tv_sec * 1000000000ULL + now.tv_nsec);
+    #else
+        return 0;
+    #endif
+}
+
+static uint32_t profiler_ticks_per_us() {
+    #if defined(PROFILER_ESP32_TIMER)
+        return getCpuFrequencyMhz();
+    #else
+        return 1000;
+    #endif
+}
+
+#ifdef PROFILER_ESP32_TIMER
+    static hw_timer_t *profiler_timer = NULL;
+
+    /* Sampling interrupt - the interrupt entry saved the interrupted task's registers in an exception frame on its
+       stack, and pointed pxCurrentTCB->pxTopOfStack (the first member of the TCB) at it */
+    static void IRAM_ATTR profiler_isr() {
+        uint32_t start = profiler_ticks();
+        const XtExcFrame *frame = *(const XtExcFrame **) xTaskGetCurrentTaskHandle();
+
+        /* a0 is the return address into the caller, with the window increment in its top 2 bits - back to a code address, inside the call instruction */
+        uint32_t a0 = frame->a0;
+        uint32_t caller = a0 ? ((a0 & 0x3FFFFFFF) | 0x40000000) - 3 : 0;
+        sampleProfiler::record(frame->pc, caller, start);
+    }
+#endif
+
+#ifdef PROFILER_SIGPROF
+    static timer_t profiler_timer;
+    static bool profiler_timer_created = false;
+
+    /* Sampling signal - the interrupted PC is in the signal context (no caller: the host build has no frame pointers) */
+    static void profiler_signal(int signal, siginfo_t *info, void *context) {
+        uint32_t start = profiler_ticks();
+        uintptr_t pc = 0;
+        #if defined(__x86_64__)
+            pc = ((ucontext_t *) context)->uc_mcontext.gregs[REG_RIP];
+        #elif defined(__aarch64__)
+            pc = ((ucontext_t *) context)->uc_mcontext.pc;
+        #endif
+        sampleProfiler::record(pc, 0, start);
+    }
+
+    static int profiler_first_image(dl_phdr_info *info, size_t size, void *base) {
+        *(uintptr_t *) base = info->dlpi_addr;
+        return 1;
+    }
+#endif
+
+/* Constructor of the class */
+sampleProfiler::sampleProfiler() {
+}
+
+/* Start sampling (the buffer is cleared) - returns false if the rate is out of range / the timer couldn't be set up */
+bool sampleProfiler::begin(uint32_t rate_hz) {
+    if (!rate_hz || rate_hz > PROFILER_MAX_HZ) {return false;}
+    end();
+
+    _head = 0;
+    _total_qty = 0;
+    _handler_ticks = 0;
+    _rate_hz = rate_hz;
+    _running = true;
+
+    #if defined(PROFILER_ESP32_TIMER)
+        /* 1 MHz timer clock (80 MHz APB / 80) - the interrupt is allocated on this core */
+        profiler_timer = timerBegin(PROFILER_TIMER, 80, true);
+        if (!profiler_timer) {
+            _running = false;
+            return false;
+        }
+        timerAttachInterrupt(profiler_timer, &profiler_isr, true);
+        timerAlarmWrite(profiler_timer, 1000000UL / rate_hz, true);
+        timerAlarmEnable(profiler_timer);
+    #elif defined(PROFILER_SIGPROF)
+        /* A wall clock timer, like the ESP32's (time spent waiting is sampled too) */
+        struct sigaction action = {};
+        action.sa_sigaction = profiler_signal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, NULL);
+
+        sigevent event = {};
+        event.sigev_notify = SIGEV_SIGNAL;
+        event.sigev_signo = SIGPROF;
+        if (timer_create(CLOCK_MONOTONIC, &event, &profiler_timer)) {
+            _running = false;
+            return false;
+        }
+        profiler_timer_created = true;
+        itimerspec period = {};
+        period.it_interval.tv_nsec = 1000000000L / rate_hz;
+        period.it_value = period.it_interval;
+        timer_settime(profiler_timer, 0, &period, NULL);
+    #else
+        _running = false;
+    #endif
+
+    return _running;
+}
+
+/* Stop sampling - the samples stay in the buffer */
+void sampleProfiler::end() {
+    _running = false;
+
+    #if defined(PROFILER_ESP32_TIMER)
+        if (profiler_timer) {
+            timerAlarmDisable(profiler_timer);
+            timerDetachInterrupt(profiler_timer);
+            timerEnd(profiler_timer);
+            profiler_timer = NULL;
+        }
+    #elif defined(PROFILER_SIGPROF)
+        if (profiler_timer_created) {
+            timer_delete(profiler_timer);
+            profiler_timer_created = false;
+        }
+    #endif
+}
+
+/* Returns true while sampling */
+bool sampleProfiler::running() {
+    return _running;
+}
+
+/* Sampling rate of the last begin() */
+uint32_t sampleProfiler::rate_hz() {
+    return _rate_hz;
+}
+
+/* Samples in the buffer / taken since begin() (the buffer keeps the last PROFILER_SAMPLE_QTY) */
+uint16_t sampleProfiler::sample_qty() {
+    uint32_t total_qty = _total_qty;
+    return min(total_qty, (uint32_t) PROFILER_SAMPLE_QTY);
+}
+
+uint32_t sampleProfiler::total_qty() {
+    return _total_qty;
+}
+
+/* Estimated share of the CPU (of the sampled core) taken by the sampling, in % */
+float sampleProfiler::overhead_pct() {
+    float handler_us = _total_qty ? (float) _handler_ticks / _total_qty / profiler_ticks_per_us() : 0;
+    return (handler_us + PROFILER_DISPATCH_US) * _rate_hz / 10000.0f;
+}
+
+/* Order of the samples in a dump - by pc, then caller */
+static int compare_samples(const void *a, const void *b) {
+    const profileSample *sample_a = (const profileSample *) a;
+    const profileSample *sample_b = (const profileSample *) b;
+    if (sample_a->pc != sample_b->pc) {return sample_a->pc < sample_b->pc ? -1 : 1;}
+    if (sample_a->caller != sample_b->caller) {return sample_a->caller < sample_b->caller ? -1 : 1;}
+    return 0;
+}
+
+/* Stop sampling, and pass the samples (aggregated by pc + caller, in address order) to print_line, one line at a time */
+void sampleProfiler::dump(void (*print_line)(const char *line)) {
+    end();
+
+    /* The order of the ring buffer doesn't matter once it's stopped - sort it in place, so equal samples are next to each other */
+    uint16_t qty = sample_qty();
+    qsort(_samples, qty, sizeof(profileSample), compare_samples);
+
+    char line[64];
+    snprintf(line, sizeof(line), "# profile rate_hz=%u samples=%u total=%u base=%lx",
+             (unsigned) _rate_hz, (unsigned) qty, (unsigned) _total_qty, (unsigned long) image_base());
+    print_line(line);
+
+    for (uint16_t idx = 0; idx < qty;) {
+        uint16_t count = 1;
+        while (idx + count < qty && !compare_samples(&_samples[idx], &_samples[idx + count])) {count++;}
+        snprintf(line, sizeof(line), "%u %lx %lx", count, (unsigned long) _samples[idx].pc, (unsigned long) _samples[idx].caller);
+        print_line(line);
+        idx += count;
+    }
+}
+
+/* Record a sample - called from the sampling interrupt / signal */
+void IRAM_ATTR sampleProfiler::record(uintptr_t pc, uintptr_t caller, uint32_t start_ticks) {
+    if (!_running) {return;}
+
+    uint16_t head = _head;
+    _samples[head].pc = pc;
+    _samples[head].caller = caller;
+    _head = (head + 1) % PROFILER_SAMPLE_QTY;
+    _total_qty++;
+    _handler_ticks += (uint32_t) (profiler_ticks() - start_ticks);
+}
+
+/* Load address of the image (the addresses of a position independent host executable are relative to it) */
+uintptr_t sampleProfiler::image_base() {
+    uintptr_t base = 0;
+    #ifdef PROFILER_SIGPROF
+        dl_iterate_phdr(profiler_first_image, &base);
+    #endif
+    return base;
+}
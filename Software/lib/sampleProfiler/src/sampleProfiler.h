@@ -0,0 +1,114 @@
+/*
+    sampleProfiler.h - built from 'lib_template.h'
+    This library is intended to find where the CPU time goes (inside a pattern, a lightTools
+    helper, FastLED.show() ...) without instrumenting any code: a periodic timer interrupt
+    records the address of the code it interrupted into a ring buffer, and the samples are
+    dumped as text, to be symbolized against the firmware ELF on a host
+    ('tools/host/profile_report.cpp' - folded stacks for a flame graph / a flat report).
+
+    Sampling:
+        - ESP32: a hardware timer interrupt on the core that called begin() (the Arduino loop's core).
+          The interrupted task's PC / return address (a0) are read from the exception frame the
+          interrupt entry saved on its stack (pxCurrentTCB->pxTopOfStack) - a sample is the
+          function running + its caller
+        - Linux (host tools): SIGPROF from a wall clock timer (like the ESP32's), PC only
+        - code running with interrupts disabled (critical sections, other interrupts) isn't
+          sampled while it runs - its time shows up on the code right after it
+
+    Overhead:
+        - one sample costs the interrupt entry / exit (PROFILER_DISPATCH_US) + the handler (measured)
+        - at PROFILER_DEFAULT_HZ that is ~0.2% of one core - overhead_pct() reports the estimate
+          for the current rate, and begin() refuses rates over PROFILER_MAX_HZ
+
+    Dump (one line each, see dump()):
+        # profile rate_hz=<rate> samples=<qty> total=<qty> base=<hex>        (base: load address of the image, 0 on the ESP32)
+        <count> <pc hex> <caller hex>                                         (caller 0 = unknown)
+*/
+
+#ifndef sampleProfiler_h
+    #define sampleProfiler_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    /* Sampling backend */
+    #if defined(ESP32)
+        #define PROFILER_ESP32_TIMER
+    #elif defined(__linux__)
+        #define PROFILER_SIGPROF
+    #else
+        /* No way to sample the online simulator's AVR - keep the buffer minimal */
+        #define PROFILER_SAMPLE_QTY 1
+    #endif
+
+    /* Profiler configuration */
+    #ifndef PROFILER_SAMPLE_QTY
+        #define PROFILER_SAMPLE_QTY 1024            //Ring buffer size - the most recent samples are kept (1 s at the default rate, 8 KB)
+    #endif
+    #ifndef PROFILER_DEFAULT_HZ
+        #define PROFILER_DEFAULT_HZ 1000
+    #endif
+    #ifndef PROFILER_MAX_HZ
+        #define PROFILER_MAX_HZ 5000                //Highest rate begin() takes (~1% overhead)
+    #endif
+    #ifndef PROFILER_DISPATCH_US
+        #define PROFILER_DISPATCH_US 1.5            //Interrupt entry / exit of one sample (not measurable from the handler)
+    #endif
+    #ifndef PROFILER_TIMER
+        #define PROFILER_TIMER 3                    //ESP32 hardware timer used for the sampling interrupt
+    #endif
+
+    /* One sample */
+    struct profileSample
+    {
+        uintptr_t pc;
+        uintptr_t caller;
+    };
+
+    /* Class container */
+    class sampleProfiler
+    {
+        public:
+            /* Constructor of the class */
+            sampleProfiler();
+
+            /* Start sampling (the buffer is cleared) - returns false if the rate is out of range / the timer couldn't be set up */
+            static bool begin(uint32_t rate_hz=PROFILER_DEFAULT_HZ);
+
+            /* Stop sampling - the samples stay in the buffer */
+            static void end();
+
+            /* Returns true while sampling */
+            static bool running();
+
+            /* Sampling rate of the last begin() */
+            static uint32_t rate_hz();
+
+            /* Samples in the buffer / taken since begin() (the buffer keeps the last PROFILER_SAMPLE_QTY) */
+            static uint16_t sample_qty();
+            static uint32_t total_qty();
+
+            /* Estimated share of the CPU (of the sampled core) taken by the sampling, in % */
+            static float overhead_pct();
+
+            /* Stop sampling, and pass the samples (aggregated by pc + caller, in address order) to print_line, one line at a time */
+            static void dump(void (*print_line)(const char *line));
+
+            /* Record a sample - called from the sampling interrupt / signal (start_ticks: when it was entered, to measure the overhead) */
+            static void record(uintptr_t pc, uintptr_t caller, uint32_t start_ticks);
+
+        private:
+            /* Load address of the image (the addresses of a position independent host executable are relative to it) */
+            static uintptr_t image_base();
+
+            /* Ring buffer */
+            static profileSample _samples[PROFILER_SAMPLE_QTY];
+            static volatile uint16_t _head;
+            static volatile uint32_t _total_qty;
+
+            /* Sampling state */
+            static volatile bool _running;
+            static uint32_t _rate_hz;
+            static volatile uint64_t _handler_ticks;                        //Time spent in the handler (CPU cycles on the ESP32, ns on Linux)
+    };
+#endif
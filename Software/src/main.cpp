@@ -49,6 +49,9 @@
     #define BLYNK_DEVICE_NAME "ChristmasGhost"
     //#define BLYNK_AUTH_TOKEN "utlNLbeY_iekzKw9PZKoW0bTrAr2XUrD"
     #define BLYNK_PRINT Serial
+    #define BLYNK_USE_LITTLEFS      //Mount LittleFS (holds the pre-rendered animations, see framePlayer)
+    #define BLYNK_HEARTBEAT 60      //Keep-alive ping period (s) - every ping wakes the modem from sleep, and a dropped connection costs a full TLS handshake to re-open
+    #define BLYNK_TIMEOUT_MS 6000UL //Reply timeout before the connection is dropped - leaves room for the modem sleep's wake-up latency
 /* ------------   [End] Early definitions for Blynk -------------- */
 
 /* ------------ [START] prepended libraries (for online simulation) -------------- */
@@ -66,6 +69,21 @@
         #include <klassyLights.h>   // Light function library by Ryan K.
         #include <cochise.h>        // Light function library by Cochise F.
         #include <nmayelights.h>    // Light function library by Nick M.
+        #include <lightScript.h>    // Light script interpreter - runs patterns uploaded without reflashing
+        #include <framePlayer.h>    // Pre-rendered animation player - streams animations from LittleFS
+        #include <assetStore.h>     // Read-only assets, memory mapped from the 'assets' flash partition
+        #include <ghostSettings.h>  // Persisted user settings (pattern / brightness) - resumed after a reboot
+        #include <audioReactive.h>  // Audio-reactive patterns - microphone sampled by I2S DMA, analyzed on the second core
+        #include <ghostSync.h>      // Multi-ghost shows - shared time base / pattern over UDP multicast
+        #include <pixelNode.h>      // Pixel node - frames streamed by a show controller over sACN (E1.31) / Art-Net
+        #include <lightZones.h>     // Zone map - eyes / ambiance / strand each run their own pattern
+        #include <pixelMap.h>       // 2D layout of the strand (wreath / grid / ...) for 2D patterns
+        #include <connectBackoff.h> // Backoff between failed WiFi / cloud connect attempts (used by Edgent, see include/ConfigMode.h)
+        #include <ghostApi.h>       // Local HTTP / JSON API (patterns / brightness) + WebSocket live preview of the lights
+        #include <frameStream.h>    // Binary frame stream on the serial port (mixed in with the log text) - live preview / capture on a host
+        #include <sampleProfiler.h> // Sampling profiler - where the CPU time goes, symbolized on a host against the firmware ELF
+        #include <frameTrace.h>     // Frame timeline tracing (build with -DFRAME_TRACE) - exported as Chrome trace-event JSON on a host
+        #include <frameBudget.h>    // Frame budget - lowers the frame rate / quality of a pattern overrunning its render time, so loop() doesn't starve
     #endif
 
 /* -------------- [END] Include necessary libraries -------------- */
@@ -77,6 +95,7 @@
         #define LED_DATA_PIN 26
         #define LEFT_TOUCH_PIN 15
         #define RIGHT_TOUCH_PIN 14
+        //#define AUDIO_MIC_CHANNEL ADC1_CHANNEL_0  //GPIO36 (VP) - uncomment if an analog microphone is fitted for the audio-reactive patterns (the pin floats otherwise)
     #else                           //pins for online simulation (AVR)
         #define LED_DATA_PIN 5
         #define LEFT_TOUCH_PIN 12
@@ -92,6 +111,10 @@
         #define LED_STRAND_QTY 100      //Actual QTY of lights in the strands --> USE THIS FOR LIGHT FUNCTIONS
         #define LED_PER_START_POS 10    //Starting array position for the peripheral LEDs
         #define LED_MAX_BRIGHTNESS 255  //Maximum allowed brightness for the LEDs
+        #define LED_EYE_START_POS 0     //Starting array position for the 2x eye LEDs (left, right)
+        #define LED_EYE_QTY 2
+        #define LED_AMB_START_POS 2     //Starting array position for the 8x ambiance LEDs (chained around the ghost - 4x up the left side, then 4x down the right side)
+        #define LED_AMB_QTY 8
     #else                               //If running on virtual arduino simulation (AVR)
         #define LED_TYPE WS2811
         #define LED_COLOR_ORDER RGB
@@ -102,6 +125,9 @@
     #endif
     CRGB LED_ARR[LED_ARR_QTY];      //global LED array
 
+    /* The light libraries are handed LED_STRAND_QTY lights starting at LED_PER_START_POS - make sure they all fit in the LED array */
+    static_assert(LED_PER_START_POS + LED_STRAND_QTY <= LED_ARR_QTY, "LED_PER_START_POS + LED_STRAND_QTY must fit in LED_ARR_QTY");
+
 /* -------------- [END] HW Configuration Setup -------------- */
 
 /* ------------ [START] Debug compile options -------------- */
@@ -110,6 +136,7 @@
 
 /* ------------ [START] Serial Terminal Configuration -------------- */
     #define SERIAL_BAUD 115200
+    #define SERIAL_TX_BUF_LEN 2048      //Transmit buffer - a streamed frame (lib/frameStream) is queued without waiting on the UART
 /* -------------- [END] Serial Terminal Configuration -------------- */
 
 /* ---------- [START] Button Configuration -------------- */
@@ -117,11 +144,38 @@
     Button2 right_hand_btn;         //Button for pressing the ghost's right hand
 /* ------------ [End] Button Configuration -------------- */
 
+/* ------------ [START] Boot Configuration -------------- */
+    /*
+        The ghost boots in stages: the LEDs are set up and the first frame is drawn straight away,
+        then Edgent / WiFi are brought up one short step per loop iteration (see boot_step).
+        Timestamps are micros() since the app started (the ROM / 2nd stage bootloader time before that isn't included).
+    */
+    bool boot_complete = false;         //Set once every boot stage has run
+    uint32_t boot_first_frame_us = 0;   //Time the first frame was pushed to the LEDs
+    uint32_t boot_complete_us = 0;      //Time the last boot stage finished
+    uint32_t last_frame_ms = 0;         //Time the last frame was drawn (used to keep drawing while Edgent blocks)
+
+    /* Frame interval to keep up while Edgent is busy waiting (connecting to WiFi / the cloud, config mode) */
+    #define YIELD_FRAME_MS 16
+
+    /* Stack of the helper task drawing while Edgent blocks in the cloud connect (see edgent_blocking) - it runs the same render path
+       as loop() (lightScript's VM, framePlayer's LittleFS reads, FastLED.show()), so it gets the stack of Arduino's loop task until
+       the high-water mark it logs has been measured on a ghost. It only exists during a connect attempt */
+    #define BLOCKING_TASK_STACK 8192
+/* ------------ [End] Boot Configuration -------------- */
+
 /* ------------ [START] Define Function Prototypes -------------- */
     /* General Protoypes */
     void pin_config();                          //Function to initialize HW config
     void print_welcome_message();               //Function to print a welcome message with the SW version
     void next_pattern();                        //Cycle through the pattern list periodically, wrapping around once reaching the end of the array
+    bool select_pattern(uint8_t idx);           //Function to select a pattern of the list (e.g. from the local API) - returns false if it can't run right now
+    bool pattern_available(uint8_t idx);        //Function to check if a pattern has everything it needs to run (e.g. an animation file)
+    bool open_animation(const char *name);      //Function to open an animation, from the asset partition if it's there, else from LittleFS
+    void resume_settings();                     //Function to resume the pattern / brightness saved before the last reboot
+    void boot_step();                           //Function to run the next deferred boot stage (Edgent / WiFi / LittleFS), one per loop iteration
+    void edgent_yield();                        //Function to keep the lights running while Edgent is busy waiting
+    void edgent_blocking(bool blocking);        //Function to keep the lights running from a helper task while Edgent is blocked in the cloud handshake
 
     /* Power Management Prototypes */
     void disableWiFi();                                             //Function to disable WiFi for power savings
@@ -129,6 +183,11 @@
 
     /* LED Management Prototypes */
     void led_handler();                         //Handler function to execute various LED management tasks
+    void init_zones();                          //Function to map the LED array into zones (eyes / ambiance / strand), each running its own pattern
+    void strand_pattern(ledSpan lights, uint8_t phase);    //Zone pattern of the strand - runs the selected pattern of the pattern list
+
+    /* Remote Command Prototypes */
+    void init_remote_commands();                //Function to register the ghost's own console commands / configuration web routes
 
     /* Input Button Management Prototypes */
     void button_handler();                      //Handler function to execute various input button management tasks
@@ -150,9 +209,21 @@
 
  /* ----------- [START] Construct all User Light Libraries ------------- */
     lightTools lightTools;  //Common lightTools member, to be used by any user classes
+    assetStore assetStore;  //Common read-only assets (tables / animations) mapped from flash, to be used by any user classes
+    sampleProfiler sampleProfiler;  //Sampling profiler of the Arduino loop's core (started from the console)
+    frameTrace frameTrace;          //Frame timeline tracing (markers compiled in with -DFRAME_TRACE, started from the console)
+    frameBudget frameBudget(&lightTools);   //Render time budget of the patterns - lowers lightTools' blending / detail while a pattern overruns it
     klassyLights klassyLights(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
     cochise cochise(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
     nmayelights nmayelights(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
+    lightScript lightScript(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
+    framePlayer framePlayer(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
+    audioReactive audioReactive(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
+    pixelNode pixelNode(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
+    pixelMap pixelMap(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY, &lightTools);
+    lightZones lightZones(LED_ARR, LED_ARR_QTY, &lightTools);   //The zone map spans the whole LED array (eyes + ambiance + strand)
+    ghostApi ghostApi(LED_ARR, LED_ARR_QTY, &lightTools);       //The live preview shows the whole LED array
+    frameStream frameStream(LED_ARR, LED_ARR_QTY, &lightTools); //The serial frame stream carries the whole LED array
  /* ------------- [END] Construct all User Light Libraries ------------- */
 
 /* ------------ [START] Define Pattern List -------------- */
@@ -161,65 +232,186 @@
     typedef void (*FunctionList[])();
 
     /* Update this array whenever new functions need to be added, and the led_handler will automatically loop through them */
-    FunctionList christmas_patterns = {klassyLights.jacobs_ladder, cochise.stack_lights_in_the_middle, cochise.red_and_green_curtain_lights_to_middle, klassyLights.fading_candy_cane, nmayelights.police_lights};
+    FunctionList christmas_patterns = {klassyLights.jacobs_ladder, cochise.stack_lights_in_the_middle, cochise.red_and_green_curtain_lights_to_middle, klassyLights.fading_candy_cane, nmayelights.police_lights, lightScript.run, framePlayer.play, audioReactive.pulse, pixelMap.plasma, pixelMap.radial_wave, pixelMap.scroll_text};
+
+    /* Pre-rendered animation played by framePlayer.play - packed into the asset partition, or uploaded from 'data/' with PlatformIO's "Upload Filesystem Image" */
+    #define ANIMATION_NAME "anim/show.gfa"
+
+    /* 2D layout of the strand used by the pixelMap patterns - packed into the asset partition (without it, the strand is treated as a line) */
+    #define PIXEL_MAP_LAYOUT_NAME "layout/strand.glm"
 
     /* function list index to loop through the patterns */
     uint8_t christmas_patterns_idx = 0;
 
-    /* update this to set the duration (in seconds) of each pattern (how long it will run before moving to the next pattern) */
+    /* update this to set the default duration (in seconds) of each pattern (how long it will run before moving to the next pattern) */
     #define PATTERN_DURATION 60
 
+    /* User settings (pattern index / brightness / pattern duration), persisted to flash so they survive a reboot */
+    ghostSettings ghostSettings(LED_MAX_BRIGHTNESS, PATTERN_DURATION);
+
+    /* Multi-ghost sync - the ghosts on the network elect a leader, and follow its time base + pattern index */
+    ghostSync ghostSync;
+    #ifndef ONLINE_SIMULATION
+        udpSyncTransport sync_transport;
+    #endif
+
+    /* FastLED's timing helpers (beatsin / EVERY_N_* / ...) run on the shared time base, so time based patterns match across ghosts (needs -DUSE_GET_MILLISECOND_TIMER, see platformio.ini) */
+    #ifdef USE_GET_MILLISECOND_TIMER
+        uint32_t get_millisecond_timer() {return ghostSync.millis();}
+    #endif
+
+    /* First sACN (E1.31) / Art-Net universe of the lights - frames streamed by a show controller take over from the patterns */
+    #define PIXEL_NODE_FIRST_UNIVERSE 1
+
     /* Macro to calculate array sizes */
     #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
+    /* What the local API (lib/ghostApi) controls - the pattern list + brightness, the same way the buttons / console do */
+    class ghostApiControl : public apiControl
+    {
+        public:
+            uint8_t pattern_qty() {return ARRAY_SIZE(christmas_patterns);}
+            uint8_t pattern_idx() {return christmas_patterns_idx;}
+            bool pattern_available(uint8_t idx) {return ::pattern_available(idx);}
+            bool select_pattern(uint8_t idx) {return ::select_pattern(idx);}
+            uint8_t brightness() {return ghostSettings.brightness();}
+            void set_brightness(uint8_t value) {
+                ghostSettings.set_brightness(value);
+                FastLED.setBrightness(ghostSettings.brightness());
+            }
+    } api_control;
+
+    /* Where the frame stream (lib/frameStream) goes - the serial port, mixed in with the log text */
+    class serialFrameSink : public frameSink
+    {
+        public:
+            size_t room() {return Serial.availableForWrite();}
+            size_t write(const uint8_t *data, size_t len) {return Serial.write(data, len);}
+    } serial_sink;
+
 /* -------------- [END] Define Pattern List -------------- */
 
 void setup() {
     /* Initialize the Serial Terminal */
-    Serial.begin(SERIAL_BAUD);
-
-    /* Set WiFi to automatic sleep to reduce power */
     #ifndef ONLINE_SIMULATION
-        WiFi.setSleep(true);
+        Serial.setTxBufferSize(SERIAL_TX_BUF_LEN);
     #endif
+    Serial.begin(SERIAL_BAUD);
 
-    /* Disable BT to reduce power */
-    disableBT();
-
-    /* Initialize the HW pins / buttons */
+    /* Initialize the HW pins (LED power) */
     pin_config();
-    init_buttons();
 
-    /* Print Welcome Message */
-    print_welcome_message();
-
-    /* Finish initialization depending on physical HW vs Virtual Simulation */
+    /* Stage 1 - only what the first frame needs: the LEDs, and anything a resumed pattern reads from flash */
     #ifndef ONLINE_SIMULATION       //If running on physical HW
         FastLED.addLeds<LED_TYPE, LED_DATA_PIN, LED_COLOR_ORDER>(LED_ARR, LED_ARR_QTY).setCorrection(TypicalLEDStrip);
         FastLED.setBrightness(LED_MAX_BRIGHTNESS);
 
-        /* Initiate Blynk Edgent */
-        BlynkEdgent.begin();
+        /* Restore the light script saved in flash (falls back to the built-in script) */
+        lightScript.restore();
+
+        /* Map the asset partition (left closed if nothing valid was flashed there) - this only sets up the flash cache mapping */
+        if (assetStore.begin()) {
+            open_animation(ANIMATION_NAME);
+            if (assetView layout = assetStore.find(PIXEL_MAP_LAYOUT_NAME)) {
+                if (!pixelMap.load(layout.data, layout.len)) {time_logln("Layout doesn't fit the strand: " PIXEL_MAP_LAYOUT_NAME);}
+            }
+        }
+
+        /* Restore the user settings saved before the last reboot */
+        ghostSettings.restore();
     #else                           //If running online simulation
         FastLED.addLeds<NEOPIXEL, LED_DATA_PIN>(LED_ARR, LED_ARR_QTY).setCorrection(TypicalLEDStrip);
         FastLED.setBrightness(LED_MAX_BRIGHTNESS);
     #endif
 
-    /* Create LED array / Set master brightness */
+    /* Resume the previous pattern / brightness, and draw the first frame */
+    init_zones();
+    resume_settings();
+    led_handler();
+    boot_first_frame_us = micros();
 
+    /* Stage 2 - everything that isn't needed to draw (the rest is deferred to boot_step) */
+    #ifndef ONLINE_SIMULATION
+        /* Set WiFi to automatic sleep to reduce power */
+        WiFi.setSleep(true);
+
+        /* Keep the lights running whenever Edgent waits on the network */
+        edgentYieldHook = edgent_yield;
+        edgentBlockingHook = edgent_blocking;
+
+        /* Power the WiFi modem down completely while Edgent backs off between failed connect attempts */
+        edgentRadioOffHook = disableWiFi;
+
+        /* Sync with the other ghosts once WiFi is up (the node id is mixed from the whole MAC address) */
+        ghostSync.begin(&sync_transport, ghostSync.mac_node_id(ESP.getEfuseMac()));
+
+        /* Mark the WiFi events on the frame timeline (the argument is the arduino_event_id_t) */
+        #ifdef FRAME_TRACE
+            WiFi.onEvent([](arduino_event_id_t event) {TRACE_INSTANT("wifi", event);});
+        #endif
+    #endif
+
+    /* Start sampling the microphone (the analysis runs on the other core) */
+    #if !defined(ONLINE_SIMULATION) && defined(AUDIO_MIC_CHANNEL)
+        if (!audioReactive.begin(AUDIO_MIC_CHANNEL)) {time_logln("Unable to start the microphone");}
+    #endif
+
+    /* Disable BT to reduce power */
+    disableBT();
+
+    /* Initialize the buttons */
+    init_buttons();
+
+    /* Print Welcome Message */
+    print_welcome_message();
+    time_logln("First frame drawn at " + String(boot_first_frame_us / 1000.0, 1) + " ms");
 }
 
 void loop() {
     /* Handle LED tasks */
     led_handler();
 
+    /* Answer the local API, and send the live preview of the frame just drawn (never waits on the network) */
+    TRACE_BEGIN("ghostApi.loop");
+    ghostApi.loop();
+    TRACE_END("ghostApi.loop");
+
     /* Handle input tasks */
     button_handler();
 
-    /* Handle BlynkEdgent */
-    #ifndef ONLINE_SIMULATION
-        BlynkEdgent.run();
-    #endif
+    /* Write settings changes to flash once they settle */
+    ghostSettings.loop();
+
+    /* Exchange the time base / pattern with the other ghosts */
+    ghostSync.loop();
+
+    /* Finish booting one stage at a time, then handle BlynkEdgent */
+    if (!boot_complete) {
+        boot_step();
+    } else {
+        #ifndef ONLINE_SIMULATION
+            TRACE_BEGIN("BlynkEdgent.run");
+            BlynkEdgent.run();
+            TRACE_END("BlynkEdgent.run");
+
+            /* Listen for a show controller once WiFi is up (the E1.31 multicast groups are joined on the WiFi interface) */
+            static bool pixel_node_started = false;
+            if (!pixel_node_started && WiFi.status() == WL_CONNECTED) {
+                pixel_node_started = pixelNode.begin(PIXEL_NODE_FIRST_UNIVERSE);
+                if (!pixel_node_started) {time_logln("Unable to start the pixel node");}
+            }
+
+            /* Local API - open while connected to the home network */
+            bool api_wanted = WiFi.status() == WL_CONNECTED;
+            if (api_wanted != ghostApi.is_open()) {
+                if (api_wanted) {
+                    if (!ghostApi.begin(&api_control)) {time_logln("Unable to start the local API");}
+                } else {
+                    ghostApi.end();
+                }
+            }
+        #endif
+    }
 
     /* Delay a small amount to pet the watchdog */
     delayMicroseconds(1);
@@ -259,25 +451,231 @@ void disableBT() {
 
 /* Handler function to execute various LED management tasks */
 void led_handler() {
-
-    /* Cycle through the pattern list periodically, wrapping around once reaching the end of the array */
-    EVERY_N_SECONDS(PATTERN_DURATION) {next_pattern();}
-
-    /* Run the currently selected pattern */
-    christmas_patterns[christmas_patterns_idx]();
+    TRACE_SCOPE("led_handler");
+
+    /* Pattern that drew the strand's last frame (none while a show controller had the lights) */
+    static uint8_t drawn_idx = UINT8_MAX;
+
+    /* Frames streamed from a show controller take over from the patterns - only complete frames are shown */
+    if (pixelNode.loop()) {
+        drawn_idx = UINT8_MAX;
+        TRACE_BEGIN("show");
+        FastLED.show();
+        TRACE_END("show");
+        frameStream.send(micros(), 0);
+        last_frame_ms = millis();
+        return;
+    }
+    if (pixelNode.active()) {drawn_idx = UINT8_MAX; return;}
+
+    /* Cycle through the pattern list periodically, wrapping around once reaching the end of the array (followers show the leader's pattern instead) */
+    static CEveryNSeconds pattern_timer(PATTERN_DURATION);
+    pattern_timer.setPeriod(ghostSettings.pattern_duration());
+    uint8_t leader_idx = ghostSync.pattern_idx();
+    if (leader_idx != SYNC_NO_PATTERN) {
+        if (leader_idx != christmas_patterns_idx && leader_idx < ARRAY_SIZE(christmas_patterns) && pattern_available(leader_idx)) {
+            christmas_patterns_idx = leader_idx;
+            ghostSettings.set_pattern_idx(christmas_patterns_idx);
+            TRACE_INSTANT("pattern", christmas_patterns_idx);
+        }
+    } else if (pattern_timer) {
+        next_pattern();
+    }
+    ghostSync.set_pattern_idx(christmas_patterns_idx);
+
+    /* Keep the pattern within its render budget - while it overruns, the frame rate is capped, so the rest of loop() gets its time */
+    frameBudget.set_pattern(christmas_patterns_idx);
+    if (!frameBudget.frame_due(micros())) {return;}
+
+    /* The animation draws deltas against its previous frame - it starts over once the strand held anything else */
+    if (christmas_patterns_idx != drawn_idx) {
+        framePlayer.restart();
+        drawn_idx = christmas_patterns_idx;
+    }
+
+    /* Crossfade the palette a step per frame (if a new palette was selected) */
+    lightTools.blend_palette_step();
+
+    /* Run the pattern of every zone (the strand runs the currently selected pattern) */
+    uint32_t render_start_us = micros();
+    TRACE_BEGIN("render");
+    lightZones.render();
+    TRACE_END("render");
+    uint32_t render_us = micros() - render_start_us;
+
+    /* Lower the quality once the pattern kept overrunning its budget, raise it back once there's headroom again */
+    int8_t quality_change = frameBudget.report(render_us);
+    if (quality_change) {
+        TRACE_INSTANT("budget", frameBudget.level());
+        time_logln("Pattern " + String(christmas_patterns_idx, DEC) + " rendered in " + String(render_us) + " us (budget " + String(frameBudget.level_budget_us(frameBudget.level() + quality_change)) +
+                   " us) --> quality " + (quality_change < 0 ? "lowered" : "raised") + " to " + frameBudget.level_name(frameBudget.level()));
+    }
 
     /* push LED data */
+    TRACE_BEGIN("show");
     FastLED.show();
+    TRACE_END("show");
+
+    /* Stream the frame to a host, if the stream was turned on ("stream" console command) */
+    frameStream.send(render_start_us, render_us);
+
+    /* Keep track of frame timing */
+    last_frame_ms = millis();
+}
+
+/* Function to map the LED array into zones (eyes / ambiance / strand), each running its own pattern */
+void init_zones() {
+    /* On-board lights - the right eye / right side copy the left ones (mirrored, so the ghost is symmetrical), they aren't rendered twice */
+    #ifdef LED_EYE_QTY
+        uint8_t left_eye = lightZones.add_zone(LED_EYE_START_POS, LED_EYE_QTY / 2, lightZones.eyes_glow);
+        lightZones.add_mirror(LED_EYE_START_POS + LED_EYE_QTY / 2, left_eye);
+    #endif
+    #ifdef LED_AMB_QTY
+        uint8_t left_side = lightZones.add_zone(LED_AMB_START_POS, LED_AMB_QTY / 2, lightZones.ambiance_breathe);
+        lightZones.add_mirror(LED_AMB_START_POS + LED_AMB_QTY / 2, left_side, true);
+    #endif
+
+    /* External strand - the light libraries draw on LED_ARR[LED_PER_START_POS] onwards (see their constructors), not on the lights handed to strand_pattern, so the zone must be exactly those lights */
+    uint8_t strand = lightZones.add_zone(LED_PER_START_POS, LED_STRAND_QTY, strand_pattern);
+    if (strand == LIGHT_ZONE_NONE) {time_logln("Unable to map the strand zone");}
+    else if (lightZones.zone(strand).start != LED_PER_START_POS || lightZones.zone(strand).len != LED_STRAND_QTY || lightZones.zone(strand).reverse) {
+        time_logln("Strand zone doesn't match the light libraries' lights (LED_PER_START_POS / LED_STRAND_QTY)");
+    }
+}
+
+/* Zone pattern of the strand - runs the selected pattern of the pattern list (the light libraries are bound to the strand's lights already, see init_zones) */
+void strand_pattern(ledSpan lights, uint8_t phase) {
+    (void) lights; (void) phase;
+    christmas_patterns[christmas_patterns_idx]();
 }
 
 /* Cycle through the pattern list periodically, wrapping around once reaching the end of the array */
 void next_pattern() {
-    christmas_patterns_idx = (christmas_patterns_idx + 1) % ARRAY_SIZE(christmas_patterns);
+    /* Skip over patterns that can't run right now (there's always at least one native pattern available) */
+    do {
+        christmas_patterns_idx = (christmas_patterns_idx + 1) % ARRAY_SIZE(christmas_patterns);
+    } while (!pattern_available(christmas_patterns_idx));
+    ghostSettings.set_pattern_idx(christmas_patterns_idx);
+    TRACE_INSTANT("pattern", christmas_patterns_idx);
     time_logln("Moving to next pattern index: " + String(christmas_patterns_idx, DEC));
 }
 
+/* Function to select a pattern of the list (e.g. from the local API) - returns false if it can't run right now */
+bool select_pattern(uint8_t idx) {
+    if (idx >= ARRAY_SIZE(christmas_patterns) || !pattern_available(idx)) {return false;}
+    christmas_patterns_idx = idx;
+    ghostSettings.set_pattern_idx(christmas_patterns_idx);
+    TRACE_INSTANT("pattern", christmas_patterns_idx);
+    time_logln("Selected pattern index: " + String(christmas_patterns_idx, DEC));
+    return true;
+}
+
+/* Function to check if a pattern has everything it needs to run (e.g. an animation file) */
+bool pattern_available(uint8_t idx) {
+    if (christmas_patterns[idx] == framePlayer.play) {return framePlayer.is_open();}
+    if (christmas_patterns[idx] == audioReactive.pulse) {return audioReactive.active();}
+    if (christmas_patterns[idx] == pixelMap.scroll_text) {return pixelMap.mapped();}
+
+    return true;
+}
+
+/* Function to resume the pattern / brightness saved before the last reboot */
+void resume_settings() {
+    if (ghostSettings.pattern_idx() < ARRAY_SIZE(christmas_patterns) && pattern_available(ghostSettings.pattern_idx())) {
+        christmas_patterns_idx = ghostSettings.pattern_idx();
+    }
+    FastLED.setBrightness(ghostSettings.brightness());
+    time_logln("Resuming pattern index: " + String(christmas_patterns_idx, DEC));
+}
+
+/* Function to run the next deferred boot stage (Edgent / WiFi / LittleFS), one per loop iteration */
+void boot_step() {
+    #ifndef ONLINE_SIMULATION
+        /* Initiate Blynk Edgent (also mounts LittleFS) - one short step per call */
+        if (!BlynkEdgent.beginStep()) {return;}
+
+        /* LittleFS is mounted now --> fall back to the animation file, if it wasn't in the asset partition */
+        if (!framePlayer.is_open() && !open_animation(ANIMATION_NAME)) {time_logln("No animation found named " ANIMATION_NAME);}
+
+        /* Register the ghost's own console commands / web routes */
+        init_remote_commands();
+
+        /* The saved pattern may only be available now (e.g. an animation on LittleFS) */
+        if (ghostSettings.pattern_idx() != christmas_patterns_idx) {resume_settings();}
+    #endif
+
+    boot_complete = true;
+    boot_complete_us = micros();
+    time_logln("Boot complete at " + String(boot_complete_us / 1000.0, 1) + " ms (first frame at " + String(boot_first_frame_us / 1000.0, 1) + " ms)");
+}
+
+/* Function to keep the lights running while Edgent is busy waiting */
+void edgent_yield() {
+    /* Edgent also calls this from its regular run() - only draw if the main loop hasn't drawn recently */
+    if ((millis() - last_frame_ms) < YIELD_FRAME_MS) {return;}
+
+    led_handler();
+    button_handler();
+}
+
+/* Function to keep the lights running from a helper task while Edgent is blocked in the cloud connect */
+void edgent_blocking(bool blocking) {
+    #ifndef ONLINE_SIMULATION
+        /* The DNS lookup / TCP connect / TLS handshake block the loop for up to a few seconds without calling edgent_yield -
+           a helper task on the same core draws the current pattern meanwhile, and is deleted (outside of a frame) once it returns.
+           It only renders and shows frames: the pattern timer, the buttons, the settings and the log wait for the loop */
+        static TaskHandle_t blocking_task = NULL;
+        static SemaphoreHandle_t frame_mutex = NULL;
+
+        if (blocking) {
+            if (blocking_task != NULL) {return;}
+            if (frame_mutex == NULL) {frame_mutex = xSemaphoreCreateMutex();}
+            xTaskCreatePinnedToCore([](void *) {
+                for (;;) {
+                    xSemaphoreTake(frame_mutex, portMAX_DELAY);
+                    if (!pixelNode.active() && (millis() - last_frame_ms) >= YIELD_FRAME_MS && frameBudget.frame_due(micros())) {
+                        lightTools.blend_palette_step();
+                        lightZones.render();
+                        FastLED.show();
+                        last_frame_ms = millis();
+                    }
+                    xSemaphoreGive(frame_mutex);
+                    vTaskDelay(pdMS_TO_TICKS(YIELD_FRAME_MS));
+                }
+            }, "edgent_blocking", BLOCKING_TASK_STACK, NULL, 1, &blocking_task, xPortGetCoreID());
+        } else if (blocking_task != NULL) {
+            xSemaphoreTake(frame_mutex, portMAX_DELAY);
+            UBaseType_t stack_free = uxTaskGetStackHighWaterMark(blocking_task);
+            vTaskDelete(blocking_task);
+            blocking_task = NULL;
+            xSemaphoreGive(frame_mutex);
+
+            /* Stack the helper never touched (the pattern it drew is logged with it, to size BLOCKING_TASK_STACK from) */
+            time_logln("Blocking helper: " + String(stack_free) + " of " + String(BLOCKING_TASK_STACK) + " stack bytes never used (pattern " +
+                       String(christmas_patterns_idx, DEC) + ")");
+        }
+    #endif
+}
+
+/* Function to open an animation, from the asset partition if it's there, else from LittleFS */
+bool open_animation(const char *name) {
+    #ifndef ONLINE_SIMULATION
+        /* Animations in the asset partition are played straight from the mapped flash */
+        static memoryFrameSource asset_source;
+        if (assetView anim = assetStore.find(name)) {
+            asset_source = memoryFrameSource(anim.data, anim.len);
+            return framePlayer.open(&asset_source);
+        }
+
+        return framePlayer.open(LittleFS, (String("/") + name).c_str());
+    #else
+        return false;
+    #endif
+}
+
 /* Handler function to execute various input button management tasks */
 void button_handler() {
+    TRACE_SCOPE("button_handler");
     left_hand_btn.loop();
     right_hand_btn.loop();
 
@@ -300,6 +698,211 @@ void button_handler() {
 
 }
 
+/* Function to register the ghost's own console commands / configuration web routes */
+void init_remote_commands() {
+    #ifndef ONLINE_SIMULATION
+        /* Hex of a light script being uploaded in several pieces (the console input line is short) */
+        static String script_upload_hex = "";
+
+        /* Light scripts: "script [info]", "script load <hex>", "script add <hex>" + "script commit", "script erase" */
+        edgentConsole.addCommand("script", [](int argc, const char** argv) {
+            if (argc < 1 || 0 == strcmp(argv[0], "info")) {
+                edgentConsole.printf(R"json({"status":"OK","code_len":%u})json" "\n", lightScript.code_len());
+            } else if (0 == strcmp(argv[0], "add") && argc >= 2) {
+                script_upload_hex += argv[1];
+                edgentConsole.printf(R"json({"status":"OK","staged":%u})json" "\n", script_upload_hex.length() / 2);
+            } else if ((0 == strcmp(argv[0], "load") && argc >= 2) || 0 == strcmp(argv[0], "commit")) {
+                bool loaded = lightScript.load_hex((argc >= 2) ? argv[1] : script_upload_hex.c_str()) && lightScript.save();
+                script_upload_hex = "";
+                if (loaded) {
+                    edgentConsole.print(R"json({"status":"OK","msg":"script loaded"})json" "\n");
+                } else {
+                    edgentConsole.print(R"json({"status":"error","msg":"invalid script"})json" "\n");
+                }
+            } else if (0 == strcmp(argv[0], "erase")) {
+                lightScript.erase();
+                edgentConsole.print(R"json({"status":"OK","msg":"script erased"})json" "\n");
+            }
+        });
+
+        /* Animations: "anim [info]", "anim open [name]", "anim close" (LittleFS files can be managed with the console's ls / rm / mv) */
+        edgentConsole.addCommand("anim", [](int argc, const char** argv) {
+            if (argc >= 1 && 0 == strcmp(argv[0], "open")) {
+                if (!open_animation((argc >= 2) ? argv[1] : ANIMATION_NAME)) {
+                    edgentConsole.print(R"json({"status":"error","msg":"invalid animation"})json" "\n");
+                    return;
+                }
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "close")) {
+                framePlayer.close();
+            }
+            edgentConsole.printf(R"json({"status":"OK","open":%s,"frames":%u,"frame_ms":%u})json" "\n",
+                                 framePlayer.is_open() ? "true" : "false", framePlayer.frame_qty(), framePlayer.frame_ms());
+        });
+
+        /* Assets: "assets" lists the contents of the asset partition */
+        edgentConsole.addCommand("assets", [](int argc, const char** argv) {
+            for (uint16_t idx = 0; idx < assetStore.asset_qty(); idx++) {
+                edgentConsole.printf("%8u %s\n", (unsigned) assetStore.entry(idx)->len, assetStore.entry(idx)->name);
+            }
+            edgentConsole.printf(R"json({"status":"OK","open":%s,"assets":%u,"bytes":%u})json" "\n",
+                                 assetStore.is_open() ? "true" : "false", assetStore.asset_qty(), (unsigned) assetStore.image_len());
+        });
+
+        /* Settings: "settings [info]", "settings brightness <0-255>", "settings duration <seconds>", "settings save", "settings erase" */
+        edgentConsole.addCommand("settings", [](int argc, const char** argv) {
+            if (argc >= 2 && 0 == strcmp(argv[0], "brightness")) {
+                ghostSettings.set_brightness(constrain(atoi(argv[1]), 0, 255));
+                FastLED.setBrightness(ghostSettings.brightness());
+            } else if (argc >= 2 && 0 == strcmp(argv[0], "duration")) {
+                ghostSettings.set_pattern_duration(constrain(atoi(argv[1]), 1, 65535));
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "save")) {
+                ghostSettings.flush();
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "erase")) {
+                ghostSettings.erase();
+                resume_settings();
+            }
+            edgentConsole.printf(R"json({"status":"OK","pattern":%u,"brightness":%u,"duration":%u,"dirty":%s,"writes":%u})json" "\n",
+                                 ghostSettings.pattern_idx(), ghostSettings.brightness(), ghostSettings.pattern_duration(),
+                                 ghostSettings.dirty() ? "true" : "false", (unsigned) ghostSettings.write_qty());
+        });
+
+        /* Palettes: "palette [info]" lists the built-in palettes, "palette <name>" crossfades to one of them */
+        edgentConsole.addCommand("palette", [](int argc, const char** argv) {
+            static const char *palette_name = lightTools::palette_info(0)->name;
+
+            if (argc >= 1 && 0 != strcmp(argv[0], "info")) {
+                const lightPaletteInfo *info = lightTools::find_palette(argv[0]);
+                if (!info) {
+                    edgentConsole.print(R"json({"status":"error","msg":"unknown palette"})json" "\n");
+                    return;
+                }
+                lightTools.blend_to_palette(info->gradient);
+                palette_name = info->name;
+            }
+            for (uint8_t idx = 0; idx < lightTools::palette_qty(); idx++) {
+                edgentConsole.printf("%s\n", lightTools::palette_info(idx)->name);
+            }
+            edgentConsole.printf(R"json({"status":"OK","palette":"%s","blending":%s})json" "\n",
+                                 palette_name, lightTools.palette_blending() ? "true" : "false");
+        });
+
+        /* Audio: "audio" reports the latest analysis (levels per band, beats) */
+        edgentConsole.addCommand("audio", [](int argc, const char** argv) {
+            audioSnapshot audio = {};
+            audioReactive.snapshot(&audio);
+
+            String bands = "";
+            for (uint8_t band = 0; band < AUDIO_BAND_QTY; band++) {bands += (band ? "," : "") + String(audio.bands[band]);}
+            edgentConsole.printf(R"json({"status":"OK","active":%s,"level":%u,"bands":[%s],"beats":%u,"frames":%u})json" "\n",
+                                 audioReactive.active() ? "true" : "false", audio.level, bands.c_str(), audio.beat_qty, (unsigned) audioReactive.frame_qty());
+        });
+
+        /* Sync: "sync" reports the multi-ghost sync state (role, leader, latest time base error / clock trim) */
+        edgentConsole.addCommand("sync", [](int argc, const char** argv) {
+            edgentConsole.printf(R"json({"status":"OK","role":"%s","node":"%08x","leader":"%08x","time_ms":%u,"error_us":%d,"rate_ppm":%d,"steps":%u})json" "\n",
+                                 ghostSync.leading() ? "leader" : (ghostSync.following() ? "follower" : "alone"), (unsigned) ghostSync.node_id(), (unsigned) ghostSync.leader_id(),
+                                 (unsigned) ghostSync.millis(), (int) ghostSync.last_error_us(), (int) ghostSync.rate_ppm(), ghostSync.step_qty());
+        });
+
+        /* Pixel node: "node" reports the sACN / Art-Net receive statistics */
+        edgentConsole.addCommand("node", [](int argc, const char** argv) {
+            const pixelNodeStats &stats = pixelNode.stats();
+            edgentConsole.printf(R"json({"status":"OK","active":%s,"first_universe":%u,"universes":%u,"frames":%u,"packets":%u,"dropped_frames":%u,"late":%u,"ignored":%u})json" "\n",
+                                 pixelNode.active() ? "true" : "false", PIXEL_NODE_FIRST_UNIVERSE, pixelNode.universe_qty(), (unsigned) stats.frame_qty,
+                                 (unsigned) stats.packet_qty, (unsigned) stats.dropped_frame_qty, (unsigned) stats.late_qty, (unsigned) stats.ignored_qty);
+        });
+
+        /* 2D layout: "text <message>" sets the text of the scrolling text pattern, "text" alone reports if a layout is loaded */
+        edgentConsole.addCommand("text", [](int argc, const char** argv) {
+            if (argc >= 1) {
+                String text = argv[0];
+                for (int arg = 1; arg < argc; arg++) {text += String(" ") + argv[arg];}
+                pixelMap.set_text(text.c_str());
+            }
+            edgentConsole.printf(R"json({"status":"OK","mapped":%s,"led_qty":%u})json" "\n",
+                                 pixelMap.mapped() ? "true" : "false", LED_STRAND_QTY);
+        });
+
+        /* Frame stream: "stream on|raw [baud]" streams the lights on this serial port (delta / uncompressed, optionally switching the port's baud rate), "stream off", "stream" reports the statistics */
+        edgentConsole.addCommand("stream", [](int argc, const char** argv) {
+            if (argc >= 1 && (0 == strcmp(argv[0], "on") || 0 == strcmp(argv[0], "raw"))) {
+                frameStream.begin(&serial_sink, 0 == strcmp(argv[0], "raw"));
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "off")) {
+                frameStream.end();
+            }
+            const frameStreamStats &stats = frameStream.stats();
+            edgentConsole.printf(R"json({"status":"OK","open":%s,"raw":%s,"frames":%u,"key_frames":%u,"skipped":%u,"bytes":%u})json" "\n",
+                                 frameStream.is_open() ? "true" : "false", frameStream.raw() ? "true" : "false", (unsigned) stats.frame_qty,
+                                 (unsigned) stats.key_qty, (unsigned) stats.skipped_qty, (unsigned) stats.byte_qty);
+
+            /* The reply goes out at the old baud rate - the host switches over once it got it */
+            if (argc >= 2 && frameStream.is_open() && atol(argv[1]) > 0) {
+                Serial.flush();
+                Serial.updateBaudRate(atol(argv[1]));
+            }
+        });
+
+        /* Profiler: "profile start [hz]" samples the Arduino loop's core, "profile stop", "profile dump" stops + prints the samples (see tools/host/profile_report.cpp), "profile" reports the state */
+        edgentConsole.addCommand("profile", [](int argc, const char** argv) {
+            if (argc >= 1 && 0 == strcmp(argv[0], "start")) {
+                if (!sampleProfiler.begin((argc >= 2) ? atol(argv[1]) : PROFILER_DEFAULT_HZ)) {
+                    edgentConsole.print(R"json({"status":"error","msg":"invalid rate"})json" "\n");
+                    return;
+                }
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "stop")) {
+                sampleProfiler.end();
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "dump")) {
+                sampleProfiler.dump([](const char *line) {edgentConsole.printf("%s\n", line);});
+            }
+            edgentConsole.printf(R"json({"status":"OK","running":%s,"rate_hz":%u,"samples":%u,"total":%u,"overhead_pct":%.2f})json" "\n",
+                                 sampleProfiler.running() ? "true" : "false", (unsigned) sampleProfiler.rate_hz(), sampleProfiler.sample_qty(),
+                                 (unsigned) sampleProfiler.total_qty(), sampleProfiler.overhead_pct());
+        });
+
+        /* Tracing: "trace start [trigger]" records the frame timeline (optionally frozen around the first "pattern" / "wifi" / ... marker named trigger), "trace stop", "trace dump" stops + prints the records (see tools/host/trace_json.cpp), "trace" reports the state */
+        edgentConsole.addCommand("trace", [](int argc, const char** argv) {
+            if (argc >= 1 && 0 == strcmp(argv[0], "start")) {
+                if (!frameTrace.begin((argc >= 2) ? argv[1] : NULL)) {
+                    edgentConsole.print(R"json({"status":"error","msg":"tracing not built in (-DFRAME_TRACE)"})json" "\n");
+                    return;
+                }
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "stop")) {
+                frameTrace.end();
+            } else if (argc >= 1 && 0 == strcmp(argv[0], "dump")) {
+                frameTrace.dump([](const char *line) {edgentConsole.printf("%s\n", line);});
+            }
+            edgentConsole.printf(R"json({"status":"OK","running":%s,"triggered":%s,"records":%u,"total":%u})json" "\n",
+                                 frameTrace.running() ? "true" : "false", frameTrace.triggered() ? "true" : "false",
+                                 (unsigned) frameTrace.record_qty(), (unsigned) frameTrace.total_qty());
+        });
+
+        /* Frame budget: "budget [us]" reports the quality level / render statistics (optionally setting the render time allowed per frame) */
+        edgentConsole.addCommand("budget", [](int argc, const char** argv) {
+            if (argc >= 1 && atol(argv[0]) > 0) {frameBudget.set_budget_us(atol(argv[0]));}
+            const frameBudgetStats &stats = frameBudget.stats();
+            edgentConsole.printf(R"json({"status":"OK","level":"%s","budget_us":%u,"level_budget_us":%u,"frames":%u,"over":%u,"lowered":%u,"raised":%u,"worst_us":%u})json" "\n",
+                                 frameBudget.level_name(frameBudget.level()), (unsigned) frameBudget.budget_us(),
+                                 (unsigned) frameBudget.level_budget_us(frameBudget.level()), (unsigned) stats.frame_qty,
+                                 (unsigned) stats.over_qty, (unsigned) stats.lowered_qty, (unsigned) stats.raised_qty, (unsigned) stats.worst_us);
+        });
+
+        /* Boot timing: "boot" reports the boot-to-first-frame / boot-complete times (ms since the app started) */
+        edgentConsole.addCommand("boot", [](int argc, const char** argv) {
+            edgentConsole.printf(R"json({"status":"OK","first_frame_ms":%.1f,"complete_ms":%.1f})json" "\n",
+                                 boot_first_frame_us / 1000.0, boot_complete_us / 1000.0);
+        });
+
+        /* Light scripts can also be uploaded while the configuration web server is running */
+        server.on("/script", HTTP_POST, []() {
+            if (lightScript.load_hex(server.arg("hex").c_str()) && lightScript.save()) {
+                server.send(200, "application/json", R"json({"status":"ok","msg":"Script loaded"})json");
+            } else {
+                server.send(500, "application/json", R"json({"status":"error","msg":"Script invalid"})json");
+            }
+        });
+    #endif
+}
+
 /* Function to initialize the button configurations */
 void init_buttons() {
     /* Configure Left Hand */
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""
+    pack_assets.py - asset image packer for lib/assetStore
+
+    Packs every file below a folder into a single asset image (".gas"), to be flashed into
+    the ghost's 'assets' partition and memory mapped by lib/assetStore.  Each asset is named
+    by its path relative to the folder, using '/' separators (e.g. "anim/show.gfa").
+
+    Usage:
+        python pack_assets.py data -o temp/assets.gas
+        python pack_assets.py --list temp/assets.gas
+
+    After packing, the flash offset of the 'assets' partition is read from 'partitions.csv'
+    and the esptool command to flash the image is printed.
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+
+GAS_VERSION = 1
+HEADER_LEN = 16
+ENTRY_LEN = 40
+NAME_LEN = 28           # Including the terminating NUL
+ALIGN = 4
+PARTITION_LABEL = 'assets'
+DEFAULT_PARTITIONS = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'partitions.csv')
+
+
+def fnv1a(name):
+    """32b FNV-1a hash of an asset name (same as assetStore::hash_name)"""
+    h = 2166136261
+    for b in name.encode('utf-8'):
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def align(value):
+    return (value + ALIGN - 1) & ~(ALIGN - 1)
+
+
+def collect(folder):
+    """(name, data) of every file below folder, sorted by name"""
+    assets = []
+    for root, _, files in os.walk(folder):
+        for fn in files:
+            path = os.path.join(root, fn)
+            name = os.path.relpath(path, folder).replace(os.sep, '/')
+            if len(name.encode('utf-8')) >= NAME_LEN:
+                sys.exit("asset name too long (max %d characters): %s" % (NAME_LEN - 1, name))
+            with open(path, 'rb') as f:
+                assets.append((name, f.read()))
+    return sorted(assets)
+
+
+def pack(assets):
+    bucket_qty = 1
+    while bucket_qty < 2 * len(assets):
+        bucket_qty *= 2
+
+    entries_ofs = HEADER_LEN + align(bucket_qty * 2)
+    offset = data_ofs = entries_ofs + len(assets) * ENTRY_LEN
+
+    buckets = [0] * bucket_qty
+    entries = b''
+    data = b''
+    for idx, (name, blob) in enumerate(assets):
+        h = fnv1a(name)
+        bucket = h & (bucket_qty - 1)
+        while buckets[bucket]:
+            bucket = (bucket + 1) & (bucket_qty - 1)
+        buckets[bucket] = idx + 1
+
+        entries += struct.pack('<III', h, offset, len(blob)) + name.encode('utf-8').ljust(NAME_LEN, b'\0')
+        padded = blob.ljust(align(len(blob)), b'\0')
+        data += padded
+        offset += len(padded)
+
+    bucket_bytes = struct.pack('<%dH' % bucket_qty, *buckets).ljust(align(bucket_qty * 2), b'\0')
+    header = b'GAS' + struct.pack('<BHHII', GAS_VERSION, len(assets), bucket_qty, data_ofs + len(data), 0)
+    return header + bucket_bytes + entries + data
+
+
+def unpack(image):
+    """Parse an image back into {name: data}, the same way assetStore looks assets up"""
+    if image[:3] != b'GAS' or image[3] != GAS_VERSION:
+        raise ValueError("not an asset image")
+    asset_qty, bucket_qty, image_len = struct.unpack_from('<HHI', image, 4)
+    entries_ofs = HEADER_LEN + align(bucket_qty * 2)
+    buckets = struct.unpack_from('<%dH' % bucket_qty, image, HEADER_LEN)
+
+    assets = {}
+    for i in range(asset_qty):
+        h, offset, length = struct.unpack_from('<III', image, entries_ofs + i * ENTRY_LEN)
+        raw_name = image[entries_ofs + i * ENTRY_LEN + 12:entries_ofs + (i + 1) * ENTRY_LEN]
+        name = raw_name.split(b'\0', 1)[0].decode('utf-8')
+
+        # Find the asset through the hash table, to check the index as well
+        bucket = fnv1a(name) & (bucket_qty - 1)
+        while buckets[bucket] and buckets[bucket] != i + 1:
+            bucket = (bucket + 1) & (bucket_qty - 1)
+        if buckets[bucket] != i + 1 or h != fnv1a(name) or offset + length > image_len:
+            raise ValueError("corrupt index entry: %s" % name)
+        assets[name] = image[offset:offset + length]
+    return assets
+
+
+def find_partition(partitions_csv):
+    """(offset, size) of the assets partition, or None if it can't be found"""
+    try:
+        with open(partitions_csv) as f:
+            for row in csv.reader(line for line in f if not line.lstrip().startswith('#')):
+                row = [col.strip() for col in row]
+                if len(row) >= 5 and row[0] == PARTITION_LABEL:
+                    return int(row[3], 0), int(row[4], 0)
+    except (OSError, ValueError):
+        pass
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack a folder of assets for lib/assetStore")
+    parser.add_argument('input', help="folder to pack (or an image to list, with --list)")
+    parser.add_argument('-o', '--output', help="output asset image (.gas)")
+    parser.add_argument('--list', action='store_true', help="list the assets in an existing image")
+    parser.add_argument('--partitions', default=DEFAULT_PARTITIONS, help="partition table holding the 'assets' partition")
+    args = parser.parse_args()
+
+    if args.list:
+        with open(args.input, 'rb') as f:
+            for name, blob in sorted(unpack(f.read()).items()):
+                print("%8d %s" % (len(blob), name))
+        return
+
+    if not args.output:
+        parser.error("-o/--output is required when packing")
+
+    assets = collect(args.input)
+    image = pack(assets)
+    if unpack(image) != dict(assets):
+        sys.exit("internal error: packed image does not unpack to the input files")
+
+    partition = find_partition(args.partitions)
+    if partition and len(image) > partition[1]:
+        sys.exit("image is %d bytes, but the '%s' partition only holds %d" % (len(image), PARTITION_LABEL, partition[1]))
+
+    with open(args.output, 'wb') as f:
+        f.write(image)
+
+    print("%s: %d assets, %d bytes" % (args.output, len(assets), len(image)))
+    if partition:
+        print("flash with: esptool.py --chip esp32 write_flash 0x%X %s" % (partition[0], args.output))
+
+
+if __name__ == '__main__':
+    main()
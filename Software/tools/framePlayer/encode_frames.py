@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+    encode_frames.py - animation encoder for lib/framePlayer
+
+    Converts a GIF (or a sequence of PNG/GIF images) into the compact ".gfa" animation
+    format streamed by lib/framePlayer.  Each image is sampled along a horizontal line,
+    one sample per light, so a picture of the light string (like the ones made with
+    'Rainbow_GIF_editor.pptm') maps straight onto the LED array.
+
+    The first frame is stored in full; every frame after that only stores the lights that
+    changed, using run-length encoding for lights that share a color.
+
+    Requires Pillow (pip install pillow).
+
+    Usage:
+        python encode_frames.py rainbow_pattern.gif -o data/anim/show.gfa --leds 100
+        python encode_frames.py frame_*.png -o data/anim/show.gfa --leds 100 --fps 30
+        python encode_frames.py rainbow_pattern.gif -o show.gfa --row 0.45 --x0 0.05 --x1 0.95
+
+    The resulting file can be placed in Software/data/anim/ and uploaded with PlatformIO's
+    "Upload Filesystem Image" task.
+"""
+
+import argparse
+import struct
+import sys
+
+try:
+    from PIL import Image, ImageSequence
+except ImportError:
+    sys.exit("Pillow is required: pip install pillow")
+
+GFA_VERSION = 1
+CMD_SKIP = 0x00
+CMD_RUN = 0x40
+CMD_COPY = 0x80
+CMD_MAX_QTY = 64
+CMD_LONG_SKIP = 0xFE
+CMD_END = 0xFF
+
+
+def load_frames(paths):
+    """Yield (RGB image, duration_ms) for every frame of every input file"""
+    for path in paths:
+        image = Image.open(path)
+        for frame in ImageSequence.Iterator(image):
+            duration = frame.info.get('duration', image.info.get('duration', 0))
+            rgba = frame.convert('RGBA')
+            background = Image.new('RGBA', rgba.size, (0, 0, 0, 255))
+            yield Image.alpha_composite(background, rgba).convert('RGB'), duration
+
+
+def sample_frame(image, leds, row, x0, x1):
+    """Sample one color per light along a horizontal line of the image"""
+    width, height = image.size
+    y = min(height - 1, int(row * height))
+    pixels = []
+    for i in range(leds):
+        x = min(width - 1, int((x0 + (i + 0.5) / leds * (x1 - x0)) * width))
+        pixels.append(image.getpixel((x, y)))
+    return pixels
+
+
+def encode_frame(pixels, previous):
+    """Encode one frame as SKIP / RUN / COPY commands against the previous frame (None = full frame)"""
+    out = bytearray()
+    i = 0
+    count = len(pixels)
+    while i < count:
+        # Unchanged lights --> SKIP
+        if previous is not None and pixels[i] == previous[i]:
+            j = i
+            while j < count and pixels[j] == previous[j]:
+                j += 1
+            qty = j - i
+            if qty > CMD_MAX_QTY:
+                out += struct.pack('<BH', CMD_LONG_SKIP, qty)
+            else:
+                out.append(CMD_SKIP | (qty - 1))
+            i = j
+            continue
+
+        # Several lights of the same color --> RUN
+        j = i
+        while j < count and j - i < CMD_MAX_QTY and pixels[j] == pixels[i]:
+            j += 1
+        if j - i >= 2:
+            out.append(CMD_RUN | (j - i - 1))
+            out += bytes(pixels[i])
+            i = j
+            continue
+
+        # Anything else --> COPY, until a run or an unchanged light starts
+        j = i
+        while j < count and j - i < CMD_MAX_QTY:
+            if previous is not None and pixels[j] == previous[j]:
+                break
+            if j + 1 < count and pixels[j] == pixels[j + 1] and j > i:
+                break
+            j += 1
+        out.append(CMD_COPY | (j - i - 1))
+        for p in pixels[i:j]:
+            out += bytes(p)
+        i = j
+
+    out.append(CMD_END)
+    return out
+
+
+def decode(data):
+    """Decode an animation (used to double check the encoder's output)"""
+    led_qty, frame_qty = struct.unpack_from('<HH', data, 4)
+    pos = 16
+    frame = [(0, 0, 0)] * led_qty
+    frames = []
+    for _ in range(frame_qty):
+        i = 0
+        while True:
+            cmd = data[pos]
+            pos += 1
+            if cmd == CMD_END:
+                break
+            if cmd == CMD_LONG_SKIP:
+                i += struct.unpack_from('<H', data, pos)[0]
+                pos += 2
+                continue
+            qty = (cmd & 0x3F) + 1
+            if cmd & 0xC0 == CMD_RUN:
+                frame[i:i + qty] = [tuple(data[pos:pos + 3])] * qty
+                pos += 3
+            elif cmd & 0xC0 == CMD_COPY:
+                frame[i:i + qty] = [tuple(data[pos + k * 3:pos + k * 3 + 3]) for k in range(qty)]
+                pos += qty * 3
+            i += qty
+        frames.append(list(frame))
+    return frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Encode a GIF / PNG sequence for lib/framePlayer")
+    parser.add_argument('inputs', nargs='+', help="GIF file, or PNG/GIF images in playback order")
+    parser.add_argument('-o', '--output', required=True, help="output animation file (.gfa)")
+    parser.add_argument('--leds', type=int, default=100, help="number of lights to sample (default: 100)")
+    parser.add_argument('--fps', type=float, help="playback rate (default: the GIF frame duration, or 30)")
+    parser.add_argument('--row', type=float, default=0.5, help="vertical position of the sampling line, 0..1 (default: 0.5)")
+    parser.add_argument('--x0', type=float, default=0.0, help="left end of the sampling line, 0..1 (default: 0)")
+    parser.add_argument('--x1', type=float, default=1.0, help="right end of the sampling line, 0..1 (default: 1)")
+    args = parser.parse_args()
+
+    frames = []
+    durations = []
+    for image, duration in load_frames(args.inputs):
+        frames.append(sample_frame(image, args.leds, args.row, args.x0, args.x1))
+        durations.append(duration)
+    if not frames:
+        sys.exit("no frames found")
+
+    if args.fps:
+        frame_ms = int(round(1000 / args.fps))
+    else:
+        known = [d for d in durations if d]
+        frame_ms = int(round(sum(known) / len(known))) if known else 33
+    frame_ms = max(1, frame_ms)     # the player rejects a frame time of 0
+
+    body = bytearray()
+    previous = None
+    for pixels in frames:
+        body += encode_frame(pixels, previous)
+        previous = pixels
+
+    data = b'GFA' + struct.pack('<BHHHHI', GFA_VERSION, args.leds, len(frames), frame_ms, 0, 0) + bytes(body)
+    if decode(data) != frames:
+        sys.exit("internal error: encoded animation does not decode to the input frames")
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+
+    raw = len(frames) * args.leds * 3
+    print("%s: %d frames x %d lights @ %d ms/frame, %d bytes (%.1f%% of raw)" %
+          (args.output, len(frames), args.leds, frame_ms, len(data), 100.0 * len(data) / raw))
+
+
+if __name__ == '__main__':
+    main()
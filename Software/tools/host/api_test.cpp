@@ -0,0 +1,370 @@
+/*
+    api_test.cpp - host tool
+    Runs lib/ghostApi on loopback against a fake ghost (a pattern list + brightness), with a
+    local client on the other end of the socket:
+        - the JSON API: state / pattern list / pattern selection / brightness, and the error replies
+        - the WebSocket handshake (RFC 6455 example key), and the close handshake
+        - the live preview: every message is decoded with the frame codec, and must match the
+          lights at the time it was sent (a client that joins later must get a full frame)
+        - a client that stops reading: the preview is skipped (never queued / blocking), the
+          client is dropped after GHOST_API_TIMEOUT_MS, and the other client's deltas stay intact
+        - the time loop() takes (it must never wait on the network)
+
+    Usage (built by 'build_host.sh'):
+        api_test [--leds N] [--frames N] [--port P]
+        api_test --serve [--port P]     serve the fake ghost on the virtual clock in real time,
+                                        to try it with curl / a browser (Ctrl+C to stop)
+
+    The exit code is 1 if a check failed.
+*/
+
+#include "host_libs.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define MAX_LOOP_US 2000                //Longest loop() may take (it never waits on the network)
+
+struct testOptions {
+    uint16_t leds = 300;
+    uint32_t frames = 600;
+    uint16_t port = 48080;
+    bool serve = false;
+} opt;
+
+int failures = 0;
+
+#define CHECK(cond, ...) do {if (!(cond)) {printf("FAIL: " __VA_ARGS__); printf("\n"); failures++;}} while (0)
+
+int64_t wall_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Fake ghost - 3 patterns, the last one can't run */
+class fakeControl : public apiControl
+{
+    public:
+        uint8_t pattern_qty() {return 3;}
+        uint8_t pattern_idx() {return idx;}
+        bool pattern_available(uint8_t pattern) {return pattern < 2;}
+        bool select_pattern(uint8_t pattern) {
+            if (!pattern_available(pattern)) {return false;}
+            idx = pattern;
+            return true;
+        }
+        uint8_t brightness() {return level;}
+        void set_brightness(uint8_t value) {level = value;}
+
+        uint8_t idx = 0;
+        uint8_t level = 128;
+} control;
+
+/* Draw frame 'frame' - a moving dot on a slowly changing background, so most frames are small deltas (or every light changing every frame, if 'noisy') */
+void draw(std::vector<CRGB> &leds, uint32_t frame, bool noisy) {
+    for (uint16_t idx = 0; idx < leds.size(); idx++) {
+        leds[idx] = noisy ? CRGB(frame * 7 + idx, frame * 13 + idx * 3, idx) : CRGB((idx + frame / 8) % 7 * 20, control.idx * 60, control.level);
+    }
+    leds[frame % leds.size()] = CRGB(255, 255, 255);
+}
+
+/* Run one frame: draw, advance the virtual clock, serve - returns how long loop() took */
+int64_t step(std::vector<CRGB> &leds, uint32_t frame, bool noisy=false) {
+    draw(leds, frame, noisy);
+    host::clock_us += 16000;
+    int64_t start = wall_us();
+    ghostApi::loop();
+    return wall_us() - start;
+}
+
+int connect_client(int rcvbuf=0) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvbuf) {setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));}
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr *) &addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+/* Read whatever is waiting (non-blocking) - returns false once the server closed the connection */
+bool read_waiting(int fd, std::string &in) {
+    char buf[4096];
+    for (;;) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len > 0) {in.append(buf, len); continue;}
+        return len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+/* Send a request, and serve until the server closed the connection - returns the response */
+std::string request(const std::string &text, std::vector<CRGB> &leds) {
+    int fd = connect_client();
+    if (fd < 0) {return "";}
+    send(fd, text.data(), text.size(), 0);
+
+    std::string response;
+    for (uint32_t frame = 0; frame < 100; frame++) {
+        step(leds, frame);
+        if (!read_waiting(fd, response)) {break;}
+    }
+    close(fd);
+    return response;
+}
+
+int status_code(const std::string &response) {
+    return response.size() > 12 ? atoi(response.c_str() + 9) : 0;
+}
+
+std::string body(const std::string &response) {
+    size_t pos = response.find("\r\n\r\n");
+    return pos == std::string::npos ? "" : response.substr(pos + 4);
+}
+
+/* One preview client - decodes the messages into its own copy of the lights */
+struct previewClient {
+    int fd = -1;
+    std::string in;
+    std::vector<CRGB> lights;
+    uint32_t message_qty = 0;
+    uint32_t byte_qty = 0;
+    bool closed = false;
+
+    bool open(uint16_t led_qty, int rcvbuf=0) {
+        fd = connect_client(rcvbuf);
+        lights.assign(led_qty, CRGB(1, 2, 3));          //Garbage - the first message must be a full frame
+        std::string req = "GET /ws HTTP/1.1\r\nHost: ghost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        send(fd, req.data(), req.size(), 0);
+        for (uint32_t frame = 0; frame < 10 && in.find("\r\n\r\n") == std::string::npos; frame++) {
+            ghostApi::loop();
+            read_waiting(fd, in);
+        }
+        size_t end = in.find("\r\n\r\n");
+        if (end == std::string::npos) {return false;}
+        bool accepted = status_code(in) == 101 && in.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != std::string::npos;
+        in.erase(0, end + 4);
+        return accepted;
+    }
+
+    /* Decode every complete message waiting - returns the qty of messages, or -1 if one was corrupt */
+    int receive() {
+        closed |= !read_waiting(fd, in);
+        int qty = 0;
+        while (in.size() >= 2) {
+            const uint8_t *msg = (const uint8_t *) in.data();
+            size_t len = msg[1] & 0x7F, pos = 2;
+            if (len == 126) {
+                if (in.size() < 4) {break;}
+                len = (msg[2] << 8) | msg[3];
+                pos = 4;
+            }
+            if (in.size() < pos + len) {break;}
+            if (msg[0] != 0x82 || !decode(&msg[pos], len)) {return -1;}
+            byte_qty += pos + len;
+            message_qty++;
+            qty++;
+            in.erase(0, pos + len);
+        }
+        return qty;
+    }
+
+    /* framePlayer's frame format (see framePlayer.h) */
+    bool decode(const uint8_t *data, size_t len) {
+        size_t pos = 0, idx = 0;
+        while (pos < len) {
+            uint8_t cmd = data[pos++];
+            if (cmd == FRAME_CMD_END) {return pos == len && idx == lights.size();}
+            size_t qty = (cmd & FRAME_CMD_QTY_MASK) + 1;
+            if (cmd == FRAME_CMD_LONG_SKIP) {
+                qty = data[pos] | (data[pos + 1] << 8);
+                pos += 2;
+                idx += qty;
+            } else if (cmd < FRAME_CMD_RUN) {
+                idx += qty;
+            } else if (cmd < FRAME_CMD_COPY) {
+                for (size_t end = idx + qty; idx < end && idx < lights.size(); idx++) {lights[idx] = CRGB(data[pos], data[pos + 1], data[pos + 2]);}
+                pos += 3;
+            } else {
+                for (size_t end = idx + qty; idx < end && idx < lights.size(); idx++, pos += 3) {lights[idx] = CRGB(data[pos], data[pos + 1], data[pos + 2]);}
+            }
+            if (idx > lights.size()) {return false;}
+        }
+        return false;
+    }
+
+    bool matches(const std::vector<CRGB> &leds) const {
+        return lights == leds;
+    }
+};
+
+void test_api(std::vector<CRGB> &leds) {
+    std::string r = request("GET /api/state HTTP/1.1\r\nHost: ghost\r\n\r\n", leds);
+    CHECK(status_code(r) == 200 && body(r) == R"({"pattern":0,"brightness":128,"led_qty":)" + std::to_string(leds.size()) + R"(,"preview_ms":50,"clients":0})",
+          "state: %s", r.c_str());
+    CHECK(r.find("Content-Length: " + std::to_string(body(r).size()) + "\r\n") != std::string::npos, "state: content length");
+
+    r = request("GET /api/patterns HTTP/1.1\r\n\r\n", leds);
+    CHECK(body(r) == R"({"pattern":0,"patterns":[{"idx":0,"available":true},{"idx":1,"available":true},{"idx":2,"available":false}]})", "patterns: %s", r.c_str());
+
+    r = request("POST /api/pattern?idx=1 HTTP/1.1\r\nContent-Length: 0\r\n\r\n", leds);
+    CHECK(status_code(r) == 200 && control.idx == 1 && body(r).find(R"("pattern":1)") != std::string::npos, "select: %s", r.c_str());
+    r = request("POST /api/pattern?idx=2 HTTP/1.1\r\n\r\n", leds);
+    CHECK(status_code(r) == 409 && control.idx == 1, "select unavailable: %s", r.c_str());
+    r = request("POST /api/pattern?idx=7 HTTP/1.1\r\n\r\n", leds);
+    CHECK(status_code(r) == 400, "select out of range: %s", r.c_str());
+    r = request("POST /api/pattern?other=1&idx=x HTTP/1.1\r\n\r\n", leds);
+    CHECK(status_code(r) == 400, "select bad value: %s", r.c_str());
+
+    r = request("POST /api/brightness?value=40 HTTP/1.1\r\n\r\n", leds);
+    CHECK(status_code(r) == 200 && control.level == 40, "brightness: %s", r.c_str());
+    r = request("POST /api/brightness?value=256 HTTP/1.1\r\n\r\n", leds);
+    CHECK(status_code(r) == 400 && control.level == 40, "brightness out of range: %s", r.c_str());
+
+    CHECK(status_code(request("GET /nothing HTTP/1.1\r\n\r\n", leds)) == 404, "unknown path");
+    CHECK(status_code(request("DELETE /api/state HTTP/1.1\r\n\r\n", leds)) == 405, "wrong method");
+    CHECK(status_code(request("GET /ws HTTP/1.1\r\n\r\n", leds)) == 400, "websocket without upgrade");
+    CHECK(status_code(request("GET /api/state HTTP/1.1\r\nX-Long: " + std::string(GHOST_API_BUF_LEN, 'x') + "\r\n\r\n", leds)) == 431, "request too long");
+
+    /* A client that never finishes its request is dropped after the timeout */
+    int idle = connect_client();
+    send(idle, "GET /api/st", 11, 0);
+    std::string in;
+    bool open = true;
+    for (uint32_t frame = 0; frame < GHOST_API_TIMEOUT_MS / 16 + 10 && open; frame++) {
+        step(leds, frame);
+        open = read_waiting(idle, in);
+    }
+    CHECK(!open && in.empty(), "idle client wasn't dropped");
+    close(idle);
+
+    printf("api: %u requests answered\n", ghostApi::stats().request_qty);
+}
+
+void test_preview(std::vector<CRGB> &leds) {
+    ghostApiStats before = ghostApi::stats();
+    previewClient first, second;
+    uint32_t mismatch = 0;
+
+    /* The handshakes are served without drawing --> a message sent meanwhile shows the current lights */
+    auto check_handshake = [&](previewClient &client, int rcvbuf) {
+        CHECK(client.open(leds.size(), rcvbuf), "websocket handshake");
+        int first_qty = first.receive();
+        if (first_qty < 0 || (first_qty > 0 && !first.matches(leds))) {mismatch++;}
+    };
+    check_handshake(first, 0);
+
+    /* Every message must match the lights it was sent from - the second client joins halfway */
+    int64_t max_loop_us = 0;
+    for (uint32_t frame = 0; frame < opt.frames; frame++) {
+        if (frame == opt.frames / 2) {check_handshake(second, 4096);}
+        max_loop_us = std::max(max_loop_us, step(leds, frame));
+
+        /* A message is sent right after the frame it shows was drawn --> compare as soon as it arrives */
+        int first_qty = first.receive(), second_qty = second.fd >= 0 ? second.receive() : 0;
+        if (first_qty < 0 || second_qty < 0) {mismatch++; continue;}
+        if (first_qty > 0 && !first.matches(leds)) {mismatch++;}
+        if (second_qty > 0 && !second.matches(leds)) {mismatch++;}
+    }
+    ghostApiStats after = ghostApi::stats();
+    uint32_t frames = after.frame_qty - before.frame_qty;
+    uint32_t bytes = after.byte_qty - before.byte_qty;
+    double expected = opt.frames / ((GHOST_API_PREVIEW_MS + 15) / 16);    //A frame every 4th step of 16 ms
+    printf("preview: %u frames (%.0f expected at %u ms), %.0f bytes per frame (%.1f%% of the raw %u), loop() max %lld us\n",
+           frames, expected, GHOST_API_PREVIEW_MS, (double) bytes / std::max(frames, 1U), 100.0 * bytes / std::max(frames, 1U) / (leds.size() * 3),
+           (unsigned) leds.size() * 3, (long long) max_loop_us);
+    CHECK(!mismatch, "%u preview frames didn't match the lights", mismatch);
+    CHECK(first.message_qty == frames && second.message_qty > 0, "messages received: %u / %u of %u", first.message_qty, second.message_qty, frames);
+    CHECK(frames >= expected * 0.9, "preview rate");
+    CHECK(max_loop_us < MAX_LOOP_US, "loop() took %lld us", (long long) max_loop_us);
+
+    /* Stalled client (small receive window): stop reading it while every light changes every frame - once its socket is full,
+       the preview is skipped for everyone (loop() doesn't wait), until it is dropped */
+    before = ghostApi::stats();
+    max_loop_us = 0;
+    uint32_t stall_frames = (GHOST_API_TIMEOUT_MS + 2000) / 16;
+    uint32_t dropped_at = 0;
+    for (uint32_t frame = 0; frame < stall_frames; frame++) {
+        max_loop_us = std::max(max_loop_us, step(leds, opt.frames + frame, true));
+        int qty = first.receive();
+        if (qty < 0 || (qty > 0 && !first.matches(leds))) {mismatch++;}
+        if (!dropped_at && ghostApi::preview_qty() == 1) {dropped_at = frame;}
+    }
+    after = ghostApi::stats();
+    printf("stalled client: dropped after %u ms, %u frames skipped meanwhile, loop() max %lld us\n",
+           dropped_at * 16, after.skipped_qty - before.skipped_qty, (long long) max_loop_us);
+    CHECK(dropped_at && dropped_at * 16 <= GHOST_API_TIMEOUT_MS + 1000, "stalled client wasn't dropped");
+    CHECK(after.skipped_qty > before.skipped_qty, "no frame was skipped for the stalled client");
+    CHECK(!mismatch, "preview frames didn't match the lights after the stalled client");
+    CHECK(max_loop_us < MAX_LOOP_US, "loop() took %lld us with a stalled client", (long long) max_loop_us);
+    close(second.fd);
+
+    /* Close handshake */
+    const uint8_t close_msg[6] = {0x88, 0x80, 1, 2, 3, 4};     //Masked, empty close
+    send(first.fd, close_msg, sizeof(close_msg), 0);
+    first.in.clear();
+    for (uint32_t frame = 0; frame < 20 && !first.closed; frame++) {
+        step(leds, frame);
+        first.closed = !read_waiting(first.fd, first.in);
+    }
+    CHECK(first.closed && first.in.size() >= 2 && (uint8_t) first.in[first.in.size() - 2] == 0x88, "close handshake");
+    CHECK(ghostApi::preview_qty() == 0, "preview still open after the close");
+    close(first.fd);
+}
+
+/* Serve the fake ghost in real time */
+void serve(std::vector<CRGB> &leds) {
+    printf("serving on port %u - e.g. curl http://localhost:%u/api/state\n", opt.port, opt.port);
+    for (uint32_t frame = 0; ; frame++) {
+        step(leds, frame);
+        usleep(16000);
+    }
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [--leds N] [--frames N] [--port P] [--serve]\n", exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--leds") && has_value) {opt.leds = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--frames") && has_value) {opt.frames = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--port") && has_value) {opt.port = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--serve")) {opt.serve = true;}
+        else {return usage(argv[0]);}
+    }
+    opt.leds = constrain(opt.leds, 1, GHOST_API_MAX_LEDS);
+    host::serial_out = NULL;
+
+    std::vector<CRGB> leds(opt.leds);
+    lightTools tools;
+    ghostApi api(leds.data(), opt.leds, &tools);
+    if (!ghostApi::begin(&control, opt.port)) {
+        printf("unable to listen on port %u\n", opt.port);
+        return 1;
+    }
+
+    if (opt.serve) {serve(leds);}
+
+    printf("%u lights, %u frames at 16 ms\n", opt.leds, opt.frames);
+    test_api(leds);
+    test_preview(leds);
+    ghostApi::end();
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/*
+    audio_beats.cpp - host tool
+    Runs audio through the same analysis the ghost uses (lib/audioReactive - fixed-point FFT,
+    band levels, beat detection), and lists the beats it detects.
+
+    Usage (built by 'build_host.sh'):
+        audio_beats <file.wav> [--expect-bpm BPM] [--bands]
+        audio_beats --synth BPM [--seconds S]
+
+    With a WAV file, every detected beat is listed with the tempo between beats, and the median
+    tempo is reported (--expect-bpm fails the run unless it is within 5% of BPM).  --bands also
+    prints the band levels of every analysis frame.
+
+    --synth runs a synthesized drum track (a kick on every beat at BPM, off-beat hi-hats, a
+    steady chord and noise) and checks the detection against the known kick times: after the
+    first 2 seconds (the automatic gain settling), every kick must be detected within 2 analysis
+    frames, with no extra beats.  The analysis must also count the drums as active audio, and
+    stop counting once the input turns into full scale noise (an unconnected, floating pin).
+    The exit code is 1 if the check fails.
+*/
+
+#include "host_libs.h"
+#include "host_audio.h"
+#include <algorithm>
+#include <vector>
+
+#define SYNTH_SETTLE_MS 2000                                                //Beats before this are not checked (automatic gain settling)
+#define FRAME_MS ((AUDIO_FFT_LEN * 1000UL) / AUDIO_SAMPLE_RATE)             //Audio per analysis frame
+#define BEAT_TOLERANCE_MS (2 * FRAME_MS + 1)                                //Latest a beat may be detected after the kick
+
+/* Analyze the samples a frame at a time, collecting the audio time of every beat */
+std::vector<uint32_t> detect_beats(const std::vector<int16_t> &samples, bool print_bands) {
+    std::vector<uint32_t> beats;
+    uint16_t beat_qty = 0;
+
+    for (size_t pos = 0; pos + AUDIO_FFT_LEN <= samples.size(); pos += AUDIO_FFT_LEN) {
+        audioReactive::process(&samples[pos], AUDIO_FFT_LEN);
+        host::clock_us += FRAME_MS * 1000;
+
+        audioSnapshot audio;
+        if (!audioReactive::snapshot(&audio)) {continue;}
+        if (audio.beat_qty != beat_qty) {
+            beat_qty = audio.beat_qty;
+            beats.push_back(audio.beat_ms);
+        }
+
+        if (print_bands) {
+            printf("%8.3f %3u |", audio.audio_ms / 1000.0, audio.level);
+            for (uint8_t band = 0; band < AUDIO_BAND_QTY; band++) {printf(" %3u", audio.bands[band]);}
+            printf("%s\n", (audio.beat_ms == audio.audio_ms && beat_qty) ? "  BEAT" : "");
+        }
+    }
+
+    return beats;
+}
+
+/* Median tempo between consecutive beats */
+double median_bpm(const std::vector<uint32_t> &beats) {
+    std::vector<uint32_t> gaps;
+    for (size_t i = 1; i < beats.size(); i++) {gaps.push_back(beats[i] - beats[i - 1]);}
+    if (gaps.empty()) {return 0;}
+
+    std::sort(gaps.begin(), gaps.end());
+    return 60000.0 / gaps[gaps.size() / 2];
+}
+
+int run_wav(const char *path, double expect_bpm, bool print_bands) {
+    std::vector<int16_t> samples;
+    if (!hostLoadWav(path, &samples)) {
+        fprintf(stderr, "%s: not a PCM WAV file\n", path);
+        return 1;
+    }
+
+    std::vector<uint32_t> beats = detect_beats(samples, print_bands);
+    for (size_t i = 0; i < beats.size(); i++) {
+        printf("beat %4zu at %8.3f s", i + 1, beats[i] / 1000.0);
+        if (i) {printf("  (%5.1f BPM)", 60000.0 / (beats[i] - beats[i - 1]));}
+        printf("\n");
+    }
+
+    double bpm = median_bpm(beats);
+    printf("%s: %.1f s of audio, %zu beats, median tempo %.1f BPM\n", path, samples.size() / (double) AUDIO_SAMPLE_RATE, beats.size(), bpm);
+    if (expect_bpm > 0 && fabs(bpm - expect_bpm) > expect_bpm * 0.05) {
+        printf("FAIL: expected %.1f BPM\n", expect_bpm);
+        return 1;
+    }
+
+    return 0;
+}
+
+int run_synth(double bpm, double seconds) {
+    std::vector<int16_t> samples;
+    std::vector<uint32_t> kicks;
+    hostSynthBeats(bpm, seconds, &samples, &kicks);
+    std::vector<uint32_t> beats = detect_beats(samples, false);
+
+    /* Match every checked kick to the first beat detected after it */
+    uint32_t checked = 0, hits = 0, latency_sum = 0, latency_max = 0;
+    size_t beat = 0;
+    for (uint32_t kick : kicks) {
+        if (kick < SYNTH_SETTLE_MS || kick + BEAT_TOLERANCE_MS > seconds * 1000) {continue;}
+        checked++;
+
+        while (beat < beats.size() && beats[beat] < kick) {beat++;}
+        if (beat < beats.size() && beats[beat] - kick <= BEAT_TOLERANCE_MS) {
+            uint32_t latency = beats[beat] - kick;
+            hits++;
+            latency_sum += latency;
+            latency_max = std::max(latency_max, latency);
+        }
+    }
+
+    uint32_t extra = 0;
+    for (uint32_t detected : beats) {
+        if (detected >= SYNTH_SETTLE_MS + BEAT_TOLERANCE_MS && detected + BEAT_TOLERANCE_MS <= seconds * 1000) {
+            bool matched = false;
+            for (uint32_t kick : kicks) {matched |= detected >= kick && detected - kick <= BEAT_TOLERANCE_MS;}
+            if (!matched) {extra++;}
+        }
+    }
+
+    printf("synth %.0f BPM, %.0f s: %u of %u kicks detected (latency avg %.1f ms, max %u ms), %u extra beats, median tempo %.1f BPM\n",
+           bpm, seconds, hits, checked, hits ? (double) latency_sum / hits : 0.0, latency_max, extra, median_bpm(beats));
+
+    /* The drums count as audio - then an unconnected input (a floating pin, full scale noise) must stop counting */
+    bool drums_active = audioReactive::active();
+    std::vector<int16_t> floating(AUDIO_SAMPLE_RATE * (AUDIO_SIGNAL_MS * 2 / 1000 + 1));
+    uint32_t seed = 1;
+    for (int16_t &sample : floating) {
+        seed = seed * 1103515245 + 12345;
+        sample = 2048 + (int16_t) ((seed >> 16) % 8001) - 4000;
+    }
+    detect_beats(floating, false);
+    bool floating_active = audioReactive::active();
+    printf("active on the drums: %s, on a floating input: %s\n", drums_active ? "yes" : "no", floating_active ? "yes" : "no");
+
+    bool pass = checked && hits == checked && !extra && drums_active && !floating_active;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s <file.wav> [--expect-bpm BPM] [--bands]\n"
+                    "       %s --synth BPM [--seconds S]\n", exe, exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    const char *wav = NULL;
+    double synth_bpm = 0, seconds = 30, expect_bpm = 0;
+    bool print_bands = false;
+
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--synth") && has_value) {synth_bpm = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--seconds") && has_value) {seconds = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--expect-bpm") && has_value) {expect_bpm = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--bands")) {print_bands = true;}
+        else if (argv[arg][0] != '-' && !wav) {wav = argv[arg];}
+        else {return usage(argv[0]);}
+    }
+
+    if (synth_bpm > 0) {return run_synth(synth_bpm, seconds);}
+    if (wav) {return run_wav(wav, expect_bpm, print_bands);}
+    return usage(argv[0]);
+}
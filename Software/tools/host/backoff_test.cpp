@@ -0,0 +1,261 @@
+/*
+    backoff_test.cpp - host tool
+    Runs Edgent's connect loop (include/ConfigMode.h - an attempt when connectBackoff says it's
+    due, the radio powered down after a failure) against a fake WiFi driver, on a virtual clock,
+    and checks the retry schedule and the radio-on time while the router is off.
+
+    Usage (built by 'build_host.sh'):
+        backoff_test [--outage-min M] [--ghosts N]
+
+    Scenarios:
+        outage      the router is off for M minutes (default 120), then back on - every wait must be
+                    within the jittered schedule, the radio must be off while waiting, the radio
+                    duty cycle must stay under 5% (the driver reports the router missing after a
+                    3 s scan), and the ghost must reconnect within one capped
+                    wait of the router coming back
+        dead        the router never comes back - the ghost must give up after BACKOFF_MAX_ATTEMPTS
+        provision   a single attempt (start_over(1), as when the app provisions the ghost) - the
+                    first failure must give up right away
+        lockstep    N ghosts (default 8) lose the network at the same moment - their retries must
+                    drift apart (spread over at least 1/8 of the wait, no two within 10 ms)
+
+    The lights are drawn every 16ms throughout (also while an attempt blocks, as Edgent's
+    app_loop() does) - the longest gap between two frames is checked too.  The exit code is 1 if
+    any check fails.
+*/
+
+#include "host_libs.h"
+#include <algorithm>
+#include <vector>
+
+#define FRAME_MS 16                     //Frame period of the lights
+#define POLL_MS 10                      //Edgent's delay() while an attempt is waiting for the connection
+#define JOIN_MS 700                     //Time to connect when the router is up
+#define NO_AP_MS 3000                   //Time until the driver reports the router missing (WL_NO_SSID_AVAIL, after a scan of every channel)
+#define DUTY_LIMIT_PCT 5.0              //Highest radio duty cycle allowed during an outage
+
+int result = 0;
+
+void fail(const char *scenario, const char *msg) {
+    printf("%-10s FAIL: %s\n", scenario, msg);
+    result = 1;
+}
+
+/* Fake WiFi driver - a router that is up / down, and a radio that is on while an attempt runs */
+class fakeWifi : public backoffRadio
+{
+    public:
+        bool router_up = false;
+        bool radio_on = false;
+        uint64_t radio_on_us = 0;               //Total time the radio was on
+        uint64_t radio_on_since = 0;
+        uint32_t power_down_qty = 0;
+
+        /* Connect attempt (WiFi.begin + waiting for WL_CONNECTED) - the radio powers up, the lights keep running (app_loop) */
+        bool connect(void (*app_loop)()) {
+            if (!radio_on) {
+                radio_on = true;
+                radio_on_since = host::clock_us;
+            }
+            uint32_t wait_ms = router_up ? JOIN_MS : NO_AP_MS;
+            for (uint32_t waited = 0; waited < wait_ms; waited += POLL_MS) {
+                host::clock_us += POLL_MS * 1000;
+                app_loop();
+            }
+            return router_up;
+        }
+
+        void power_down() override {
+            if (radio_on) {radio_on_us += host::clock_us - radio_on_since;}
+            radio_on = false;
+            power_down_qty++;
+        }
+
+        uint64_t on_us() {
+            return radio_on_us + (radio_on ? host::clock_us - radio_on_since : 0);
+        }
+};
+
+fakeWifi wifi;
+
+/* The lights - a frame whenever one is due, tracking the longest gap */
+uint64_t last_frame_us = 0;
+uint64_t longest_gap_us = 0;
+void app_loop() {
+    if (host::clock_us - last_frame_us < FRAME_MS * 1000) {return;}
+    longest_gap_us = max(longest_gap_us, host::clock_us - last_frame_us);
+    last_frame_us = host::clock_us;
+}
+
+/* One pass of Edgent's run() in MODE_CONNECTING_NET (enterConnectNet + connectFailed) - returns 1 once connected, -1 once it gave up, 0 otherwise */
+struct attemptLog {uint64_t failed_us; uint32_t wait_ms;};
+int8_t edgent_run(std::vector<attemptLog> *log) {
+    app_loop();
+    if (!connectBackoff::due()) {return 0;}
+
+    connectBackoff::attempt();
+    if (wifi.connect(app_loop)) {
+        connectBackoff::connected();
+        return 1;
+    }
+
+    uint32_t wait_ms = connectBackoff::failed();
+    if (log) {log->push_back({host::clock_us, wait_ms});}
+    return connectBackoff::exhausted() ? -1 : 0;
+}
+
+/* Start over with a ghost that just lost the network */
+void reset_ghost(uint32_t seed) {
+    wifi = fakeWifi();
+    connectBackoff::begin(&wifi, seed);
+    last_frame_us = host::clock_us;
+    longest_gap_us = 0;
+}
+
+/* Longest wait allowed after the n-th failure in a row */
+uint32_t ceiling_ms(uint16_t failure) {
+    uint64_t ceiling = BACKOFF_BASE_MS;
+    for (uint16_t step = 1; step < failure && ceiling < BACKOFF_MAX_MS; step++) {ceiling *= 2;}
+    return min(ceiling, (uint64_t) BACKOFF_MAX_MS);
+}
+
+/* Check the waits of a run against the schedule, and that the radio was off for all of them */
+void check_schedule(const char *scenario, const std::vector<attemptLog> &log) {
+    for (size_t idx = 0; idx < log.size(); idx++) {
+        uint32_t ceiling = ceiling_ms(idx + 1);
+        if (log[idx].wait_ms < ceiling / 2 || log[idx].wait_ms > ceiling) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "wait %u after failure %u is outside %u..%u ms", log[idx].wait_ms, (unsigned) idx + 1, ceiling / 2, ceiling);
+            fail(scenario, msg);
+            return;
+        }
+    }
+    if (wifi.power_down_qty != log.size()) {fail(scenario, "the radio wasn't powered down after every failure");}
+}
+
+/* The router is off for a while, then back on */
+void scenario_outage(uint32_t outage_min) {
+    reset_ghost(0x6A09E667);
+    uint64_t start_us = host::clock_us;
+    uint64_t router_back_us = start_us + (uint64_t) outage_min * 60000000ULL;
+    std::vector<attemptLog> log;
+
+    int8_t state = 0;
+    uint64_t radio_on_at_return_us = 0;
+    while (state == 0) {
+        if (!wifi.router_up && host::clock_us >= router_back_us) {
+            wifi.router_up = true;
+            radio_on_at_return_us = wifi.on_us();
+        }
+        if (wifi.radio_on && !wifi.router_up) {fail("outage", "the radio is on between attempts");}
+        state = edgent_run(&log);
+        host::clock_us += 1000;
+    }
+    if (state < 0) {fail("outage", "gave up before the router came back"); return;}
+
+    double duty_pct = 100.0 * radio_on_at_return_us / (router_back_us - start_us);
+    double reconnect_s = (host::clock_us - router_back_us) / 1e6;
+    printf("%-10s %u min outage: %u attempts, radio on %.0f s (%.2f%% duty, back to back would be 100%%), reconnected %.1f s after the router came back\n",
+           "outage", outage_min, (unsigned) log.size() + 1, radio_on_at_return_us / 1e6, duty_pct, reconnect_s);
+    printf("%-10s waits (s):", "");
+    for (size_t idx = 0; idx < log.size() && idx < 12; idx++) {printf(" %.1f", log[idx].wait_ms / 1000.0);}
+    printf("%s\n", (log.size() > 12) ? " ..." : "");
+
+    check_schedule("outage", log);
+    if (connectBackoff::radio_on_ms() != radio_on_at_return_us / 1000) {fail("outage", "radio-on accounting doesn't match the driver");}
+    if (duty_pct > DUTY_LIMIT_PCT) {fail("outage", "radio duty cycle over the limit");}
+    if (reconnect_s * 1000 > BACKOFF_MAX_MS + NO_AP_MS + JOIN_MS) {fail("outage", "reconnect took longer than one capped wait");}
+    if (longest_gap_us > (FRAME_MS + POLL_MS) * 1000) {fail("outage", "the lights stalled");}
+    if (connectBackoff::failure_qty() || !connectBackoff::due()) {fail("outage", "the schedule wasn't reset by the connection");}
+}
+
+/* The router never comes back */
+void scenario_dead() {
+    reset_ghost(0xBB67AE85);
+    uint64_t start_us = host::clock_us;
+    std::vector<attemptLog> log;
+
+    int8_t state = 0;
+    while (state == 0) {
+        state = edgent_run(&log);
+        host::clock_us += 1000;
+    }
+
+    printf("%-10s gave up after %u attempts, %.1f hours, radio on %.1f%% of the time\n", "dead",
+           (unsigned) log.size(), (host::clock_us - start_us) / 3.6e9, 100.0 * wifi.on_us() / (host::clock_us - start_us));
+    check_schedule("dead", log);
+    if (state > 0 || log.size() != BACKOFF_MAX_ATTEMPTS) {fail("dead", "didn't give up after BACKOFF_MAX_ATTEMPTS");}
+}
+
+/* Provisioning from the app - one attempt, then report the error */
+void scenario_provision() {
+    reset_ghost(0x3C6EF372);
+    connectBackoff::start_over(1);
+    int8_t state = edgent_run(NULL);
+
+    printf("%-10s single attempt %s\n", "provision", (state < 0) ? "gave up after the first failure" : "kept retrying");
+    if (state >= 0) {fail("provision", "didn't give up after a single attempt");}
+
+    /* A connection restores the full schedule */
+    reset_ghost(0x3C6EF372);
+    connectBackoff::start_over(1);
+    wifi.router_up = true;
+    edgent_run(NULL);
+    wifi.router_up = false;
+    edgent_run(NULL);
+    if (connectBackoff::exhausted()) {fail("provision", "the attempt limit wasn't restored by the connection");}
+}
+
+/* Ghosts losing the network at the same moment */
+void scenario_lockstep(uint8_t ghost_qty) {
+    const uint8_t attempt_qty = 8;
+    std::vector<std::vector<uint64_t>> retries(ghost_qty);
+    uint64_t start_us = host::clock_us;
+
+    for (uint8_t ghost = 0; ghost < ghost_qty; ghost++) {
+        host::clock_us = start_us;
+        reset_ghost(0x9E3779B9u * (ghost + 1));     //The firmware seeds with the MAC address
+        std::vector<attemptLog> log;
+        while (log.size() < attempt_qty) {
+            edgent_run(&log);
+            host::clock_us += 1000;
+        }
+        for (const attemptLog &entry : log) {retries[ghost].push_back(entry.failed_us + (uint64_t) entry.wait_ms * 1000);}
+    }
+
+    /* How far the ghosts spread out by the last retry, and the closest two got to each other */
+    std::vector<uint64_t> last;
+    for (uint8_t ghost = 0; ghost < ghost_qty; ghost++) {last.push_back(retries[ghost][attempt_qty - 1]);}
+    std::sort(last.begin(), last.end());
+    uint64_t closest_us = UINT64_MAX;
+    for (uint8_t ghost = 1; ghost < ghost_qty; ghost++) {closest_us = min(closest_us, last[ghost] - last[ghost - 1]);}
+    double spread_s = (last.back() - last.front()) / 1e6;
+
+    printf("%-10s %u ghosts, retry %u: spread over %.1f s, closest two %.2f s apart\n", "lockstep", ghost_qty, attempt_qty, spread_s, closest_us / 1e6);
+    if (spread_s * 1000 < ceiling_ms(attempt_qty) / 8) {fail("lockstep", "ghosts retry nearly in lockstep");}
+    if (closest_us < 10000) {fail("lockstep", "two ghosts retry at the same time");}
+}
+
+int main(int argc, char **argv) {
+    uint32_t outage_min = 120;
+    uint8_t ghost_qty = 8;
+    for (int arg = 1; arg < argc; arg++) {
+        if (!strcmp(argv[arg], "--outage-min") && arg + 1 < argc) {
+            outage_min = atoi(argv[++arg]);
+        } else if (!strcmp(argv[arg], "--ghosts") && arg + 1 < argc) {
+            int ghosts = atoi(argv[++arg]);
+            ghost_qty = constrain(ghosts, 2, 64);
+        } else {
+            fprintf(stderr, "usage: %s [--outage-min M] [--ghosts N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    scenario_outage(outage_min);
+    scenario_dead();
+    scenario_provision();
+    scenario_lockstep(ghost_qty);
+
+    printf("%s\n", result ? "backoff checks FAILED" : "all backoff checks passed");
+    return result;
+}
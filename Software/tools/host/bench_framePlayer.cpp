@@ -0,0 +1,83 @@
+/*
+    bench_framePlayer.cpp - host benchmark
+    Measures the per-frame cost of streaming + decoding an animation (lib/framePlayer)
+    from a file, on a 300 light canvas (one decoded frame per call).  Asset images
+    (lib/assetStore) are memory mapped, and every ".gfa" asset inside is played
+    straight from the mapping.
+
+    Usage (built by 'build_host.sh'):
+        bench_framePlayer <animation.gfa | assets.gas> [...]
+*/
+
+#include "host_libs.h"
+#include "host_frame_source.h"
+#include <chrono>
+
+#define BENCH_LED_QTY 300           //Canvas size to benchmark with
+#define BENCH_FRAMES 20000          //Frames to render per measurement
+
+CRGB canvas[BENCH_LED_QTY];
+
+/* Play an animation from the source, and print its per-frame cost - returns false if it isn't a valid animation */
+template <typename source_t> bool bench(const char *name, source_t *source) {
+    if (!framePlayer::open(source)) {
+        fprintf(stderr, "%s: not a valid animation\n", name);
+        return false;
+    }
+
+    /* Step the virtual clock by the animation's own frame time, so every call decodes a frame */
+    uint32_t decoded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < BENCH_FRAMES && framePlayer::is_open(); frame++) {
+        host::clock_us += (uint64_t) framePlayer::frame_ms() * 1000;
+        framePlayer::play();
+        decoded++;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (!framePlayer::is_open()) {
+        fprintf(stderr, "%s: animation data is corrupt\n", name);
+        return false;
+    }
+
+    printf("%-28s %8u %8u %12.0f %14.0f\n", name, framePlayer::frame_qty(), framePlayer::frame_ms(),
+           std::chrono::duration<double, std::nano>(elapsed).count() / decoded, (double) source->bytes_read() / decoded);
+    framePlayer::close();
+    return true;
+}
+
+int main(int argc, char **argv) {
+    lightTools tools;
+    framePlayer player(canvas, BENCH_LED_QTY, &tools);
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <animation.gfa | assets.gas> [...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-28s %8s %8s %12s %14s\n", "animation", "frames", "ms/fr", "ns/frame", "bytes/frame");
+    for (int arg = 1; arg < argc; arg++) {
+        /* Asset image --> play every animation inside, straight from the mapped file */
+        if (assetStore::begin_file(argv[arg])) {
+            for (uint16_t idx = 0; idx < assetStore::asset_qty(); idx++) {
+                if (!strstr(assetStore::entry(idx)->name, ".gfa")) {continue;}
+
+                assetView anim = assetStore::asset(idx);
+                hostMemoryFrameSource source(anim.data, anim.len);
+                if (!bench(assetStore::entry(idx)->name, &source)) {return 1;}
+            }
+            assetStore::end();
+            continue;
+        }
+
+        const char *base = strrchr(argv[arg], '/');
+        hostFileFrameSource source;
+        if (!source.open(argv[arg])) {
+            fprintf(stderr, "%s: can't open file\n", argv[arg]);
+            return 1;
+        }
+        if (!bench(base ? base + 1 : argv[arg], &source)) {return 1;}
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+    bench_ledSpan.cpp - host benchmark
+    Compares drawing through a ledSpan (lib/lightTools) against drawing through a plain
+    'CRGB *', using the same access patterns as the light libraries (sequential fills,
+    mirrored writes from both ends, and read-modify-write fades), on a 300 light canvas.
+
+    'build_host.sh' builds this twice:
+        bench_ledSpan           release build - the span should match the raw pointer (ratio ~1.00x)
+        bench_ledSpan_debug     with LIGHT_DEBUG_BOUNDS - shows the cost of the bounds checks
+
+    Usage:
+        bench_ledSpan
+*/
+
+#include "host_libs.h"
+#include <chrono>
+
+#define BENCH_LED_QTY 300           //Canvas size to benchmark with
+#define BENCH_FRAMES 200000         //Frames to render per measurement
+#define BENCH_ROUNDS 5              //Best of N measurements, to filter out scheduling noise
+
+CRGB canvas[BENCH_LED_QTY];
+lightTools tools;
+
+/* Sequential fill with a branch per light (like nmayelights::pl_state1) */
+template <typename leds_t> void kernel_fill(leds_t leds, uint16_t led_qty, uint32_t frame) {
+    CRGB color = CRGB(frame & 0xFF, 0, 255 - (frame & 0xFF));
+    for (int i = 0; i < led_qty; i++) {
+        leds[i] = ((i / 25) & 1) ? CRGB(0, 0, 0) : color;
+    }
+}
+
+/* Writes from both ends towards the middle (like klassyLights::travel_light_to_mid) */
+template <typename leds_t> void kernel_mirror(leds_t leds, uint16_t led_qty, uint32_t frame) {
+    CRGB color = CRGB(0, frame & 0xFF, 0);
+    for (uint16_t trail = 0; trail < led_qty / 2; trail++) {
+        leds[trail] = color;
+        leds[(led_qty - 1) - trail] = color;
+    }
+}
+
+/* Read-modify-write fade of every light (like lightScript's fade instruction) */
+template <typename leds_t> void kernel_fade(leds_t leds, uint16_t led_qty, uint32_t frame) {
+    CRGB color = CRGB(0, 0, frame & 0xFF);
+    for (uint16_t i = 0; i < led_qty; i++) {
+        CRGB &led = leds[i];
+        led = tools.fadeToColor(led, color, 32);
+    }
+}
+
+/* Render BENCH_FRAMES frames with a kernel, returning the best average wall-clock ns per frame */
+template <typename leds_t> double bench_kernel(void (*kernel)(leds_t, uint16_t, uint32_t), leds_t leds) {
+    double best_ns = 0;
+    for (uint8_t round = 0; round < BENCH_ROUNDS; round++) {
+        fill_solid(canvas, BENCH_LED_QTY, CRGB::Black);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+            kernel(leds, BENCH_LED_QTY, frame);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / BENCH_FRAMES;
+        if (!round || ns < best_ns) {best_ns = ns;}
+    }
+
+    return best_ns;
+}
+
+/* Benchmark one kernel through both accessors, and check they drew the same frame */
+#define BENCH_KERNEL(kernel) do {                                                                   \
+        double raw_ns = bench_kernel<CRGB *>(kernel<CRGB *>, canvas);                             \
+        uint32_t raw_hash = tools.frame_hash(canvas, BENCH_LED_QTY);                                \
+        double span_ns = bench_kernel<ledSpan>(kernel<ledSpan>, ledSpan(canvas, BENCH_LED_QTY));   \
+        uint32_t span_hash = tools.frame_hash(canvas, BENCH_LED_QTY);                               \
+        printf("%-14s %12.1f %12.1f %7.2fx %s\n", #kernel, raw_ns, span_ns, span_ns / raw_ns,      \
+            (raw_hash == span_hash) ? "" : "FRAMES DIFFER");                                        \
+        if (raw_hash != span_hash) {result = 1;}                                                    \
+    } while (0)
+
+int main() {
+    int result = 0;
+
+    #ifdef LIGHT_DEBUG_BOUNDS
+        printf("ledSpan accesses are bounds checked (LIGHT_DEBUG_BOUNDS)\n");
+    #else
+        printf("ledSpan accesses are not bounds checked (release)\n");
+    #endif
+
+    printf("%-14s %12s %12s %8s\n", "kernel", "raw ns/fr", "span ns/fr", "ratio");
+    BENCH_KERNEL(kernel_fill);
+    BENCH_KERNEL(kernel_mirror);
+    BENCH_KERNEL(kernel_fade);
+
+    return result;
+}
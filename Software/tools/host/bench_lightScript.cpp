@@ -0,0 +1,88 @@
+/*
+    bench_lightScript.cpp - host benchmark
+    Compares the per-frame cost of light scripts (lib/lightScript) against the native
+    patterns they re-implement, on a 300 light canvas at 60 FPS of virtual time.
+
+    Usage (built by 'build_host.sh'):
+        bench_lightScript <script.lsb> [<script.lsb> ...]
+
+    Each script is paired with the native pattern of the same name (e.g. 'jacobs_ladder.lsb'
+    is compared with klassyLights::jacobs_ladder).
+*/
+
+#include "host_libs.h"
+#include <chrono>
+
+#define BENCH_LED_QTY 300           //Canvas size to benchmark with
+#define BENCH_FRAME_US 16667        //Virtual time per frame (60 FPS)
+#define BENCH_FRAMES 20000          //Frames to render per measurement
+
+/* Native patterns that have a light script equivalent */
+struct nativePattern {
+    const char *name;
+    void (*run)();
+};
+static const nativePattern native_patterns[] = {
+    {"jacobs_ladder", klassyLights::jacobs_ladder},
+    {"fading_candy_cane", klassyLights::fading_candy_cane},
+};
+
+CRGB canvas[BENCH_LED_QTY];
+
+/* Render BENCH_FRAMES frames of a pattern, returning the average wall-clock ns per frame */
+static double bench_pattern(void (*pattern)()) {
+    fill_solid(canvas, BENCH_LED_QTY, CRGB::Black);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+        pattern();
+        host::clock_us += BENCH_FRAME_US;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / BENCH_FRAMES;
+}
+
+/* Read a binary script container from disk */
+static bool read_script(const char *path, uint8_t *buf, uint16_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {return false;}
+    *len = fread(buf, 1, LSCRIPT_HEADER_LEN + LSCRIPT_MAX_CODE_LEN, f);
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    lightTools tools;
+    klassyLights klassy(canvas, BENCH_LED_QTY, &tools);
+    lightScript script(canvas, BENCH_LED_QTY, &tools);
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <script.lsb> [<script.lsb> ...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-20s %14s %14s %8s %14s\n", "pattern", "native ns/fr", "script ns/fr", "ratio", "script bytes");
+    for (int arg = 1; arg < argc; arg++) {
+        /* Find the native pattern matching the script's file name */
+        const char *base = strrchr(argv[arg], '/');
+        base = base ? base + 1 : argv[arg];
+        const nativePattern *native = NULL;
+        for (size_t i = 0; i < LIGHT_ARRAY_SIZE(native_patterns); i++) {
+            if (!strncmp(base, native_patterns[i].name, strlen(native_patterns[i].name))) {native = &native_patterns[i];}
+        }
+
+        uint8_t buf[LSCRIPT_HEADER_LEN + LSCRIPT_MAX_CODE_LEN];
+        uint16_t len = 0;
+        if (!native || !read_script(argv[arg], buf, &len) || !lightScript::load(buf, len)) {
+            fprintf(stderr, "%s: no matching native pattern, or not a valid script\n", argv[arg]);
+            return 1;
+        }
+
+        double native_ns = bench_pattern(native->run);
+        double script_ns = bench_pattern(lightScript::run);
+        printf("%-20s %14.0f %14.0f %7.2fx %14u\n", native->name, native_ns, script_ns, script_ns / native_ns, lightScript::code_len());
+    }
+
+    return 0;
+}
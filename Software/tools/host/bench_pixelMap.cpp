@@ -0,0 +1,122 @@
+/*
+    bench_pixelMap.cpp - host benchmark
+    Measures the per-frame cost of the 2D patterns of lib/pixelMap on 500 mapped lights (a
+    20 x 25 serpentine grid, and a wreath), against the same plasma worked out with per-frame
+    trig (sinf / sqrtf per light) - the cost the index tables avoid.
+
+    Usage (built by 'build_host.sh'):
+        bench_pixelMap
+*/
+
+#include "host_libs.h"
+#include <chrono>
+#include <vector>
+
+#define BENCH_LED_QTY 500           //Mapped lights to benchmark with
+#define BENCH_FRAMES 20000          //Frames to render per measurement
+#define BENCH_ROUNDS 5              //Best of N measurements, to filter out scheduling noise
+#define BENCH_FRAME_US 16000        //Virtual time per frame, so the animations move
+
+CRGB canvas[BENCH_LED_QTY];
+lightTools tools;
+pixelMap map(canvas, BENCH_LED_QTY, &tools);
+
+/* Build a layout file (same format / scaling as tools/pixelMap/make_layout.py) */
+std::vector<uint8_t> make_layout(const std::vector<std::pair<float, float>> &positions) {
+    float x_min = 1e9f, x_max = -1e9f, y_min = 1e9f, y_max = -1e9f;
+    for (auto &p : positions) {
+        x_min = min(x_min, p.first); x_max = max(x_max, p.first);
+        y_min = min(y_min, p.second); y_max = max(y_max, p.second);
+    }
+    float span = max(x_max - x_min, y_max - y_min);
+    float x_pad = (span - (x_max - x_min)) / 2, y_pad = (span - (y_max - y_min)) / 2;
+
+    std::vector<uint8_t> layout = {'G', 'L', 'M', PIXEL_MAP_VERSION, (uint8_t) positions.size(), (uint8_t) (positions.size() >> 8), 0, 0};
+    for (auto &p : positions) {
+        layout.push_back(lroundf((p.first - x_min + x_pad) * 255 / span));
+        layout.push_back(lroundf((p.second - y_min + y_pad) * 255 / span));
+    }
+    return layout;
+}
+
+/* 20 x 25 grid, every other row running backwards */
+std::vector<uint8_t> grid_layout() {
+    std::vector<std::pair<float, float>> positions;
+    for (int row = 0; row < 25; row++) {
+        for (int col = 0; col < 20; col++) {positions.push_back({(float) ((row & 1) ? 19 - col : col), (float) row});}
+    }
+    return make_layout(positions);
+}
+
+/* Ring, with the strand spiralling across it 4 times */
+std::vector<uint8_t> wreath_layout() {
+    std::vector<std::pair<float, float>> positions;
+    for (int i = 0; i < BENCH_LED_QTY; i++) {
+        float around = 2 * (float) M_PI * i / BENCH_LED_QTY;
+        float across = 0.75f + 0.25f * sinf(2 * (float) M_PI * 4 * i / BENCH_LED_QTY);
+        positions.push_back({across * cosf(around), -across * sinf(around)});
+    }
+    return make_layout(positions);
+}
+
+/* The plasma of pixelMap::plasma, working out every light's radius and every sine with float math each frame */
+void plasma_trig() {
+    const float to_rad = 2 * (float) M_PI / 256;
+    uint8_t t1 = beat8(11), t2 = beat8(7), t3 = beat8(5);
+    for (uint16_t led = 0; led < BENCH_LED_QTY; led++) {
+        float x = pixelMap::x(led), y = pixelMap::y(led);
+        float dx = x - 127.5f, dy = 127.5f - y;
+        float radius = min(sqrtf(dx * dx + dy * dy) * (255.0f / 180.3f), 255.0f);
+        float wave = 4 * 128 + 127 * (sinf((x + t1) * to_rad) + sinf((y - t2) * to_rad) + sinf((2 * radius - t3) * to_rad) + sinf(((x + y) / 2 + t2 + t3) * to_rad));
+        canvas[led] = tools.palette((uint16_t) wave >> 2);
+    }
+}
+
+/* Render BENCH_FRAMES frames with a pattern, returning the best average wall-clock ns per frame */
+double bench_pattern(void (*pattern)()) {
+    double best_ns = 0;
+    for (uint8_t round = 0; round < BENCH_ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+            host::clock_us += BENCH_FRAME_US;
+            pattern();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / BENCH_FRAMES;
+        if (!round || ns < best_ns) {best_ns = ns;}
+    }
+
+    return best_ns;
+}
+
+/* Benchmark the patterns on a layout */
+int bench_layout(const char *name, const std::vector<uint8_t> &layout) {
+    if (!pixelMap::load(layout.data(), layout.size())) {
+        fprintf(stderr, "%s: layout rejected\n", name);
+        return 1;
+    }
+
+    double trig_ns = bench_pattern(plasma_trig);
+    struct {const char *name; void (*pattern)();} patterns[] = {
+        {"plasma", pixelMap::plasma}, {"radial_wave", pixelMap::radial_wave}, {"scroll_text", pixelMap::scroll_text},
+    };
+    printf("%-8s %-14s %12.1f %10.2f\n", name, "plasma (trig)", trig_ns, trig_ns / BENCH_LED_QTY);
+    for (auto &p : patterns) {
+        double ns = bench_pattern(p.pattern);
+        printf("%-8s %-14s %12.1f %10.2f", name, p.name, ns, ns / BENCH_LED_QTY);
+        if (p.pattern == pixelMap::plasma) {printf("   %.1fx faster than per-frame trig", trig_ns / ns);}
+        printf("\n");
+    }
+    return 0;
+}
+
+int main() {
+    int result = 0;
+
+    printf("%-8s %-14s %12s %10s\n", "layout", "pattern", "ns/frame", "ns/light");
+    result |= bench_layout("grid", grid_layout());
+    result |= bench_layout("wreath", wreath_layout());
+
+    return result;
+}
@@ -0,0 +1,254 @@
+/*
+    budget_test.cpp - host tool
+    Runs the real application (setup() + loop()) on the virtual clock with slow patterns
+    injected into the pattern list - their render time is simulated (delayMicroseconds) from a
+    cost model that follows the render quality (lightTools::blending() / detail_step()) - and
+    checks lib/frameBudget lowers the quality while they overrun the budget of their level
+    (FRAME_BUDGET_US, or their share of loop() once the frame rate is capped), and raises it
+    back once they don't.
+
+    Usage (built by 'build_host.sh'):
+        budget_test [--other-us U]
+            --other-us U        time the rest of each loop() iteration takes (default 200)
+
+    Scenarios:
+        fast        a pattern well within the budget - full quality, a frame every loop()
+        low_fps     a pattern overrunning FRAME_BUDGET_US, but within its share at the capped frame
+                    rate - settles at low_fps (not lower), blending kept
+        blend       a pattern overrunning its share at the capped rate because of its blending -
+                    settles at no_blend (not lower), and loop() gets more than 90% of the time back
+        per_led     a pattern overrunning because of its work per light - settles at half_res, with
+                    the lights in between filled in from their drawn neighbors
+        recover     the per_led pattern gets cheap - the quality is raised back to full, a level per hold
+        remember    switching away from a slow pattern and back - it starts out at the level it settled
+                    on (no overrun burst), while the fast pattern in between runs at full quality
+        edge        a pattern overrunning at full / low_fps, with headroom at no_blend - the hold
+                    doubles, so it doesn't flap (10 minutes)
+        plasma      pixelMap.plasma at half resolution stays close to the full resolution frame (4 s of frames)
+
+    The exit code is 1 if any check fails.
+*/
+
+#include "host_ghost.h"
+
+/* Cost model of an injected pattern */
+struct patternCost {
+    uint32_t base_us;                           //Always
+    uint32_t blend_us;                          //While blending
+    uint32_t led_us;                            //Per light drawn
+};
+
+patternCost cost = {0, 0, 0};
+uint64_t render_total_us = 0;                   //Time spent in the injected pattern
+uint64_t frames = 0;
+uint32_t other_us = 200;
+int result = 0;
+
+void fail(const char *scenario, const char *msg) {
+    printf("%-10s FAIL: %s\n", scenario, msg);
+    result = 1;
+}
+
+/* The injected pattern - a gradient over the strand, taking the time of the cost model */
+void slow_pattern() {
+    uint16_t drawn = 0;
+    for (uint16_t led = 0; led < LED_STRAND_QTY; led += lightTools.detail_step(), drawn++) {
+        LED_ARR[LED_PER_START_POS + led] = CRGB(led * 2, 255 - led * 2, 64);
+    }
+    lightTools.upscale(&LED_ARR[LED_PER_START_POS], LED_STRAND_QTY);
+
+    uint32_t render_us = cost.base_us + (lightTools.blending() ? cost.blend_us : 0) + drawn * cost.led_us;
+    delayMicroseconds(render_us);
+    render_total_us += render_us;
+}
+
+void on_show(const CRGB *leds, uint16_t num_leds, uint8_t brightness) {
+    (void) leds; (void) num_leds; (void) brightness;
+    frames++;
+}
+
+/* Run the ghost on pattern slot 'idx' (holding the injected pattern) for a while */
+struct runResult {
+    double seconds = 0;
+    uint64_t loops = 0;
+    uint64_t frames = 0;
+    uint64_t render_us = 0;
+    uint32_t level_changes = 0;
+    uint32_t over = 0;
+    double render_share = 0;
+};
+
+runResult run(uint8_t idx, double seconds) {
+    christmas_patterns_idx = idx;
+    runResult res;
+    res.seconds = seconds;
+    frameBudgetStats before = frameBudget.stats();
+    uint64_t start_us = host::clock_us, start_frames = frames, start_render = render_total_us;
+    while (host::clock_us - start_us < (uint64_t) (seconds * 1e6)) {
+        loop();
+        host::clock_us += other_us;
+        res.loops++;
+    }
+    res.frames = frames - start_frames;
+    res.render_us = render_total_us - start_render;
+    res.level_changes = (frameBudget.stats().lowered_qty - before.lowered_qty) + (frameBudget.stats().raised_qty - before.raised_qty);
+    res.over = frameBudget.stats().over_qty - before.over_qty;
+    res.render_share = (double) res.render_us / (host::clock_us - start_us);
+    return res;
+}
+
+void report(const char *scenario, const runResult &res) {
+    printf("%-10s level %-8s  %6.1f fps, %5.1f%% of the time rendering, %llu loops, %u level changes, %u frames over the budget\n",
+           scenario, frameBudget.level_name(frameBudget.level()), res.frames / res.seconds, 100 * res.render_share,
+           (unsigned long long) res.loops, res.level_changes, res.over);
+}
+
+void scenario_fast() {
+    cost = {1000, 500, 10};
+    runResult res = run(0, 10);
+    report("fast", res);
+    if (frameBudget.level() != FRAME_BUDGET_FULL || res.level_changes) {fail("fast", "the quality must stay full");}
+    if (res.frames != res.loops) {fail("fast", "at full quality, every loop() must draw a frame");}
+}
+
+void scenario_low_fps() {
+    /* 5 ms a frame --> over FRAME_BUDGET_US, but 15% of the time at the capped rate */
+    cost = {2500, 2500, 0};
+    runResult res = run(6, 1);
+    if (frameBudget.level() != FRAME_BUDGET_LOW_FPS) {fail("low_fps", "must reach low_fps within a second");}
+    res = run(6, 20);
+    report("low_fps", res);
+    if (frameBudget.level() != FRAME_BUDGET_LOW_FPS || res.level_changes || res.over) {fail("low_fps", "must settle at low_fps, within its share");}
+    if (!lightTools.blending()) {fail("low_fps", "blending must be kept");}
+    if (res.render_share > FRAME_BUDGET_LOW_FPS_SHARE_PCT / 100.0) {fail("low_fps", "rendering must stay within its share of the time");}
+    if (res.frames < 20 * (FRAME_BUDGET_LOW_FPS_HZ - 1)) {fail("low_fps", "the frame rate must stay at the cap");}
+}
+
+void scenario_blend() {
+    /* 8 ms a frame while blending --> over the share at the capped rate, 3 ms without */
+    cost = {3000, 5000, 0};
+    runResult res = run(1, 1);
+    if (frameBudget.level() != FRAME_BUDGET_NO_BLEND) {fail("blend", "must reach no_blend within a second");}
+    res = run(1, 20);
+    report("blend", res);
+    if (frameBudget.level() != FRAME_BUDGET_NO_BLEND || res.level_changes) {fail("blend", "must settle at no_blend");}
+    if (res.render_share > 0.1) {fail("blend", "loop() must get more than 90% of the time");}
+    if (res.frames < 20 * (FRAME_BUDGET_LOW_FPS_HZ - 1)) {fail("blend", "the frame rate must stay at the cap");}
+}
+
+void scenario_per_led() {
+    cost = {0, 0, 100};
+    run(2, 1);
+    runResult res = run(2, 20);
+    report("per_led", res);
+    if (frameBudget.level() != FRAME_BUDGET_HALF_RES || res.level_changes || res.over) {fail("per_led", "must settle at half_res, within the budget");}
+
+    /* Every other light is drawn, the ones in between are the gradient of their neighbors */
+    bool filled = true;
+    for (uint16_t led = 1; led + 1 < LED_STRAND_QTY; led += 2) {
+        CRGB expected = lightTools.fadeToColor(LED_ARR[LED_PER_START_POS + led - 1], LED_ARR[LED_PER_START_POS + led + 1], 128);
+        if (LED_ARR[LED_PER_START_POS + led] != expected) {filled = false;}
+    }
+    if (!filled) {fail("per_led", "the lights in between must be filled in from their neighbors");}
+}
+
+void scenario_recover() {
+    /* A level per hold (FRAME_BUDGET_RESTORE_FRAMES frames at the capped rate) - 3 levels back to full */
+    cost = {0, 0, 5};
+    double hold_s = (double) FRAME_BUDGET_RESTORE_FRAMES / FRAME_BUDGET_LOW_FPS_HZ;
+    runResult res = run(2, 3 * hold_s + 1);
+    report("recover", res);
+    if (frameBudget.level() != FRAME_BUDGET_FULL || res.level_changes != 3) {fail("recover", "must be raised back to full, a level at a time");}
+}
+
+void scenario_remember() {
+    cost = {0, 0, 100};
+    run(3, 2);
+    if (frameBudget.level() != FRAME_BUDGET_HALF_RES) {fail("remember", "must settle at half_res");}
+
+    /* The fast pattern in between runs at full quality */
+    christmas_patterns[4] = pixelMap.radial_wave;
+    runResult res = run(4, 2);
+    if (frameBudget.level() != FRAME_BUDGET_FULL || res.frames != res.loops) {fail("remember", "another pattern must start at full quality");}
+
+    res = run(3, 2);
+    report("remember", res);
+    if (frameBudget.level() != FRAME_BUDGET_HALF_RES || res.over) {fail("remember", "the slow pattern must start out at half_res, without overrunning");}
+}
+
+void scenario_edge() {
+    /* 7000 us while blending (over at low_fps too), 1000 us without (headroom) --> raised, overruns, lowered, ... */
+    cost = {1000, 6000, 0};
+    runResult res = run(5, 600);
+    report("edge", res);
+    if (res.level_changes > 20) {fail("edge", "the quality must not flap");}
+    if (res.render_share > 0.1) {fail("edge", "loop() must get more than 90% of the time");}
+}
+
+void scenario_plasma() {
+    /* The same frame at full / half resolution (the clock stands still in between), over a few seconds of the animation */
+    const uint16_t sample_qty = 40;
+    CRGB full[LED_STRAND_QTY];
+    uint64_t error = 0;
+    for (uint16_t sample = 0; sample < sample_qty; sample++, host::clock_us += 100000) {
+        lightTools.set_quality(true, 1);
+        pixelMap.plasma();
+        memcpy(full, &LED_ARR[LED_PER_START_POS], sizeof(full));
+        lightTools.set_quality(true, 2);
+        pixelMap.plasma();
+        lightTools.set_quality(true, 1);
+
+        for (uint16_t led = 0; led < LED_STRAND_QTY; led++) {
+            const CRGB &half = LED_ARR[LED_PER_START_POS + led];
+            error += abs(half.r - full[led].r) + abs(half.g - full[led].g) + abs(half.b - full[led].b);
+        }
+    }
+    double mean = (double) error / ((uint32_t) sample_qty * LED_STRAND_QTY * 3);
+    printf("%-10s mean error of the half resolution frame: %.1f / 255\n", "plasma", mean);
+    if (mean > 8) {fail("plasma", "the half resolution frame must stay close to the full one");}
+}
+
+int main(int argc, char **argv) {
+    for (int arg = 1; arg < argc; arg++) {
+        if (!strcmp(argv[arg], "--other-us") && arg + 1 < argc) {
+            other_us = atoi(argv[++arg]);
+        } else {
+            fprintf(stderr, "usage: %s [--other-us U]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    /* The ghost's log goes to a file - the quality changes are logged there */
+    FILE *log = tmpfile();
+    host::serial_out = log;
+    host::show_hook = on_show;
+    setup();
+
+    /* Every slot runs the injected pattern, and the pattern timer never switches */
+    ghostSettings.set_pattern_duration(UINT16_MAX);
+    for (uint8_t idx = 0; idx < ARRAY_SIZE(christmas_patterns); idx++) {christmas_patterns[idx] = slow_pattern;}
+
+    scenario_fast();
+    scenario_low_fps();
+    scenario_blend();
+    scenario_per_led();
+    scenario_recover();
+    scenario_remember();
+    scenario_edge();
+    scenario_plasma();
+
+    /* Every change was logged */
+    const frameBudgetStats &stats = frameBudget.stats();
+    uint32_t logged = 0;
+    char line[256];
+    rewind(log);
+    while (fgets(line, sizeof(line), log)) {
+        if (strstr(line, "--> quality lowered to ") || strstr(line, "--> quality raised to ")) {logged++;}
+    }
+    if (logged != stats.lowered_qty + stats.raised_qty) {fail("log", "every quality change must be logged");}
+    printf("%u quality changes logged (%u lowered, %u raised), worst render %u us\n",
+           logged, (unsigned) stats.lowered_qty, (unsigned) stats.raised_qty, (unsigned) stats.worst_us);
+
+    printf("%s\n", result ? "budget checks FAILED" : "all budget checks passed");
+    return result;
+}
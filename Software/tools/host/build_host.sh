@@ -0,0 +1,167 @@
+#!/usr/bin/env bash
+#---------------------------------------------------------------------------------------------
+#----
+#----       Author: Ryan Klassing
+#----
+#----       Description:
+#----       Builds the host (Linux) tools that compile the real light libraries against
+#----       the Arduino / FastLED shims in 'shim/'.  Outputs are written to Software/temp/host/
+#----
+#----       Expected Use:
+#----           ./build_host.sh             build everything
+#----           ./build_host.sh bench       build + run the benchmarks
+#----           ./build_host.sh bench <animation.gfa | assets.gas> ...   also benchmark these animations
+#----           ./build_host.sh golden check        compare every pattern against the checked-in golden hashes (test/golden.txt)
+#----           ./build_host.sh golden record       re-record the golden hashes (after an intended change of the visuals - commit them)
+#----           ./build_host.sh sim [options]       run the ghost in the simulator (see simulator.cpp for the options)
+#----           ./build_host.sh soak [options]      soak test days of uptime (see soak.cpp for the options)
+#----           ./build_host.sh audio [file.wav]    check the beat detection on synthesized drum tracks (and list the beats of a WAV file)
+#----           ./build_host.sh sync [options]      check the multi-ghost sync on loopback (see sync_test.cpp for the options)
+#----           ./build_host.sh backoff [options]   check the WiFi connect backoff against a fake WiFi driver (see backoff_test.cpp for the options)
+#----           ./build_host.sh budget [options]    check the frame budget against injected slow patterns (see budget_test.cpp for the options)
+#----           ./build_host.sh node [options]      stream sACN / Art-Net into the pixel node on loopback (see pixel_node_test.cpp for the options)
+#----           ./build_host.sh api [options]       check the local HTTP API / WebSocket preview on loopback (see api_test.cpp for the options)
+#----           ./build_host.sh stream [options]    check the serial frame stream, or view / capture one (see serial_view.cpp for the options)
+#----           ./build_host.sh profile [options]   check the sampling profiler, or report on a ghost's profile (see profile_report.cpp for the options)
+#----           ./build_host.sh trace [options]     check the frame tracing, or convert a ghost's trace to Chrome JSON (see trace_json.cpp for the options)
+#----
+#---------------------------------------------------------------------------------------------
+
+set -euo pipefail
+
+HOST_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+SOFTWARE_DIR="$(cd "${HOST_DIR}/../.." && pwd)"
+OUT_DIR="${SOFTWARE_DIR}/temp/host"
+CXX="${CXX:-g++}"
+CXXFLAGS="${CXXFLAGS:--std=gnu++17 -O2 -Wall}"
+
+# Every lib/<name>/src folder is an include path, the same way PlatformIO finds them
+INCLUDES=(-I"${HOST_DIR}" -I"${HOST_DIR}/shim")
+for lib_src in "${SOFTWARE_DIR}"/lib/*/src; do
+    INCLUDES+=(-I"${lib_src}")
+done
+
+mkdir -p "${OUT_DIR}"
+
+# build <source name> [extra flags]  /  build_as <source name> <output name> [extra flags]
+build() {
+    build_as "$1" "$@"
+}
+
+build_as() {
+    local name="$1"
+    local out="$2"
+    shift 2
+    echo "Building ${out}..."
+    ${CXX} ${CXXFLAGS} "$@" "${INCLUDES[@]}" "${HOST_DIR}/${name}.cpp" "${HOST_DIR}/shim/host_shim.cpp" -o "${OUT_DIR}/${out}"
+}
+
+assemble_scripts() {
+    for script in "${SOFTWARE_DIR}"/tools/lightScript/examples/*.lsa; do
+        python3 "${SOFTWARE_DIR}/tools/lightScript/lsasm.py" "${script}" -o "${OUT_DIR}/$(basename "${script%.lsa}").lsb"
+    done
+}
+
+# Benchmarks are release builds - everything else checks every ledSpan access (LIGHT_DEBUG_BOUNDS)
+build bench_lightScript
+build bench_framePlayer
+build bench_ledSpan
+build_as bench_ledSpan bench_ledSpan_debug -DLIGHT_DEBUG_BOUNDS
+build bench_pixelMap
+build pixel_node_test -pthread
+build api_test -DLIGHT_DEBUG_BOUNDS
+build serial_view -DLIGHT_DEBUG_BOUNDS
+build profile_report
+build trace_json -DLIGHT_DEBUG_BOUNDS -DFRAME_TRACE
+build audio_beats -DLIGHT_DEBUG_BOUNDS
+build golden_frames -DLIGHT_DEBUG_BOUNDS
+build simulator -DLIGHT_DEBUG_BOUNDS
+build sync_test -DLIGHT_DEBUG_BOUNDS -DUSE_GET_MILLISECOND_TIMER
+build backoff_test -DLIGHT_DEBUG_BOUNDS
+build budget_test -DLIGHT_DEBUG_BOUNDS
+build soak -DLIGHT_DEBUG_BOUNDS -fsanitize=address,undefined -fno-sanitize-recover=all -g
+assemble_scripts
+
+if [[ "${1:-}" == "bench" ]]; then
+    shift
+    "${OUT_DIR}/bench_lightScript" "${OUT_DIR}"/*.lsb
+    "${OUT_DIR}/bench_ledSpan"
+    "${OUT_DIR}/bench_ledSpan_debug"
+    "${OUT_DIR}/bench_pixelMap"
+    if [[ $# -gt 0 ]]; then
+        "${OUT_DIR}/bench_framePlayer" "$@"
+    fi
+fi
+
+if [[ "${1:-}" == "golden" ]]; then
+    mkdir -p "${SOFTWARE_DIR}/temp/golden"
+    cd "${SOFTWARE_DIR}"
+    "${OUT_DIR}/golden_frames" "${2:-check}" "${@:3}"
+fi
+
+if [[ "${1:-}" == "sim" ]]; then
+    cd "${SOFTWARE_DIR}"
+    "${OUT_DIR}/simulator" "${@:2}"
+fi
+
+if [[ "${1:-}" == "soak" ]]; then
+    "${OUT_DIR}/soak" "${@:2}"
+fi
+
+if [[ "${1:-}" == "audio" ]]; then
+    for bpm in 90 120 150; do
+        "${OUT_DIR}/audio_beats" --synth "${bpm}"
+    done
+    if [[ $# -gt 1 ]]; then
+        "${OUT_DIR}/audio_beats" "${@:2}"
+    fi
+fi
+
+if [[ "${1:-}" == "backoff" ]]; then
+    "${OUT_DIR}/backoff_test" "${@:2}"
+fi
+
+if [[ "${1:-}" == "sync" ]]; then
+    if [[ $# -gt 1 ]]; then
+        "${OUT_DIR}/sync_test" "${@:2}"
+    else
+        "${OUT_DIR}/sync_test"
+        "${OUT_DIR}/sync_test" --loss 20 --kill-leader 10
+    fi
+fi
+
+if [[ "${1:-}" == "budget" ]]; then
+    "${OUT_DIR}/budget_test" "${@:2}"
+fi
+
+if [[ "${1:-}" == "node" ]]; then
+    "${OUT_DIR}/pixel_node_test" "${@:2}"
+fi
+
+if [[ "${1:-}" == "api" ]]; then
+    "${OUT_DIR}/api_test" "${@:2}"
+fi
+
+if [[ "${1:-}" == "stream" ]]; then
+    if [[ $# -gt 1 ]]; then
+        "${OUT_DIR}/serial_view" "${@:2}"
+    else
+        "${OUT_DIR}/serial_view" --selftest
+    fi
+fi
+
+if [[ "${1:-}" == "profile" ]]; then
+    if [[ $# -gt 1 ]]; then
+        "${OUT_DIR}/profile_report" "${@:2}"
+    else
+        "${OUT_DIR}/profile_report" --selftest
+    fi
+fi
+
+if [[ "${1:-}" == "trace" ]]; then
+    if [[ $# -gt 1 ]]; then
+        "${OUT_DIR}/trace_json" "${@:2}"
+    else
+        "${OUT_DIR}/trace_json" --selftest
+    fi
+fi
@@ -0,0 +1,302 @@
+/*
+    golden_frames.cpp - host tool
+    Golden-frame regression check for every pattern in 'christmas_patterns'.  Each pattern
+    is run for a fixed number of frames on a virtual clock, and its frames are compared
+    against the golden hashes checked in as 'test/golden.txt' - so a rewrite (e.g. of
+    lightTools::fadeToColor) can be checked to be bit-identical to the original.
+
+    Usage (built by 'build_host.sh', run from Software/):
+        golden_frames record [--golden file] [--dump dir] [--frames N] [--fps F] [--seed S] [--anim file.gfa]
+        golden_frames check [--golden file] [--dump dir [--png]]
+            --golden file       golden hashes (default test/golden.txt)
+            --dump dir          record: also write the raw frames (<name>.rgb) + a PNG strip (<name>.png, one row per frame)
+                                check: compare against those frames, to find the first differing frame of a pattern
+            --png               check: write a diff strip of each differing pattern (recorded | current | changed lights in white)
+
+    The golden file holds the run settings, then a line per pattern: the hash of the whole run,
+    and a hash per second of frames (so a differing pattern is narrowed down to a second, even
+    without the raw frames).  'check' replays the run with the recorded settings.
+*/
+
+#include "host_ghost.h"
+#include "host_frame_source.h"
+#include "host_png.h"
+#include "host_audio.h"
+#include <string>
+#include <vector>
+
+/* Names for the patterns in the list (anything missing here is named by its index) */
+struct patternName {void (*pattern)(); const char *name;};
+const patternName pattern_names[] = {
+    {klassyLights::jacobs_ladder, "jacobs_ladder"},
+    {cochise::stack_lights_in_the_middle, "stack_lights_in_the_middle"},
+    {cochise::red_and_green_curtain_lights_to_middle, "red_and_green_curtain_lights_to_middle"},
+    {klassyLights::fading_candy_cane, "fading_candy_cane"},
+    {nmayelights::police_lights, "police_lights"},
+    {lightScript::run, "lightScript"},
+    {framePlayer::play, "framePlayer"},
+    {audioReactive::pulse, "audioReactive_pulse"},
+    {pixelMap::plasma, "pixelMap_plasma"},
+    {pixelMap::radial_wave, "pixelMap_radial_wave"},
+    {pixelMap::scroll_text, "pixelMap_scroll_text"},
+};
+
+/* Settings of a run - recorded in the golden file, ahead of the hashes */
+struct runSettings {
+    uint32_t frames = 600;
+    uint32_t fps = 60;
+    uint32_t seed = 1;                          //random() / random8() seed, set before the first pattern
+    std::string anim = "data/anim/show.gfa";
+};
+
+/* Hashes of a pattern's run - the whole run, and every second of frames */
+struct runHashes {
+    std::string name;
+    uint32_t run = 0;
+    std::vector<uint32_t> seconds;
+};
+
+#define GOLDEN_DEFAULT_FILE "test/golden.txt"
+
+std::string pattern_name(uint8_t idx) {
+    for (const patternName &p : pattern_names) {
+        if (p.pattern == christmas_patterns[idx]) {return p.name;}
+    }
+    return "pattern_" + std::to_string(idx);
+}
+
+/* Run every pattern (in list order, so shared state evolves the same way each run), storing all frames */
+std::vector<std::vector<uint8_t>> run_patterns(const runSettings &settings) {
+    hostFileFrameSource anim_source;
+    if (anim_source.open(settings.anim.c_str())) {framePlayer::open(&anim_source);}
+
+    /* The audio-reactive patterns hear a synthesized drum track (120 BPM), in step with their frames */
+    std::vector<int16_t> audio;
+    std::vector<uint32_t> kicks;
+    hostSynthBeats(120, (double) settings.frames / settings.fps, &audio, &kicks);
+    hostAudioFeed audio_feed;
+
+    /* The random patterns draw the same numbers every run */
+    randomSeed(settings.seed);
+
+    std::vector<std::vector<uint8_t>> runs;
+    uint64_t frame_us = 1000000 / settings.fps;
+    for (uint8_t idx = 0; idx < ARRAY_SIZE(christmas_patterns); idx++) {
+        std::vector<uint8_t> frames;
+        fill_solid(LED_ARR, LED_ARR_QTY, CRGB::Black);
+        audio_feed.start(audio, host::clock_us);
+        for (uint32_t frame = 0; frame < settings.frames; frame++) {
+            host::clock_us += frame_us;
+            if (christmas_patterns[idx] == audioReactive::pulse) {audio_feed.update();}
+            christmas_patterns[idx]();
+            frames.insert(frames.end(), (uint8_t *) &LED_ARR[LED_PER_START_POS], (uint8_t *) &LED_ARR[LED_PER_START_POS + LED_STRAND_QTY]);
+        }
+        runs.push_back(frames);
+    }
+
+    framePlayer::close();
+    return runs;
+}
+
+runHashes run_hashes(const std::string &name, const std::vector<uint8_t> &frames, const runSettings &settings) {
+    runHashes hashes;
+    hashes.name = name;
+    hashes.run = lightTools.frame_hash((const CRGB *) frames.data(), frames.size() / 3);
+
+    size_t second_len = (size_t) LED_STRAND_QTY * 3 * settings.fps;
+    for (size_t start = 0; start < frames.size(); start += second_len) {
+        size_t len = std::min(second_len, frames.size() - start);
+        hashes.seconds.push_back(lightTools.frame_hash((const CRGB *) &frames[start], len / 3));
+    }
+    return hashes;
+}
+
+bool write_file(const std::string &path, const std::vector<uint8_t> &data) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {return false;}
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return (fclose(f) == 0) && ok;
+}
+
+bool read_file(const std::string &path, std::vector<uint8_t> &data) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {return false;}
+    uint8_t buf[65536];
+    size_t n;
+    data.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {data.insert(data.end(), buf, buf + n);}
+    fclose(f);
+    return true;
+}
+
+int record(const std::string &golden_path, const std::string &dump_dir, const runSettings &settings) {
+    std::vector<std::vector<uint8_t>> runs = run_patterns(settings);
+
+    FILE *golden = fopen(golden_path.c_str(), "w");
+    if (!golden) {fprintf(stderr, "can't write %s\n", golden_path.c_str()); return 1;}
+    fprintf(golden, "# Golden frames of every pattern - 'build_host.sh golden record' writes them, 'build_host.sh golden check' compares against them\n");
+    fprintf(golden, "# <hash of the run> <pattern> <hash of each second of frames>\n");
+    fprintf(golden, "frames %u fps %u leds %u seed %u anim %s\n", settings.frames, settings.fps, LED_STRAND_QTY, settings.seed, settings.anim.c_str());
+
+    for (uint8_t idx = 0; idx < runs.size(); idx++) {
+        runHashes hashes = run_hashes(pattern_name(idx), runs[idx], settings);
+        if (!dump_dir.empty() &&
+            (!write_file(dump_dir + "/" + hashes.name + ".rgb", runs[idx]) ||
+             !host::write_png((dump_dir + "/" + hashes.name + ".png").c_str(), runs[idx].data(), LED_STRAND_QTY, settings.frames))) {
+            fprintf(stderr, "can't write %s/%s\n", dump_dir.c_str(), hashes.name.c_str());
+            fclose(golden);
+            return 1;
+        }
+        fprintf(golden, "%08x %s", hashes.run, hashes.name.c_str());
+        for (uint32_t hash : hashes.seconds) {fprintf(golden, " %08x", hash);}
+        fprintf(golden, "\n");
+        printf("%-40s %08x\n", hashes.name.c_str(), hashes.run);
+    }
+
+    if (fclose(golden) != 0) {fprintf(stderr, "can't write %s\n", golden_path.c_str()); return 1;}
+    printf("golden hashes written to %s\n", golden_path.c_str());
+    return 0;
+}
+
+/* Read the golden file - the run settings, and the hashes of every pattern */
+bool read_golden(const std::string &golden_path, runSettings &settings, std::vector<runHashes> &golden) {
+    FILE *f = fopen(golden_path.c_str(), "r");
+    if (!f) {return false;}
+
+    char line[4096];
+    bool have_settings = false;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') {continue;}
+
+        if (!have_settings) {
+            char anim[256] = "";
+            unsigned frames, fps, leds, seed;
+            if (sscanf(line, "frames %u fps %u leds %u seed %u anim %255s", &frames, &fps, &leds, &seed, anim) != 5) {break;}
+            if (leds != LED_STRAND_QTY) {fprintf(stderr, "recorded with %u lights, built with %u\n", leds, LED_STRAND_QTY); break;}
+            settings.frames = frames;
+            settings.fps = fps;
+            settings.seed = seed;
+            settings.anim = anim;
+            have_settings = true;
+            continue;
+        }
+
+        runHashes hashes;
+        char name[128];
+        unsigned hash;
+        int used;
+        if (sscanf(line, "%x %127s%n", &hash, name, &used) != 2) {continue;}
+        hashes.run = hash;
+        hashes.name = name;
+        for (const char *pos = line + used; sscanf(pos, " %x%n", &hash, &used) == 1; pos += used) {hashes.seconds.push_back(hash);}
+        golden.push_back(hashes);
+    }
+
+    fclose(f);
+    return have_settings;
+}
+
+int check(const std::string &golden_path, const std::string &dump_dir, bool png) {
+    /* Replay with the recorded settings */
+    runSettings settings;
+    std::vector<runHashes> golden;
+    if (!read_golden(golden_path, settings, golden)) {
+        fprintf(stderr, "no golden hashes in %s (use 'record' first)\n", golden_path.c_str());
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> runs = run_patterns(settings);
+    uint32_t frame_len = LED_STRAND_QTY * 3;
+    int failures = 0;
+
+    for (uint8_t idx = 0; idx < runs.size(); idx++) {
+        runHashes current = run_hashes(pattern_name(idx), runs[idx], settings);
+        const runHashes *expected_hashes = NULL;
+        for (const runHashes &hashes : golden) {
+            if (hashes.name == current.name) {expected_hashes = &hashes;}
+        }
+        if (!expected_hashes) {
+            printf("%-40s MISSING (not in %s)\n", current.name.c_str(), golden_path.c_str());
+            failures++;
+            continue;
+        }
+
+        if (expected_hashes->run == current.run) {
+            printf("%-40s OK\n", current.name.c_str());
+            continue;
+        }
+        failures++;
+
+        /* Without the recorded frames, narrow it down to the first differing second */
+        std::vector<uint8_t> expected;
+        if (dump_dir.empty() || !read_file(dump_dir + "/" + current.name + ".rgb", expected)) {
+            uint32_t second = 0;
+            while (second < current.seconds.size() && second < expected_hashes->seconds.size() && current.seconds[second] == expected_hashes->seconds[second]) {second++;}
+            printf("%-40s FAIL - hash %08x, golden %08x, first differing frames %u-%u\n", current.name.c_str(), current.run, expected_hashes->run,
+                   second * settings.fps, std::min((second + 1) * settings.fps, settings.frames) - 1);
+            continue;
+        }
+
+        /* Find the differing frames */
+        uint32_t first_diff = UINT32_MAX, diff_qty = 0;
+        for (uint32_t frame = 0; frame < settings.frames; frame++) {
+            if (expected.size() < (size_t) (frame + 1) * frame_len || memcmp(&expected[frame * frame_len], &runs[idx][frame * frame_len], frame_len)) {
+                if (first_diff == UINT32_MAX) {first_diff = frame;}
+                diff_qty++;
+            }
+        }
+        printf("%-40s FAIL - %u of %u frames differ, first at frame %u\n", current.name.c_str(), diff_qty, settings.frames, first_diff);
+
+        /* Diff strip: recorded | current | changed lights */
+        if (png) {
+            expected.resize(runs[idx].size());
+            uint32_t width = LED_STRAND_QTY * 3 + 2;
+            std::vector<uint8_t> strip((size_t) width * settings.frames * 3, 0x40);
+            for (uint32_t frame = 0; frame < settings.frames; frame++) {
+                uint8_t *row = &strip[(size_t) frame * width * 3];
+                const uint8_t *before = &expected[frame * frame_len];
+                const uint8_t *after = &runs[idx][frame * frame_len];
+                memcpy(row, before, frame_len);
+                memcpy(&row[frame_len + 3], after, frame_len);
+                for (uint32_t led = 0; led < LED_STRAND_QTY; led++) {
+                    memset(&row[(frame_len + 3) * 2 + led * 3], memcmp(&before[led * 3], &after[led * 3], 3) ? 0xFF : 0x00, 3);
+                }
+            }
+            std::string path = dump_dir + "/" + current.name + "_diff.png";
+            if (host::write_png(path.c_str(), strip.data(), width, settings.frames)) {printf("    diff strip: %s\n", path.c_str());}
+        }
+    }
+
+    printf("%d of %u patterns differ\n", failures, (unsigned) runs.size());
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || (strcmp(argv[1], "record") && strcmp(argv[1], "check"))) {
+        fprintf(stderr, "usage: %s record [--golden file] [--dump dir] [--frames N] [--fps F] [--seed S] [--anim file.gfa]\n"
+                        "       %s check [--golden file] [--dump dir [--png]]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    runSettings settings;
+    std::string golden_path = GOLDEN_DEFAULT_FILE;
+    std::string dump_dir;
+    bool png = false;
+    for (int arg = 2; arg < argc; arg++) {
+        if (!strcmp(argv[arg], "--golden") && arg + 1 < argc) {golden_path = argv[++arg];}
+        else if (!strcmp(argv[arg], "--dump") && arg + 1 < argc) {dump_dir = argv[++arg];}
+        else if (!strcmp(argv[arg], "--frames") && arg + 1 < argc) {settings.frames = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--fps") && arg + 1 < argc) {settings.fps = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--seed") && arg + 1 < argc) {settings.seed = strtoul(argv[++arg], NULL, 0);}
+        else if (!strcmp(argv[arg], "--anim") && arg + 1 < argc) {settings.anim = argv[++arg];}
+        else if (!strcmp(argv[arg], "--png")) {png = true;}
+        else {fprintf(stderr, "unknown option: %s\n", argv[arg]); return 2;}
+    }
+    if (!settings.frames || !settings.fps) {fprintf(stderr, "--frames / --fps must be > 0\n"); return 2;}
+    if (png && dump_dir.empty()) {fprintf(stderr, "--png needs the recorded frames (--dump dir)\n"); return 2;}
+
+    /* Set up the ghost as it boots (patterns get their LED arrays / lightTools from the constructors) */
+    setup();
+
+    return (0 == strcmp(argv[1], "record")) ? record(golden_path, dump_dir, settings) : check(golden_path, dump_dir, png);
+}
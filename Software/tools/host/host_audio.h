@@ -0,0 +1,139 @@
+/*
+    host_audio.h - host build
+    Audio sources for the host tools, at the sample rate the analysis in lib/audioReactive
+    expects (AUDIO_SAMPLE_RATE, signed 16b mono):
+        - hostLoadWav()         reads a PCM WAV file (8b / 16b, any channel qty / sample rate)
+        - hostSynthBeats()      synthesizes a drum track with kicks at a known tempo, under a
+                                steady chord and some noise - the kick times are returned too
+
+    hostAudioFeed hands the samples to audioReactive::process() in step with the virtual clock.
+*/
+
+#ifndef host_audio_h
+    #define host_audio_h
+
+    #include <math.h>
+    #include <stdio.h>
+    #include <string.h>
+    #include <vector>
+
+    /* Read a little-endian value from a byte buffer */
+    inline uint32_t host_le(const uint8_t *p, uint8_t len) {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < len; i++) {value |= (uint32_t) p[i] << (8 * i);}
+        return value;
+    }
+
+    /* Load a PCM WAV file, mixed down to mono and resampled (linear) to AUDIO_SAMPLE_RATE - returns false if it isn't a PCM WAV */
+    inline bool hostLoadWav(const char *path, std::vector<int16_t> *out) {
+        FILE *f = fopen(path, "rb");
+        if (!f) {return false;}
+        std::vector<uint8_t> file;
+        uint8_t buf[65536];
+        size_t len;
+        while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {file.insert(file.end(), buf, buf + len);}
+        fclose(f);
+
+        if (file.size() < 12 || memcmp(&file[0], "RIFF", 4) || memcmp(&file[8], "WAVE", 4)) {return false;}
+
+        /* Walk the chunks for the format and the data */
+        uint16_t format = 0, channels = 0, bits = 0;
+        uint32_t rate = 0;
+        const uint8_t *data = NULL;
+        uint32_t data_len = 0;
+        for (size_t pos = 12; pos + 8 <= file.size();) {
+            uint32_t chunk_len = host_le(&file[pos + 4], 4);
+            const uint8_t *chunk = &file[pos + 8];
+            if (pos + 8 + chunk_len > file.size()) {chunk_len = file.size() - pos - 8;}
+
+            if (!memcmp(&file[pos], "fmt ", 4) && chunk_len >= 16) {
+                format = host_le(chunk, 2);
+                channels = host_le(chunk + 2, 2);
+                rate = host_le(chunk + 4, 4);
+                bits = host_le(chunk + 14, 2);
+            } else if (!memcmp(&file[pos], "data", 4)) {
+                data = chunk;
+                data_len = chunk_len;
+            }
+            pos += 8 + chunk_len + (chunk_len & 1);
+        }
+        if ((format != 1 && format != 0xFFFE) || !channels || !rate || !data || (bits != 8 && bits != 16)) {return false;}
+
+        /* Mix down to mono */
+        uint8_t bytes = bits / 8;
+        size_t frames = data_len / (bytes * channels);
+        std::vector<double> mono(frames);
+        for (size_t i = 0; i < frames; i++) {
+            double sum = 0;
+            for (uint16_t ch = 0; ch < channels; ch++) {
+                const uint8_t *s = data + (i * channels + ch) * bytes;
+                sum += (bits == 8) ? ((int) s[0] - 128) * 256.0 : (int16_t) host_le(s, 2);
+            }
+            mono[i] = sum / channels;
+        }
+
+        /* Resample to the analysis rate */
+        out->clear();
+        for (double t = 0; t + 1 < frames; t += (double) rate / AUDIO_SAMPLE_RATE) {
+            size_t i = (size_t) t;
+            double frac = t - i;
+            out->push_back((int16_t) lround(mono[i] * (1 - frac) + mono[i + 1] * frac));
+        }
+        return true;
+    }
+
+    /* Synthesize 'seconds' of a drum track with a kick every beat at 'bpm' - the kick times (ms) are added to 'beats_ms' */
+    inline void hostSynthBeats(double bpm, double seconds, std::vector<int16_t> *out, std::vector<uint32_t> *beats_ms, uint32_t seed=1) {
+        size_t qty = (size_t) (seconds * AUDIO_SAMPLE_RATE);
+        double beat_s = 60.0 / bpm;
+        out->resize(qty);
+        beats_ms->clear();
+        for (uint32_t beat = 0; beat * beat_s < seconds; beat++) {beats_ms->push_back((uint32_t) lround(beat * beat_s * 1000));}
+
+        for (size_t i = 0; i < qty; i++) {
+            double t = (double) i / AUDIO_SAMPLE_RATE;
+            double in_beat = fmod(t, beat_s);
+
+            /* Kick - a 60Hz thump, falling to 45Hz, over ~150ms */
+            double kick = 14000 * exp(-in_beat / 0.05) * sin(2 * PI * (45 * in_beat + 15 * 0.03 * (1 - exp(-in_beat / 0.03))));
+
+            /* Hi-hat on the off-beat - short burst of noise */
+            double off_beat = fmod(t + beat_s / 2, beat_s);
+            seed = seed * 1103515245 + 12345;
+            double noise = ((int32_t) (seed >> 8) % 2000) / 1000.0 - 1;
+            double hat = 3000 * exp(-off_beat / 0.01) * noise;
+
+            /* Steady chord (A major) + background hiss */
+            double chord = 1500 * (sin(2 * PI * 440 * t) + sin(2 * PI * 554.37 * t) + sin(2 * PI * 659.25 * t));
+
+            (*out)[i] = (int16_t) constrain(lround(kick + hat + chord + 200 * noise), -32768L, 32767L);
+        }
+    }
+
+    /* Hands samples to the analysis as the virtual clock advances */
+    class hostAudioFeed
+    {
+        public:
+            hostAudioFeed() : _start_us(0), _pos(0) {}
+
+            void start(const std::vector<int16_t> &samples, uint64_t start_us) {_samples = samples; _start_us = start_us; _pos = 0;}
+            bool done() const {return _pos >= _samples.size();}
+
+            /* Process every sample up to the current virtual time */
+            void update() {
+                if (host::clock_us < _start_us) {return;}
+                size_t due = (size_t) ((host::clock_us - _start_us) * AUDIO_SAMPLE_RATE / 1000000);
+                if (due > _samples.size()) {due = _samples.size();}
+                while (_pos < due) {
+                    uint16_t qty = (uint16_t) std::min((size_t) AUDIO_FFT_LEN, due - _pos);
+                    audioReactive::process(&_samples[_pos], qty);
+                    _pos += qty;
+                }
+            }
+
+        private:
+            std::vector<int16_t> _samples;
+            uint64_t _start_us;
+            size_t _pos;
+    };
+#endif
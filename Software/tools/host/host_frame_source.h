@@ -0,0 +1,44 @@
+/*
+    host_frame_source.h - host build
+    frameSources (lib/framePlayer) for the host: streaming an animation from a file
+    (standing in for a LittleFS file on the ghost), or from memory, counting the bytes read.
+*/
+
+#ifndef host_frame_source_h
+    #define host_frame_source_h
+
+    #include "host_libs.h"
+
+    class hostFileFrameSource : public frameSource
+    {
+        public:
+            hostFileFrameSource() : _file(NULL), _bytes_read(0) {}
+            ~hostFileFrameSource() {close();}
+
+            bool open(const char *path) {close(); _file = fopen(path, "rb"); return _file != NULL;}
+            void close() {if (_file) {fclose(_file); _file = NULL;}}
+            size_t read(uint8_t *buf, size_t len) {size_t n = _file ? fread(buf, 1, len, _file) : 0; _bytes_read += n; return n;}
+            bool seek(uint32_t pos) {return _file && fseek(_file, pos, SEEK_SET) == 0;}
+
+            /* Total bytes read from the file so far */
+            uint64_t bytes_read() {return _bytes_read;}
+
+        private:
+            FILE *_file;
+            uint64_t _bytes_read;
+    };
+
+    /* memoryFrameSource that counts the bytes read, for the benchmarks */
+    class hostMemoryFrameSource : public memoryFrameSource
+    {
+        public:
+            hostMemoryFrameSource(const uint8_t *data, uint32_t len) : memoryFrameSource(data, len), _bytes_read(0) {}
+            size_t read(uint8_t *buf, size_t len) {size_t n = memoryFrameSource::read(buf, len); _bytes_read += n; return n;}
+
+            /* Total bytes read from memory so far */
+            uint64_t bytes_read() {return _bytes_read;}
+
+        private:
+            uint64_t _bytes_read;
+    };
+#endif
@@ -0,0 +1,13 @@
+/*
+    host_ghost.h - host build
+    Builds the real ghost application ('src/main.cpp' with every light library) for the
+    host, the same way the online simulator does (ONLINE_SIMULATION), so host tools can
+    drive setup() / loop() / the pattern list on a virtual clock.
+*/
+
+#ifndef host_ghost_h
+    #define host_ghost_h
+
+    #include "host_libs.h"
+    #include "../../src/main.cpp"
+#endif
@@ -0,0 +1,58 @@
+/*
+    host_libs.h - host build
+    Pulls every light library into a single translation unit, in the same order (and
+    with the same ONLINE_SIMULATION flag) used by 'tools/Create_wokwi_sim.vbs' when it
+    stitches the libraries together for the online simulator.
+*/
+
+#ifndef host_libs_h
+    #define host_libs_h
+
+    #define ONLINE_SIMULATION
+
+    /* Include the host shims for the Arduino / FastLED libraries */
+    #include <Arduino.h>
+    #include <FastLED.h>
+
+    /* Common light tools must come first - every user library depends on it */
+    #include "lightTools.h"
+    #include "lightTools.cpp"
+
+    /* User light libraries */
+    #include "assetStore.h"
+    #include "assetStore.cpp"
+    #include "audioReactive.h"
+    #include "audioReactive.cpp"
+    #include "cochise.h"
+    #include "cochise.cpp"
+    #include "connectBackoff.h"
+    #include "connectBackoff.cpp"
+    #include "frameBudget.h"
+    #include "frameBudget.cpp"
+    #include "framePlayer.h"
+    #include "framePlayer.cpp"
+    #include "frameStream.h"
+    #include "frameStream.cpp"
+    #include "frameTrace.h"
+    #include "frameTrace.cpp"
+    #include "ghostApi.h"
+    #include "ghostApi.cpp"
+    #include "ghostSettings.h"
+    #include "ghostSettings.cpp"
+    #include "ghostSync.h"
+    #include "ghostSync.cpp"
+    #include "klassyLights.h"
+    #include "klassyLights.cpp"
+    #include "lightScript.h"
+    #include "lightScript.cpp"
+    #include "lightZones.h"
+    #include "lightZones.cpp"
+    #include "nmayelights.h"
+    #include "nmayelights.cpp"
+    #include "pixelMap.h"
+    #include "pixelMap.cpp"
+    #include "pixelNode.h"
+    #include "pixelNode.cpp"
+    #include "sampleProfiler.h"
+    #include "sampleProfiler.cpp"
+#endif
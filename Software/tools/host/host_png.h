@@ -0,0 +1,80 @@
+/*
+    host_png.h - host build
+    Minimal PNG writer (8 bit RGB, uncompressed deflate blocks) for dumping LED frames as
+    images without any external libraries.
+*/
+
+#ifndef host_png_h
+    #define host_png_h
+
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <vector>
+
+    namespace host {
+        /* CRC-32 used by the PNG chunks */
+        inline uint32_t png_crc(const uint8_t *data, size_t len, uint32_t crc=0) {
+            crc = ~crc;
+            for (size_t i = 0; i < len; i++) {
+                crc ^= data[i];
+                for (int bit = 0; bit < 8; bit++) {crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));}
+            }
+            return ~crc;
+        }
+
+        inline void png_put32(std::vector<uint8_t> &out, uint32_t value) {
+            out.push_back(value >> 24); out.push_back(value >> 16); out.push_back(value >> 8); out.push_back(value);
+        }
+
+        inline void png_chunk(FILE *f, const char *type, const std::vector<uint8_t> &data) {
+            std::vector<uint8_t> chunk;
+            png_put32(chunk, data.size());
+            chunk.insert(chunk.end(), type, type + 4);
+            chunk.insert(chunk.end(), data.begin(), data.end());
+            png_put32(chunk, png_crc(&chunk[4], chunk.size() - 4));
+            fwrite(chunk.data(), 1, chunk.size(), f);
+        }
+
+        /* Write 'rgb' (width x height x 3 bytes, row by row) as a PNG - returns false if the file can't be written */
+        inline bool write_png(const char *path, const uint8_t *rgb, uint32_t width, uint32_t height) {
+            FILE *f = fopen(path, "wb");
+            if (!f) {return false;}
+
+            static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+            fwrite(signature, 1, sizeof(signature), f);
+
+            std::vector<uint8_t> ihdr;
+            png_put32(ihdr, width);
+            png_put32(ihdr, height);
+            ihdr.push_back(8); ihdr.push_back(2); ihdr.push_back(0); ihdr.push_back(0); ihdr.push_back(0);
+            png_chunk(f, "IHDR", ihdr);
+
+            /* Raw scanlines (filter type 0), wrapped in a zlib stream of stored deflate blocks */
+            std::vector<uint8_t> raw;
+            for (uint32_t y = 0; y < height; y++) {
+                raw.push_back(0);
+                raw.insert(raw.end(), &rgb[(size_t) y * width * 3], &rgb[(size_t) (y + 1) * width * 3]);
+            }
+
+            std::vector<uint8_t> idat = {0x78, 0x01};
+            uint32_t adler_a = 1, adler_b = 0;
+            for (size_t pos = 0; pos < raw.size(); ) {
+                size_t len = std::min((size_t) 65535, raw.size() - pos);
+                idat.push_back((pos + len == raw.size()) ? 1 : 0);
+                idat.push_back(len & 0xFF); idat.push_back(len >> 8);
+                idat.push_back(~len & 0xFF); idat.push_back((~len >> 8) & 0xFF);
+                for (size_t i = pos; i < pos + len; i++) {
+                    idat.push_back(raw[i]);
+                    adler_a = (adler_a + raw[i]) % 65521;
+                    adler_b = (adler_b + adler_a) % 65521;
+                }
+                pos += len;
+            }
+            png_put32(idat, (adler_b << 16) | adler_a);
+            png_chunk(f, "IDAT", idat);
+            png_chunk(f, "IEND", std::vector<uint8_t>());
+
+            return fclose(f) == 0;
+        }
+    }
+#endif
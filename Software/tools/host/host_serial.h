@@ -0,0 +1,47 @@
+/*
+    host_serial.h - host build
+    Opens the ghost's serial port (USB-UART) raw, at a given speed - shared by the host tools
+    that talk to a real ghost (serial_view, profile_report).
+*/
+
+#ifndef host_serial_h
+    #define host_serial_h
+
+    #include <fcntl.h>
+    #include <map>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <string>
+    #include <termios.h>
+    #include <unistd.h>
+
+    namespace host {
+        /* termios constant of a baud rate (0 if it isn't a standard one) */
+        inline speed_t baud_constant(uint32_t baud) {
+            static const std::map<uint32_t, speed_t> speeds = {
+                {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200}, {230400, B230400},
+                {460800, B460800}, {500000, B500000}, {921600, B921600}, {1000000, B1000000}, {1500000, B1500000}, {2000000, B2000000}};
+            auto speed = speeds.find(baud);
+            return speed == speeds.end() ? 0 : speed->second;
+        }
+
+        /* Set a serial port raw (no echo / line editing), at a baud rate */
+        inline bool serial_set_baud(int fd, uint32_t baud) {
+            termios tty = {};
+            if (tcgetattr(fd, &tty)) {return false;}
+            cfmakeraw(&tty);
+            tty.c_cflag |= CLOCAL | CREAD;
+            tty.c_cc[VMIN] = 1;
+            tty.c_cc[VTIME] = 0;
+            speed_t speed = baud_constant(baud);
+            return speed && !cfsetispeed(&tty, speed) && !cfsetospeed(&tty, speed) && !tcsetattr(fd, TCSANOW, &tty);
+        }
+
+        /* Send a console command (ended by a line end), and wait until it was sent */
+        inline void serial_command(int fd, const std::string &command) {
+            std::string line = command + "\n";
+            if (write(fd, line.data(), line.size()) < 0) {fprintf(stderr, "can't send '%s' to the ghost\n", command.c_str());}
+            tcdrain(fd);
+        }
+    }
+#endif
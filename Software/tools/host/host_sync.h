@@ -0,0 +1,87 @@
+/*
+    host_sync.h - host build
+    Loopback transport for lib/ghostSync: every simulated ghost binds a UDP socket on
+    127.0.0.1 (base_port + node index), and "multicasts" by sending to every other node's port.
+    Received packets can be dropped at random, to test the sync on a lossy network.
+*/
+
+#ifndef host_sync_h
+    #define host_sync_h
+
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #include <vector>
+
+    class hostUdpSyncTransport : public syncTransport
+    {
+        public:
+            /* Bind node 'idx' of 'qty' nodes - returns false if the port is taken */
+            bool open(uint16_t base_port, uint8_t idx, uint8_t qty, uint8_t loss_pct, uint32_t seed) {
+                _fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+                if (_fd < 0) {return false;}
+
+                sockaddr_in addr = loopback(base_port + idx);
+                if (bind(_fd, (sockaddr *) &addr, sizeof(addr))) {return false;}
+
+                for (uint8_t peer = 0; peer < qty; peer++) {
+                    if (peer != idx) {_peers.push_back(loopback(base_port + peer));}
+                }
+                _loss_pct = loss_pct;
+                _seed = seed;
+                return true;
+            }
+
+            void close() {
+                if (_fd >= 0) {::close(_fd);}
+                _fd = -1;
+            }
+
+            /* Wait up to timeout_us for a packet to arrive */
+            void wait(uint32_t timeout_us) {
+                pollfd fd = {_fd, POLLIN, 0};
+                timespec timeout = {0, (long) timeout_us * 1000};
+                ppoll(&fd, 1, &timeout, NULL);
+            }
+
+            uint32_t sent_qty() const {return _sent_qty;}
+            uint32_t dropped_qty() const {return _dropped_qty;}
+
+            bool ready() {return _fd >= 0;}
+
+            bool send(const uint8_t *buf, uint16_t len) {
+                for (const sockaddr_in &peer : _peers) {sendto(_fd, buf, len, 0, (const sockaddr *) &peer, sizeof(peer));}
+                _sent_qty++;
+                return true;
+            }
+
+            uint16_t receive(uint8_t *buf, uint16_t len) {
+                while (true) {
+                    ssize_t read = recv(_fd, buf, len, 0);
+                    if (read <= 0) {return 0;}
+
+                    _seed = _seed * 1103515245 + 12345;
+                    if ((_seed >> 16) % 100 < _loss_pct) {_dropped_qty++; continue;}
+                    return (uint16_t) read;
+                }
+            }
+
+        private:
+            static sockaddr_in loopback(uint16_t port) {
+                sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(port);
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                return addr;
+            }
+
+            int _fd = -1;
+            std::vector<sockaddr_in> _peers;
+            uint8_t _loss_pct = 0;
+            uint32_t _seed = 1;
+            uint32_t _sent_qty = 0;
+            uint32_t _dropped_qty = 0;
+    };
+#endif
@@ -0,0 +1,262 @@
+/*
+    pixel_node_test.cpp - host tool
+    Streams synthetic sACN (E1.31) / Art-Net universes over loopback UDP into lib/pixelNode,
+    and measures the receive path:
+        - packet-to-pixel latency: from sending the last universe of a frame until loop()
+          reports the complete frame (p50 / p99 / max)
+        - the highest frame rate at which (nearly) every frame is shown
+        - frame integrity: every frame shown must hold a single frame's pixels (no universe of
+          an older / newer frame mixed in) - checked on every frame
+
+    Every light of frame f is drawn as (f & 0xFF, f >> 8, light & 0xFF), so a shown frame can be
+    checked by looking at its lights.  Scenarios:
+        - E1.31 and Art-Net at increasing frame rates (and flat out)
+        - a lossy, reordering network: universes sent out of order within a frame, some held
+          back until after the next frame's copy (late - must be dropped), and some lost
+
+    Usage (built by 'build_host.sh'):
+        pixel_node_test [--leds N] [--seconds S] [--port P]
+
+    The exit code is 1 if a frame was torn, a late universe wasn't dropped, or the lights can't
+    keep up with 40 FPS.
+*/
+
+#include "host_libs.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define FIRST_UNIVERSE 1
+#define MIN_FPS 40                      //Slowest rate the receive path must sustain (a typical show controller rate)
+#define SHOWN_PCT 99                    //A rate is sustained if at least this share of its frames was shown
+
+struct testOptions {
+    uint16_t leds = 400;
+    double seconds = 1;
+    uint16_t port = 45568;
+} opt;
+
+/* Frame time stamps, shared with the sender thread */
+#define FRAME_RING 65536
+std::atomic<int64_t> sent_us[FRAME_RING];
+std::atomic<bool> sending;
+
+int64_t wall_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Universe 'idx' of frame 'frame' as an E1.31 / Art-Net datagram */
+std::vector<uint8_t> make_packet(bool artnet, uint32_t frame, uint8_t idx, uint8_t seq) {
+    uint16_t universe = FIRST_UNIVERSE + idx;
+    uint16_t first_led = idx * PIXEL_NODE_UNIVERSE_LEDS;
+    uint16_t led_qty = std::min<uint16_t>(PIXEL_NODE_UNIVERSE_LEDS, opt.leds - first_led);
+    uint16_t data_len = led_qty * 3;
+
+    std::vector<uint8_t> packet(artnet ? ARTNET_HEADER_LEN : E131_HEADER_LEN);
+    if (artnet) {
+        memcpy(&packet[0], "Art-Net", 8);
+        packet[9] = ARTNET_OP_DMX >> 8;
+        packet[11] = 14;
+        packet[12] = seq;
+        packet[14] = universe & 0xFF;
+        packet[15] = universe >> 8;
+        packet[16] = data_len >> 8;
+        packet[17] = data_len & 0xFF;
+    } else {
+        uint16_t len = E131_HEADER_LEN + data_len;
+        static const uint8_t acn_id[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+        packet[1] = 0x10;
+        memcpy(&packet[4], acn_id, sizeof(acn_id));
+        packet[16] = 0x70 | ((len - 16) >> 8); packet[17] = (len - 16) & 0xFF;
+        packet[21] = 0x04;
+        packet[38] = 0x70 | ((len - 38) >> 8); packet[39] = (len - 38) & 0xFF;
+        packet[43] = 0x02;
+        memcpy(&packet[44], "ghost pixel_node_test", 21);
+        packet[108] = 100;
+        packet[E131_SEQ_POS] = seq;
+        packet[E131_UNIVERSE_POS] = universe >> 8;
+        packet[E131_UNIVERSE_POS + 1] = universe & 0xFF;
+        packet[115] = 0x70 | ((len - 115) >> 8); packet[116] = (len - 115) & 0xFF;
+        packet[117] = 0x02;
+        packet[118] = 0xA1;
+        packet[122] = 0x01;
+        packet[E131_COUNT_POS] = (data_len + 1) >> 8;
+        packet[E131_COUNT_POS + 1] = (data_len + 1) & 0xFF;
+    }
+
+    for (uint16_t led = first_led; led < first_led + led_qty; led++) {
+        packet.push_back(frame & 0xFF);
+        packet.push_back(frame >> 8);
+        packet.push_back(led & 0xFF);
+    }
+    return packet;
+}
+
+/* Sender options for one scenario */
+struct scenario {
+    const char *name;
+    bool artnet;
+    double fps;                         //0 = flat out
+    uint8_t shuffle_pct;                //Frames whose universes are sent out of order
+    uint8_t late_pct;                   //Universes held back until after the next frame's copy
+    uint8_t loss_pct;                   //Universes lost
+};
+
+/* What the sender did */
+struct senderResult {
+    uint32_t frame_qty;
+    uint32_t late_qty;
+    uint32_t lost_qty;
+};
+
+void run_sender(const scenario &sc, senderResult *result) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int buf = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(sc.artnet ? opt.port + 1 : opt.port);
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    uint8_t universe_qty = pixelNode::universe_qty();
+    std::vector<uint8_t> seq(universe_qty, 0);
+    std::vector<std::vector<uint8_t>> held(universe_qty);
+    uint32_t seed = 12345;
+    auto chance = [&seed](uint8_t pct) {seed = seed * 1103515245 + 12345; return (seed >> 16) % 100 < pct;};
+
+    *result = {};
+    int64_t start_us = wall_us();
+    for (uint32_t frame = 0; wall_us() - start_us < opt.seconds * 1e6 && frame < FRAME_RING; frame++) {
+        if (sc.fps > 0) {
+            int64_t due_us = start_us + (int64_t) (frame * 1e6 / sc.fps);
+            while (wall_us() < due_us) {std::this_thread::yield();}
+        }
+
+        std::vector<uint8_t> order;
+        for (uint8_t idx = 0; idx < universe_qty; idx++) {order.push_back(idx);}
+        if (chance(sc.shuffle_pct)) {std::reverse(order.begin(), order.end());}
+
+        for (uint8_t idx : order) {
+            std::vector<uint8_t> packet = make_packet(sc.artnet, frame, idx, ++seq[idx]);
+            if (seq[idx] == 0 && sc.artnet) {packet[12] = seq[idx] = 1;}   //Art-Net sequence 0 means "not sequenced"
+            if (idx == order.back()) {sent_us[frame % FRAME_RING] = wall_us();}
+
+            if (chance(sc.loss_pct)) {result->lost_qty++; continue;}
+            if (held[idx].empty() && chance(sc.late_pct)) {held[idx] = packet; continue;}
+
+            sendto(fd, packet.data(), packet.size(), 0, (sockaddr *) &to, sizeof(to));
+            if (!held[idx].empty()) {
+                sendto(fd, held[idx].data(), held[idx].size(), 0, (sockaddr *) &to, sizeof(to));
+                held[idx].clear();
+                result->late_qty++;
+            }
+        }
+        result->frame_qty++;
+    }
+
+    close(fd);
+    sending = false;
+}
+
+/* Returns the frame the lights hold, or -1 if they hold more than one frame */
+int32_t shown_frame(const CRGB *leds) {
+    int32_t frame = leds[0].r | (leds[0].g << 8);
+    for (uint16_t led = 0; led < opt.leds; led++) {
+        if ((leds[led].r | (leds[led].g << 8)) != frame || leds[led].b != (led & 0xFF)) {return -1;}
+    }
+    return frame;
+}
+
+/* Run one scenario - returns false if a frame was torn / a late universe got through */
+bool run_scenario(const scenario &sc, CRGB *leds, double *shown_pct) {
+    /* Fresh sockets / sequence numbers for every scenario */
+    if (!pixelNode::begin(FIRST_UNIVERSE, opt.port, opt.port + 1)) {
+        fprintf(stderr, "unable to bind ports %u / %u\n", opt.port, opt.port + 1);
+        return false;
+    }
+    pixelNodeStats before = pixelNode::stats();
+    std::vector<double> latency;
+    uint32_t shown = 0, torn = 0;
+    senderResult sent;
+
+    sending = true;
+    std::thread sender(run_sender, sc, &sent);
+    int64_t idle_since = 0;
+    while (true) {
+        host::clock_us = wall_us();
+        if (pixelNode::loop()) {
+            int64_t now = wall_us();
+            int32_t frame = shown_frame(leds);
+            if (frame < 0) {torn++; continue;}
+            shown++;
+            latency.push_back(now - sent_us[frame % FRAME_RING]);
+            idle_since = 0;
+        } else if (!sending) {
+            /* Sender finished --> drain what's still in flight */
+            if (!idle_since) {idle_since = wall_us();}
+            if (wall_us() - idle_since > 50000) {break;}
+        }
+    }
+    sender.join();
+
+    pixelNodeStats after = pixelNode::stats();
+    uint32_t late = after.late_qty - before.late_qty;
+    uint32_t dropped = after.dropped_frame_qty - before.dropped_frame_qty;
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&latency](double p) {return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, (size_t) (latency.size() * p))];};
+
+    *shown_pct = 100.0 * shown / std::max(sent.frame_qty, 1U);
+    char rate[16];
+    snprintf(rate, sizeof(rate), sc.fps > 0 ? "%.0f FPS" : "flat out", sc.fps);
+    printf("%-24s %-8s %7.0f FPS sent, %6.2f%% shown, latency p50 %5.0f us, p99 %6.0f us, max %6.0f us | %u dropped, %u late, %u torn\n",
+           sc.name, rate, sent.frame_qty / opt.seconds, *shown_pct, pct(0.5), pct(0.99), latency.empty() ? 0.0 : latency.back(), dropped, late, torn);
+
+    return !torn && (!sc.late_pct || late == sent.late_qty);
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [--leds N] [--seconds S] [--port P]\n", exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--leds") && has_value) {opt.leds = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--seconds") && has_value) {opt.seconds = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--port") && has_value) {opt.port = atoi(argv[++arg]);}
+        else {return usage(argv[0]);}
+    }
+    opt.leds = constrain(opt.leds, 1, PIXEL_NODE_MAX_UNIVERSES * PIXEL_NODE_UNIVERSE_LEDS);
+    host::serial_out = NULL;
+
+    std::vector<CRGB> leds(opt.leds);
+    lightTools tools;
+    pixelNode node(leds.data(), opt.leds, &tools);
+    printf("%u lights in %u universes, %.1f s per run\n", opt.leds, pixelNode::universe_qty(), opt.seconds);
+
+    bool pass = true;
+    double shown_pct = 0, sustained_fps = 0;
+    for (double fps : {40.0, 100.0, 250.0, 500.0, 1000.0, 2000.0, 5000.0, 10000.0, 20000.0}) {
+        pass &= run_scenario({"E1.31", false, fps, 0, 0, 0}, leds.data(), &shown_pct);
+        if (fps > 0 && shown_pct >= SHOWN_PCT && fps > sustained_fps) {sustained_fps = fps;}
+    }
+    pass &= run_scenario({"Art-Net", true, 1000, 0, 0, 0}, leds.data(), &shown_pct);
+    pass &= run_scenario({"E1.31 reorder/late/loss", false, 500, 20, 5, 2}, leds.data(), &shown_pct);
+    pass &= run_scenario({"Art-Net reorder/late/loss", true, 500, 20, 5, 2}, leds.data(), &shown_pct);
+
+    printf("highest rate with %u%% of the frames shown: %.0f FPS\n", SHOWN_PCT, sustained_fps);
+    pass &= sustained_fps >= MIN_FPS;
+
+    pixelNode::end();
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,430 @@
+/*
+    profile_report.cpp - host tool
+    Turns the samples of lib/sampleProfiler ("profile dump" on the ghost's console) into a report,
+    symbolized against the firmware ELF with addr2line:
+        - folded stacks, one "caller;function count" line each - the input of flamegraph.pl,
+          speedscope, ... (e.g. 'flamegraph.pl profile.folded > profile.svg')
+        - or a flat report: the share of the samples per function, with its main callers
+
+    Usage (built by 'build_host.sh'):
+        profile_report [options] <console log | ->     a log holding a dump (the other lines are ignored)
+        profile_report [options] --port DEV             profile the ghost over its serial port ("profile start", wait, "profile dump")
+            --elf FILE          firmware ELF (default .pio/build/esp32doit-devkit-v1/firmware.elf)
+            --addr2line CMD     addr2line of the firmware's toolchain (default: xtensa-esp32-elf-addr2line from
+                                PlatformIO's toolchain, else the one in the PATH)
+            --top N             flat report of the N busiest functions, instead of folded stacks
+            --baud N            with --port: serial port speed (default 115200)
+            --hz R              with --port: sampling rate (default PROFILER_DEFAULT_HZ)
+            --seconds S         with --port: time to sample (default 1 - the ghost keeps the last PROFILER_SAMPLE_QTY samples)
+            --save FILE         with --port: save the dump, to report on it again later
+        profile_report --selftest   profile a known workload on the host (SIGPROF backend), and check the
+                                    report finds it, at the expected share / rate / overhead
+
+    Examples:
+        profile_report --port /dev/ttyUSB0 --top 20
+        profile_report --port /dev/ttyUSB0 --seconds 1 > ghost.folded && flamegraph.pl ghost.folded > ghost.svg
+        profile_report --elf .pio/build/esp32doit-devkit-v1/firmware.elf console.log
+
+    The exit code is 1 if the self test failed.
+*/
+
+#include "host_libs.h"
+#include "host_serial.h"
+#include <algorithm>
+#include <errno.h>
+#include <map>
+#include <poll.h>
+#include <set>
+#include <string>
+#include <time.h>
+#include <vector>
+
+lightTools lightTools;
+
+/* A dump of lib/sampleProfiler */
+struct profileEntry {
+    uint32_t count;
+    uintptr_t pc;
+    uintptr_t caller;
+};
+
+struct profileDump {
+    bool found = false;
+    uint32_t rate_hz = 0;
+    uintptr_t base = 0;
+    std::vector<profileEntry> entries;
+
+    /* Parse one line of a console log - returns true once it was the status line ending a dump */
+    bool parse_line(const std::string &line) {
+        unsigned rate = 0, samples = 0, total = 0;
+        unsigned long base_addr = 0;
+        if (sscanf(line.c_str(), "# profile rate_hz=%u samples=%u total=%u base=%lx", &rate, &samples, &total, &base_addr) == 4) {
+            found = true;
+            rate_hz = rate;
+            base = base_addr;
+            entries.clear();
+            return false;
+        }
+
+        unsigned count = 0;
+        unsigned long pc = 0, caller = 0;
+        char rest = 0;
+        if (found && sscanf(line.c_str(), "%u %lx %lx%c", &count, &pc, &caller, &rest) == 3) {
+            entries.push_back({count, (uintptr_t) pc, (uintptr_t) caller});
+            return false;
+        }
+        return found && line.find("\"overhead_pct\"") != std::string::npos;
+    }
+
+    uint32_t sample_qty() const {
+        uint32_t qty = 0;
+        for (const profileEntry &entry : entries) {qty += entry.count;}
+        return qty;
+    }
+};
+
+/* Resolves addresses to function names with addr2line */
+class symbolizer {
+    public:
+        std::string addr2line;
+        std::string elf;
+        uintptr_t base = 0;
+
+        /* Look up every address at once (addr2line is started once per batch, not per address) */
+        void resolve(const std::set<uintptr_t> &addresses) {
+            std::vector<uintptr_t> batch;
+            for (uintptr_t addr : addresses) {
+                if (addr && !_names.count(addr)) {batch.push_back(addr);}
+                if (batch.size() == 200) {run(batch);}
+            }
+            run(batch);
+        }
+
+        std::string name(uintptr_t addr) const {
+            auto found = _names.find(addr);
+            return found == _names.end() ? hex(addr) : found->second;
+        }
+
+        static std::string hex(uintptr_t addr) {
+            char buf[24];
+            snprintf(buf, sizeof(buf), "0x%lx", (unsigned long) addr);
+            return buf;
+        }
+
+    private:
+        std::map<uintptr_t, std::string> _names;
+
+        void run(std::vector<uintptr_t> &batch) {
+            if (batch.empty()) {return;}
+            std::string command = addr2line + " -f -C -e '" + elf + "'";
+            for (uintptr_t addr : batch) {command += " " + hex(addr - base);}
+
+            FILE *pipe = popen(command.c_str(), "r");
+            char function[4096], location[4096];
+            for (uintptr_t addr : batch) {
+                if (!pipe || !fgets(function, sizeof(function), pipe) || !fgets(location, sizeof(location), pipe)) {break;}
+                std::string name = function;
+                while (!name.empty() && (name.back() == '\n' || name.back() == '\r')) {name.pop_back();}
+                _names[addr] = (name.empty() || name == "??") ? hex(addr) : strip_arguments(name);
+            }
+            if (pipe) {pclose(pipe);}
+            batch.clear();
+        }
+
+        /* "lightTools::fadeToColor(CRGB, CRGB, unsigned char)" -> "lightTools::fadeToColor" */
+        static std::string strip_arguments(const std::string &name) {
+            if (name.empty() || name.back() != ')') {return name;}
+            int depth = 0;
+            for (size_t pos = name.size(); pos-- > 0;) {
+                if (name[pos] == ')') {depth++;}
+                if (name[pos] == '(' && !--depth) {return pos ? name.substr(0, pos) : name;}
+            }
+            return name;
+        }
+};
+
+/* Report options */
+struct reportOptions {
+    const char *input = NULL;
+    const char *port = NULL;
+    std::string elf = ".pio/build/esp32doit-devkit-v1/firmware.elf";
+    std::string addr2line;
+    uint32_t top = 0;
+    uint32_t baud = 115200;
+    uint32_t hz = PROFILER_DEFAULT_HZ;
+    double seconds = 1;
+    const char *save = NULL;
+} opt;
+
+/* addr2line of PlatformIO's ESP32 toolchain if it's there, else the one in the PATH */
+std::string default_addr2line() {
+    const char *home = getenv("HOME");
+    std::string pio = std::string(home ? home : "") + "/.platformio/packages/toolchain-xtensa-esp32/bin/xtensa-esp32-elf-addr2line";
+    if (!access(pio.c_str(), X_OK)) {return pio;}
+    if (!system("command -v xtensa-esp32-elf-addr2line >/dev/null 2>&1")) {return "xtensa-esp32-elf-addr2line";}
+    return "addr2line";
+}
+
+/* Samples per (caller, function) name - names are resolved once per address */
+std::map<std::pair<std::string, std::string>, uint32_t> fold(const profileDump &dump, symbolizer &symbols) {
+    std::set<uintptr_t> addresses;
+    for (const profileEntry &entry : dump.entries) {
+        addresses.insert(entry.pc);
+        addresses.insert(entry.caller);
+    }
+    symbols.resolve(addresses);
+
+    std::map<std::pair<std::string, std::string>, uint32_t> stacks;
+    for (const profileEntry &entry : dump.entries) {
+        stacks[{entry.caller ? symbols.name(entry.caller) : "", symbols.name(entry.pc)}] += entry.count;
+    }
+    return stacks;
+}
+
+/* Folded stacks, busiest first */
+void print_folded(const std::map<std::pair<std::string, std::string>, uint32_t> &stacks, FILE *out) {
+    std::vector<std::pair<uint32_t, std::string>> lines;
+    for (const auto &stack : stacks) {
+        lines.push_back({stack.second, stack.first.first.empty() ? stack.first.second : stack.first.first + ";" + stack.first.second});
+    }
+    std::sort(lines.begin(), lines.end(), [](const std::pair<uint32_t, std::string> &a, const std::pair<uint32_t, std::string> &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (const auto &line : lines) {fprintf(out, "%s %u\n", line.second.c_str(), line.first);}
+}
+
+/* Flat report - samples per function, with its main callers */
+void print_top(const std::map<std::pair<std::string, std::string>, uint32_t> &stacks, uint32_t qty, uint32_t total, uint32_t rate_hz, FILE *out) {
+    std::map<std::string, uint32_t> self;
+    std::map<std::string, std::vector<std::pair<uint32_t, std::string>>> callers;
+    for (const auto &stack : stacks) {
+        self[stack.first.second] += stack.second;
+        if (!stack.first.first.empty()) {callers[stack.first.second].push_back({stack.second, stack.first.first});}
+    }
+    std::vector<std::pair<uint32_t, std::string>> functions;
+    for (const auto &function : self) {functions.push_back({function.second, function.first});}
+    std::sort(functions.rbegin(), functions.rend());
+
+    fprintf(out, "%u samples at %u Hz (%.2f s)\n", total, rate_hz, rate_hz ? (double) total / rate_hz : 0.0);
+    for (uint32_t idx = 0; idx < functions.size() && idx < qty; idx++) {
+        fprintf(out, "%6.1f%% %7u  %s\n", 100.0 * functions[idx].first / total, functions[idx].first, functions[idx].second.c_str());
+        std::vector<std::pair<uint32_t, std::string>> &from = callers[functions[idx].second];
+        std::sort(from.rbegin(), from.rend());
+        for (uint32_t caller = 0; caller < from.size() && caller < 3; caller++) {
+            fprintf(out, "%17s %5.1f%% from %s\n", "", 100.0 * from[caller].first / functions[idx].first, from[caller].second.c_str());
+        }
+    }
+}
+
+int report(const profileDump &dump) {
+    if (!dump.found) {fprintf(stderr, "no profile dump found (\"profile dump\" on the ghost's console)\n"); return 1;}
+    if (access(opt.elf.c_str(), R_OK)) {fprintf(stderr, "can't read %s - the addresses are left as they are\n", opt.elf.c_str());}
+
+    symbolizer symbols;
+    symbols.addr2line = opt.addr2line;
+    symbols.elf = opt.elf;
+    symbols.base = dump.base;
+    auto stacks = fold(dump, symbols);
+    if (opt.top) {
+        print_top(stacks, opt.top, dump.sample_qty(), dump.rate_hz, stdout);
+    } else {
+        print_folded(stacks, stdout);
+    }
+    return 0;
+}
+
+/* Read a console log, up to the end of the last dump */
+int report_file() {
+    FILE *in = strcmp(opt.input, "-") ? fopen(opt.input, "r") : stdin;
+    if (!in) {fprintf(stderr, "can't open %s\n", opt.input); return 1;}
+
+    profileDump dump, last;
+    char line[512];
+    while (fgets(line, sizeof(line), in)) {
+        std::string text = line;
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {text.pop_back();}
+        if (dump.parse_line(text)) {last = dump;}
+    }
+    if (in != stdin) {fclose(in);}
+    return report(last.found ? last : dump);
+}
+
+/* Profile the ghost over its serial port */
+int report_port() {
+    int fd = open(opt.port, O_RDWR | O_NOCTTY);
+    if (fd < 0) {fprintf(stderr, "can't open %s: %s\n", opt.port, strerror(errno)); return 1;}
+    if (!host::serial_set_baud(fd, opt.baud)) {fprintf(stderr, "can't set %s to %u baud\n", opt.port, opt.baud); return 1;}
+    tcflush(fd, TCIFLUSH);
+
+    host::serial_command(fd, "profile start " + std::to_string(opt.hz));
+    usleep((useconds_t) (opt.seconds * 1e6));
+    tcflush(fd, TCIFLUSH);
+    host::serial_command(fd, "profile dump");
+
+    /* Read lines until the status line after the dump (or nothing came for a while) */
+    FILE *save = opt.save ? fopen(opt.save, "w") : NULL;
+    profileDump dump;
+    std::string line;
+    bool done = false;
+    pollfd poll_fd = {fd, POLLIN, 0};
+    while (!done && poll(&poll_fd, 1, 5000) > 0) {
+        char buf[512];
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) {break;}
+        for (ssize_t pos = 0; pos < len && !done; pos++) {
+            if (buf[pos] != '\n') {
+                if (buf[pos] != '\r') {line += buf[pos];}
+                continue;
+            }
+            if (save) {fprintf(save, "%s\n", line.c_str());}
+            done = dump.parse_line(line);
+            line.clear();
+        }
+    }
+    if (save) {fclose(save);}
+    close(fd);
+    if (!done) {fprintf(stderr, "the dump didn't end (timeout) - reporting what was received\n");}
+    return report(dump);
+}
+
+/* ----------------------------------- Self test ----------------------------------- */
+
+int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, "FAIL: " __VA_ARGS__); fprintf(stderr, "\n"); } } while (0)
+
+volatile uint32_t sink;
+
+double now_s() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* The known workload: 3/4 of the time in selftest_hot, 1/4 in selftest_cold */
+__attribute__((noinline)) void selftest_spin(double seconds, uint32_t seed) {
+    double end = now_s() + seconds;
+    uint32_t x = seed;
+    while (true) {
+        for (uint32_t step = 0; step < 2000; step++) {x = x * 1664525 + 1013904223;}
+        if (now_s() >= end) {break;}
+    }
+    sink = x;
+}
+
+__attribute__((noinline)) void selftest_hot(double seconds) {
+    double end = now_s() + seconds;
+    CRGB a = CRGB::Red;
+    while (true) {
+        for (uint16_t step = 0; step < 2000; step++) {a = lightTools.fadeToColor(a, CRGB(step, 255 - step, 7), 3);}
+        if (now_s() >= end) {break;}
+    }
+    sink = a.r;
+}
+
+__attribute__((noinline)) void selftest_cold(double seconds) {
+    selftest_spin(seconds, 7);
+}
+
+std::vector<std::string> dump_lines;
+
+profileDump profile_workload(uint32_t rate_hz, double seconds, double *elapsed) {
+    CHECK(sampleProfiler::begin(rate_hz), "begin(%u) failed", rate_hz);
+    double start = now_s();
+    while (now_s() - start < seconds) {
+        selftest_hot(0.003);
+        selftest_cold(0.001);
+    }
+    *elapsed = now_s() - start;
+
+    dump_lines.clear();
+    sampleProfiler::dump([](const char *line) {dump_lines.push_back(line);});
+    CHECK(!sampleProfiler::running(), "still sampling after dump()");
+
+    /* Through the text format, like a console log */
+    profileDump dump;
+    for (const std::string &line : dump_lines) {dump.parse_line(line);}
+    return dump;
+}
+
+int selftest() {
+    CHECK(!sampleProfiler::begin(0) && !sampleProfiler::begin(PROFILER_MAX_HZ + 1), "out of range rates must be refused");
+
+    /* The workload at the default rate */
+    double elapsed = 0;
+    profileDump dump = profile_workload(PROFILER_DEFAULT_HZ, 0.8, &elapsed);
+    uint32_t qty = dump.sample_qty();
+    double expected = elapsed * PROFILER_DEFAULT_HZ;
+    CHECK(dump.found && qty == sampleProfiler::sample_qty(), "dump: %u samples, %u in the profiler", qty, sampleProfiler::sample_qty());
+    CHECK(qty > expected * 0.75 && qty < expected * 1.25, "%u samples in %.2f s at %u Hz", qty, elapsed, PROFILER_DEFAULT_HZ);
+
+    char exe[4096] = "";
+    ssize_t exe_len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (exe_len > 0) {exe[exe_len] = 0;}
+    symbolizer symbols;
+    symbols.addr2line = opt.addr2line;
+    symbols.elf = exe;
+    symbols.base = dump.base;
+    auto stacks = fold(dump, symbols);
+
+    std::map<std::string, uint32_t> self;
+    for (const auto &stack : stacks) {self[stack.first.second] += stack.second;}
+    uint32_t hot = self["selftest_hot"] + self["lightTools::fadeToColor"];
+    uint32_t cold = self["selftest_spin"] + self["selftest_cold"];
+    double hot_share = (double) hot / std::max(1u, hot + cold);
+    printf("%u samples in %.2f s (%.0f expected): selftest_hot %u, selftest_cold %u (%.0f%% hot, 75%% expected), %u elsewhere\n",
+           qty, elapsed, expected, hot, cold, 100 * hot_share, qty - hot - cold);
+    CHECK(hot + cold > qty * 0.8, "only %u of %u samples symbolized to the workload", hot + cold, qty);
+    CHECK(hot_share > 0.65 && hot_share < 0.85, "%.0f%% of the workload samples in selftest_hot (75%% expected)", 100 * hot_share);
+
+    float overhead = sampleProfiler::overhead_pct();
+    printf("overhead at %u Hz: %.2f%% (estimate)\n", PROFILER_DEFAULT_HZ, overhead);
+    CHECK(overhead < 2.0f, "overhead %.2f%% at the default rate", overhead);
+
+    /* The flat report / folded stacks of the same samples */
+    print_top(stacks, 5, qty, dump.rate_hz, stdout);
+
+    /* More samples than the ring buffer holds - the most recent ones are kept */
+    dump = profile_workload(PROFILER_MAX_HZ, 0.25, &elapsed);
+    CHECK(sampleProfiler::sample_qty() == PROFILER_SAMPLE_QTY && sampleProfiler::total_qty() > PROFILER_SAMPLE_QTY && dump.sample_qty() == PROFILER_SAMPLE_QTY,
+          "ring buffer: %u samples kept of %u", sampleProfiler::sample_qty(), sampleProfiler::total_qty());
+    printf("at %u Hz: %u samples taken in %.2f s, the last %u kept, overhead %.2f%% (estimate)\n",
+           PROFILER_MAX_HZ, sampleProfiler::total_qty(), elapsed, sampleProfiler::sample_qty(), sampleProfiler::overhead_pct());
+
+    printf(failures ? "FAIL: %d check(s) failed\n" : "PASS\n", failures);
+    return failures ? 1 : 0;
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [--elf FILE] [--addr2line CMD] [--top N] <console log | ->\n"
+                    "       %s [--elf FILE] [--addr2line CMD] [--top N] --port DEV [--baud N] [--hz R] [--seconds S] [--save FILE]\n"
+                    "       %s --selftest\n", exe, exe, exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    bool run_selftest = false;
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--selftest")) {run_selftest = true;}
+        else if (!strcmp(argv[arg], "--elf") && has_value) {opt.elf = argv[++arg];}
+        else if (!strcmp(argv[arg], "--addr2line") && has_value) {opt.addr2line = argv[++arg];}
+        else if (!strcmp(argv[arg], "--top") && has_value) {opt.top = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--port") && has_value) {opt.port = argv[++arg];}
+        else if (!strcmp(argv[arg], "--baud") && has_value) {opt.baud = atol(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--hz") && has_value) {opt.hz = atol(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--seconds") && has_value) {opt.seconds = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--save") && has_value) {opt.save = argv[++arg];}
+        else if (argv[arg][0] != '-' || !strcmp(argv[arg], "-")) {opt.input = argv[arg];}
+        else {return usage(argv[0]);}
+    }
+
+    if (run_selftest) {
+        /* The host executable is symbolized with the host's addr2line */
+        if (opt.addr2line.empty()) {opt.addr2line = "addr2line";}
+        return selftest();
+    }
+    if (opt.addr2line.empty()) {opt.addr2line = default_addr2line();}
+    if (opt.port) {return report_port();}
+    if (!opt.input) {return usage(argv[0]);}
+    return report_file();
+}
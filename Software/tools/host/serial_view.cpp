@@ -0,0 +1,600 @@
+/*
+    serial_view.cpp - host tool
+    Decodes the binary frame stream of lib/frameStream (COBS framed packets, mixed in with the
+    ghost's log text on the serial port) - from the ghost's serial port, a capture file, or the
+    host simulator ('simulator --stream FILE'):
+        - a live terminal view: the log text scrolls, with the latest frame drawn below it
+        - a PPM stream (one image per video frame, resampled on the frames' timestamps - e.g.
+          piped into ffmpeg to make a video)
+        - a timing report: frames received / skipped by the ghost, frame interval and render
+          time percentiles, bytes per frame - to compare the real device against the simulator
+
+    Turn the stream on from the ghost's console first ("stream on", "stream raw" for
+    uncompressed frames, "stream on 921600" to speed up the port) - or let '--start' do it.
+
+    Usage (built by 'build_host.sh'):
+        serial_view [options] <serial device | capture file | ->
+            --baud N            serial port speed (default 115200)
+            --start [BAUD]      send "stream on [BAUD]" to the ghost first (then switch the port to BAUD), and "stream off" at the end
+            --raw               with --start: ask for uncompressed frames ("stream raw")
+            --capture FILE      save everything received to FILE (to replay it later)
+            --ansi              live terminal view (the default, unless --ppm writes to stdout)
+            --no-ansi           no terminal view (e.g. only --stats)
+            --no-text           drop the log text
+            --ppm FILE          write the frames as a PPM stream ('-' for stdout)
+            --fps F             PPM frames per second (default 30)
+            --scale N           PPM pixels per light (default 4)
+            --stats             print the timing report at the end (Ctrl+C ends a live capture)
+        serial_view --selftest  round trip the stream through a modeled UART (bandwidth limited, with
+                                log text in between, a late start and a corrupted packet), and check
+                                every frame decodes to the lights it was sent from
+
+    Examples:
+        serial_view --start 921600 --stats /dev/ttyUSB0
+        serial_view --no-ansi --ppm - capture.bin | ffmpeg -f image2pipe -c:v ppm -r 30 -i - ghost.mp4
+        simulator --seconds 60 --stream sim.bin && serial_view --no-ansi --stats sim.bin
+
+    The exit code is 1 if the self test failed.
+*/
+
+#include "host_libs.h"
+#include "host_serial.h"
+#include <algorithm>
+#include <errno.h>
+#include <functional>
+#include <map>
+#include <signal.h>
+#include <string>
+#include <vector>
+
+lightTools lightTools;
+
+/* One frame decoded from the stream */
+struct streamFrame {
+    uint8_t flags;
+    uint16_t seq;
+    uint16_t ref;
+    uint32_t time_us;
+    uint32_t render_us;
+    uint32_t wire_len;                              //Bytes on the wire (COBS + delimiters)
+    const std::vector<CRGB> *lights;
+};
+
+/* Splits the serial data into log text and frame packets, and decodes the frames */
+class streamDecoder {
+    public:
+        std::function<void(const std::string &line)> on_text;          //One line of log text (without the line end)
+        std::function<void(const streamFrame &frame)> on_frame;
+
+        uint32_t frame_qty = 0;
+        uint32_t bad_qty = 0;                       //Packets with a bad CRC / that didn't decode
+        uint32_t waiting_qty = 0;                   //Delta frames dropped (their reference was missed) until the next key frame
+        uint32_t gap_qty = 0;                       //Frames the ghost skipped (gaps in seq)
+        uint64_t byte_qty = 0;
+
+        void feed(const uint8_t *data, size_t len) {
+            for (size_t pos = 0; pos < len; pos++) {feed(data[pos]);}
+            byte_qty += len;
+        }
+
+        void feed(uint8_t byte) {
+            if (!_in_packet) {
+                if (byte) {text(byte);} else {_in_packet = true;}
+                return;
+            }
+            if (byte) {
+                _buf.push_back(byte);
+                if (_buf.size() > FRAME_STREAM_OUT_LEN) {          //Too long for a packet - it was text
+                    for (uint8_t c : _buf) {text(c);}
+                    _buf.clear();
+                    _in_packet = false;
+                }
+                return;
+            }
+
+            /* A delimiter: back to back ones are a packet end + the next start */
+            if (_buf.empty()) {return;}
+            if (packet()) {
+                _in_packet = false;
+            } else {
+                /* Not a packet - it was text between a packet end and this delimiter, which starts the next packet */
+                for (uint8_t c : _buf) {text(c);}
+            }
+            _buf.clear();
+        }
+
+        /* Pass on the text not ended by a line end yet */
+        void flush() {
+            if (!_line.empty() && on_text) {on_text(_line);}
+            _line.clear();
+        }
+
+    private:
+        bool _in_packet = false;
+        std::vector<uint8_t> _buf;
+        std::string _line;
+        std::vector<CRGB> _lights;
+        bool _have_ref = false;
+        uint16_t _ref_seq = 0;                      //seq of the frame in _lights
+        uint16_t _last_seq = 0;
+        bool _have_seq = false;
+
+        void text(uint8_t c) {
+            if (c == '\n') {
+                if (!_line.empty() && _line.back() == '\r') {_line.pop_back();}
+                if (on_text) {on_text(_line);}
+                _line.clear();
+            } else {
+                _line += (char) c;
+            }
+        }
+
+        /* Decode the packet in _buf - returns false if it isn't one (text) */
+        bool packet() {
+            uint8_t packet[FRAME_STREAM_PACKET_LEN];
+            int32_t len = frameStream::cobs_decode(_buf.data(), _buf.size(), packet, sizeof(packet));
+            if (len < FRAME_STREAM_HEADER_LEN + FRAME_STREAM_CRC_LEN || packet[0] != FRAME_STREAM_TYPE_FRAME) {return false;}
+            if (frameStream::crc16(packet, len - 2) != (packet[len - 2] | (packet[len - 1] << 8))) {
+                bad_qty++;
+                return true;
+            }
+
+            streamFrame frame;
+            frame.flags = packet[1];
+            frame.seq = packet[2] | (packet[3] << 8);
+            frame.ref = packet[4] | (packet[5] << 8);
+            frame.time_us = frame.render_us = 0;
+            for (uint8_t byte = 0; byte < 4; byte++) {
+                frame.time_us |= (uint32_t) packet[6 + byte] << (8 * byte);
+                frame.render_us |= (uint32_t) packet[10 + byte] << (8 * byte);
+            }
+            uint16_t led_qty = packet[14] | (packet[15] << 8);
+            frame.wire_len = _buf.size() + 2;
+            frame.lights = &_lights;
+
+            if (_have_seq && frame.seq != (uint16_t) (_last_seq + 1)) {gap_qty += (uint16_t) (frame.seq - _last_seq - 1);}
+            _have_seq = true;
+            _last_seq = frame.seq;
+
+            /* A delta needs the frame it was made against */
+            bool key = frame.flags & FRAME_STREAM_KEY;
+            if (!key && (!_have_ref || frame.ref != _ref_seq || led_qty != _lights.size())) {
+                waiting_qty++;
+                return true;
+            }
+            if (key) {_lights.assign(led_qty, CRGB::Black);}
+
+            const uint8_t *data = &packet[FRAME_STREAM_HEADER_LEN];
+            size_t data_len = len - FRAME_STREAM_HEADER_LEN - FRAME_STREAM_CRC_LEN;
+            bool valid = (frame.flags & FRAME_STREAM_RAW) ? raw_frame(data, data_len) : decode_frame(data, data_len);
+            _have_ref = valid;
+            if (!valid) {
+                bad_qty++;
+                return true;
+            }
+            _ref_seq = frame.seq;
+
+            frame_qty++;
+            if (on_frame) {on_frame(frame);}
+            return true;
+        }
+
+        bool raw_frame(const uint8_t *data, size_t len) {
+            if (len != _lights.size() * 3) {return false;}
+            for (size_t idx = 0; idx < _lights.size(); idx++) {_lights[idx] = CRGB(data[idx * 3], data[idx * 3 + 1], data[idx * 3 + 2]);}
+            return true;
+        }
+
+        /* framePlayer's frame format (see framePlayer.h) */
+        bool decode_frame(const uint8_t *data, size_t len) {
+            size_t pos = 0, idx = 0;
+            while (pos < len) {
+                uint8_t cmd = data[pos++];
+                if (cmd == FRAME_CMD_END) {return pos == len && idx == _lights.size();}
+                size_t qty = (cmd & FRAME_CMD_QTY_MASK) + 1;
+                if (cmd == FRAME_CMD_LONG_SKIP) {
+                    if (pos + 2 > len) {return false;}
+                    idx += data[pos] | (data[pos + 1] << 8);
+                    pos += 2;
+                } else if (cmd < FRAME_CMD_RUN) {
+                    idx += qty;
+                } else if (cmd < FRAME_CMD_COPY) {
+                    if (pos + 3 > len) {return false;}
+                    for (size_t end = idx + qty; idx < end && idx < _lights.size(); idx++) {_lights[idx] = CRGB(data[pos], data[pos + 1], data[pos + 2]);}
+                    pos += 3;
+                } else {
+                    if (pos + qty * 3 > len) {return false;}
+                    for (size_t end = idx + qty; idx < end && idx < _lights.size(); idx++, pos += 3) {_lights[idx] = CRGB(data[pos], data[pos + 1], data[pos + 2]);}
+                }
+                if (idx > _lights.size()) {return false;}
+            }
+            return false;
+        }
+};
+
+/* Frame timing collected for the report */
+struct streamTiming {
+    std::vector<uint32_t> interval_us;
+    std::vector<uint32_t> render_us;
+    uint64_t wire_qty = 0;
+    uint32_t key_qty = 0;
+    uint32_t text_qty = 0;
+    uint64_t first_us = 0;
+    uint64_t last_us = 0;                           //Unwrapped (time_us wraps every ~71 minutes)
+    uint32_t last_time_us = 0;
+    uint32_t frame_qty = 0;
+
+    void add(const streamFrame &frame) {
+        if (frame_qty) {
+            uint32_t interval = frame.time_us - last_time_us;
+            interval_us.push_back(interval);
+            last_us += interval;
+        } else {
+            first_us = last_us = frame.time_us;
+        }
+        last_time_us = frame.time_us;
+        render_us.push_back(frame.render_us);
+        wire_qty += frame.wire_len;
+        if (frame.flags & FRAME_STREAM_KEY) {key_qty++;}
+        frame_qty++;
+    }
+
+    static uint32_t percentile(std::vector<uint32_t> values, double pct) {
+        if (values.empty()) {return 0;}
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t) (pct / 100.0 * values.size()))];
+    }
+
+    void report(const streamDecoder &decoder, FILE *out) const {
+        double seconds = (last_us - first_us) / 1e6;
+        fprintf(out, "frames: %u received (%u key) over %.1f s - %.1f FPS received\n",
+                frame_qty, key_qty, seconds, seconds > 0 ? (frame_qty - 1) / seconds : 0.0);
+        fprintf(out, "        %u missing (skipped by the ghost for lack of room on the link, or lost), %u dropped waiting for a key frame, %u bad packets\n",
+                decoder.gap_qty, decoder.waiting_qty, decoder.bad_qty);
+        fprintf(out, "interval: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                percentile(interval_us, 50) / 1e3, percentile(interval_us, 99) / 1e3, percentile(interval_us, 100) / 1e3);
+        fprintf(out, "render:   p50 %u us, p99 %u us, max %u us\n",
+                percentile(render_us, 50), percentile(render_us, 99), percentile(render_us, 100));
+        fprintf(out, "link:     %.0f bytes per frame, %llu bytes total (%u lines of text)\n",
+                frame_qty ? (double) wire_qty / frame_qty : 0.0, (unsigned long long) decoder.byte_qty, text_qty);
+    }
+};
+
+/* Viewer options / state */
+struct viewOptions {
+    const char *input = NULL;
+    uint32_t baud = 115200;
+    bool start = false;
+    uint32_t start_baud = 0;
+    bool raw = false;
+    FILE *capture = NULL;
+    bool ansi = true;
+    bool text = true;
+    FILE *ppm = NULL;
+    double fps = 30;
+    uint32_t scale = 4;
+    bool stats = false;
+} opt;
+
+volatile sig_atomic_t stop_requested = 0;
+
+/* Live terminal view - the log text scrolls, the latest frame stays on the last line */
+std::string frame_line;
+
+void draw_frame_line() {
+    fputs(frame_line.c_str(), stdout);
+    fflush(stdout);
+}
+
+void show_text(const std::string &line) {
+    std::string clean;
+    for (char c : line) {clean += (c >= ' ' || c == '\t') ? c : '.';}
+    if (opt.ansi) {
+        printf("\r\x1b[K%s\n", clean.c_str());
+        draw_frame_line();
+    } else {
+        fprintf(stderr, "%s\n", clean.c_str());
+    }
+}
+
+void show_frame(const streamFrame &frame, double fps) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "\r%10.3f s %5.1f FPS %5u us ", frame.time_us / 1e6, fps, frame.render_us);
+    frame_line = buf;
+    for (const CRGB &c : *frame.lights) {
+        snprintf(buf, sizeof(buf), "\x1b[38;2;%u;%u;%um█", c.r, c.g, c.b);
+        frame_line += buf;
+    }
+    frame_line += "\x1b[0m";
+    draw_frame_line();
+}
+
+/* PPM stream, resampled at opt.fps on the frames' timestamps */
+struct ppmWriter {
+    std::vector<CRGB> lights;
+    std::vector<uint8_t> image;
+    uint64_t next_us = 0;
+    uint64_t now_us = 0;
+    uint32_t last_time_us = 0;
+    bool started = false;
+
+    void write_image() {
+        uint32_t width = lights.size() * opt.scale;
+        image.resize((size_t) width * opt.scale * 3);
+        for (uint32_t y = 0; y < opt.scale; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                const CRGB &c = lights[x / opt.scale];
+                uint8_t *px = &image[((size_t) y * width + x) * 3];
+                px[0] = c.r; px[1] = c.g; px[2] = c.b;
+            }
+        }
+        fprintf(opt.ppm, "P6\n%u %u\n255\n", width, opt.scale);
+        fwrite(image.data(), 1, image.size(), opt.ppm);
+    }
+
+    /* Every video frame up to this frame's time shows the previous frame */
+    void add(const streamFrame &frame) {
+        if (started) {
+            now_us += (uint32_t) (frame.time_us - last_time_us);
+            if (lights.size() == frame.lights->size()) {
+                for (; next_us <= now_us; next_us += (uint64_t) (1e6 / opt.fps)) {write_image();}
+            }
+        }
+        started = true;
+        last_time_us = frame.time_us;
+        lights = *frame.lights;
+    }
+
+    void finish() {
+        if (started) {write_image();}
+    }
+};
+
+int view() {
+    int fd = strcmp(opt.input, "-") ? open(opt.input, O_RDWR | O_NOCTTY) : STDIN_FILENO;
+    if (fd < 0) {fd = open(opt.input, O_RDONLY | O_NOCTTY);}
+    if (fd < 0) {fprintf(stderr, "can't open %s: %s\n", opt.input, strerror(errno)); return 1;}
+    bool serial_port = isatty(fd);
+    if (serial_port && !host::serial_set_baud(fd, opt.baud)) {fprintf(stderr, "can't set %s to %u baud\n", opt.input, opt.baud); return 1;}
+
+    if (opt.start) {
+        if (!serial_port) {fprintf(stderr, "--start needs a serial port\n"); return 2;}
+        std::string command = opt.raw ? "stream raw" : "stream on";
+        if (opt.start_baud) {command += " " + std::to_string(opt.start_baud);}
+        host::serial_command(fd, command);
+        if (opt.start_baud) {
+            usleep(100000);                         //The ghost replies at the old speed, then switches
+            if (!host::serial_set_baud(fd, opt.start_baud)) {fprintf(stderr, "can't set %s to %u baud\n", opt.input, opt.start_baud); return 1;}
+        }
+    }
+
+    streamDecoder decoder;
+    streamTiming timing;
+    ppmWriter ppm;
+    decoder.on_text = [&](const std::string &line) {
+        timing.text_qty++;
+        if (opt.text) {show_text(line);}
+    };
+    decoder.on_frame = [&](const streamFrame &frame) {
+        uint32_t interval = timing.frame_qty ? frame.time_us - timing.last_time_us : 0;
+        timing.add(frame);
+        if (opt.ansi) {show_frame(frame, interval ? 1e6 / interval : 0.0);}
+        if (opt.ppm) {ppm.add(frame);}
+    };
+
+    /* Ctrl+C ends a live capture (the report is still printed) */
+    struct sigaction action = {};
+    action.sa_handler = [](int) {stop_requested = 1;};
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    uint8_t buf[4096];
+    while (!stop_requested) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len < 0 && errno == EINTR) {continue;}
+        if (len <= 0) {break;}
+        if (opt.capture) {fwrite(buf, 1, len, opt.capture);}
+        decoder.feed(buf, len);
+    }
+    decoder.flush();
+    if (opt.ansi) {fputs("\n", stdout);}
+    if (opt.ppm) {ppm.finish();}
+
+    if (opt.start) {
+        if (opt.start_baud) {host::serial_set_baud(fd, opt.start_baud);}
+        host::serial_command(fd, "stream off");
+    }
+    if (fd != STDIN_FILENO) {close(fd);}
+    if (opt.stats) {timing.report(decoder, opt.ansi ? stdout : stderr);}
+    return 0;
+}
+
+/* ----------------------------------- Self test ----------------------------------- */
+
+int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, "FAIL: " __VA_ARGS__); fprintf(stderr, "\n"); } } while (0)
+
+/* A UART with a transmit buffer, drained at its baud rate on the virtual clock (10 bits per byte) */
+class uartSink : public frameSink {
+    public:
+        std::vector<uint8_t> wire;
+        std::vector<size_t> packet_pos;             //Where every frame packet starts on the wire
+        uint32_t baud;
+        size_t buffer_len;
+        double queued = 0;
+        double max_queued = 0;
+
+        uartSink(uint32_t baud, size_t buffer_len) : baud(baud), buffer_len(buffer_len) {}
+
+        void elapse(uint32_t us) {queued = std::max(0.0, queued - us * (baud / 10.0) / 1e6);}
+        size_t room() {return queued < buffer_len ? buffer_len - (size_t) queued : 0;}
+        size_t write(const uint8_t *data, size_t len) {
+            if (len && !data[0]) {packet_pos.push_back(wire.size());}
+            wire.insert(wire.end(), data, data + len);
+            queued += len;
+            max_queued = std::max(max_queued, queued);
+            return len;
+        }
+        void print(const std::string &text) {
+            wire.insert(wire.end(), text.begin(), text.end());
+            queued += text.size();
+        }
+};
+
+/* Lights that change a little every frame (dots moving over a slow gradient), with some noise */
+void draw(std::vector<CRGB> &lights, uint32_t frame) {
+    for (size_t idx = 0; idx < lights.size(); idx++) {
+        lights[idx] = CHSV((idx + frame / 4) & 0xFF, 255, 64);
+        if ((idx + frame) % 37 == 0) {lights[idx] = CRGB::White;}
+    }
+    lights[random16() % lights.size()] = CRGB(random8(), random8(), 0);
+}
+
+/* Decode the wire data (from an offset, with an optional corrupted byte), and check the frames / text against what was sent */
+void check_decode(const char *name, const uartSink &uart, size_t start, long corrupt_at,
+                  const std::map<uint16_t, std::vector<CRGB>> &sent, const std::vector<std::string> &lines, uint32_t skipped) {
+    std::vector<uint8_t> data(uart.wire.begin() + start, uart.wire.end());
+    if (corrupt_at >= 0) {data[corrupt_at - start] = (data[corrupt_at - start] == 0x5A) ? 0x5B : data[corrupt_at - start] ^ 0x5A;}
+    size_t available = uart.packet_pos.end() - std::lower_bound(uart.packet_pos.begin(), uart.packet_pos.end(), start);
+
+    streamDecoder decoder;
+    uint32_t mismatches = 0;
+    std::vector<std::string> text;
+    decoder.on_frame = [&](const streamFrame &frame) {
+        auto expected = sent.find(frame.seq);
+        if (expected == sent.end() || expected->second != *frame.lights) {mismatches++;}
+    };
+    decoder.on_text = [&](const std::string &line) {text.push_back(line);};
+    decoder.feed(data.data(), data.size());
+    decoder.flush();
+
+    CHECK(!mismatches, "%s: %u frames decoded to the wrong lights", name, mismatches);
+    if (!start && corrupt_at < 0) {
+        CHECK(decoder.frame_qty == sent.size() && !decoder.bad_qty && !decoder.waiting_qty, "%s: %u of %zu frames decoded (%u bad, %u waiting)",
+              name, decoder.frame_qty, sent.size(), decoder.bad_qty, decoder.waiting_qty);
+        CHECK(decoder.gap_qty == skipped, "%s: %u gaps in seq, %u frames skipped", name, decoder.gap_qty, skipped);
+        CHECK(text == lines, "%s: log text changed (%zu lines, %zu sent)", name, text.size(), lines.size());
+    } else {
+        /* Whatever was lost, the stream must be back within a key frame interval */
+        CHECK(decoder.frame_qty + FRAME_STREAM_KEY_INTERVAL + 1 >= available && (corrupt_at < 0 || decoder.frame_qty < available),
+              "%s: %u of %zu frames decoded", name, decoder.frame_qty, available);
+    }
+    printf("  %-28s %5u frames, %u skipped, %u bad, %u waiting for a key frame, %zu lines of text\n",
+           name, decoder.frame_qty, decoder.gap_qty, decoder.bad_qty, decoder.waiting_qty, text.size());
+}
+
+/* Stream frames through a modeled UART, with log lines in between */
+void run_stream(const char *name, uint16_t led_qty, uint32_t baud, bool raw, uint32_t frames) {
+    std::vector<CRGB> lights(led_qty);
+    frameStream stream(lights.data(), led_qty, &lightTools);
+    uartSink uart(baud, 2048);
+    std::map<uint16_t, std::vector<CRGB>> sent;
+    std::vector<std::string> lines;
+    frameStreamStats before = frameStream::stats();
+
+    srand(1234);
+    frameStream::begin(&uart, raw);
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        draw(lights, frame);
+        uint16_t seq = (uint16_t) (before.frame_qty + before.skipped_qty + frame);
+        if (frameStream::send(frame * 16667, 900 + frame % 200)) {sent[seq] = lights;}
+        if (frame % 45 == 7) {
+            lines.push_back("[" + std::to_string(frame * 16667) + "] log line " + std::to_string(frame) + ", no zeros in here");
+            uart.print(lines.back() + "\r\n");
+        }
+        uart.elapse(16667);
+    }
+    frameStream::end();
+    if (sent.empty()) {
+        CHECK(false, "%s: no frame sent", name);
+        return;
+    }
+
+    /* Frames skipped before the first / after the last frame sent leave no gap */
+    uint32_t skipped = (uint16_t) (sent.rbegin()->first - sent.begin()->first + 1) - sent.size();
+    double fps = sent.size() / (frames / 60.0);
+    printf("%s: %u lights at %u baud, %s - %zu of %u frames sent (%.1f FPS), %.0f bytes per frame, buffer peak %.0f bytes\n",
+           name, led_qty, baud, raw ? "raw" : "delta", sent.size(), frames, fps,
+           (double) (frameStream::stats().byte_qty - before.byte_qty) / sent.size(), uart.max_queued);
+    CHECK(uart.max_queued <= uart.buffer_len + 1, "%s: %.0f bytes queued in a %zu byte buffer (the lights would stall)", name, uart.max_queued, uart.buffer_len);
+
+    size_t middle = uart.packet_pos[uart.packet_pos.size() / 2];
+    check_decode("from the start", uart, 0, -1, sent, lines, skipped);
+    check_decode("joined mid-packet", uart, uart.packet_pos[uart.packet_pos.size() / 3] + 5, -1, sent, lines, skipped);
+    check_decode("one corrupted byte", uart, 0, (long) middle + 12, sent, lines, skipped);
+}
+
+int selftest() {
+    /* COBS round trips - zeros, long runs without a zero (block splits at 254), and random data */
+    srand(42);
+    for (uint32_t len : {0u, 1u, 2u, 253u, 254u, 255u, 508u, 600u, 1500u}) {
+        for (uint8_t fill : {0x00, 0x01, 0xAA, 0xFF}) {
+            std::vector<uint8_t> data(len), encoded(FRAME_STREAM_COBS_LEN(len) + 1), decoded(len + 1);
+            for (uint32_t pos = 0; pos < len; pos++) {data[pos] = (fill == 0xAA) ? random8() : fill;}
+            uint16_t encoded_len = frameStream::cobs_encode(data.data(), len, encoded.data());
+            int32_t decoded_len = frameStream::cobs_decode(encoded.data(), encoded_len, decoded.data(), len);
+            bool zero_free = std::find(encoded.begin(), encoded.begin() + encoded_len, 0) == encoded.begin() + encoded_len;
+            CHECK(encoded_len <= FRAME_STREAM_COBS_LEN(len) && zero_free && decoded_len == (int32_t) len && std::equal(data.begin(), data.end(), decoded.begin()),
+                  "COBS round trip of %u bytes of 0x%02X (encoded %u, decoded %d)", len, fill, encoded_len, decoded_len);
+        }
+    }
+    uint8_t check[] = "123456789";
+    CHECK(frameStream::crc16(check, 9) == 0x29B1, "CRC-16/CCITT-FALSE check value: %04X", frameStream::crc16(check, 9));
+
+    /* The ghost at its default speed (most frames skipped), a faster port, and uncompressed frames */
+    run_stream("110 lights", 110, 115200, false, 1800);
+    run_stream("300 lights", 300, 921600, false, 1800);
+    run_stream("300 lights raw", 300, 921600, true, 1800);
+    run_stream("300 lights raw, slow", 300, 115200, true, 600);
+
+    printf(failures ? "FAIL: %d check(s) failed\n" : "PASS\n", failures);
+    return failures ? 1 : 0;
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [--baud N] [--start [BAUD]] [--raw] [--capture FILE] [--ansi | --no-ansi] [--no-text]\n"
+                    "       %*s [--ppm FILE] [--fps F] [--scale N] [--stats] <serial device | capture file | ->\n"
+                    "       %s --selftest\n", exe, (int) strlen(exe), "", exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    bool ansi_set = false;
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--selftest")) {return selftest();}
+        else if (!strcmp(argv[arg], "--baud") && has_value) {opt.baud = atol(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--start")) {
+            opt.start = true;
+            if (has_value && isdigit((unsigned char) argv[arg + 1][0])) {opt.start_baud = atol(argv[++arg]);}
+        }
+        else if (!strcmp(argv[arg], "--raw")) {opt.raw = true;}
+        else if (!strcmp(argv[arg], "--capture") && has_value) {
+            opt.capture = fopen(argv[++arg], "wb");
+            if (!opt.capture) {fprintf(stderr, "can't write %s\n", argv[arg]); return 1;}
+        }
+        else if (!strcmp(argv[arg], "--ansi")) {opt.ansi = ansi_set = true;}
+        else if (!strcmp(argv[arg], "--no-ansi")) {opt.ansi = false; ansi_set = true;}
+        else if (!strcmp(argv[arg], "--no-text")) {opt.text = false;}
+        else if (!strcmp(argv[arg], "--ppm") && has_value) {
+            const char *path = argv[++arg];
+            opt.ppm = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+            if (!opt.ppm) {fprintf(stderr, "can't write %s\n", path); return 1;}
+        }
+        else if (!strcmp(argv[arg], "--fps") && has_value) {opt.fps = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--scale") && has_value) {opt.scale = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--stats")) {opt.stats = true;}
+        else if (argv[arg][0] != '-' || !strcmp(argv[arg], "-")) {opt.input = argv[arg];}
+        else {return usage(argv[0]);}
+    }
+    if (!opt.input || opt.fps <= 0 || !opt.scale) {return usage(argv[0]);}
+    if (opt.ppm == stdout) {
+        if (ansi_set && opt.ansi) {fprintf(stderr, "--ansi and '--ppm -' both write to stdout\n"); return 2;}
+        opt.ansi = false;
+    }
+
+    int result = view();
+    if (opt.ppm && opt.ppm != stdout) {fclose(opt.ppm);}
+    if (opt.capture) {fclose(opt.capture);}
+    return result;
+}
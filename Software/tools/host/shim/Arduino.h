@@ -0,0 +1,136 @@
+/*
+    Arduino.h - host build shim
+    Minimal stand-in for the Arduino core, so the light libraries and main.cpp
+    can be compiled natively on Linux by 'tools/host/build_host.sh'.
+
+    Only the pieces of the Arduino API used by this project are provided.  Time is
+    virtual: millis()/micros() return the host clock, which only moves when the
+    host program (or a delay) advances it - this is what lets host programs run
+    much faster than real time.
+*/
+
+#ifndef Arduino_h
+    #define Arduino_h
+
+    /* Include standard libraries needed */
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <math.h>
+    #include <string>
+    #include <algorithm>
+
+    /* Arduino constants */
+    #define HIGH 0x1
+    #define LOW  0x0
+    #define INPUT 0x01
+    #define OUTPUT 0x03
+    #define INPUT_PULLUP 0x05
+    #define INPUT_PULLDOWN 0x09
+    #define DEC 10
+    #define HEX 16
+    #define BIN 2
+
+    /* Flash / IRAM placement is plain memory on the host */
+    #define PROGMEM
+    #define IRAM_ATTR
+    #define F(x) (x)
+    #define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+    #define pgm_read_word(addr) (*(const uint16_t *)(addr))
+    #define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+    #define memcpy_P memcpy
+
+    /* Arduino helper macros */
+    #define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+    #define PI 3.1415926535897932384626433832795
+
+    using std::min;
+    using std::max;
+
+    typedef bool boolean;
+    typedef uint8_t byte;
+
+    /* Virtual clock (owned by the host program) */
+    namespace host {
+        extern uint64_t clock_us;                       //Current virtual time, in microseconds
+        extern uint8_t pin_state[64];                   //Simulated input pin levels (driven by the host program)
+        extern FILE *serial_out;                        //Where Serial output goes (stderr by default, NULL to drop it)
+    }
+
+    inline unsigned long micros() {return (unsigned long) (uint32_t) host::clock_us;}
+    inline unsigned long millis() {return (unsigned long) (uint32_t) (host::clock_us / 1000);}
+    inline void delay(unsigned long ms) {host::clock_us += (uint64_t) ms * 1000;}
+    inline void delayMicroseconds(unsigned int us) {host::clock_us += us;}
+
+    /* GPIO - outputs are ignored, inputs are driven by the host program */
+    inline void pinMode(uint8_t pin, uint8_t mode) {(void) pin; (void) mode;}
+    inline void digitalWrite(uint8_t pin, uint8_t val) {(void) pin; (void) val;}
+    inline int digitalRead(uint8_t pin) {return (pin < 64) ? host::pin_state[pin] : LOW;}
+
+    /* Random numbers */
+    inline long random(long howbig) {return howbig ? (rand() % howbig) : 0;}
+    inline long random(long howsmall, long howbig) {return (howsmall >= howbig) ? howsmall : howsmall + random(howbig - howsmall);}
+    inline void randomSeed(unsigned long seed) {srand(seed);}
+
+    /* Small subset of the Arduino String class */
+    class String {
+        public:
+            String() {}
+            String(const char *s) : _s(s ? s : "") {}
+            String(const std::string &s) : _s(s) {}
+            String(char c) : _s(1, c) {}
+            String(int v, int base=DEC) {_s = fmt((long long) v, base);}
+            String(unsigned int v, int base=DEC) {_s = fmt((long long) v, base);}
+            String(long v, int base=DEC) {_s = fmt((long long) v, base);}
+            String(unsigned long v, int base=DEC) {_s = fmt((long long) v, base);}
+            String(unsigned char v, int base=DEC) {_s = fmt((long long) v, base);}
+            String(double v, int decimals=2) {char b[48]; snprintf(b, sizeof(b), "%.*f", decimals, v); _s = b;}
+
+            const char *c_str() const {return _s.c_str();}
+            unsigned int length() const {return _s.length();}
+            long toInt() const {return atol(_s.c_str());}
+            bool startsWith(const String &p) const {return _s.compare(0, p._s.size(), p._s) == 0;}
+            bool endsWith(const String &p) const {return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;}
+            String substring(unsigned int from) const {return from < _s.size() ? String(_s.substr(from)) : String();}
+            String substring(unsigned int from, unsigned int to) const {return from < _s.size() ? String(_s.substr(from, to - from)) : String();}
+            int indexOf(char c) const {size_t i = _s.find(c); return i == std::string::npos ? -1 : (int) i;}
+            void toCharArray(char *buf, unsigned int size) const {if (size) {strncpy(buf, _s.c_str(), size - 1); buf[size - 1] = 0;}}
+            char operator[](unsigned int i) const {return i < _s.size() ? _s[i] : 0;}
+
+            String &operator+=(const String &rhs) {_s += rhs._s; return *this;}
+            friend String operator+(const String &lhs, const String &rhs) {return String(lhs._s + rhs._s);}
+            friend String operator+(const String &lhs, const char *rhs) {return String(lhs._s + rhs);}
+            friend String operator+(const char *lhs, const String &rhs) {return String(lhs + rhs._s);}
+            bool operator==(const String &rhs) const {return _s == rhs._s;}
+            bool operator!=(const String &rhs) const {return _s != rhs._s;}
+
+        private:
+            static std::string fmt(long long v, int base) {
+                if (base == DEC) {return std::to_string(v);}
+                std::string out;
+                unsigned long long u = (unsigned long long) v;
+                do {out.insert(out.begin(), "0123456789ABCDEF"[u % base]); u /= base;} while (u);
+                return out;
+            }
+            std::string _s;
+    };
+
+    /* Serial port - text goes to stderr (host::serial_out) so stdout stays free for rendered frames */
+    class HardwareSerial {
+        public:
+            void begin(unsigned long baud) {(void) baud;}
+            size_t write(uint8_t c) {return (!host::serial_out || fputc(c, host::serial_out) != EOF) ? 1 : 0;}
+            size_t write(const uint8_t *buf, size_t len) {return host::serial_out ? fwrite(buf, 1, len, host::serial_out) : len;}
+            size_t print(const String &s) {return write((const uint8_t *) s.c_str(), s.length());}
+            size_t print(const char *s) {return write((const uint8_t *) s, strlen(s));}
+            size_t println(const String &s) {return print(s) + print("\r\n");}
+            size_t println(const char *s="") {return print(s) + print("\r\n");}
+            int available() {return 0;}
+            int availableForWrite() {return 4096;}     //A file / the terminal never fills up
+            int read() {return -1;}
+            void flush() {if (host::serial_out) {fflush(host::serial_out);}}
+            operator bool() {return true;}
+    };
+    extern HardwareSerial Serial;
+#endif
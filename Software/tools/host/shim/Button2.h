@@ -0,0 +1,40 @@
+/*
+    Button2.h - host build shim
+    Minimal stand-in for Button2 v2.0.3.  The button level is read from the
+    host virtual pins, which are driven by the host program.
+*/
+
+#ifndef Button2_h
+    #define Button2_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    class Button2;
+    typedef void (*CallbackFunction)(Button2 &);
+
+    class Button2 {
+        public:
+            void begin(uint8_t attachTo, uint8_t buttonMode=INPUT_PULLUP, bool isCapacitive=false, bool activeLow=true) {
+                (void) buttonMode; (void) isCapacitive;
+                _pin = attachTo; _activeLow = activeLow;
+            }
+            void loop() {
+                bool now = isPressed();
+                if (_was_pressed && !now && _click_cb) {_click_cb(*this);}
+                _was_pressed = now;
+            }
+            bool isPressed() {return digitalRead(_pin) == (_activeLow ? LOW : HIGH);}
+            void setDebounceTime(unsigned int ms) {(void) ms;}
+            void setLongClickTime(unsigned int ms) {(void) ms;}
+            void setClickHandler(CallbackFunction f) {_click_cb = f;}
+            void setLongClickHandler(CallbackFunction f) {(void) f;}
+            uint8_t getPin() {return _pin;}
+
+        private:
+            uint8_t _pin = 255;
+            bool _activeLow = true;
+            bool _was_pressed = false;
+            CallbackFunction _click_cb = NULL;
+    };
+#endif
@@ -0,0 +1,261 @@
+/*
+    FastLED.h - host build shim
+    Minimal stand-in for FastLED v3.5.0, so the light libraries and main.cpp can be
+    compiled natively on Linux by 'tools/host/build_host.sh'.
+
+    The math helpers (scale8, sin8, sin16, beatsin16, hsv2rgb_rainbow, ...) follow the
+    portable C implementations from FastLED, so patterns render the same way they would
+    on the ESP32.  FastLED.show() hands the frame to the host program instead of a data pin.
+*/
+
+#ifndef FastLED_h
+    #define FastLED_h
+
+    /* Include standard libraries needed */
+    #include <Arduino.h>
+
+    /* Time source used by the beat / EVERY_N helpers (can be overridden like the real library) */
+    #if defined(USE_GET_MILLISECOND_TIMER)
+        uint32_t get_millisecond_timer();
+        #define GET_MILLIS get_millisecond_timer
+    #else
+        #define GET_MILLIS millis
+    #endif
+
+    /* ---------- lib8tion: 8/16 bit math ---------- */
+    typedef uint8_t fract8;
+    typedef uint16_t accum88;
+
+    inline uint8_t scale8(uint8_t i, fract8 scale) {return (((uint16_t) i) * (1 + (uint16_t) scale)) >> 8;}
+    inline uint8_t scale8_video(uint8_t i, fract8 scale) {return (((int) i * (int) scale) >> 8) + ((i && scale) ? 1 : 0);}
+    inline uint16_t scale16(uint16_t i, uint16_t scale) {return ((uint32_t) i * (1 + (uint32_t) scale)) >> 16;}
+    inline uint8_t qadd8(uint8_t i, uint8_t j) {unsigned int t = i + j; return (t > 255) ? 255 : t;}
+    inline uint8_t qsub8(uint8_t i, uint8_t j) {int t = i - j; return (t < 0) ? 0 : t;}
+    inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac) {return (b > a) ? a + scale8(b - a, frac) : a - scale8(a - b, frac);}
+
+    inline int16_t sin16(uint16_t theta) {
+        static const uint16_t base[] = {0, 6393, 12539, 18204, 23170, 27245, 30273, 32137};
+        static const uint8_t slope[] = {49, 48, 44, 38, 31, 23, 14, 4};
+        uint16_t offset = (theta & 0x3FFF) >> 3;
+        if (theta & 0x4000) {offset = 2047 - offset;}
+        uint8_t section = offset / 256;
+        uint16_t mx = slope[section] * (uint16_t) ((uint8_t) offset / 2);
+        int16_t y = mx + base[section];
+        if (theta & 0x8000) {y = -y;}
+        return y;
+    }
+    inline int16_t cos16(uint16_t theta) {return sin16(theta + 16384);}
+
+    inline uint8_t sin8(uint8_t theta) {
+        static const uint8_t b_m16_interleave[] = {0, 49, 49, 41, 90, 27, 117, 10};
+        uint8_t offset = theta;
+        if (theta & 0x40) {offset = (uint8_t) 255 - offset;}
+        offset &= 0x3F;
+        uint8_t secoffset = offset & 0x0F;
+        if (theta & 0x40) {++secoffset;}
+        const uint8_t *p = b_m16_interleave + ((offset >> 4) * 2);
+        uint8_t mx = (p[1] * secoffset) >> 4;
+        int8_t y = mx + p[0];
+        if (theta & 0x80) {y = -y;}
+        y += 128;
+        return y;
+    }
+    inline uint8_t cos8(uint8_t theta) {return sin8(theta + 64);}
+
+    inline uint16_t beat88(accum88 beats_per_minute_88, uint32_t timebase=0) {return (((uint32_t) GET_MILLIS() - timebase) * beats_per_minute_88 * 280) >> 16;}
+    inline uint16_t beat16(accum88 beats_per_minute, uint32_t timebase=0) {if (beats_per_minute < 256) {beats_per_minute <<= 8;} return beat88(beats_per_minute, timebase);}
+    inline uint8_t beat8(accum88 beats_per_minute, uint32_t timebase=0) {return beat16(beats_per_minute, timebase) >> 8;}
+    inline uint16_t beatsin16(accum88 beats_per_minute, uint16_t lowest=0, uint16_t highest=65535, uint32_t timebase=0, uint16_t phase_offset=0) {
+        uint16_t beatsin = sin16(beat16(beats_per_minute, timebase) + phase_offset) + 32768;
+        return lowest + scale16(beatsin, highest - lowest);
+    }
+    inline uint8_t beatsin8(accum88 beats_per_minute, uint8_t lowest=0, uint8_t highest=255, uint32_t timebase=0, uint8_t phase_offset=0) {
+        uint8_t beatsin = sin8(beat8(beats_per_minute, timebase) + phase_offset);
+        return lowest + scale8(beatsin, highest - lowest);
+    }
+
+    inline uint8_t random8() {return rand() & 0xFF;}
+    inline uint8_t random8(uint8_t lim) {return scale8(random8(), lim);}
+    inline uint16_t random16() {return rand() & 0xFFFF;}
+
+    /* ---------- pixel types ---------- */
+    struct CHSV {
+        union {
+            struct {uint8_t hue; uint8_t sat; uint8_t val;};
+            uint8_t raw[3];
+        };
+        CHSV() : hue(0), sat(0), val(0) {}
+        CHSV(uint8_t ih, uint8_t is, uint8_t iv) : hue(ih), sat(is), val(iv) {}
+    };
+
+    struct CRGB;
+    void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+
+    struct CRGB {
+        union {
+            struct {uint8_t r; uint8_t g; uint8_t b;};
+            uint8_t raw[3];
+        };
+
+        typedef enum {
+            Amethyst=0x9966CC, Aqua=0x00FFFF, Aquamarine=0x7FFFD4, Black=0x000000, Blue=0x0000FF,
+            Crimson=0xDC143C, Cyan=0x00FFFF, DarkBlue=0x00008B, DarkGreen=0x006400, DarkOrange=0xFF8C00,
+            DarkRed=0x8B0000, DeepPink=0xFF1493, DeepSkyBlue=0x00BFFF, FairyLight=0xFFE42D, ForestGreen=0x228B22,
+            Fuchsia=0xFF00FF, Gold=0xFFD700, Goldenrod=0xDAA520, Gray=0x808080, Green=0x008000,
+            HotPink=0xFF69B4, Indigo=0x4B0082, Ivory=0xFFFFF0, LightBlue=0xADD8E6, Lime=0x00FF00,
+            Magenta=0xFF00FF, Maroon=0x800000, Navy=0x000080, OldLace=0xFDF5E6, Orange=0xFFA500,
+            OrangeRed=0xFF4500, Pink=0xFFC0CB, Purple=0x800080, Red=0xFF0000, SeaGreen=0x2E8B57,
+            Silver=0xC0C0C0, SkyBlue=0x87CEEB, Snow=0xFFFAFA, Teal=0x008080, Violet=0xEE82EE,
+            White=0xFFFFFF, Yellow=0xFFFF00
+        } HTMLColorCode;
+
+        CRGB() : r(0), g(0), b(0) {}
+        CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+        CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+        CRGB(HTMLColorCode colorcode) : CRGB((uint32_t) colorcode) {}
+        CRGB(const CHSV &rhs) {hsv2rgb_rainbow(rhs, *this);}
+
+        uint8_t &operator[](uint8_t x) {return raw[x];}
+        const uint8_t &operator[](uint8_t x) const {return raw[x];}
+
+        CRGB &operator+=(const CRGB &rhs) {r = qadd8(r, rhs.r); g = qadd8(g, rhs.g); b = qadd8(b, rhs.b); return *this;}
+        CRGB &operator-=(const CRGB &rhs) {r = qsub8(r, rhs.r); g = qsub8(g, rhs.g); b = qsub8(b, rhs.b); return *this;}
+        CRGB &operator|=(const CRGB &rhs) {if (rhs.r > r) {r = rhs.r;} if (rhs.g > g) {g = rhs.g;} if (rhs.b > b) {b = rhs.b;} return *this;}
+        CRGB &nscale8(uint8_t scale) {r = scale8(r, scale); g = scale8(g, scale); b = scale8(b, scale); return *this;}
+        CRGB &nscale8_video(uint8_t scale) {r = scale8_video(r, scale); g = scale8_video(g, scale); b = scale8_video(b, scale); return *this;}
+        CRGB &fadeToBlackBy(uint8_t fadefactor) {return nscale8(255 - fadefactor);}
+        CRGB &setRGB(uint8_t nr, uint8_t ng, uint8_t nb) {r = nr; g = ng; b = nb; return *this;}
+        CRGB &setHSV(uint8_t h, uint8_t s, uint8_t v) {hsv2rgb_rainbow(CHSV(h, s, v), *this); return *this;}
+
+        explicit operator bool() const {return r || g || b;}
+        bool operator==(const CRGB &rhs) const {return r == rhs.r && g == rhs.g && b == rhs.b;}
+        bool operator!=(const CRGB &rhs) const {return !(*this == rhs);}
+    };
+
+    inline void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb) {
+        uint8_t hue = hsv.hue, sat = hsv.sat, val = hsv.val;
+        uint8_t offset8 = (hue & 0x1F) << 3;
+        uint8_t third = scale8(offset8, (256 / 3));
+        uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+        uint8_t r, g, b;
+
+        switch (hue >> 5) {
+            case 0: r = 255 - third; g = third;       b = 0;               break;   //R -> O
+            case 1: r = 171;         g = 85 + third;  b = 0;               break;   //O -> Y
+            case 2: r = 171 - twothirds; g = 170 + third; b = 0;           break;   //Y -> G
+            case 3: r = 0;           g = 255 - third; b = third;           break;   //G -> A
+            case 4: r = 0;           g = 171 - twothirds; b = 85 + twothirds; break; //A -> B
+            case 5: r = third;       g = 0;           b = 255 - third;     break;   //B -> P
+            case 6: r = 85 + third;  g = 0;           b = 171 - third;     break;   //P -> K
+            default: r = 170 + third; g = 0;          b = 85 - third;      break;   //K -> R
+        }
+
+        if (sat != 255) {
+            if (sat == 0) {r = 255; g = 255; b = 255;}
+            else {
+                if (r) {r = scale8(r, sat);}
+                if (g) {g = scale8(g, sat);}
+                if (b) {b = scale8(b, sat);}
+                uint8_t desat = 255 - sat;
+                desat = scale8(desat, desat);
+                r += desat; g += desat; b += desat;
+            }
+        }
+
+        if (val != 255) {
+            val = scale8_video(val, val);
+            if (val == 0) {r = 0; g = 0; b = 0;}
+            else {
+                if (r) {r = scale8(r, val);}
+                if (g) {g = scale8(g, val);}
+                if (b) {b = scale8(b, val);}
+            }
+        }
+
+        rgb.r = r; rgb.g = g; rgb.b = b;
+    }
+
+    /* ---------- color utilities ---------- */
+    inline void fill_solid(CRGB *leds, int num_leds, const CRGB &color) {for (int i = 0; i < num_leds; i++) {leds[i] = color;}}
+    inline void fill_rainbow(CRGB *leds, int num_leds, uint8_t initialhue, uint8_t deltahue=5) {
+        CHSV hsv(initialhue, 240, 255);
+        for (int i = 0; i < num_leds; i++) {leds[i] = hsv; hsv.hue += deltahue;}
+    }
+    inline void nscale8(CRGB *leds, uint16_t num_leds, uint8_t scale) {for (uint16_t i = 0; i < num_leds; i++) {leds[i].nscale8(scale);}}
+    inline void fadeToBlackBy(CRGB *leds, uint16_t num_leds, uint8_t fadeBy) {nscale8(leds, num_leds, 255 - fadeBy);}
+    inline void fade_raw(CRGB *leds, uint16_t num_leds, uint8_t fadeBy) {nscale8(leds, num_leds, 255 - fadeBy);}
+    inline CRGB blend(const CRGB &p1, const CRGB &p2, fract8 amountOfP2) {
+        return CRGB(lerp8by8(p1.r, p2.r, amountOfP2), lerp8by8(p1.g, p2.g, amountOfP2), lerp8by8(p1.b, p2.b, amountOfP2));
+    }
+
+    /* ---------- periodic timers (EVERY_N_*) ---------- */
+    template<typename TIMETYPE, TIMETYPE (*TIMEGETTER)()>
+    class CEveryNTime {
+        public:
+            TIMETYPE mPrevTrigger;
+            TIMETYPE mPeriod;
+
+            CEveryNTime(TIMETYPE period) : mPeriod(period) {reset();}
+            TIMETYPE getTime() {return TIMEGETTER();}
+            void reset() {mPrevTrigger = getTime();}
+            void setPeriod(TIMETYPE period) {mPeriod = period;}
+            TIMETYPE getPeriod() {return mPeriod;}
+            bool ready() {
+                bool isReady = (TIMETYPE) (getTime() - mPrevTrigger) >= mPeriod;
+                if (isReady) {reset();}
+                return isReady;
+            }
+            operator bool() {return ready();}
+    };
+
+    inline uint32_t fastled_get_millis() {return GET_MILLIS();}
+    inline uint32_t fastled_get_seconds() {return GET_MILLIS() / 1000;}
+    typedef CEveryNTime<uint32_t, fastled_get_millis> CEveryNMillis;
+    typedef CEveryNTime<uint32_t, fastled_get_seconds> CEveryNSeconds;
+
+    #define CONCAT_HELPER(x, y) x##y
+    #define CONCAT_MACRO(x, y) CONCAT_HELPER(x, y)
+    #define EVERY_N_MILLIS(N) EVERY_N_MILLIS_I(CONCAT_MACRO(PER, __COUNTER__), N)
+    #define EVERY_N_MILLIS_I(NAME, N) static CEveryNMillis NAME(N); if (NAME)
+    #define EVERY_N_MILLISECONDS(N) EVERY_N_MILLIS(N)
+    #define EVERY_N_SECONDS(N) EVERY_N_SECONDS_I(CONCAT_MACRO(PER, __COUNTER__), N)
+    #define EVERY_N_SECONDS_I(NAME, N) static CEveryNSeconds NAME(N); if (NAME)
+
+    /* ---------- controller ---------- */
+    enum EOrder {RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210};
+    enum ESimChipsets {WS2811, WS2812, WS2812B, NEOPIXEL};
+    enum LEDColorCorrection {TypicalLEDStrip = 0xFFB0F0, TypicalPixelString = 0xFFE08C, UncorrectedColor = 0xFFFFFF};
+
+    class CLEDController {
+        public:
+            CLEDController &setCorrection(uint32_t correction) {(void) correction; return *this;}
+    };
+
+    namespace host {
+        extern void (*show_hook)(const CRGB *leds, uint16_t num_leds, uint8_t brightness);   //Set by the host program to capture frames
+    }
+
+    class CFastLED {
+        public:
+            template<int CHIPSET, uint8_t DATA_PIN, int RGB_ORDER=RGB>
+            CLEDController &addLeds(CRGB *data, int nLedsOrOffset, int nLedsIfOffset=0) {
+                (void) nLedsIfOffset;
+                _leds = data; _num_leds = nLedsOrOffset;
+                return _controller;
+            }
+
+            void setBrightness(uint8_t scale) {_brightness = scale;}
+            uint8_t getBrightness() {return _brightness;}
+            void show() {if (host::show_hook && _leds) {host::show_hook(_leds, _num_leds, _brightness);}}
+            void clear(bool writeData=false) {if (_leds) {fill_solid(_leds, _num_leds, CRGB::Black);} if (writeData) {show();}}
+            int size() {return _num_leds;}
+            CRGB *leds() {return _leds;}
+
+        private:
+            CLEDController _controller;
+            CRGB *_leds = NULL;
+            uint16_t _num_leds = 0;
+            uint8_t _brightness = 255;
+    };
+    extern CFastLED FastLED;
+#endif
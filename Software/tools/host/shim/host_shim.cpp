@@ -0,0 +1,17 @@
+/*
+    host_shim.cpp - host build shim
+    Storage for the globals declared by the Arduino / FastLED shims.
+*/
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+namespace host {
+    uint64_t clock_us = 0;
+    uint8_t pin_state[64] = {0};
+    FILE *serial_out = stderr;
+    void (*show_hook)(const CRGB *leds, uint16_t num_leds, uint8_t brightness) = NULL;
+}
+
+HardwareSerial Serial;
+CFastLED FastLED;
@@ -0,0 +1,219 @@
+/*
+    simulator.cpp - host tool
+    Headless Linux simulator for the ghost: builds the real 'src/main.cpp' and light libraries
+    against the host shims (FastLED / Button2 / millis), and runs setup() + loop() on a
+    virtual clock - as fast as the host allows, or in real time.
+
+    The LED strand can be rendered to the terminal (ANSI truecolor, one line per frame) and/or
+    to a PPM stream (one image per frame, e.g. piped into ffmpeg to make a video).  Button
+    presses on the ghost's hands can be scripted.
+
+    Usage (built by 'build_host.sh'):
+        simulator [options]
+            --seconds S         simulated run time (default 60)
+            --fps F             loop() iterations per simulated second (default 60)
+            --realtime          pace the simulation to the wall clock (default: as fast as possible)
+            --ansi              render frames to the terminal
+            --ppm FILE          write frames as a PPM stream ('-' for stdout)
+            --scale N           PPM pixels per light (default 4)
+            --every MS          only render a frame every MS simulated milliseconds (default: every frame)
+            --press T:HAND[:MS] press 'left' or 'right' at T seconds, held for MS (default 100) - repeatable
+            --quiet             drop the ghost's Serial output
+            --hash              print a hash over every frame shown (to compare two runs)
+            --wav FILE          play a WAV file into the microphone (audio-reactive patterns), from the start of the run
+            --synth BPM         play a synthesized drum track at BPM into the microphone instead
+            --stream FILE       write the ghost's serial output with the frame stream turned on (lib/frameStream), as
+                                the ghost sends it - decode it with 'serial_view' (e.g. to compare with a capture of the device)
+
+    Examples:
+        simulator --realtime --ansi
+        simulator --seconds 3600 --press 10:left --hash
+        simulator --seconds 30 --every 33 --ppm - | ffmpeg -f image2pipe -c:v ppm -r 30 -i - ghost.mp4
+        simulator --seconds 60 --stream sim.bin && serial_view --no-ansi --stats sim.bin
+*/
+
+#include "host_ghost.h"
+#include "host_audio.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* A scripted button press */
+struct buttonPress {
+    uint64_t start_us;
+    uint64_t end_us;
+    uint8_t pin;
+};
+
+/* Simulator options / state */
+struct simOptions {
+    double seconds = 60;
+    uint32_t fps = 60;
+    bool realtime = false;
+    bool ansi = false;
+    FILE *ppm = NULL;
+    uint32_t scale = 4;
+    uint32_t every_ms = 0;
+    bool hash = false;
+    FILE *stream = NULL;
+    std::vector<buttonPress> presses;
+    std::vector<int16_t> audio;
+} sim;
+
+uint64_t frames_shown = 0;
+uint64_t frames_rendered = 0;
+uint32_t run_hash = 2166136261UL;
+uint64_t last_render_us = 0;
+std::vector<uint8_t> ppm_image;
+
+/* Scale a light by the master brightness, like the LED driver does */
+CRGB displayed(const CRGB &led, uint8_t brightness) {
+    return CRGB(scale8(led.r, brightness), scale8(led.g, brightness), scale8(led.b, brightness));
+}
+
+void render_ansi(const CRGB *leds, uint16_t num_leds, uint8_t brightness) {
+    std::string line = sim.realtime ? "\r" : "";
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%9.3f ", host::clock_us / 1e6);
+    line += buf;
+    for (uint16_t i = 0; i < num_leds; i++) {
+        CRGB c = displayed(leds[i], brightness);
+        snprintf(buf, sizeof(buf), "\x1b[38;2;%u;%u;%um█", c.r, c.g, c.b);
+        line += buf;
+    }
+    line += sim.realtime ? "\x1b[0m" : "\x1b[0m\n";
+    fputs(line.c_str(), stdout);
+    fflush(stdout);
+}
+
+void render_ppm(const CRGB *leds, uint16_t num_leds, uint8_t brightness) {
+    uint32_t width = num_leds * sim.scale;
+    ppm_image.resize((size_t) width * sim.scale * 3);
+    for (uint32_t y = 0; y < sim.scale; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            CRGB c = displayed(leds[x / sim.scale], brightness);
+            uint8_t *px = &ppm_image[((size_t) y * width + x) * 3];
+            px[0] = c.r; px[1] = c.g; px[2] = c.b;
+        }
+    }
+    fprintf(sim.ppm, "P6\n%u %u\n255\n", width, sim.scale);
+    fwrite(ppm_image.data(), 1, ppm_image.size(), sim.ppm);
+}
+
+/* Called by the FastLED shim for every FastLED.show() */
+void on_show(const CRGB *leds, uint16_t num_leds, uint8_t brightness) {
+    frames_shown++;
+    if (sim.hash) {run_hash = lightTools.frame_hash(leds, num_leds, run_hash);}
+
+    if (frames_rendered && (host::clock_us - last_render_us) < (uint64_t) sim.every_ms * 1000) {return;}
+    last_render_us = host::clock_us;
+    frames_rendered++;
+
+    if (sim.ansi) {render_ansi(leds, num_leds, brightness);}
+    if (sim.ppm) {render_ppm(leds, num_leds, brightness);}
+}
+
+/* Drive the hand inputs from the scripted presses */
+void update_buttons() {
+    host::pin_state[LEFT_TOUCH_PIN] = host::pin_state[RIGHT_TOUCH_PIN] = LOW;
+    for (const buttonPress &press : sim.presses) {
+        if (host::clock_us >= press.start_us && host::clock_us < press.end_us) {host::pin_state[press.pin] = HIGH;}
+    }
+}
+
+bool parse_press(const char *arg) {
+    char hand[16] = "";
+    double at_s = 0;
+    unsigned hold_ms = 100;
+    if (sscanf(arg, "%lf:%15[a-z]:%u", &at_s, hand, &hold_ms) < 2) {return false;}
+
+    buttonPress press;
+    press.start_us = (uint64_t) (at_s * 1e6);
+    press.end_us = press.start_us + (uint64_t) hold_ms * 1000;
+    if (!strcmp(hand, "left")) {press.pin = LEFT_TOUCH_PIN;}
+    else if (!strcmp(hand, "right")) {press.pin = RIGHT_TOUCH_PIN;}
+    else {return false;}
+
+    sim.presses.push_back(press);
+    return true;
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [--seconds S] [--fps F] [--realtime] [--ansi] [--ppm FILE] [--scale N] [--every MS]\n"
+                    "       %*s [--press T:left|right[:MS]]... [--quiet] [--hash] [--wav FILE | --synth BPM] [--stream FILE]\n", exe, (int) strlen(exe), "");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--seconds") && has_value) {sim.seconds = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--fps") && has_value) {sim.fps = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--realtime")) {sim.realtime = true;}
+        else if (!strcmp(argv[arg], "--ansi")) {sim.ansi = true;}
+        else if (!strcmp(argv[arg], "--ppm") && has_value) {
+            const char *path = argv[++arg];
+            sim.ppm = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+            if (!sim.ppm) {fprintf(stderr, "can't write %s\n", path); return 1;}
+        }
+        else if (!strcmp(argv[arg], "--scale") && has_value) {sim.scale = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--every") && has_value) {sim.every_ms = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--press") && has_value) {
+            if (!parse_press(argv[++arg])) {fprintf(stderr, "bad --press '%s' (expected T:left|right[:MS])\n", argv[arg]); return 2;}
+        }
+        else if (!strcmp(argv[arg], "--quiet")) {host::serial_out = NULL;}
+        else if (!strcmp(argv[arg], "--hash")) {sim.hash = true;}
+        else if (!strcmp(argv[arg], "--wav") && has_value) {
+            if (!hostLoadWav(argv[++arg], &sim.audio)) {fprintf(stderr, "%s: not a PCM WAV file\n", argv[arg]); return 1;}
+        }
+        else if (!strcmp(argv[arg], "--synth") && has_value) {
+            std::vector<uint32_t> kicks;
+            hostSynthBeats(atof(argv[++arg]), sim.seconds, &sim.audio, &kicks);
+        }
+        else if (!strcmp(argv[arg], "--stream") && has_value) {
+            sim.stream = fopen(argv[++arg], "wb");
+            if (!sim.stream) {fprintf(stderr, "can't write %s\n", argv[arg]); return 1;}
+        }
+        else {return usage(argv[0]);}
+    }
+    if (sim.stream) {host::serial_out = sim.stream;}
+    if (!sim.fps || !sim.scale || sim.seconds <= 0) {return usage(argv[0]);}
+    if (sim.ansi && sim.ppm == stdout) {fprintf(stderr, "--ansi and '--ppm -' both write to stdout\n"); return 2;}
+
+    host::show_hook = on_show;
+    uint64_t step_us = 1000000 / sim.fps;
+    uint64_t end_us = (uint64_t) (sim.seconds * 1e6);
+
+    hostAudioFeed audio_feed;
+    audio_feed.start(sim.audio, 0);
+
+    auto wall_start = std::chrono::steady_clock::now();
+    update_buttons();
+    setup();
+    if (sim.stream) {frameStream.begin(&serial_sink);}
+    while (host::clock_us < end_us) {
+        /* loop() itself moves the clock a little (delays) - step the rest of the way to the next iteration */
+        uint64_t next_us = host::clock_us + step_us;
+        update_buttons();
+        audio_feed.update();
+        loop();
+        if (host::clock_us < next_us) {host::clock_us = next_us;}
+
+        if (sim.realtime) {std::this_thread::sleep_until(wall_start + std::chrono::microseconds(host::clock_us));}
+    }
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    if (sim.ansi && sim.realtime) {fputs("\n", stdout);}
+    if (sim.ppm && sim.ppm != stdout) {fclose(sim.ppm);}
+    if (sim.stream) {
+        host::serial_out = stderr;
+        fclose(sim.stream);
+    }
+
+    fprintf(stderr, "simulated %.1f s (%llu frames) in %.2f s of wall time - %.0fx real time, ended on pattern index %u\n",
+            host::clock_us / 1e6, (unsigned long long) frames_shown, wall_s, (host::clock_us / 1e6) / wall_s, christmas_patterns_idx);
+    if (sim.hash) {printf("frame hash: %08x\n", run_hash);}
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+    soak.cpp - host tool
+    Soak test for the ghost's state machines: runs the real application (setup() + loop())
+    for days of simulated uptime on the virtual clock - every pattern switch, random button
+    presses, and the 32b millis() wraparound after 49.7 days - checking invariants on every
+    loop iteration:
+        - the pattern index is in range, and points to a pattern that can run
+        - patterns keep cycling (no switch is ever late by more than a second)
+        - every loop iteration pushes exactly one frame to the LEDs
+        - settings writes to flash honor the write-behind rate limit (ghostSettings)
+    Out-of-bounds LED writes (or any other memory error) are caught by building this tool with
+    AddressSanitizer / UndefinedBehaviorSanitizer ('build_host.sh' does).
+
+    By default the clock starts 12 hours before millis() wraps, so the wrap happens early in
+    the run (as on a ghost that has been up for 49 days).
+
+    Usage (built by 'build_host.sh'):
+        soak [--days D] [--fps F] [--start-ms MS] [--press-every S] [--seed N]
+            --days D            simulated uptime (default 3)
+            --fps F             loop() iterations per simulated second (default 60)
+            --start-ms MS       initial millis() value (default: 12 hours before the wrap)
+            --press-every S     average time between random button presses (default 300, 0 = none)
+            --seed N            seed for the button presses (default 1)
+*/
+
+#include "host_ghost.h"
+#include <chrono>
+#include <random>
+
+/* Soak options */
+struct soakOptions {
+    double days = 3;
+    uint32_t fps = 60;
+    uint64_t start_ms = 0x100000000ULL - 12ULL * 3600 * 1000;
+    double press_every_s = 300;
+    uint32_t seed = 1;
+} soak;
+
+/* Counters */
+uint64_t shows = 0;
+uint64_t loops = 0;
+uint64_t presses = 0;
+uint64_t pattern_switches = 0;
+uint32_t longest_static_ms[ARRAY_SIZE(christmas_patterns)] = {0};
+
+/* Called by the FastLED shim for every FastLED.show() */
+void on_show(const CRGB *leds, uint16_t num_leds, uint8_t brightness) {
+    (void) leds; (void) num_leds; (void) brightness;
+    shows++;
+}
+
+/* Report an invariant violation, and stop */
+void fail(const char *what, uint64_t now_us) {
+    fprintf(stderr, "\nINVARIANT FAILED after %.3f h of uptime (millis() = %lu): %s\n",
+            (now_us - soak.start_ms * 1000) / 3.6e9, millis(), what);
+    exit(1);
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [--days D] [--fps F] [--start-ms MS] [--press-every S] [--seed N]\n", exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--days") && has_value) {soak.days = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--fps") && has_value) {soak.fps = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--start-ms") && has_value) {soak.start_ms = strtoull(argv[++arg], NULL, 0);}
+        else if (!strcmp(argv[arg], "--press-every") && has_value) {soak.press_every_s = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--seed") && has_value) {soak.seed = strtoul(argv[++arg], NULL, 0);}
+        else {return usage(argv[0]);}
+    }
+    if (!soak.fps || soak.days <= 0) {return usage(argv[0]);}
+
+    host::serial_out = NULL;
+    host::show_hook = on_show;
+    host::clock_us = soak.start_ms * 1000;
+
+    uint64_t step_us = 1000000 / soak.fps;
+    uint64_t end_us = host::clock_us + (uint64_t) (soak.days * 86400e6);
+    uint64_t next_report_us = host::clock_us + 86400000000ULL;
+
+    /* Random button presses (exponential gaps, random hand, 50 ms - 3 s hold) */
+    std::mt19937 rng(soak.seed);
+    std::exponential_distribution<double> press_gap(soak.press_every_s > 0 ? 1.0 / soak.press_every_s : 1.0);
+    std::uniform_int_distribution<uint32_t> press_hold_ms(50, 3000);
+    uint64_t press_start_us = soak.press_every_s > 0 ? host::clock_us + (uint64_t) (press_gap(rng) * 1e6) : UINT64_MAX;
+    uint64_t press_end_us = 0;
+    uint8_t press_pin = LEFT_TOUCH_PIN;
+
+    auto wall_start = std::chrono::steady_clock::now();
+    setup();
+
+    uint8_t last_idx = christmas_patterns_idx;
+    uint64_t last_switch_us = host::clock_us;
+    uint32_t last_writes = ghostSettings.write_qty();
+    uint64_t last_write_us = 0;
+    uint32_t last_hash = 0;
+    uint64_t static_since_us = host::clock_us;
+
+    while (host::clock_us < end_us) {
+        /* Scripted hand presses */
+        if (host::clock_us >= press_start_us) {
+            press_pin = (rng() & 1) ? LEFT_TOUCH_PIN : RIGHT_TOUCH_PIN;
+            press_end_us = press_start_us + (uint64_t) press_hold_ms(rng) * 1000;
+            press_start_us = press_end_us + (uint64_t) (press_gap(rng) * 1e6);
+            presses++;
+        }
+        host::pin_state[LEFT_TOUCH_PIN] = host::pin_state[RIGHT_TOUCH_PIN] = LOW;
+        if (host::clock_us < press_end_us) {host::pin_state[press_pin] = HIGH;}
+
+        uint64_t shows_before = shows;
+        uint64_t next_us = host::clock_us + step_us;
+        loop();
+        loops++;
+        if (host::clock_us < next_us) {host::clock_us = next_us;}
+
+        /* Invariant: one frame per loop iteration */
+        if (shows != shows_before + 1) {fail("loop() did not push exactly one frame", host::clock_us);}
+
+        /* Invariant: the pattern index is valid, and the pattern can run */
+        if (christmas_patterns_idx >= ARRAY_SIZE(christmas_patterns)) {fail("pattern index out of range", host::clock_us);}
+        if (!pattern_available(christmas_patterns_idx)) {fail("switched to a pattern that can't run", host::clock_us);}
+
+        /* Invariant: patterns keep cycling - a switch is never late (presses only make them earlier) */
+        bool switched = christmas_patterns_idx != last_idx;
+        if (switched) {
+            last_idx = christmas_patterns_idx;
+            last_switch_us = host::clock_us;
+            pattern_switches++;
+        } else if ((host::clock_us - last_switch_us) > ((uint64_t) ghostSettings.pattern_duration() + 1) * 1000000) {
+            fail("pattern cycling stalled", host::clock_us);
+        }
+
+        /* Invariant: flash writes never come faster than the write-behind rate limit (less 1 ms for the resolution of millis()) */
+        if (ghostSettings.write_qty() != last_writes) {
+            if (last_write_us && (host::clock_us - last_write_us) < (uint64_t) (SETTINGS_MIN_WRITE_MS - 1) * 1000) {fail("settings written faster than SETTINGS_MIN_WRITE_MS", host::clock_us);}
+            last_writes = ghostSettings.write_qty();
+            last_write_us = host::clock_us;
+        }
+
+        /* Not an invariant (some patterns hold still on purpose) - track the longest frozen stretch per pattern */
+        uint32_t hash = lightTools.frame_hash(LED_ARR, LED_ARR_QTY);
+        if (hash != last_hash || switched) {static_since_us = host::clock_us; last_hash = hash;}
+        uint32_t static_ms = (host::clock_us - static_since_us) / 1000;
+        if (static_ms > longest_static_ms[christmas_patterns_idx]) {longest_static_ms[christmas_patterns_idx] = static_ms;}
+
+        if (host::clock_us >= next_report_us) {
+            next_report_us += 86400000000ULL;
+            fprintf(stderr, "day %.0f: %llu frames, %llu pattern switches, %llu presses, %u settings writes, millis() = %lu\n",
+                    (host::clock_us - soak.start_ms * 1000) / 86400e6, (unsigned long long) shows, (unsigned long long) pattern_switches,
+                    (unsigned long long) presses, ghostSettings.write_qty(), millis());
+        }
+    }
+
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    double sim_s = (host::clock_us - soak.start_ms * 1000) / 1e6;
+    printf("soaked %.2f days (%llu loops, %llu pattern switches, %llu presses, %u settings writes) in %.1f s - %.0fx real time\n",
+           sim_s / 86400, (unsigned long long) loops, (unsigned long long) pattern_switches, (unsigned long long) presses,
+           ghostSettings.write_qty(), wall_s, sim_s / wall_s);
+    printf("longest frozen stretch per pattern index:");
+    for (uint8_t idx = 0; idx < ARRAY_SIZE(christmas_patterns); idx++) {printf(" [%u] %.1fs", idx, longest_static_ms[idx] / 1000.0);}
+    printf("\nall invariants held\n");
+
+    return 0;
+}
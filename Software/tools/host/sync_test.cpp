@@ -0,0 +1,279 @@
+/*
+    sync_test.cpp - host tool
+    Runs several ghosts' sync (lib/ghostSync) as separate processes talking over loopback UDP,
+    and measures how closely their time bases / patterns match.
+
+    Every node has its own local clock - the wall clock with a random offset (up to --offset ms)
+    and a random crystal error (up to --drift ppm) - and logs its shared time base, role and
+    pattern index every few ms.  The leader moves to the next pattern every 3 seconds.
+    Afterwards every follower's time base is compared against the leader's at the same wall
+    clock time:
+        - sync error (p50 / p95 / max, once the first leader was elected)
+        - identical frames: a time based frame (beatsin dots) rendered from both time bases
+        - pattern agreement with the leader
+        - the time base is only stepped while the first leader is elected (first contact - or two
+          leaders meeting, if a packet was lost), and otherwise never runs backwards, or more than
+          SYNC_SLEW_PPM (+ the clock error) off real time
+
+    Usage (built by 'build_host.sh'):
+        sync_test [--nodes N] [--seconds S] [--loss PCT] [--drift PPM] [--offset MS] [--kill-leader S] [--port P] [--seed N]
+
+    --kill-leader stops the leader after S seconds - the remaining nodes must elect a new leader
+    without their time bases jumping.  The exit code is 1 if a check fails.
+*/
+
+#include "host_libs.h"
+#include "host_sync.h"
+#include <algorithm>
+#include <sys/wait.h>
+#include <time.h>
+#include <vector>
+
+#define NODE_ID_BASE 0x47680000UL       //Node ids - node 0 has the lowest id (and the shortest leader timeout), so it's expected to lead
+#define SAMPLE_US 2000                  //Time between two log samples of a node
+#define ELECTION_US ((2 * SYNC_LEADER_TIMEOUT_MS + 1024) * 1000LL)    //Time base steps are only expected while the first leader is elected
+#define RATE_WINDOW_US 100000          //Time base rate is checked over this window
+#define PATTERN_MS 3000                 //Leader moves to the next pattern this often
+#define PATTERN_QTY 7
+#define FRAME_LEDS 100
+#define MAX_P95_US 1000                 //Checks on the sync error
+#define MAX_ERROR_US 5000
+
+/* One log sample of a node */
+struct syncSample {
+    int64_t real_us;                    //Wall clock (shared by all nodes)
+    uint64_t synced_us;                 //Node's shared time base
+    uint8_t leading;
+    uint8_t following;
+    uint8_t pattern_idx;                //Pattern shown (own pattern while leading, the leader's while following)
+    uint8_t step_qty;
+};
+
+struct syncOptions {
+    uint8_t nodes = 4;
+    double seconds = 20;
+    uint8_t loss_pct = 0;
+    double drift_ppm = 100;
+    double offset_ms = 5000;
+    double kill_leader_s = 0;
+    uint16_t port = 47210;
+    uint32_t seed = 1;
+} opt;
+
+/* FastLED's timing helpers run on the time base being rendered */
+uint32_t render_ms = 0;
+uint32_t get_millisecond_timer() {return render_ms;}
+
+int64_t wall_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Time based frame - a few dots swinging at different rates */
+uint32_t frame_hash(uint32_t ms) {
+    CRGB leds[FRAME_LEDS];
+    render_ms = ms;
+    fill_solid(leds, FRAME_LEDS, CRGB::Black);
+    for (uint8_t dot = 0; dot < 4; dot++) {leds[beatsin16(11 + 7 * dot, 0, FRAME_LEDS - 1)] += CHSV(dot * 64, 255, 255);}
+
+    uint32_t hash = 2166136261UL;
+    const uint8_t *bytes = (const uint8_t *) leds;
+    for (size_t i = 0; i < sizeof(leds); i++) {hash = (hash ^ bytes[i]) * 16777619UL;}
+    return hash;
+}
+
+/* Simulated ghost - runs the sync on its own (offset / drifting) clock, and logs it */
+void run_node(uint8_t idx, int64_t epoch_us, FILE *log) {
+    host::serial_out = NULL;
+
+    uint32_t seed = opt.seed * 2654435761UL + idx * 40503UL;
+    auto rand_unit = [&seed]() {seed = seed * 1103515245 + 12345; return ((seed >> 8) % 20001) / 10000.0 - 1;};
+    double drift = opt.drift_ppm * rand_unit() / 1e6;
+    uint64_t offset_us = (uint64_t) ((opt.offset_ms * 2 + opt.offset_ms * rand_unit()) * 1000) + 1000000;
+
+    hostUdpSyncTransport transport;
+    if (!transport.open(opt.port, idx, opt.nodes, opt.loss_pct, seed)) {
+        fprintf(stderr, "node %u: unable to bind port %u\n", idx, opt.port + idx);
+        _exit(2);
+    }
+
+    auto update_clock = [&]() {
+        int64_t real_us = wall_us() - epoch_us;
+        host::clock_us = offset_us + (int64_t) (real_us * (1 + drift));
+        return real_us;
+    };
+
+    int64_t end_us = (int64_t) (opt.seconds * 1e6);
+    if (idx == 0 && opt.kill_leader_s > 0) {end_us = (int64_t) (opt.kill_leader_s * 1e6);}
+
+    update_clock();
+    ghostSync::begin(&transport, NODE_ID_BASE + idx);
+
+    int64_t next_sample_us = 0;
+    for (int64_t real_us = update_clock(); real_us < end_us; real_us = update_clock()) {
+        uint8_t own_pattern_idx = (ghostSync::millis() / PATTERN_MS) % PATTERN_QTY;
+        ghostSync::set_pattern_idx(own_pattern_idx);
+        ghostSync::loop();
+        uint8_t pattern_idx = ghostSync::leading() ? own_pattern_idx : ghostSync::pattern_idx();
+
+        if (real_us >= next_sample_us) {
+            syncSample sample = {real_us, ghostSync::micros64(), ghostSync::leading(), ghostSync::following(), pattern_idx, (uint8_t) ghostSync::step_qty()};
+            fwrite(&sample, sizeof(sample), 1, log);
+            next_sample_us = real_us + SAMPLE_US;
+        }
+
+        transport.wait(500);
+    }
+
+    fflush(log);
+    transport.close();
+    _exit(0);
+}
+
+/* Value at real time t, interpolated between two samples of the leader (false if it wasn't leading around t) */
+bool leader_at(const std::vector<syncSample> &log, int64_t t, double *synced_us, uint8_t *pattern_idx) {
+    auto after = std::lower_bound(log.begin(), log.end(), t, [](const syncSample &s, int64_t t) {return s.real_us < t;});
+    if (after == log.begin() || after == log.end()) {return false;}
+    auto before = after - 1;
+    if (!before->leading || !after->leading) {return false;}
+
+    double frac = (double) (t - before->real_us) / (after->real_us - before->real_us);
+    *synced_us = before->synced_us + frac * ((double) after->synced_us - before->synced_us);
+    *pattern_idx = before->pattern_idx;
+    return true;
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [--nodes N] [--seconds S] [--loss PCT] [--drift PPM] [--offset MS] [--kill-leader S] [--port P] [--seed N]\n", exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--nodes") && has_value) {int nodes = atoi(argv[++arg]); opt.nodes = constrain(nodes, 2, 32);}
+        else if (!strcmp(argv[arg], "--seconds") && has_value) {opt.seconds = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--loss") && has_value) {int loss = atoi(argv[++arg]); opt.loss_pct = constrain(loss, 0, 100);}
+        else if (!strcmp(argv[arg], "--drift") && has_value) {opt.drift_ppm = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--offset") && has_value) {opt.offset_ms = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--kill-leader") && has_value) {opt.kill_leader_s = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--port") && has_value) {opt.port = atoi(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--seed") && has_value) {opt.seed = strtoul(argv[++arg], NULL, 0);}
+        else {return usage(argv[0]);}
+    }
+
+    /* Start every node on the same wall clock epoch */
+    int64_t epoch_us = wall_us() + 100000;
+    std::vector<FILE *> logs;
+    std::vector<pid_t> pids;
+    for (uint8_t idx = 0; idx < opt.nodes; idx++) {
+        logs.push_back(tmpfile());
+        fflush(NULL);
+        pid_t pid = fork();
+        if (pid == 0) {run_node(idx, epoch_us, logs[idx]);}
+        pids.push_back(pid);
+    }
+
+    bool pass = true;
+    for (pid_t pid : pids) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) {pass = false;}
+    }
+    if (!pass) {printf("FAIL: a node didn't run\n"); return 1;}
+
+    std::vector<std::vector<syncSample>> samples(opt.nodes);
+    for (uint8_t idx = 0; idx < opt.nodes; idx++) {
+        rewind(logs[idx]);
+        syncSample sample;
+        while (fread(&sample, sizeof(sample), 1, logs[idx]) == 1) {samples[idx].push_back(sample);}
+        fclose(logs[idx]);
+    }
+
+    printf("%u nodes, %.0f s, loss %u%%, drift +-%.0f ppm, offset +-%.0f ms%s\n", opt.nodes, opt.seconds, opt.loss_pct, opt.drift_ppm, opt.offset_ms,
+           opt.kill_leader_s > 0 ? (" (leader stopped at " + String(opt.kill_leader_s, 1) + " s)").c_str() : "");
+
+    /* Every node on its own - monotonic, rate bounded, stepped at most once */
+    double max_rate = 1 + (SYNC_SLEW_PPM + SYNC_MAX_RATE_PPM + 2 * opt.drift_ppm) / 1e6;
+    for (uint8_t idx = 0; idx < opt.nodes; idx++) {
+        const std::vector<syncSample> &log = samples[idx];
+        uint32_t backwards = 0, rate_errors = 0, late_steps = 0;
+        size_t anchor = 0;
+        for (size_t i = 1; i < log.size(); i++) {
+            if (log[i].step_qty != log[i - 1].step_qty) {
+                late_steps += log[i].real_us > ELECTION_US;
+                anchor = i;
+                continue;
+            }
+            if (log[i].synced_us < log[i - 1].synced_us) {backwards++;}
+
+            /* Rate over RATE_WINDOW_US (shorter windows are dominated by the 1us resolution) */
+            if (log[i].real_us - log[anchor].real_us < RATE_WINDOW_US) {continue;}
+            double rate = ((double) log[i].synced_us - log[anchor].synced_us) / (log[i].real_us - log[anchor].real_us);
+            if (rate > max_rate || rate < 2 - max_rate) {rate_errors++;}
+            anchor = i;
+        }
+        uint8_t steps = log.empty() ? 0 : log.back().step_qty;
+        bool ok = !backwards && !rate_errors && !late_steps && !log.empty();
+        printf("node %u: %s, %zu samples, %u steps (%u after the election), %u backwards, %u rate errors%s\n", idx,
+               log.empty() ? "no samples" : (log.back().leading ? "leader" : (log.back().following ? "follower" : "alone")),
+               log.size(), steps, late_steps, backwards, rate_errors, ok ? "" : "  <-- FAIL");
+        pass &= ok;
+    }
+
+    /* Followers against the leader of the moment */
+    std::vector<double> errors;
+    uint32_t frames = 0, frames_same = 0, patterns = 0, patterns_same = 0;
+    double first_sync_s = 0;
+    uint8_t synced_qty = 0;
+    for (uint8_t idx = 0; idx < opt.nodes; idx++) {
+        bool synced = false;
+        for (const syncSample &sample : samples[idx]) {
+            if (!sample.following) {continue;}
+
+            double leader_us = 0;
+            uint8_t leader_pattern = 0;
+            bool found = false;
+            for (uint8_t leader = 0; leader < opt.nodes && !found; leader++) {
+                if (leader != idx) {found = leader_at(samples[leader], sample.real_us, &leader_us, &leader_pattern);}
+            }
+            if (!found) {continue;}
+
+            double error = sample.synced_us - leader_us;
+            if (!synced) {
+                if (fabs(error) > MAX_ERROR_US) {continue;}
+                synced = true;
+                synced_qty++;
+                first_sync_s = std::max(first_sync_s, sample.real_us / 1e6);
+            }
+            if (sample.real_us <= ELECTION_US) {continue;}
+            errors.push_back(fabs(error));
+
+            frames++;
+            frames_same += frame_hash(sample.synced_us / 1000) == frame_hash((uint64_t) leader_us / 1000);
+
+            /* The leader's pattern reaches the followers with its next packet */
+            uint32_t in_pattern_ms = (uint64_t) (leader_us / 1000) % PATTERN_MS;
+            if (in_pattern_ms > SYNC_INTERVAL_MS * 2) {
+                patterns++;
+                patterns_same += sample.pattern_idx == leader_pattern;
+            }
+        }
+    }
+
+    if (synced_qty < opt.nodes - 1) {
+        printf("FAIL: only %u of %u followers synced\n", synced_qty, opt.nodes - 1);
+        return 1;
+    }
+    std::sort(errors.begin(), errors.end());
+    double p50 = errors[errors.size() / 2], p95 = errors[errors.size() * 95 / 100], max = errors.back();
+    printf("all followers synced after %.2f s\n", first_sync_s);
+    printf("sync error: p50 %.0f us, p95 %.0f us, max %.0f us (%zu samples)\n", p50, p95, max, errors.size());
+    printf("identical frames: %.2f%% (%u samples)\n", 100.0 * frames_same / frames, frames);
+    printf("pattern matches the leader: %.2f%% (%u samples)\n", 100.0 * patterns_same / (patterns ? patterns : 1), patterns);
+
+    pass &= p95 <= MAX_P95_US && max <= MAX_ERROR_US && patterns_same * 100ULL >= patterns * (99ULL - opt.loss_pct);
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
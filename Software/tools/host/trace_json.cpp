@@ -0,0 +1,484 @@
+/*
+    trace_json.cpp - host tool
+    Turns the records of lib/frameTrace ("trace dump" on the ghost's console, from a build with
+    -DFRAME_TRACE) into Chrome trace-event JSON - open it in chrome://tracing or ui.perfetto.dev
+    to see the spans of every core on a timeline (one track per core), with the pattern switches /
+    WiFi events marked across them.
+
+    Usage (built by 'build_host.sh'):
+        trace_json [options] <console log | ->      a log holding a dump (the other lines are ignored)
+        trace_json [options] --port DEV              trace the ghost over its serial port ("trace start", wait, "trace dump")
+            -o FILE             write the JSON to FILE (default stdout)
+            --baud N            with --port: serial port speed (default 115200)
+            --seconds S         with --port: time to trace (default 1 - the ghost keeps the last TRACE_RECORD_QTY records
+                                of each core), or with --trigger: the longest wait for the trigger (default 120)
+            --trigger NAME      with --port: freeze the trace around the first marker NAME (e.g. pattern, wifi)
+            --save FILE         with --port: save the dump, to convert it again later
+        trace_json --selftest   trace known spans on the virtual clock (ring wrap, micros() wrap, trigger) and the
+                                real ghost around a pattern switch, and check the JSON holds them
+
+    Examples:
+        trace_json --port /dev/ttyUSB0 -o ghost.json
+        trace_json --port /dev/ttyUSB0 --trigger pattern --seconds 90 -o switch.json
+        trace_json console.log > ghost.json
+
+    Timestamps are in microseconds from the oldest record.  A span cut by the start of a ring
+    (its begin was overwritten) is dropped, a span still open at the dump is closed at the last
+    record of its core.  The exit code is 1 if the self test failed.
+*/
+
+#include "host_ghost.h"
+#include "host_serial.h"
+#include <algorithm>
+#include <errno.h>
+#include <map>
+#include <poll.h>
+#include <string>
+#include <vector>
+
+/* A dump of lib/frameTrace */
+struct traceEntry {
+    uint8_t core;
+    uint32_t time_us;
+    char phase;
+    uint16_t arg;
+    std::string name;
+};
+
+struct traceDump {
+    bool found = false;
+    uint32_t cores = 0;
+    uint32_t now_us = 0;
+    uint32_t total = 0;
+    std::string trigger;
+    std::vector<traceEntry> entries;
+
+    /* Parse one line of a console log - returns true once it was the status line ending a dump */
+    bool parse_line(const std::string &line) {
+        unsigned core_qty = 0, now = 0, records = 0, total_qty = 0;
+        char trigger_name[64] = "";
+        if (sscanf(line.c_str(), "# trace cores=%u now_us=%u records=%u total=%u trigger=%63s", &core_qty, &now, &records, &total_qty, trigger_name) == 5) {
+            found = true;
+            cores = core_qty;
+            now_us = now;
+            total = total_qty;
+            trigger = strcmp(trigger_name, "-") ? trigger_name : "";
+            entries.clear();
+            return false;
+        }
+
+        unsigned core = 0, time_us = 0, arg = 0;
+        char phase = 0, name[128] = "", rest = 0;
+        if (found && sscanf(line.c_str(), "%u %u %c %u %127s%c", &core, &time_us, &phase, &arg, name, &rest) == 5 &&
+            (phase == 'B' || phase == 'E' || phase == 'i')) {
+            entries.push_back({(uint8_t) core, time_us, phase, (uint16_t) arg, name});
+            return false;
+        }
+        return found && line.find("\"triggered\"") != std::string::npos;
+    }
+};
+
+/* An event of the Chrome trace (ts in us from the oldest record) */
+struct chromeEvent {
+    std::string name;
+    char phase;
+    uint64_t ts;
+    uint8_t core;
+    int32_t arg;                                //-1: none
+};
+
+struct convertStats {
+    uint32_t spans = 0;
+    uint32_t instants = 0;
+    uint32_t cut = 0;                           //Ends whose begin was overwritten
+    uint32_t unfinished = 0;                    //Begins still open at the dump
+};
+
+/* Match the begin / end records of every core into balanced spans */
+std::vector<chromeEvent> convert(const traceDump &dump, convertStats &stats) {
+    /* micros() wraps every ~71 minutes - the age of a record (against the time of the dump) doesn't */
+    uint32_t max_age = 0;
+    for (const traceEntry &entry : dump.entries) {max_age = std::max(max_age, dump.now_us - entry.time_us);}
+
+    std::vector<chromeEvent> events;
+    for (uint32_t core = 0; core < std::max(dump.cores, 1u); core++) {
+        std::vector<chromeEvent> core_events;
+        for (const traceEntry &entry : dump.entries) {
+            if (entry.core != core) {continue;}
+            uint64_t ts = max_age - (dump.now_us - entry.time_us);
+            core_events.push_back({entry.name, entry.phase, ts, entry.core, entry.phase == 'i' ? entry.arg : -1});
+        }
+
+        /* A task preempted between reading the time and claiming its slot can be a little out of order - equal times keep the ring order */
+        std::stable_sort(core_events.begin(), core_events.end(), [](const chromeEvent &a, const chromeEvent &b) {return a.ts < b.ts;});
+
+        std::vector<std::string> open;
+        for (chromeEvent &event : core_events) {
+            if (event.phase == 'B') {
+                open.push_back(event.name);
+                events.push_back(event);
+            } else if (event.phase == 'E') {
+                auto begin = std::find(open.rbegin(), open.rend(), event.name);
+                if (begin == open.rend()) {
+                    stats.cut++;
+                    continue;
+                }
+                /* Spans still open inside it end with it */
+                while (open.back() != event.name) {
+                    events.push_back({open.back(), 'E', event.ts, event.core, -1});
+                    open.pop_back();
+                    stats.unfinished++;
+                }
+                open.pop_back();
+                events.push_back(event);
+                stats.spans++;
+            } else {
+                events.push_back(event);
+                stats.instants++;
+            }
+        }
+        uint64_t last_ts = core_events.empty() ? 0 : core_events.back().ts;
+        while (!open.empty()) {
+            events.push_back({open.back(), 'E', last_ts, (uint8_t) core, -1});
+            open.pop_back();
+            stats.unfinished++;
+        }
+    }
+    return events;
+}
+
+std::string json_string(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {quoted += '\\';}
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/* Chrome trace-event JSON (the "JSON Object Format") */
+void write_json(const traceDump &dump, const std::vector<chromeEvent> &events, FILE *out) {
+    fprintf(out, "{\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ghost\"}}");
+    for (uint32_t core = 0; core < std::max(dump.cores, 1u); core++) {
+        fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"core %u\"}}", core, core);
+    }
+    for (const chromeEvent &event : events) {
+        fprintf(out, ",\n{\"name\":%s,\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u", json_string(event.name).c_str(), event.phase,
+                (unsigned long long) event.ts, event.core);
+        if (event.phase == 'i') {fprintf(out, ",\"s\":\"g\",\"args\":{\"arg\":%d}", event.arg);}
+        fputs("}", out);
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"trigger\":%s,\"records\":%u,\"total\":%u}}\n",
+            json_string(dump.trigger.empty() ? "-" : dump.trigger).c_str(), (unsigned) dump.entries.size(), (unsigned) dump.total);
+}
+
+/* Converter options */
+struct convertOptions {
+    const char *input = NULL;
+    const char *output = NULL;
+    const char *port = NULL;
+    uint32_t baud = 115200;
+    double seconds = 0;
+    const char *trigger = NULL;
+    const char *save = NULL;
+} opt;
+
+int convert_dump(const traceDump &dump) {
+    if (!dump.found) {fprintf(stderr, "no trace dump found (\"trace dump\" on the console of a ghost built with -DFRAME_TRACE)\n"); return 1;}
+
+    convertStats stats;
+    std::vector<chromeEvent> events = convert(dump, stats);
+    FILE *out = opt.output ? fopen(opt.output, "w") : stdout;
+    if (!out) {fprintf(stderr, "can't write %s\n", opt.output); return 1;}
+    write_json(dump, events, out);
+    if (out != stdout) {fclose(out);}
+
+    fprintf(stderr, "%u records (%u written since the start): %u spans, %u instants, %u cut by the ring start, %u unfinished\n",
+            (unsigned) dump.entries.size(), (unsigned) dump.total, stats.spans, stats.instants, stats.cut, stats.unfinished);
+    return 0;
+}
+
+/* Read a console log, up to the end of the last dump */
+int convert_file() {
+    FILE *in = strcmp(opt.input, "-") ? fopen(opt.input, "r") : stdin;
+    if (!in) {fprintf(stderr, "can't open %s\n", opt.input); return 1;}
+
+    traceDump dump, last;
+    char line[512];
+    while (fgets(line, sizeof(line), in)) {
+        std::string text = line;
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {text.pop_back();}
+        if (dump.parse_line(text)) {last = dump;}
+    }
+    if (in != stdin) {fclose(in);}
+    return convert_dump(last.found ? last : dump);
+}
+
+/* Read the lines the ghost sends for up to timeout_ms, until handle_line returns true - returns false on a timeout */
+template <typename lineHandler>
+bool read_lines(int fd, int timeout_ms, std::string &line, lineHandler handle_line) {
+    pollfd poll_fd = {fd, POLLIN, 0};
+    while (poll(&poll_fd, 1, timeout_ms) > 0) {
+        char buf[512];
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) {return false;}
+        for (ssize_t pos = 0; pos < len; pos++) {
+            if (buf[pos] != '\n') {
+                if (buf[pos] != '\r') {line += buf[pos];}
+                continue;
+            }
+            bool done = handle_line(line);
+            line.clear();
+            if (done) {return true;}
+        }
+    }
+    return false;
+}
+
+/* Trace the ghost over its serial port */
+int convert_port() {
+    int fd = open(opt.port, O_RDWR | O_NOCTTY);
+    if (fd < 0) {fprintf(stderr, "can't open %s: %s\n", opt.port, strerror(errno)); return 1;}
+    if (!host::serial_set_baud(fd, opt.baud)) {fprintf(stderr, "can't set %s to %u baud\n", opt.port, opt.baud); return 1;}
+    tcflush(fd, TCIFLUSH);
+
+    std::string line;
+    bool started = false;
+    host::serial_command(fd, opt.trigger ? std::string("trace start ") + opt.trigger : "trace start");
+    read_lines(fd, 2000, line, [&](const std::string &text) {
+        if (text.find("\"triggered\"") != std::string::npos) {started = true;}
+        return text.find("\"status\"") != std::string::npos;
+    });
+    if (!started) {fprintf(stderr, "the ghost didn't start tracing (is it a -DFRAME_TRACE build?)\n"); close(fd); return 1;}
+
+    /* Without a trigger, trace for the time asked - with one, until the rings froze around it */
+    double seconds = opt.seconds ? opt.seconds : (opt.trigger ? 120 : 1);
+    if (!opt.trigger) {
+        usleep((useconds_t) (seconds * 1e6));
+    } else {
+        bool frozen = false;
+        for (double waited = 0; !frozen && waited < seconds; waited += 0.5) {
+            usleep(500000);
+            tcflush(fd, TCIFLUSH);
+            host::serial_command(fd, "trace");
+            read_lines(fd, 2000, line, [&](const std::string &text) {
+                if (text.find("\"triggered\"") == std::string::npos) {return false;}
+                frozen = text.find("\"running\":false") != std::string::npos;
+                return true;
+            });
+        }
+        if (!frozen) {fprintf(stderr, "no '%s' marker within %.0f s - dumping what was traced\n", opt.trigger, seconds);}
+    }
+    tcflush(fd, TCIFLUSH);
+    host::serial_command(fd, "trace dump");
+
+    /* Read lines until the status line after the dump (or nothing came for a while) */
+    FILE *save = opt.save ? fopen(opt.save, "w") : NULL;
+    traceDump dump;
+    bool done = read_lines(fd, 5000, line, [&](const std::string &text) {
+        if (save) {fprintf(save, "%s\n", text.c_str());}
+        return dump.parse_line(text);
+    });
+    if (save) {fclose(save);}
+    close(fd);
+    if (!done) {fprintf(stderr, "the dump didn't end (timeout) - converting what was received\n");}
+    return convert_dump(dump);
+}
+
+/* ----------------------------------- Self test ----------------------------------- */
+
+int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, "FAIL: " __VA_ARGS__); fprintf(stderr, "\n"); } } while (0)
+
+std::vector<std::string> dump_lines;
+
+/* Dump the rings into a parsed dump, the way a console log would hold them */
+traceDump take_dump() {
+    dump_lines.clear();
+    frameTrace::dump([](const char *line) {dump_lines.push_back(line);});
+
+    traceDump dump;
+    for (const std::string &line : dump_lines) {dump.parse_line(line);}
+    char status[128];
+    snprintf(status, sizeof(status), R"json({"status":"OK","running":false,"triggered":%s})json", frameTrace::triggered() ? "true" : "false");
+    CHECK(dump.parse_line(status), "the status line must end the dump");
+    return dump;
+}
+
+/* One synthetic frame on the virtual clock: led_handler (render 2000 us + show 1500 us), then button_handler (50 us) - 8 records */
+void trace_frame(uint32_t frame, uint32_t switch_every) {
+    TRACE_BEGIN("led_handler");
+    host::clock_us += 300;
+    if (switch_every && frame % switch_every == switch_every - 1) {TRACE_INSTANT("pattern", frame);}
+    TRACE_BEGIN("render");
+    host::clock_us += 2000;
+    TRACE_END("render");
+    TRACE_BEGIN("show");
+    host::clock_us += 1500;
+    TRACE_END("show");
+    TRACE_END("led_handler");
+    {
+        TRACE_SCOPE("button_handler");
+        host::clock_us += 50;
+    }
+    host::clock_us += 150;
+}
+
+/* Spans of the converted trace, by name: qty / the durations seen */
+struct spanCheck {
+    uint32_t qty = 0;
+    uint64_t min_us = UINT64_MAX;
+    uint64_t max_us = 0;
+};
+
+std::map<std::string, spanCheck> check_events(const std::vector<chromeEvent> &events, const char *label) {
+    std::map<std::string, spanCheck> spans;
+    std::vector<const chromeEvent *> open;
+    uint64_t last_ts = 0;
+    bool balanced = true;
+    for (const chromeEvent &event : events) {
+        CHECK(event.ts >= last_ts, "%s: '%s' at %llu us, after an event at %llu us", label, event.name.c_str(),
+              (unsigned long long) event.ts, (unsigned long long) last_ts);
+        last_ts = event.ts;
+        if (event.phase == 'B') {open.push_back(&event);}
+        if (event.phase == 'E') {
+            if (open.empty() || open.back()->name != event.name) {
+                balanced = false;
+                continue;
+            }
+            spanCheck &span = spans[event.name];
+            span.qty++;
+            span.min_us = std::min(span.min_us, event.ts - open.back()->ts);
+            span.max_us = std::max(span.max_us, event.ts - open.back()->ts);
+            open.pop_back();
+        }
+    }
+    CHECK(balanced && open.empty(), "%s: the spans must nest (%u left open)", label, (unsigned) open.size());
+    return spans;
+}
+
+void selftest_synthetic(uint32_t frames, uint64_t start_us, const char *label) {
+    host::clock_us = start_us;
+    CHECK(frameTrace::begin(), "%s: tracing must start", label);
+    for (uint32_t frame = 0; frame < frames; frame++) {trace_frame(frame, 0);}
+    traceDump dump = take_dump();
+
+    uint32_t total = frames * 8;
+    uint32_t kept = std::min(total, (uint32_t) TRACE_RECORD_QTY);
+    CHECK(dump.found && dump.total == total && dump.entries.size() == kept, "%s: %u of %u records dumped (%u expected)",
+          label, (unsigned) dump.entries.size(), (unsigned) dump.total, kept);
+
+    convertStats stats;
+    std::vector<chromeEvent> events = convert(dump, stats);
+    auto spans = check_events(events, label);
+    uint32_t render = spans["render"].qty;
+    CHECK(render >= kept / 8 - 1 && render <= kept / 8, "%s: %u render spans in %u records", label, render, kept);
+    CHECK(spans["render"].min_us == 2000 && spans["render"].max_us == 2000, "%s: render spans %llu..%llu us (2000 expected)", label,
+          (unsigned long long) spans["render"].min_us, (unsigned long long) spans["render"].max_us);
+    CHECK(spans["show"].min_us == 1500 && spans["show"].max_us == 1500, "%s: show spans %llu..%llu us (1500 expected)", label,
+          (unsigned long long) spans["show"].min_us, (unsigned long long) spans["show"].max_us);
+    CHECK(spans["led_handler"].min_us == 3800 && spans["button_handler"].min_us == 50, "%s: led_handler %llu us (3800 expected), button_handler %llu us (50 expected)",
+          label, (unsigned long long) spans["led_handler"].min_us, (unsigned long long) spans["button_handler"].min_us);
+    CHECK(total <= TRACE_RECORD_QTY ? !stats.cut : stats.cut <= 2, "%s: %u spans cut by the ring start", label, stats.cut);
+    printf("%s: %u frames, %u of %u records kept - %u spans (render %u), %u cut by the ring start\n",
+           label, frames, kept, total, stats.spans, render, stats.cut);
+}
+
+void selftest_trigger() {
+    /* A pattern switch every 100 frames - the rings freeze half a ring after the first one */
+    host::clock_us = 0;
+    frameTrace::begin("pattern");
+    for (uint32_t frame = 0; frame < 1000; frame++) {trace_frame(frame, 100);}
+    CHECK(frameTrace::triggered() && !frameTrace::running(), "trigger: the rings must freeze after the trigger");
+    traceDump dump = take_dump();
+
+    uint32_t instants = 0;
+    size_t trigger_pos = 0;
+    for (size_t idx = 0; idx < dump.entries.size(); idx++) {
+        if (dump.entries[idx].phase == 'i') {
+            instants++;
+            trigger_pos = idx;
+        }
+    }
+    size_t after = dump.entries.size() - trigger_pos - 1;
+    CHECK(instants == 1 && dump.entries[trigger_pos].arg == 99, "trigger: %u pattern markers (1 expected, at frame 99)", instants);
+    CHECK(after == TRACE_RECORD_QTY / 2, "trigger: %u records after the trigger (%u expected)", (unsigned) after, TRACE_RECORD_QTY / 2);
+    printf("trigger: frozen %u records after the first pattern switch, %u before it\n", (unsigned) after, (unsigned) trigger_pos);
+}
+
+void selftest_ghost() {
+    /* The real ghost, from boot to its first pattern switch (PATTERN_DURATION) - frozen around it */
+    host::clock_us = 0;
+    host::serial_out = NULL;
+    setup();
+    frameTrace::begin("pattern");
+    while (frameTrace::running() && host::clock_us < (PATTERN_DURATION + 5) * 1000000ULL) {
+        uint64_t next_us = host::clock_us + 1000000 / 60;
+        loop();
+        if (host::clock_us < next_us) {host::clock_us = next_us;}
+    }
+    CHECK(frameTrace::triggered(), "ghost: no pattern switch within %u s", PATTERN_DURATION + 5);
+    traceDump dump = take_dump();
+
+    convertStats stats;
+    std::vector<chromeEvent> events = convert(dump, stats);
+    auto spans = check_events(events, "ghost");
+    const char *names[] = {"led_handler", "render", "show", "button_handler", "ghostApi.loop"};
+    for (const char *name : names) {CHECK(spans[name].qty > 50, "ghost: %u '%s' spans", spans[name].qty, name);}
+    CHECK(stats.instants == 1, "ghost: %u pattern markers (1 expected)", stats.instants);
+
+    /* render / show run inside led_handler */
+    uint32_t depth = 0, nested = 0;
+    for (const chromeEvent &event : events) {
+        if (event.name == "led_handler" && event.phase != 'i') {depth = (event.phase == 'B');}
+        if (event.name == "render" && event.phase == 'B') {nested += depth;}
+    }
+    CHECK(nested == spans["render"].qty, "ghost: %u of %u render spans inside led_handler", nested, spans["render"].qty);
+
+    FILE *out = tmpfile();
+    write_json(dump, events, out);
+    long json_len = ftell(out);
+    fclose(out);
+    printf("ghost: %u records around the switch to pattern %u at %.1f s - %u spans, %ld bytes of JSON\n",
+           (unsigned) dump.entries.size(), christmas_patterns_idx, host::clock_us / 1e6, stats.spans, json_len);
+}
+
+int selftest() {
+    selftest_synthetic(100, 0, "synthetic");
+    selftest_synthetic(1000, 0, "ring wrap");
+    selftest_synthetic(300, 0x100000000ULL - 500000, "micros() wrap");
+    selftest_trigger();
+    selftest_ghost();
+
+    printf(failures ? "FAIL: %d check(s) failed\n" : "PASS\n", failures);
+    return failures ? 1 : 0;
+}
+
+int usage(const char *exe) {
+    fprintf(stderr, "usage: %s [-o FILE] <console log | ->\n"
+                    "       %s [-o FILE] --port DEV [--baud N] [--seconds S] [--trigger NAME] [--save FILE]\n"
+                    "       %s --selftest\n", exe, exe, exe);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    bool run_selftest = false;
+    for (int arg = 1; arg < argc; arg++) {
+        bool has_value = arg + 1 < argc;
+        if (!strcmp(argv[arg], "--selftest")) {run_selftest = true;}
+        else if (!strcmp(argv[arg], "-o") && has_value) {opt.output = argv[++arg];}
+        else if (!strcmp(argv[arg], "--port") && has_value) {opt.port = argv[++arg];}
+        else if (!strcmp(argv[arg], "--baud") && has_value) {opt.baud = atol(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--seconds") && has_value) {opt.seconds = atof(argv[++arg]);}
+        else if (!strcmp(argv[arg], "--trigger") && has_value) {opt.trigger = argv[++arg];}
+        else if (!strcmp(argv[arg], "--save") && has_value) {opt.save = argv[++arg];}
+        else if (argv[arg][0] != '-' || !strcmp(argv[arg], "-")) {opt.input = argv[arg];}
+        else {return usage(argv[0]);}
+    }
+
+    if (run_selftest) {return selftest();}
+    if (opt.port) {return convert_port();}
+    if (!opt.input) {return usage(argv[0]);}
+    return convert_file();
+}
@@ -29,7 +29,7 @@
 
 /* Initialize static class variables defined in the header file */
 lightTools *[CLASS_NAME]::_lightTools = NULL;
-CRGB *[CLASS_NAME]::_led_arr = NULL;
+ledSpan [CLASS_NAME]::_led_arr;
 uint16_t [CLASS_NAME]::_led_qty = 0;
 uint16_t [CLASS_NAME]::_led_midpoint = 0;
 
@@ -39,7 +39,7 @@ uint16_t [CLASS_NAME]::_led_midpoint = 0;
     _lightTools = lightTools;
 
     /* update the class-bound pointers / variables */
-    _led_arr = led_arr;
+    _led_arr = ledSpan(led_arr, led_qty);
     _led_qty = led_qty;
 
     /* calculate the midpoint */
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+    lsasm.py - light script assembler
+
+    Converts a light script written in text form (see 'examples/') into the bytecode
+    container understood by lib/lightScript.  The result is printed as a hex string,
+    ready to be uploaded to the ghost with the 'script load <hex>' console command, or
+    written as a binary file with '-o'.
+
+    Syntax:
+        ; comment
+        label:
+        OPCODE operand, operand ...
+
+        Registers are written r0..r15, colors c0..c7, timers t0..t7.  Numbers may be
+        decimal or 0x-prefixed hex.  The RGB instruction takes a #RRGGBB color, and all
+        jumps (including EVERY) take a label.  See lib/lightScript/src/lightScript.h for
+        the full instruction set.
+
+    Usage:
+        python lsasm.py examples/jacobs_ladder.lsa
+        python lsasm.py examples/jacobs_ladder.lsa -o jacobs_ladder.lsb
+"""
+
+import argparse
+import struct
+import sys
+
+LSCRIPT_VERSION = 1
+LSCRIPT_MAX_CODE_LEN = 512
+
+# opcode, operand kinds ('r' register, 'c' color, 't' timer, 'b' byte, 'w' 16b word, 'x' #RRGGBB, 'l' label)
+OPCODES = {
+    'END':     (0x00, ''),
+    'FILL':    (0x01, 'c'),
+    'SPAN':    (0x02, 'crr'),
+    'BLEND':   (0x03, 'crrr'),
+    'FADE':    (0x04, 'r'),
+    'PIXEL':   (0x05, 'cr'),
+    'ADDPIX':  (0x06, 'cr'),
+    'PAT':     (0x07, 'cbbrr'),
+    'RGB':     (0x10, 'cx'),
+    'HSV':     (0x11, 'crrr'),
+    'LDI':     (0x20, 'rw'),
+    'MOV':     (0x21, 'rr'),
+    'ADD':     (0x22, 'rrr'),
+    'SUB':     (0x23, 'rrr'),
+    'MOD':     (0x24, 'rrr'),
+    'ADDI':    (0x25, 'rw'),
+    'QTY':     (0x26, 'r'),
+    'TIME':    (0x30, 'rb'),
+    'BEATSIN': (0x31, 'rrrr'),
+    'EVERY':   (0x32, 'twl'),
+    'JMP':     (0x40, 'l'),
+    'JZ':      (0x41, 'rl'),
+    'JNZ':     (0x42, 'rl'),
+    'JLT':     (0x43, 'rrl'),
+}
+
+OPERAND_SIZE = {'r': 1, 'c': 1, 't': 1, 'b': 1, 'w': 2, 'x': 3, 'l': 2}
+OPERAND_LIMIT = {'r': 16, 'c': 8, 't': 8}
+
+
+class AsmError(Exception):
+    pass
+
+
+def parse_number(text):
+    try:
+        return int(text, 0)
+    except ValueError:
+        raise AsmError("invalid number '%s'" % text)
+
+
+def parse_indexed(text, prefix, limit):
+    if not text.lower().startswith(prefix):
+        raise AsmError("expected '%s<n>', got '%s'" % (prefix, text))
+    value = parse_number(text[1:])
+    if not 0 <= value < limit:
+        raise AsmError("'%s' is out of range (max %s%d)" % (text, prefix, limit - 1))
+    return value
+
+
+def tokenize(source):
+    """Yield (line_number, label, opcode, operands) for every meaningful line"""
+    for line_number, line in enumerate(source.splitlines(), 1):
+        line = line.split(';', 1)[0].strip()
+        label = None
+        if ':' in line:
+            label, line = line.split(':', 1)
+            label, line = label.strip(), line.strip()
+        if not line:
+            if label:
+                yield line_number, label, None, []
+            continue
+        parts = line.split(None, 1)
+        operands = [o.strip() for o in parts[1].split(',')] if len(parts) > 1 else []
+        yield line_number, label, parts[0].upper(), operands
+
+
+def assemble(source):
+    lines = list(tokenize(source))
+
+    # First pass - find the address of every label
+    labels = {}
+    pc = 0
+    for line_number, label, opcode, operands in lines:
+        if label:
+            if label in labels:
+                raise AsmError("line %d: duplicate label '%s'" % (line_number, label))
+            labels[label] = pc
+        if opcode:
+            if opcode not in OPCODES:
+                raise AsmError("line %d: unknown instruction '%s'" % (line_number, opcode))
+            pc += 1 + sum(OPERAND_SIZE[k] for k in OPCODES[opcode][1])
+
+    # Second pass - emit the code
+    code = bytearray()
+    for line_number, label, opcode, operands in lines:
+        if not opcode:
+            continue
+        op, kinds = OPCODES[opcode]
+        if len(operands) != len(kinds):
+            raise AsmError("line %d: %s expects %d operand(s)" % (line_number, opcode, len(kinds)))
+
+        next_pc = len(code) + 1 + sum(OPERAND_SIZE[k] for k in kinds)
+        code.append(op)
+        try:
+            for kind, text in zip(kinds, operands):
+                if kind in OPERAND_LIMIT:
+                    code.append(parse_indexed(text, kind, OPERAND_LIMIT[kind]))
+                elif kind == 'b':
+                    code.append(parse_number(text) & 0xFF)
+                elif kind == 'w':
+                    code += struct.pack('<H', parse_number(text) & 0xFFFF)
+                elif kind == 'x':
+                    if not text.startswith('#') or len(text) != 7:
+                        raise AsmError("expected a #RRGGBB color, got '%s'" % text)
+                    code += bytes.fromhex(text[1:])
+                elif kind == 'l':
+                    if text not in labels:
+                        raise AsmError("unknown label '%s'" % text)
+                    code += struct.pack('<h', labels[text] - next_pc)
+        except AsmError as e:
+            raise AsmError("line %d: %s" % (line_number, e))
+
+    if len(code) > LSCRIPT_MAX_CODE_LEN:
+        raise AsmError("script is %d bytes, the maximum is %d" % (len(code), LSCRIPT_MAX_CODE_LEN))
+
+    return b'LS' + struct.pack('<BH', LSCRIPT_VERSION, len(code)) + bytes(code)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Assemble a light script for lib/lightScript")
+    parser.add_argument('source', help="light script source file (.lsa)")
+    parser.add_argument('-o', '--output', help="write the binary container to this file instead of printing hex")
+    parser.add_argument('--c-array', action='store_true', help="print the container as a C array initializer")
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        try:
+            script = assemble(f.read())
+        except AsmError as e:
+            sys.exit("%s: %s" % (args.source, e))
+
+    if args.output:
+        with open(args.output, 'wb') as f:
+            f.write(script)
+    elif args.c_array:
+        print(', '.join('0x%02X' % b for b in script))
+    else:
+        print(script.hex().upper())
+
+
+if __name__ == '__main__':
+    main()
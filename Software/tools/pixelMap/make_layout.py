@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+    make_layout.py - layout builder for lib/pixelMap
+
+    Builds the compact ".glm" layout file read by lib/pixelMap, giving each light of the strand
+    an (x, y) position.  Positions can come from a CSV file (one "x,y" line per light, in strand
+    order, in any unit - e.g. measured off a photo of the install), or be generated for a few
+    common shapes.  The positions are scaled to fill the 0-255 layout square, keeping their
+    aspect ratio.
+
+    Usage:
+        python make_layout.py csv positions.csv -o data/layout/strand.glm
+        python make_layout.py grid 20 25 --serpentine -o data/layout/strand.glm
+        python make_layout.py ring 100 -o data/layout/strand.glm
+        python make_layout.py wreath 100 --turns 4 -o data/layout/strand.glm
+        python make_layout.py --preview data/layout/strand.glm
+
+    Pack the layout into the asset image with 'tools/assetStore/pack_assets.py' - the ghost
+    loads it as "layout/strand.glm" (PIXEL_MAP_LAYOUT_NAME in main.cpp).
+"""
+
+import argparse
+import csv
+import math
+import struct
+import sys
+
+GLM_VERSION = 1
+HEADER_LEN = 8
+
+
+def read_csv(path):
+    """Positions from a CSV file, one "x,y" row per light (rows that aren't numbers, e.g. a header, are skipped)"""
+    positions = []
+    with open(path, newline='') as f:
+        for row in csv.reader(f):
+            try:
+                positions.append((float(row[0]), float(row[1])))
+            except (ValueError, IndexError):
+                continue
+    return positions
+
+
+def grid(width, height, serpentine):
+    """Lights in rows, top to bottom - every other row running backwards if the strand snakes"""
+    positions = []
+    for row in range(height):
+        cols = range(width)
+        if serpentine and row & 1:
+            cols = reversed(cols)
+        positions += [(col, row) for col in cols]
+    return positions
+
+
+def ring(qty):
+    """Lights around a circle, starting at the right and running counter-clockwise (y grows downwards)"""
+    return [(math.cos(2 * math.pi * i / qty), -math.sin(2 * math.pi * i / qty)) for i in range(qty)]
+
+
+def wreath(qty, turns):
+    """Lights wound around a wreath - a ring, with the strand spiralling in and out across its width"""
+    positions = []
+    for i in range(qty):
+        around = 2 * math.pi * i / qty
+        across = 0.75 + 0.25 * math.sin(2 * math.pi * turns * i / qty)
+        positions.append((across * math.cos(around), -across * math.sin(around)))
+    return positions
+
+
+def normalize(positions):
+    """Scale the positions to fill 0-255, keeping the aspect ratio (the short side is centered)"""
+    xs = [p[0] for p in positions]
+    ys = [p[1] for p in positions]
+    span = max(max(xs) - min(xs), max(ys) - min(ys)) or 1.0
+    x_pad = (span - (max(xs) - min(xs))) / 2
+    y_pad = (span - (max(ys) - min(ys))) / 2
+    return [(round((x - min(xs) + x_pad) * 255 / span), round((y - min(ys) + y_pad) * 255 / span)) for x, y in positions]
+
+
+def encode(positions):
+    """Layout file - header + <x:u8> <y:u8> per light"""
+    data = bytearray(struct.pack('<ccccHH', b'G', b'L', b'M', bytes([GLM_VERSION]), len(positions), 0))
+    for x, y in positions:
+        data += bytes([x, y])
+    return bytes(data)
+
+
+def decode(data):
+    """Positions from a layout file"""
+    if len(data) < HEADER_LEN or data[:3] != b'GLM' or data[3] != GLM_VERSION:
+        sys.exit("not a layout file (version %d)" % GLM_VERSION)
+    qty = struct.unpack_from('<H', data, 4)[0]
+    if len(data) < HEADER_LEN + 2 * qty:
+        sys.exit("layout file is truncated")
+    return [(data[HEADER_LEN + 2 * i], data[HEADER_LEN + 2 * i + 1]) for i in range(qty)]
+
+
+def preview(positions, cols=64, rows=32):
+    """Print the layout as text - each cell shows the last digit of the last light in it"""
+    canvas = [[' '] * cols for _ in range(rows)]
+    for idx, (x, y) in enumerate(positions):
+        canvas[y * rows // 256][x * cols // 256] = str(idx % 10)
+    print('\n'.join(''.join(line).rstrip() for line in canvas))
+    print("%d lights" % len(positions))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build a lib/pixelMap layout file (.glm)")
+    parser.add_argument('--preview', metavar='LAYOUT', help="print an existing layout file, and exit")
+    sub = parser.add_subparsers(dest='shape')
+    p = sub.add_parser('csv', help="positions from a CSV file (x,y per light, in strand order)")
+    p.add_argument('path')
+    p = sub.add_parser('grid', help="lights in rows, top to bottom")
+    p.add_argument('width', type=int)
+    p.add_argument('height', type=int)
+    p.add_argument('--serpentine', action='store_true', help="every other row runs backwards")
+    p = sub.add_parser('ring', help="lights around a circle")
+    p.add_argument('qty', type=int)
+    p = sub.add_parser('wreath', help="lights wound around a wreath")
+    p.add_argument('qty', type=int)
+    p.add_argument('--turns', type=int, default=4, help="times the strand crosses the wreath and back (default: 4)")
+    for p in sub.choices.values():
+        p.add_argument('-o', '--output', required=True, help="output layout file (.glm)")
+    args = parser.parse_args()
+
+    if args.preview:
+        with open(args.preview, 'rb') as f:
+            preview(decode(f.read()))
+        return
+    if not args.shape:
+        parser.error("a shape (csv / grid / ring / wreath) or --preview is required")
+
+    if args.shape == 'csv':
+        positions = read_csv(args.path)
+    elif args.shape == 'grid':
+        positions = grid(args.width, args.height, args.serpentine)
+    elif args.shape == 'ring':
+        positions = ring(args.qty)
+    else:
+        positions = wreath(args.qty, args.turns)
+    if not positions or len(positions) > 0xFFFF:
+        sys.exit("a layout needs 1 to 65535 lights (got %d)" % len(positions))
+
+    positions = normalize(positions)
+    with open(args.output, 'wb') as f:
+        f.write(encode(positions))
+    preview(positions)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+    pack_web.py - web asset packer for the provisioning pages (see include/ConfigMode.h)
+
+    Compresses every file below the 'web' folder with gzip, into 'www/<name>.gz' - the layout
+    served by serveWebAsset().  The output folder is either the LittleFS data folder (built into
+    the file system image with 'pio run -t buildfs'), or a folder packed into the 'assets'
+    partition by 'tools/assetStore/pack_assets.py' (mapped flash, served without a file read).
+
+    The output is deterministic (no timestamp / file name in the gzip header), so an unchanged
+    page keeps its ETag - the firmware's ETag is the 32b FNV-1a hash of the compressed file,
+    printed here as well.
+
+    Usage:
+        python pack_web.py                          # web -> data/www (LittleFS)
+        python pack_web.py -o temp/assets           # web -> temp/assets/www, then:
+        python ../assetStore/pack_assets.py temp/assets -o temp/assets.gas
+"""
+
+import argparse
+import gzip
+import os
+import sys
+
+SOFTWARE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..')
+DEFAULT_INPUT = os.path.join(SOFTWARE_DIR, 'web')
+DEFAULT_OUTPUT = os.path.join(SOFTWARE_DIR, 'data')
+WEB_DIR = 'www'
+NAME_LEN = 28           # Asset name limit of lib/assetStore, including the terminating NUL
+
+
+def fnv1a(data):
+    """32b FNV-1a hash (same as the firmware's ETag)"""
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def compress(data):
+    """Deterministic gzip: no mtime / file name in the header, best compression"""
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compress the provisioning pages for the ghost's web server")
+    parser.add_argument('input', nargs='?', default=DEFAULT_INPUT, help="folder holding the pages (default: web)")
+    parser.add_argument('-o', '--output', default=DEFAULT_OUTPUT, help="folder to write www/<name>.gz into (default: data)")
+    args = parser.parse_args()
+
+    out_dir = os.path.join(args.output, WEB_DIR)
+    total_raw = total_gz = 0
+    for root, _, files in sorted(os.walk(args.input)):
+        for fn in sorted(files):
+            path = os.path.join(root, fn)
+            name = os.path.relpath(path, args.input).replace(os.sep, '/')
+            asset_name = '%s/%s.gz' % (WEB_DIR, name)
+            if len(asset_name.encode('utf-8')) >= NAME_LEN:
+                sys.exit("name too long for the asset partition (max %d characters): %s" % (NAME_LEN - 1, asset_name))
+
+            with open(path, 'rb') as f:
+                raw = f.read()
+            packed = compress(raw)
+
+            out_path = os.path.join(out_dir, *asset_name.split('/')[1:])
+            os.makedirs(os.path.dirname(out_path), exist_ok=True)
+            with open(out_path, 'wb') as f:
+                f.write(packed)
+
+            total_raw += len(raw)
+            total_gz += len(packed)
+            print("%-28s %6d -> %6d bytes  ETag \"%08x\"" % (asset_name, len(raw), len(packed), fnv1a(packed)))
+
+    if not total_raw:
+        sys.exit("no files found in %s" % args.input)
+    print("total %d -> %d bytes (%.0f%%)" % (total_raw, total_gz, 100.0 * total_gz / total_raw))
+
+
+if __name__ == '__main__':
+    main()